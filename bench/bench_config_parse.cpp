@@ -0,0 +1,115 @@
+/****************************************************************************
+ * file: bench_config_parse.cpp
+ * author: luke le
+ * description:
+ *     times parse_config on synthetic topologies of growing size.
+ * usage:
+ *     bench_config_parse [nodes] [runs] [degree] [--json=results.json]
+ *         defaults: 1000, 10000 and 100000 nodes, 5 runs, degree 4
+ * notes:
+ *     the config is a ring with chords: node i links to i +- 1, i +- 7,
+ *     i +- 13, ... up to the requested (even) degree. It is written with
+ *     comments and blank lines so the comment/whitespace handling is part
+ *     of what is measured. The file is written once to /tmp and removed
+ *     afterwards; the best run is reported so page-cache warmup does not
+ *     count.
+ ****************************************************************************/
+#include "bench_json.hpp"
+#include "config.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+    /**
+     * @brief write an n-node ring-with-chords config; returns its size
+     */
+    long long write_config(const std::string &path, int n, int degree) {
+        std::ofstream out(path.c_str(), std::ios::trunc);
+        out << "# synthetic benchmark topology\n"
+            << n << " 5 10 2 100 200    # globals\n\n";
+        for (int i = 0; i < n; ++i)
+            out << i << " dc" << (i % 45 + 1) << ".utdallas.edu "
+                << (10000 + i % 50000) << "\n";
+        out << "\n# neighbors\n";
+        for (int i = 0; i < n; ++i) {
+            for (int k = 0; k < degree / 2; ++k) {
+                const int hop = 6 * k + 1;
+                out << (i + hop) % n << " " << (i + n - hop) % n << " ";
+            }
+            out << "   # node " << i << "\n";
+        }
+        out.flush();
+        return static_cast<long long>(out.tellp());
+    } // write_config()
+
+    /**
+     * @brief best parse time of one n-node config in ms; negative if it
+     *        did not parse
+     */
+    double time_parse(int n, int runs, int degree) {
+        const std::string path =
+            "/tmp/bench_config_" + std::to_string(::getpid()) + ".txt";
+        const long long bytes = write_config(path, n, degree);
+
+        using namespace std::chrono;
+        double best_ms = -1.0;
+        size_t edges = 0;
+        for (int r = 0; r < runs; ++r) {
+            Config cfg;
+            const steady_clock::time_point t0 = steady_clock::now();
+            const bool ok = parse_config(path, cfg);
+            const double ms = duration_cast<duration<double, std::milli> >(
+                                  steady_clock::now() - t0).count();
+            if (!ok || cfg.n != n) {
+                std::cerr << "[!] synthetic config did not parse\n";
+                std::remove(path.c_str());
+                return -1.0;
+            }
+            edges = 0;
+            for (int i = 0; i < cfg.n; ++i) edges += cfg.neighbors[i].size();
+            if (best_ms < 0 || ms < best_ms) best_ms = ms;
+        }
+        std::remove(path.c_str());
+
+        std::cout << "[*] parse_config: " << n << " nodes, " << edges / 2
+                  << " edges, " << bytes / 1024 << " KiB in " << best_ms
+                  << " ms (best of " << runs << ", "
+                  << (bytes / 1048576.0) / (best_ms / 1000.0) << " MiB/s)\n";
+        return best_ms;
+    } // time_parse()
+
+} // end anonymous namespace
+
+int main(int argc, char *argv[]) {
+    BenchReport report("bench_config_parse", argc, argv);
+    std::vector<int> sizes;
+    if (argc > 1) {
+        sizes.push_back(std::atoi(argv[1]));
+    } else {
+        sizes.push_back(1000);
+        sizes.push_back(10000);
+        sizes.push_back(100000);
+    }
+    const int runs = argc > 2 ? std::atoi(argv[2]) : 5;
+    const int degree = argc > 3 ? std::atoi(argv[3]) : 4;
+    if (runs < 1 || degree < 2 || sizes[0] < 6 * degree) {
+        std::cerr << "usage: " << argv[0]
+                  << " [nodes >= 6 * degree] [runs] [degree] [--json=<path>]\n";
+        return 1;
+    }
+
+    for (size_t s = 0; s < sizes.size(); ++s) {
+        const double ms = time_parse(sizes[s], runs, degree);
+        if (ms < 0) return 1;
+        report.add("parse_config/n=" + std::to_string(sizes[s]), ms, "ms");
+    }
+    return report.write() ? 0 : 1;
+}
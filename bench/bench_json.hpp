@@ -0,0 +1,87 @@
+/****************************************************************************
+ * file: bench_json.hpp
+ * author: luke le
+ * description:
+ *     machine-readable results for the benchmarks: every bench takes
+ *     --json=<path> and, besides its "[*]" lines, writes one JSON file
+ *     that bench/compare.py diffs against a baseline.
+ * usage:
+ *     BenchReport report("bench_message_codec", argc, argv);
+ *     report.add("encode/n=16", ns, "ns");
+ *     return report.write() ? 0 : 1;
+ * notes:
+ *     {"bench": "<name>", "results": [{"name": ..., "value": ...,
+ *      "unit": ...}, ...]}. Every value is a cost (time per operation, or
+ *     per round trip), so lower is better for all of them.
+ *
+ *     the constructor removes --json=... from argv, so the benches parse
+ *     their positional arguments as before.
+ ****************************************************************************/
+#ifndef BENCH_JSON_HPP
+#define BENCH_JSON_HPP
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * @class BenchReport
+ * @brief collects named results and writes them as JSON.
+ */
+class BenchReport {
+public:
+    BenchReport(const char *bench, int &argc, char *argv[]) : bench_(bench) {
+        int kept = 1;
+        for (int i = 1; i < argc; ++i) {
+            if (std::strncmp(argv[i], "--json=", 7) == 0) path_ = argv[i] + 7;
+            else argv[kept++] = argv[i];
+        }
+        argc = kept;
+    }
+
+    void add(const std::string &name, double value, const char *unit) {
+        Result r = {name, value, unit};
+        results_.push_back(r);
+    }
+
+    /**
+     * @brief write the JSON file if --json was given.
+     *
+     * @return false (with a message) if it cannot be written.
+     */
+    bool write() const {
+        if (path_.empty()) return true;
+        std::ofstream out(path_.c_str(), std::ios::trunc);
+        out << "{\"bench\": \"" << bench_ << "\", \"results\": [";
+        for (size_t i = 0; i < results_.size(); ++i) {
+            char value[32];
+            std::snprintf(value, sizeof(value), "%.6g", results_[i].value);
+            out << (i ? ",\n  " : "\n  ") << "{\"name\": \"" << results_[i].name
+                << "\", \"value\": " << value << ", \"unit\": \""
+                << results_[i].unit << "\"}";
+        }
+        out << "\n]}\n";
+        if (!out) {
+            std::cerr << "[!] cannot write " << path_ << "\n";
+            return false;
+        }
+        std::cout << "[*] results written to " << path_ << "\n";
+        return true;
+    }
+
+private:
+    struct Result {
+        std::string name;
+        double value;
+        const char *unit;
+    };
+
+    std::string bench_;
+    std::string path_;
+    std::vector<Result> results_;
+}; // BenchReport class
+
+#endif // BENCH_JSON_HPP
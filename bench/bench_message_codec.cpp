@@ -0,0 +1,135 @@
+/****************************************************************************
+ * file: bench_message_codec.cpp
+ * author: luke le
+ * description:
+ *     times the APP frame codec on its own: encode_app_message and
+ *     decode_app_message, and the raw-clock encode and find_app_clock +
+ *     parse_clock_text pair the protocol thread uses, across clock sizes.
+ * usage:
+ *     bench_message_codec [frames] [--json=results.json]
+ *         default: 200000 frames per size
+ * notes:
+ *     frames carry a "w" annotation and a short payload, as busy nodes
+ *     send them. The best of 5 runs is reported in ns per frame; n=1024
+ *     runs a quarter of the frames.
+ ****************************************************************************/
+#include "bench_json.hpp"
+#include "message.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+    typedef std::chrono::steady_clock Clock;
+
+    double ns_since(Clock::time_point t0, int frames) {
+        return std::chrono::duration<double, std::nano>(Clock::now() - t0)
+                   .count() /
+               frames;
+    } // ns_since()
+
+    std::vector<int> make_clock(size_t n, int f) {
+        std::vector<int> vc(n);
+        for (size_t i = 0; i < n; ++i)
+            vc[i] = static_cast<int>((f * 7919 + i * 104729) % 50000);
+        return vc;
+    } // make_clock()
+
+    double encode_path(size_t n, int count, size_t &sink) {
+        std::vector<std::vector<int> > clocks;
+        for (int f = 0; f < 64; ++f) clocks.push_back(make_clock(n, f));
+        const Clock::time_point t0 = Clock::now();
+        for (int f = 0; f < count; ++f)
+            sink += encode_app_message(3, clocks[f & 63], "payload").size();
+        return ns_since(t0, count);
+    } // encode_path()
+
+    double encode_raw_path(size_t n, int count, size_t &sink) {
+        std::vector<std::vector<uint32_t> > clocks;
+        for (int f = 0; f < 64; ++f) {
+            const std::vector<int> vc = make_clock(n, f);
+            clocks.push_back(std::vector<uint32_t>(vc.begin(), vc.end()));
+        }
+        const std::string w = app_annotation("w", 12);
+        const Clock::time_point t0 = Clock::now();
+        for (int f = 0; f < count; ++f)
+            sink += encode_annotated_app_message(3, w, clocks[f & 63].data(), n,
+                                                 "payload").size();
+        return ns_since(t0, count);
+    } // encode_raw_path()
+
+    std::vector<std::string> make_frames(size_t n) {
+        std::vector<std::string> frames;
+        for (int f = 0; f < 64; ++f)
+            frames.push_back(encode_annotated_app_message(
+                3, app_annotation("w", 12), make_clock(n, f), "payload"));
+        return frames;
+    } // make_frames()
+
+    double decode_path(const std::vector<std::string> &frames, int count,
+                       size_t &sink) {
+        std::vector<int> clock;
+        std::string payload;
+        int sender = 0;
+        const Clock::time_point t0 = Clock::now();
+        for (int f = 0; f < count; ++f) {
+            decode_app_message(frames[f & 63], sender, clock, payload);
+            sink += clock.size() + sender;
+        }
+        return ns_since(t0, count);
+    } // decode_path()
+
+    double parse_path(const std::vector<std::string> &frames, size_t n,
+                      int count, size_t &sink) {
+        std::vector<uint32_t> clock(n);
+        const char *b = nullptr, *e = nullptr;
+        const Clock::time_point t0 = Clock::now();
+        for (int f = 0; f < count; ++f) {
+            find_app_clock(frames[f & 63], b, e);
+            sink += parse_clock_text(b, e, clock.data(), n);
+        }
+        return ns_since(t0, count);
+    } // parse_path()
+
+    void run(size_t n, int count, BenchReport &report) {
+        const std::vector<std::string> frames = make_frames(n);
+        double enc = 1e30, raw = 1e30, dec = 1e30, parse = 1e30;
+        size_t sink = 0;
+        for (int r = 0; r < 5; ++r) {
+            enc = std::min(enc, encode_path(n, count, sink));
+            raw = std::min(raw, encode_raw_path(n, count, sink));
+            dec = std::min(dec, decode_path(frames, count, sink));
+            parse = std::min(parse, parse_path(frames, n, count, sink));
+        }
+        std::cout << "[*] n=" << n << " (" << frames[0].size()
+                  << " B): encode " << enc << " ns, raw encode " << raw
+                  << " ns, decode " << dec << " ns, clock parse " << parse
+                  << " ns per frame" << (sink == 0 ? " " : "") << "\n";
+        const std::string tag = "/n=" + std::to_string(n);
+        report.add("encode" + tag, enc, "ns");
+        report.add("encode_raw" + tag, raw, "ns");
+        report.add("decode" + tag, dec, "ns");
+        report.add("clock_parse" + tag, parse, "ns");
+    } // run()
+
+} // end anonymous namespace
+
+int main(int argc, char *argv[]) {
+    BenchReport report("bench_message_codec", argc, argv);
+    const int frames = argc > 1 ? std::atoi(argv[1]) : 200000;
+    if (frames < 1) {
+        std::cerr << "usage: " << argv[0] << " [frames] [--json=<path>]\n";
+        return 1;
+    }
+    const size_t sizes[] = {5, 16, 64, 256};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+        run(sizes[s], frames, report);
+    run(1024, frames / 4 + 1, report);
+    return report.write() ? 0 : 1;
+}
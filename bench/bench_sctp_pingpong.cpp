@@ -0,0 +1,135 @@
+/****************************************************************************
+ * file: bench_sctp_pingpong.cpp
+ * author: luke le
+ * description:
+ *     times SCTPSocket send/receive round trips over loopback: one thread
+ *     echoes every message back, the other sends the next one as soon as
+ *     its echo arrives.
+ * usage:
+ *     bench_sctp_pingpong [round trips] [--json=results.json]
+ *         default: 20000 round trips per message size
+ * notes:
+ *     message sizes are 16, 256 and 1000 bytes (receive() reads at most
+ *     1024). The listener binds an ephemeral port on all interfaces and
+ *     the client connects to 127.0.0.1, with the socket options every
+ *     node uses. Of 5 runs the one with the lowest mean is reported, with
+ *     its p50 and p99.
+ ****************************************************************************/
+#include "bench_json.hpp"
+#include "sctp_wrapper.hpp"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * @brief read until `bytes` bytes arrived; receive() returns empty on a
+     *        timeout
+     */
+    bool receive_all(SCTPSocket &sock, size_t bytes, std::string &out) {
+        out.clear();
+        std::string part;
+        while (out.size() < bytes) {
+            if (!sock.receive(part)) return false;
+            out += part;
+        }
+        return true;
+    } // receive_all()
+
+    void echo(SCTPSocket *listener, size_t bytes, int count) {
+        SCTPSocket peer;
+        if (!listener->accept(peer)) return;
+        std::string msg;
+        for (int i = 0; i < count; ++i) {
+            if (!receive_all(peer, bytes, msg) || !peer.send(msg)) return;
+        }
+    } // echo()
+
+    /**
+     * @brief one connection, count round trips; false if the link failed
+     */
+    bool run_once(int port, size_t bytes, int count,
+                  std::vector<double> &rtt_us) {
+        SCTPSocket listener;
+        if (!listener.create() || !listener.bind(port) || !listener.listen(1))
+            return false;
+        sockaddr_in bound;
+        socklen_t len = sizeof(bound);
+        if (::getsockname(listener.get_fd(), (sockaddr *)&bound, &len) != 0)
+            return false;
+
+        // warm-up round trips are echoed but not timed
+        const int warmup = 100;
+        std::thread server(echo, &listener, bytes, count + warmup);
+        SCTPSocket client;
+        bool ok = client.create() &&
+                  client.connect("127.0.0.1", ntohs(bound.sin_port));
+        const std::string msg(bytes, 'x');
+        std::string back;
+        rtt_us.clear();
+        for (int i = 0; ok && i < count + warmup; ++i) {
+            const Clock::time_point t0 = Clock::now();
+            ok = client.send(msg) && receive_all(client, bytes, back);
+            if (i >= warmup)
+                rtt_us.push_back(std::chrono::duration<double, std::micro>(
+                                     Clock::now() - t0).count());
+        }
+        client.close();
+        server.join();
+        return ok;
+    } // run_once()
+
+    double mean(const std::vector<double> &v) {
+        double sum = 0;
+        for (size_t i = 0; i < v.size(); ++i) sum += v[i];
+        return v.empty() ? 0 : sum / v.size();
+    } // mean()
+
+    bool run(size_t bytes, int count, BenchReport &report) {
+        std::vector<double> best, rtt;
+        for (int r = 0; r < 5; ++r) {
+            if (!run_once(0, bytes, count, rtt)) {
+                std::cerr << "[!] loopback ping-pong failed at " << bytes
+                          << " bytes\n";
+                return false;
+            }
+            if (best.empty() || mean(rtt) < mean(best)) best.swap(rtt);
+        }
+        const double avg = mean(best);
+        std::sort(best.begin(), best.end());
+        const double p50 = best[best.size() / 2];
+        const double p99 = best[best.size() * 99 / 100];
+        std::cout << "[*] " << bytes << " B: mean " << avg << " us, p50 "
+                  << p50 << " us, p99 " << p99 << " us per round trip\n";
+        const std::string tag = "/bytes=" + std::to_string(bytes);
+        report.add("rtt_mean" + tag, avg, "us");
+        report.add("rtt_p50" + tag, p50, "us");
+        report.add("rtt_p99" + tag, p99, "us");
+        return true;
+    } // run()
+
+} // end anonymous namespace
+
+int main(int argc, char *argv[]) {
+    BenchReport report("bench_sctp_pingpong", argc, argv);
+    const int trips = argc > 1 ? std::atoi(argv[1]) : 20000;
+    if (trips < 1) {
+        std::cerr << "usage: " << argv[0] << " [round trips] [--json=<path>]\n";
+        return 1;
+    }
+    const size_t sizes[] = {16, 256, 1000};
+    for (size_t s = 0; s < 3; ++s)
+        if (!run(sizes[s], trips, report)) return 1;
+    return report.write() ? 0 : 1;
+}
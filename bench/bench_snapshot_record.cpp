@@ -0,0 +1,103 @@
+/****************************************************************************
+ * file: bench_snapshot_record.cpp
+ * author: luke le
+ * description:
+ *     times SnapshotManager::record_snapshot: how long the protocol thread
+ *     stalls per record, and how fast records reach the output file.
+ * usage:
+ *     bench_snapshot_record [records] [--json=results.json]
+ *         default: 20000 records per case
+ * notes:
+ *     cases are the async text writer (the default), the async binary
+ *     writer (--snapshot-format=binary) and the synchronous text writer
+ *     (--snapshot-sync), each at n = 16 and n = 256. Output goes to
+ *     logs/bench_snapshot-0.out (.snap) under the working directory and is
+ *     removed afterwards; fdatasync stays off so the disk is not measured.
+ *
+ *     "stall" is the mean of SnapshotManager::stall_stats(), "drain" the
+ *     wall time from the first record until flush() returns, per record.
+ *     The best of 5 runs is reported.
+ ****************************************************************************/
+#include "bench_json.hpp"
+#include "snapshot_manager.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * @brief one run; stall and drain in ns per record
+     */
+    void run_once(size_t n, int count, const SnapshotWriterOptions &opts,
+                  double &stall, double &drain) {
+        std::vector<std::vector<int> > clocks(16, std::vector<int>(n));
+        for (size_t c = 0; c < clocks.size(); ++c)
+            for (size_t i = 0; i < n; ++i)
+                clocks[c][i] =
+                    static_cast<int>((c * 7919 + i * 104729) % 50000);
+        std::string path;
+        {
+            SnapshotManager mgr(0, "bench_snapshot", static_cast<int>(n),
+                                64 * 1024, opts);
+            path = mgr.base_path() + (opts.binary ? ".snap" : ".out");
+            const Clock::time_point t0 = Clock::now();
+            for (int r = 0; r < count; ++r)
+                mgr.record_snapshot(clocks[r & 15], r);
+            mgr.flush();
+            drain = std::chrono::duration<double, std::nano>(Clock::now() - t0)
+                        .count() /
+                    count;
+            stall = static_cast<double>(mgr.stall_stats().total_ns) / count;
+        }
+        std::remove(path.c_str());
+    } // run_once()
+
+    void run(const char *name, size_t n, int count,
+             const SnapshotWriterOptions &opts, BenchReport &report) {
+        double stall = 1e30, drain = 1e30;
+        for (int r = 0; r < 5; ++r) {
+            double s, d;
+            run_once(n, count, opts, s, d);
+            stall = std::min(stall, s);
+            drain = std::min(drain, d);
+        }
+        std::cout << "[*] " << name << " n=" << n << ": stall " << stall
+                  << " ns, drain " << drain << " ns per record ("
+                  << 1e9 / drain << " records/s)\n";
+        const std::string tag = std::string(name) + "/n=" + std::to_string(n);
+        report.add("stall_" + tag, stall, "ns");
+        report.add("drain_" + tag, drain, "ns");
+    } // run()
+
+} // end anonymous namespace
+
+int main(int argc, char *argv[]) {
+    BenchReport report("bench_snapshot_record", argc, argv);
+    const int records = argc > 1 ? std::atoi(argv[1]) : 20000;
+    if (records < 1) {
+        std::cerr << "usage: " << argv[0] << " [records] [--json=<path>]\n";
+        return 1;
+    }
+
+    SnapshotWriterOptions async_text;
+    SnapshotWriterOptions async_binary;
+    async_binary.binary = true;
+    SnapshotWriterOptions sync_text;
+    sync_text.async = false;
+
+    const size_t sizes[] = {16, 256};
+    for (size_t s = 0; s < 2; ++s) {
+        run("async_text", sizes[s], records, async_text, report);
+        run("async_binary", sizes[s], records, async_binary, report);
+        run("sync_text", sizes[s], records, sync_text, report);
+    }
+    return report.write() ? 0 : 1;
+}
@@ -0,0 +1,168 @@
+/****************************************************************************
+ * file: bench_vector_clock.cpp
+ * author: luke le
+ * description:
+ *     times the per-frame vector clock work of MapProtocol: parse the
+ *     clock of a received APP frame, merge it, tick, and encode the clock
+ *     of the next outgoing frame; then merge and the cut compare on their
+ *     own.
+ * usage:
+ *     bench_vector_clock [frames] [--json=results.json]
+ *         default: 200000 frames per size
+ * notes:
+ *     three variants per n:
+ *       text     decode_app_message into a vector<int>, std::max merge,
+ *                ostringstream encode (the code before VectorClock)
+ *       dynamic  DynamicVectorClock, the default build
+ *       fixed    FixedVectorClock<n>, a -DFIXED_TOPOLOGY build
+ *     merge times DynamicVectorClock::merge alone, compare one
+ *     CutChecker::check of an n x n snapshot matrix (n row compares).
+ *     the best of 5 runs is reported in ns per frame (per merge, per
+ *     check).
+ ****************************************************************************/
+#include "bench_json.hpp"
+#include "cut_checker.hpp"
+#include "message.hpp"
+#include "vector_clock.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+    typedef std::chrono::steady_clock Clock;
+
+    double ns_since(Clock::time_point t0, int frames) {
+        return std::chrono::duration<double, std::nano>(Clock::now() - t0)
+                   .count() /
+               frames;
+    } // ns_since()
+
+    /**
+     * @brief n-entry frames as a busy node would see them
+     */
+    std::vector<std::string> make_frames(size_t n) {
+        std::vector<std::string> frames;
+        std::vector<int> vc(n);
+        for (int f = 0; f < 64; ++f) {
+            for (size_t i = 0; i < n; ++i) vc[i] = (f * 7919 + i * 104729) % 5000;
+            frames.push_back(encode_annotated_app_message(
+                1, app_annotation("w", 12), vc, ""));
+        }
+        return frames;
+    } // make_frames()
+
+    double text_path(const std::vector<std::string> &frames, size_t n,
+                     int count, size_t &sink) {
+        std::vector<int> vc(n, 0), clock;
+        std::string payload;
+        int sender = 0;
+        const Clock::time_point t0 = Clock::now();
+        for (int f = 0; f < count; ++f) {
+            decode_app_message(frames[f & 63], sender, clock, payload);
+            for (size_t i = 0; i < vc.size() && i < clock.size(); ++i)
+                vc[i] = std::max(vc[i], clock[i]);
+            ++vc[0];
+            sink += encode_annotated_app_message(0, ";w=3", vc, "").size();
+        }
+        return ns_since(t0, count);
+    } // text_path()
+
+    template <typename VC>
+    double clock_path(const std::vector<std::string> &frames, size_t n,
+                      int count, size_t &sink) {
+        VC vc(n);
+        const char *b = nullptr, *e = nullptr;
+        const Clock::time_point t0 = Clock::now();
+        for (int f = 0; f < count; ++f) {
+            VC clock(n);
+            find_app_clock(frames[f & 63], b, e);
+            clock.parse(b, e);
+            vc.merge(clock);
+            vc.tick(0);
+            sink += encode_annotated_app_message(0, ";w=3", vc.data(),
+                                                 vc.size(), "").size();
+        }
+        return ns_since(t0, count);
+    } // clock_path()
+
+    double merge_path(size_t n, int count, size_t &sink) {
+        std::vector<DynamicVectorClock> clocks(8, DynamicVectorClock(n));
+        for (size_t c = 0; c < clocks.size(); ++c)
+            for (size_t t = 0; t <= c * 3; ++t)
+                clocks[c].tick((c * 31 + t) % n);
+        DynamicVectorClock vc(n);
+        const Clock::time_point t0 = Clock::now();
+        for (int f = 0; f < count; ++f) {
+            vc.merge(clocks[f & 7]);
+            vc.tick(0);
+        }
+        const double ns = ns_since(t0, count);
+        sink += vc[0];
+        return ns;
+    } // merge_path()
+
+    double compare_path(size_t n, int count, size_t &sink) {
+        // a consistent cut: every row at or below the diagonal
+        std::vector<int> clocks(n * n);
+        for (size_t j = 0; j < n; ++j)
+            for (size_t i = 0; i < n; ++i)
+                clocks[j * n + i] =
+                    i == j ? 1000 : static_cast<int>((i + j) % 1000);
+        CutChecker checker;
+        CutViolation v;
+        const int checks = static_cast<int>(count / n) + 1;
+        const Clock::time_point t0 = Clock::now();
+        for (int c = 0; c < checks; ++c)
+            sink += checker.check(&clocks[0], static_cast<int>(n), v);
+        return ns_since(t0, checks);
+    } // compare_path()
+
+    template <size_t N>
+    void run(int count, BenchReport &report) {
+        const std::vector<std::string> frames = make_frames(N);
+        double text = 1e30, dyn = 1e30, fixed = 1e30, merge = 1e30,
+               compare = 1e30;
+        size_t sink = 0;
+        for (int r = 0; r < 5; ++r) {
+            merge = std::min(merge, merge_path(N, count, sink));
+            compare = std::min(compare, compare_path(N, count, sink));
+            text = std::min(text, text_path(frames, N, count, sink));
+            dyn = std::min(dyn, clock_path<DynamicVectorClock>(frames, N,
+                                                               count, sink));
+            fixed = std::min(fixed, clock_path<FixedVectorClock<N> >(
+                                        frames, N, count, sink));
+        }
+        std::cout << "[*] n=" << N << ": text " << text << " ns, dynamic "
+                  << dyn << " ns, fixed " << fixed << " ns per frame "
+                  << "(fixed vs dynamic x" << dyn / fixed << ", vs text x"
+                  << text / fixed << ")" << (sink == 0 ? " " : "") << "\n";
+        std::cout << "[*] n=" << N << ": merge " << merge << " ns, cut check "
+                  << compare << " ns (" << CutChecker::kernel() << ")\n";
+        const std::string n = "/n=" + std::to_string(N);
+        report.add("frame_text" + n, text, "ns");
+        report.add("frame_dynamic" + n, dyn, "ns");
+        report.add("frame_fixed" + n, fixed, "ns");
+        report.add("merge" + n, merge, "ns");
+        report.add("cut_check" + n, compare, "ns");
+    } // run()
+
+} // end anonymous namespace
+
+int main(int argc, char *argv[]) {
+    BenchReport report("bench_vector_clock", argc, argv);
+    const int frames = argc > 1 ? std::atoi(argv[1]) : 200000;
+    if (frames < 1) {
+        std::cerr << "usage: " << argv[0] << " [frames] [--json=<path>]\n";
+        return 1;
+    }
+    run<5>(frames, report);
+    run<16>(frames, report);
+    run<64>(frames, report);
+    run<256>(frames / 4 + 1, report);
+    return report.write() ? 0 : 1;
+}
@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+############################################################################
+# file: compare.py
+# author: luke le
+# description:
+#     compares benchmark results (the --json=<path> files of bench/*)
+#     against a baseline and flags every result that got slower by more
+#     than a threshold.
+# usage:
+#     bench/compare.py baseline/ current/                 directories of .json
+#     bench/compare.py base.json new.json --threshold=5   percent, default 10
+# notes:
+#     every value is a cost, so higher means slower. Results are matched by
+#     (bench, name); ones present on only one side are listed but do not
+#     fail the comparison. Exits 1 if anything regressed, 2 on bad input.
+############################################################################
+import json
+import os
+import sys
+
+
+def load(path):
+    """(bench, name) -> (value, unit) for a file or a directory of files"""
+    files = [path]
+    if os.path.isdir(path):
+        files = sorted(os.path.join(path, f) for f in os.listdir(path)
+                       if f.endswith(".json"))
+    results = {}
+    for f in files:
+        try:
+            with open(f) as fp:
+                doc = json.load(fp)
+            for r in doc["results"]:
+                results[(doc["bench"], r["name"])] = (float(r["value"]),
+                                                      r["unit"])
+        except (OSError, ValueError, KeyError, TypeError) as e:
+            sys.stderr.write("[!] cannot read %s: %s\n" % (f, e))
+            sys.exit(2)
+    return results
+
+
+def main(argv):
+    threshold = 10.0
+    paths = []
+    for arg in argv[1:]:
+        if arg.startswith("--threshold="):
+            threshold = float(arg[len("--threshold="):])
+        else:
+            paths.append(arg)
+    if len(paths) != 2:
+        sys.stderr.write("usage: %s <baseline> <current> [--threshold=pct]\n"
+                         % argv[0])
+        return 2
+
+    base = load(paths[0])
+    cur = load(paths[1])
+    regressions = 0
+    for key in sorted(set(base) | set(cur)):
+        label = "%s %s" % key
+        if key not in cur:
+            print("[~] %-50s missing from %s" % (label, paths[1]))
+            continue
+        if key not in base:
+            print("[~] %-50s new, %.4g %s" % (label, cur[key][0], cur[key][1]))
+            continue
+        old, unit = base[key]
+        new = cur[key][0]
+        change = (new - old) / old * 100.0 if old > 0 else 0.0
+        mark = "[*]"
+        if change > threshold:
+            mark = "[!]"
+            regressions += 1
+        print("%s %-50s %10.4g -> %10.4g %-3s %+7.1f%%"
+              % (mark, label, old, new, unit, change))
+
+    if regressions:
+        print("[!] %d result(s) slower by more than %g%%"
+              % (regressions, threshold))
+        return 1
+    print("[*] no regressions beyond %g%%" % threshold)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -1,32 +1,124 @@
 #include "config.hpp"
 #include "map_protocol.hpp"
+#include "node_host.hpp"
+#include "options.hpp"
+#include "topology_image.hpp"
 
+#include <csignal>
+#include <cstring>
 #include <iostream>
 #include <string>
+#include <vector>
+
+namespace {
+    // the node (or host) that SIGINT/SIGTERM should stop; stop() is
+    // signal-safe
+    MapProtocol *g_node = nullptr;
+    NodeHost *g_host = nullptr;
+
+    void on_terminate(int) {
+        if (g_node) g_node->stop();
+        if (g_host) g_host->stop();
+    }
+
+    void install_signal_handlers() {
+        struct sigaction sa;
+        std::memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = on_terminate;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGINT, &sa, nullptr);
+        sigaction(SIGTERM, &sa, nullptr);
+
+        // a peer that exits first must not kill us mid-send; the failed
+        // send is reported through its return value instead
+        signal(SIGPIPE, SIG_IGN);
+    }
+
+#ifdef FIXED_TOPOLOGY
+    // a specialized build only runs the topology it was generated from
+    bool matches_fixed_topology(const Config &cfg) {
+        if (cfg.n != static_cast<int>(fixed_topology::n) ||
+            cfg.neighbors.entries() != fixed_topology::entries)
+            return false;
+        for (size_t i = 0; i <= fixed_topology::n; ++i)
+            if (cfg.neighbors.offsets()[i] != fixed_topology::offsets[i])
+                return false;
+        for (size_t k = 0; k < fixed_topology::entries; ++k)
+            if (cfg.neighbors.targets()[k] != fixed_topology::targets[k])
+                return false;
+        return true;
+    }
+#endif
+} // end anonymous namespace
 
 int main(int argc, char *argv[]) {
     // arg verification
-    if (argc != 2) {
-        std::cerr << "usage: " << argv[0] << " <node_id>\n";
+    if (argc < 2) {
+        print_usage(argv[0]);
         return 1;
     }
+    // a list or range of ids (or "all") runs them in one process
+    const std::string which = argv[1];
+    const bool hosted = which == "all" ||
+                        which.find_first_of(",-", 1) != std::string::npos;
+    std::vector<int> ids;
     int node_id = -1;
-    try {
-        node_id = std::stoi(argv[1]);
-    } catch (...) {
-        std::cerr << "[!] invalid node_id: " << argv[1] << "\n";
+    if (hosted && which != "all" && !parse_node_ids(which, ids)) {
+        std::cerr << "[!] invalid node ids: " << argv[1] << "\n";
+        return 1;
+    }
+    if (!hosted) {
+        try {
+            node_id = std::stoi(argv[1]);
+        } catch (...) {
+            std::cerr << "[!] invalid node_id: " << argv[1] << "\n";
+            return 1;
+        }
+    }
+    Options opts;
+    if (!parse_options(argc, argv, 2, opts)) {
+        print_usage(argv[0]);
         return 1;
     }
 
     // config parsing
     Config cfg;
     std::string path = CONFIG_FILE_PATH;      // set by CMake
-    if (!parse_config(path, cfg)) {
+    if (!opts.config.empty()) path = opts.config;
+    bool loaded = false;
+    if (!opts.topology.empty()) {
+        loaded = load_topology(opts.topology, path, cfg);
+        if (!loaded) std::cerr << "[~] parsing " << path << " instead\n";
+    }
+    if (!loaded && !parse_config(path, cfg)) {
         std::cerr << "[!] something went wrong with the config file.\n";
         return 1;
     }
+#ifdef FIXED_TOPOLOGY
+    if (!matches_fixed_topology(cfg)) {
+        std::cerr << "[!] this build is specialized for a " << fixed_topology::n
+                  << "-node topology that " << path << " does not match;"
+                  << " rebuild or configure with -DFIXED_TOPOLOGY=OFF\n";
+        return 1;
+    }
+#endif
+
+    if (hosted) {
+        if (which == "all")
+            for (int i = 0; i < cfg.n; ++i) ids.push_back(i);
+        NodeHost host(cfg, ids, opts, opts.workers);
+        g_host = &host;
+        install_signal_handlers();
+        const bool ok = host.run();
+        g_host = nullptr;
+        return ok ? 0 : 1;
+    }
 
     // map protocol
-    MapProtocol node(cfg, node_id);
-    return node.run();
+    MapProtocol node(cfg, node_id, opts);
+    g_node = &node;
+    install_signal_handlers();   // cleanup.sh's SIGTERM now exits promptly
+    node.run();
+    g_node = nullptr;
+    return 0;
 }
@@ -0,0 +1,545 @@
+/****************************************************************************
+ * file: cluster_bench.cpp
+ * author: luke le
+ * description:
+ *     end-to-end benchmark on one machine: for every topology kind and
+ *     node count it generates a localhost config, starts all nodes, holds
+ *     them at the launch barrier, runs the MAP computation to termination
+ *     and writes one CSV row per run.
+ * usage:
+ *     cluster_bench [options] [-- node options]
+ *         --exe=PATH          node binary (build/proj1)
+ *         --sizes=N,N,...     node counts (8,16,32,64,128,256,512)
+ *         --kinds=K,K,...     topogen kinds (ring,torus,random-regular)
+ *         --degree=D          degree of the random kinds (4)
+ *         --seed=S            topology seed (1)
+ *         --globals=a,b,c,d,e MAP globals as in topogen (6,10,5,100,100)
+ *         --hosted            one `proj1 all` process per run instead of
+ *                             one process per node
+ *         --base-port=P       first listen port (20000)
+ *         --timeout=S         seconds before a run is stopped (300)
+ *         --dir=DIR           configs and logs/ go here (cluster-bench)
+ *         -o PATH             CSV to PATH instead of stdout
+ * notes:
+ *     columns, one row per (kind, n):
+ *       startup_ms     first fork to the last node's READY (links up)
+ *       run_ms         barrier release to the last node going quiet
+ *       app_per_s      APP frames sent by all nodes / run_ms
+ *       snapshot_*_us  node 0's global snapshot collection latencies
+ *       detect_ms      last node quiet to termination detected at node 0
+ *       halt_ms        detection to the last node's exit
+ *       rss_*_kb       peak RSS per node process (wait4); with --hosted
+ *                      the process peak divided by n
+ *     quiet is the last APP a node handled or the last time it turned
+ *     passive, from the halt records (halt_latency.cpp). Consecutive runs
+ *     rotate through 8 port ranges of 1024 so a run never binds ports the
+ *     previous one may still hold in TIME_WAIT. A run that times out or
+ *     loses a node is stopped and reported with its status; the sweep
+ *     goes on.
+ ****************************************************************************/
+#include "config.hpp"
+#include "control_channel.hpp"
+#include "shutdown_signal.hpp"
+#include "topology_gen.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+    struct BenchOptions {
+        std::string exe;
+        std::string dir;
+        std::string csv;
+        std::vector<int> sizes;
+        std::vector<std::string> kinds;
+        int degree;
+        long long seed;
+        int globals[5];
+        bool hosted;
+        int base_port;
+        int timeout_s;
+        std::vector<std::string> node_args;
+
+        BenchOptions()
+            : exe("build/proj1"), dir("cluster-bench"), degree(4), seed(1),
+              hosted(false), base_port(20000), timeout_s(300) {
+            const int g[5] = {6, 10, 5, 100, 100};
+            std::copy(g, g + 5, globals);
+        }
+    };
+
+    // one row of the CSV
+    struct RunResult {
+        std::string kind;
+        int n;
+        size_t links;
+        std::string status;       // ok, timeout, node-failed, ...
+        double startup_ms;
+        double run_ms;
+        long long app_messages;
+        double app_per_s;
+        size_t snapshots;
+        long long snap_p50_us, snap_p90_us, snap_p99_us, snap_max_us;
+        double detect_ms;
+        double halt_ms;
+        long rss_max_kb;
+        long rss_mean_kb;
+    };
+
+    const char *value_of(const char *arg, const char *name) {
+        size_t len = std::strlen(name);
+        if (std::strncmp(arg, name, len) != 0 || arg[len] != '=') return nullptr;
+        return arg + len + 1;
+    } // value_of()
+
+    std::vector<std::string> split(const std::string &s, char sep) {
+        std::vector<std::string> parts;
+        std::istringstream in(s);
+        std::string part;
+        while (std::getline(in, part, sep))
+            if (!part.empty()) parts.push_back(part);
+        return parts;
+    } // split()
+
+    double ms(int64_t ns) { return ns / 1e6; }
+
+    long long percentile(const std::vector<long long> &sorted, int pct) {
+        if (sorted.empty()) return -1;
+        return sorted[(sorted.size() - 1) * pct / 100];
+    } // percentile()
+
+    /**
+     * @brief fork one node process (or a hosting process for "all") with
+     *        its output in logs/stdout-<label>.log
+     */
+    pid_t start_node(const std::vector<std::string> &args,
+                     const std::string &label) {
+        const std::string out = "logs/stdout-" + label + ".log";
+        const std::string err = "logs/stderr-" + label + ".log";
+        std::vector<char *> argv;
+        for (size_t i = 0; i < args.size(); ++i)
+            argv.push_back(const_cast<char *>(args[i].c_str()));
+        argv.push_back(nullptr);
+
+        const pid_t pid = ::fork();
+        if (pid != 0) return pid;
+        const int fo = ::open(out.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        const int fe = ::open(err.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        const int fi = ::open("/dev/null", O_RDONLY);
+        if (fo < 0 || fe < 0 || fi < 0) _exit(127);
+        ::dup2(fi, 0);
+        ::dup2(fo, 1);
+        ::dup2(fe, 2);
+        ::setsid();
+        ::execv(argv[0], argv.data());
+        std::perror("[!] exec");
+        _exit(127);
+    } // start_node()
+
+    /**
+     * @brief reap exited children; peak RSS goes to rss_kb[pid]. Returns
+     *        how many exited with a failure status.
+     */
+    int reap(std::map<pid_t, long> &running, std::map<pid_t, long> &rss_kb) {
+        int failed = 0;
+        int status = 0;
+        struct rusage ru;
+        pid_t pid;
+        while ((pid = ::wait4(-1, &status, WNOHANG, &ru)) > 0) {
+            if (!running.erase(pid)) continue;
+            rss_kb[pid] = ru.ru_maxrss;
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) ++failed;
+        }
+        return failed;
+    } // reap()
+
+    /**
+     * @brief SIGTERM what is still running, SIGKILL it 5 s later
+     */
+    void stop_all(std::map<pid_t, long> &running,
+                  std::map<pid_t, long> &rss_kb) {
+        for (std::map<pid_t, long>::iterator it = running.begin();
+             it != running.end(); ++it)
+            ::kill(it->first, SIGTERM);
+        const int64_t kill_at = ShutdownSignal::now_ns() + 5000000000LL;
+        while (!running.empty()) {
+            reap(running, rss_kb);
+            if (ShutdownSignal::now_ns() > kill_at) {
+                for (std::map<pid_t, long>::iterator it = running.begin();
+                     it != running.end(); ++it)
+                    ::kill(it->first, SIGKILL);
+            }
+            ::usleep(10000);
+        }
+    } // stop_all()
+
+    /**
+     * @brief global snapshot collection latencies node 0 logged
+     */
+    std::vector<long long> snapshot_latencies(const std::string &log_path) {
+        std::vector<long long> us;
+        std::ifstream in(log_path.c_str());
+        std::string line;
+        const std::string key = "collected in ";
+        while (std::getline(in, line)) {
+            const size_t at = line.find(key);
+            if (line.find("Global snapshot") == std::string::npos ||
+                at == std::string::npos)
+                continue;
+            const long long v = std::atoll(line.c_str() + at + key.size());
+            if (v >= 0) us.push_back(v);
+        }
+        std::sort(us.begin(), us.end());
+        return us;
+    } // snapshot_latencies()
+
+    /**
+     * @brief fold the halt records of every node into r; false if any is
+     *        missing
+     */
+    bool read_halt_records(const std::string &name, int n, int64_t go_wall,
+                           RunResult &r) {
+        long long detected = -1, quiet = -1, last_exit = -1;
+        r.app_messages = 0;
+        bool all = true;
+        for (int id = 0; id < n; ++id) {
+            const std::string path =
+                "logs/" + name + "-" + std::to_string(id) + ".halt";
+            std::ifstream in(path.c_str());
+            long long rid, depth, det, halt, exit_ns, q = -1, sent = 0;
+            if (!(in >> rid >> depth >> det >> halt >> exit_ns)) {
+                all = false;
+                continue;
+            }
+            in >> q >> sent;
+            detected = det;
+            quiet = std::max(quiet, q);
+            last_exit = std::max(last_exit, exit_ns);
+            r.app_messages += sent;
+        }
+        if (detected < 0) return false;
+        if (quiet < 0) quiet = go_wall;
+        r.run_ms = ms(quiet - go_wall);
+        r.app_per_s = r.run_ms > 0 ? r.app_messages / (r.run_ms / 1000.0) : 0;
+        r.detect_ms = ms(detected - quiet);
+        r.halt_ms = ms(last_exit - detected);
+        return all;
+    } // read_halt_records()
+
+    RunResult run_one(const BenchOptions &o, const std::string &kind, int n,
+                      int run) {
+        RunResult r;
+        r.kind = kind;
+        r.n = n;
+        r.links = 0;
+        r.status = "ok";
+        r.startup_ms = r.run_ms = r.app_per_s = r.detect_ms = r.halt_ms = -1;
+        r.app_messages = -1;
+        r.snapshots = 0;
+        r.snap_p50_us = r.snap_p90_us = r.snap_p99_us = r.snap_max_us = -1;
+        r.rss_max_kb = r.rss_mean_kb = -1;
+
+        // ---- config ----
+        TopologySpec spec;
+        Config cfg;
+        if (!parse_topology_kind(kind, spec.kind)) {
+            r.status = "bad-kind";
+            return r;
+        }
+        spec.n = n;
+        spec.degree = o.degree;
+        spec.seed = static_cast<uint64_t>(o.seed);
+        spec.base_port = o.base_port + (run % 8) * 1024;
+        cfg.minPerActive = o.globals[0];
+        cfg.maxPerActive = o.globals[1];
+        cfg.minSendDelay_ms = o.globals[2];
+        cfg.snapshotDelay_ms = o.globals[3];
+        cfg.maxNumber = o.globals[4];
+        if (!generate_topology(spec, cfg)) {
+            r.status = "bad-topology";
+            return r;
+        }
+        r.links = cfg.neighbors.entries() / 2;
+        const std::string name = kind + "-" + std::to_string(n);
+        const std::string config = name + ".txt";
+        {
+            std::ofstream out(config.c_str(), std::ios::trunc);
+            write_config(out, cfg, "generated: cluster_bench " + name);
+            if (!out.flush()) {
+                std::cerr << "[!] cannot write " << config << "\n";
+                r.status = "io-error";
+                return r;
+            }
+        }
+        for (int id = 0; id < n; ++id)
+            std::remove(("logs/" + name + "-" + std::to_string(id) + ".halt")
+                            .c_str());
+
+        ControlServer server;
+        if (!server.listen(0)) {
+            r.status = "control-error";
+            return r;
+        }
+
+        // ---- launch, highest id first (lower ids dial) ----
+        std::vector<std::string> base;
+        base.push_back(o.exe);
+        base.push_back("");
+        base.push_back("--config=" + config);
+        base.push_back("--control=127.0.0.1:" + std::to_string(server.port()));
+        base.push_back("--metrics-socket=off");
+        base.insert(base.end(), o.node_args.begin(), o.node_args.end());
+
+        std::map<pid_t, long> running, rss_kb;
+        const int64_t t0 = ShutdownSignal::now_ns();
+        const int64_t deadline = t0 + o.timeout_s * 1000000000LL;
+        const int launches = o.hosted ? 1 : n;
+        for (int k = 0; k < launches; ++k) {
+            const int id = n - 1 - k;
+            std::vector<std::string> args = base;
+            args[1] = o.hosted ? "all" : std::to_string(id);
+            const pid_t pid = start_node(
+                args, name + "-" + (o.hosted ? "host" : std::to_string(id)));
+            if (pid < 0) {
+                std::perror("[!] fork");
+                r.status = "fork-failed";
+                stop_all(running, rss_kb);
+                return r;
+            }
+            running[pid] = id;
+        }
+
+        // ---- wait for every READY ----
+        std::vector<char> ready(n, 0);
+        int readies = 0;
+        int64_t last_ready = t0;
+        while (readies < n && r.status == "ok") {
+            reap(running, rss_kb);        // nobody exits before GO
+            if (static_cast<int>(running.size()) < launches)
+                r.status = "node-failed";
+            else if (ShutdownSignal::now_ns() > deadline)
+                r.status = "setup-timeout";
+            std::vector<ControlEvent> events;
+            server.poll(10, events);
+            for (size_t k = 0; k < events.size(); ++k) {
+                const ControlEvent &ev = events[k];
+                if (ev.kind != ControlEvent::READY || ev.id < 0 || ev.id >= n ||
+                    ready[ev.id])
+                    continue;
+                ready[ev.id] = 1;
+                ++readies;
+                last_ready = std::max(last_ready, ev.at_ns);
+            }
+        }
+        if (r.status != "ok") {
+            std::cerr << "[!] " << name << ": " << readies << "/" << n
+                      << " nodes ready (" << r.status << ")\n";
+            stop_all(running, rss_kb);
+            return r;
+        }
+        r.startup_ms = ms(last_ready - t0);
+
+        // ---- release and wait for every exit ----
+        const int64_t go_wall = ShutdownSignal::wall_ns() + 50000000LL;
+        server.release(go_wall);
+        int failed = 0;
+        while (!running.empty() && ShutdownSignal::now_ns() < deadline) {
+            failed += reap(running, rss_kb);
+            std::vector<ControlEvent> ignored;
+            server.poll(10, ignored);      // also notices closed nodes
+        }
+        if (!running.empty()) {
+            r.status = "timeout";
+            stop_all(running, rss_kb);
+        } else if (failed) {
+            r.status = "node-failed";
+        }
+
+        // ---- results ----
+        if (!read_halt_records(name, n, go_wall, r) && r.status == "ok")
+            r.status = "missing-halt";
+        const std::vector<long long> snaps = snapshot_latencies(
+            "logs/stdout-" + name + "-" + (o.hosted ? "host" : "0") + ".log");
+        r.snapshots = snaps.size();
+        r.snap_p50_us = percentile(snaps, 50);
+        r.snap_p90_us = percentile(snaps, 90);
+        r.snap_p99_us = percentile(snaps, 99);
+        r.snap_max_us = snaps.empty() ? -1 : snaps.back();
+
+        long long sum = 0;
+        r.rss_max_kb = 0;
+        for (std::map<pid_t, long>::iterator it = rss_kb.begin();
+             it != rss_kb.end(); ++it) {
+            sum += it->second;
+            r.rss_max_kb = std::max(r.rss_max_kb, it->second);
+        }
+        if (o.hosted) {
+            r.rss_max_kb /= n;             // the only process, shared by all
+            r.rss_mean_kb = r.rss_max_kb;
+        } else {
+            r.rss_mean_kb =
+                rss_kb.empty() ? -1 : static_cast<long>(sum / rss_kb.size());
+        }
+        return r;
+    } // run_one()
+
+    void write_header(std::ostream &out) {
+        out << "kind,n,mode,links,status,startup_ms,run_ms,app_messages,"
+            << "app_per_s,snapshots,snapshot_p50_us,snapshot_p90_us,"
+            << "snapshot_p99_us,snapshot_max_us,detect_ms,halt_ms,"
+            << "rss_max_kb,rss_mean_kb\n";
+    } // write_header()
+
+    void write_row(std::ostream &out, const RunResult &r, bool hosted) {
+        out << r.kind << "," << r.n << "," << (hosted ? "hosted" : "process")
+            << "," << r.links << "," << r.status << "," << r.startup_ms << ","
+            << r.run_ms << "," << r.app_messages << "," << r.app_per_s << ","
+            << r.snapshots << "," << r.snap_p50_us << "," << r.snap_p90_us
+            << "," << r.snap_p99_us << "," << r.snap_max_us << ","
+            << r.detect_ms << "," << r.halt_ms << "," << r.rss_max_kb << ","
+            << r.rss_mean_kb << "\n";
+        out.flush();
+    } // write_row()
+
+    void usage(const char *prog) {
+        std::cerr << "usage: " << prog << " [--exe=PATH] [--sizes=N,...] "
+                  << "[--kinds=K,...] [--degree=D]\n"
+                  << "       [--seed=S] [--globals=a,b,c,d,e] [--hosted] "
+                  << "[--base-port=P]\n"
+                  << "       [--timeout=S] [--dir=DIR] [-o out.csv] "
+                  << "[-- node options]\n";
+    } // usage()
+
+} // end anonymous namespace
+
+int main(int argc, char *argv[]) {
+    BenchOptions o;
+    std::string sizes = "8,16,32,64,128,256,512";
+    std::string kinds = "ring,torus,random-regular";
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        const char *v = nullptr;
+        bool ok = true;
+        if (std::strcmp(arg, "--") == 0) {
+            for (++i; i < argc; ++i) o.node_args.push_back(argv[i]);
+        } else if ((v = value_of(arg, "--exe"))) {
+            o.exe = v;
+        } else if ((v = value_of(arg, "--sizes"))) {
+            sizes = v;
+        } else if ((v = value_of(arg, "--kinds"))) {
+            kinds = v;
+        } else if ((v = value_of(arg, "--degree"))) {
+            o.degree = std::atoi(v);
+            ok = o.degree > 0;
+        } else if ((v = value_of(arg, "--seed"))) {
+            o.seed = std::atoll(v);
+        } else if ((v = value_of(arg, "--globals"))) {
+            const std::vector<std::string> g = split(v, ',');
+            ok = g.size() == 5;
+            for (size_t k = 0; ok && k < 5; ++k) {
+                o.globals[k] = std::atoi(g[k].c_str());
+                ok = o.globals[k] >= 0;
+            }
+        } else if (std::strcmp(arg, "--hosted") == 0) {
+            o.hosted = true;
+        } else if ((v = value_of(arg, "--base-port"))) {
+            o.base_port = std::atoi(v);
+            ok = o.base_port > 0 && o.base_port + 8 * 1024 < 65536;
+        } else if ((v = value_of(arg, "--timeout"))) {
+            o.timeout_s = std::atoi(v);
+            ok = o.timeout_s > 0;
+        } else if ((v = value_of(arg, "--dir"))) {
+            o.dir = v;
+        } else if (std::strcmp(arg, "-o") == 0 && i + 1 < argc) {
+            o.csv = argv[++i];
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            std::cerr << "[!] invalid option: " << arg << "\n";
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    const std::vector<std::string> size_list = split(sizes, ',');
+    for (size_t k = 0; k < size_list.size(); ++k) {
+        const int n = std::atoi(size_list[k].c_str());
+        if (n < 2 || n > 1024) {
+            std::cerr << "[!] node counts must be 2..1024: " << size_list[k]
+                      << "\n";
+            return 1;
+        }
+        o.sizes.push_back(n);
+    }
+    o.kinds = split(kinds, ',');
+    if (o.sizes.empty() || o.kinds.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // paths given on the command line are relative to where we started
+    char resolved[PATH_MAX];
+    if (::realpath(o.exe.c_str(), resolved) == nullptr) {
+        std::cerr << "[!] cannot find node binary " << o.exe << "\n";
+        return 1;
+    }
+    o.exe = resolved;
+    std::ofstream csv_file;
+    if (!o.csv.empty()) {
+        csv_file.open(o.csv.c_str(), std::ios::trunc);
+        if (!csv_file) {
+            std::cerr << "[!] cannot write " << o.csv << "\n";
+            return 1;
+        }
+    }
+    std::ostream &csv = o.csv.empty() ? std::cout : csv_file;
+
+    ::mkdir(o.dir.c_str(), 0755);
+    if (::chdir(o.dir.c_str()) != 0 ||
+        (::mkdir("logs", 0755) != 0 && errno != EEXIST)) {
+        std::cerr << "[!] cannot use " << o.dir << ": " << std::strerror(errno)
+                  << "\n";
+        return 1;
+    }
+    // every node holds a socket per link plus its own; 512 of them on one
+    // host need more than the usual 1024 descriptors between them
+    struct rlimit lim;
+    if (::getrlimit(RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur < lim.rlim_max) {
+        lim.rlim_cur = lim.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &lim);
+    }
+
+    write_header(csv);
+    int run = 0, failures = 0;
+    for (size_t s = 0; s < o.sizes.size(); ++s) {
+        for (size_t k = 0; k < o.kinds.size(); ++k, ++run) {
+            const RunResult r = run_one(o, o.kinds[k], o.sizes[s], run);
+            write_row(csv, r, o.hosted);
+            if (r.status != "ok") ++failures;
+            std::cerr << "[*] " << r.kind << " n=" << r.n << ": " << r.status
+                      << ", startup " << r.startup_ms << " ms, "
+                      << r.app_per_s << " APP/s, snapshot p99 "
+                      << r.snap_p99_us << " us, detection " << r.detect_ms
+                      << " ms, peak RSS " << r.rss_max_kb << " KiB per node\n";
+        }
+    }
+    std::cerr << "[+] " << run << " runs, " << failures << " failed\n";
+    return failures ? 1 : 0;
+}
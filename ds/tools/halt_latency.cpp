@@ -0,0 +1,117 @@
+/****************************************************************************
+ * file: halt_latency.cpp
+ * author: luke le
+ * description:
+ *     reports how long node 0 took to detect termination once the last
+ *     node went quiet, and how long the run took to halt after that, from
+ *     the per-node halt records.
+ * usage:
+ *     halt_latency logs/<config>-*.halt
+ * notes:
+ *     each node writes "<id> <depth> <detected> <halt> <exit> <quiet>
+ *     <app sent>" (wall-clock ns, then a count) after it flushed its
+ *     snapshot output; quiet is the last APP it handled or the last time
+ *     it turned passive, -1 if neither happened. Records of older builds
+ *     end after <exit>. Times from different hosts are only comparable up
+ *     to their clock skew; on one host they are exact.
+ ****************************************************************************/
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+    struct HaltRecord {
+        int id;
+        int depth;
+        long long detected_ns;   // at node 0, carried by HALT
+        long long halt_ns;       // HALT delivered here
+        long long exit_ns;       // output flushed, links closed
+        long long quiet_ns;      // last APP handled / turn passive, or -1
+        long long app_sent;
+    };
+
+    /**
+     * @brief read one .halt file; false if missing or malformed
+     */
+    bool read_record(const std::string &path, HaltRecord &r) {
+        std::ifstream in(path.c_str());
+        if (!(in >> r.id >> r.depth >> r.detected_ns >> r.halt_ns >>
+              r.exit_ns)) {
+            std::cerr << "[!] cannot read halt record " << path << "\n";
+            return false;
+        }
+        if (!(in >> r.quiet_ns >> r.app_sent)) r.quiet_ns = r.app_sent = -1;
+        return true;
+    } // read_record()
+
+    long long us(long long ns) { return ns / 1000; }
+
+} // end anonymous namespace
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <config>-<id>.halt...\n";
+        return 1;
+    }
+
+    std::vector<HaltRecord> recs;
+    for (int a = 1; a < argc; ++a) {
+        HaltRecord r;
+        if (read_record(argv[a], r)) recs.push_back(r);
+    }
+    if (recs.empty()) return 1;
+
+    // nodes that never wrote a record never saw HALT (or crashed)
+    int max_id = 0;
+    for (size_t i = 0; i < recs.size(); ++i) max_id = std::max(max_id, recs[i].id);
+    std::vector<bool> seen(max_id + 1, false);
+    for (size_t i = 0; i < recs.size(); ++i) seen[recs[i].id] = true;
+    for (int id = 0; id <= max_id; ++id)
+        if (!seen[id]) std::cerr << "[!] no halt record for node " << id << "\n";
+
+    const long long detected = recs[0].detected_ns;
+    const HaltRecord *last_halt = &recs[0], *last_exit = &recs[0];
+    const HaltRecord *last_quiet = nullptr;
+    std::vector<long long> exits;
+    std::map<int, long long> depth_halt;   // depth -> latest HALT arrival
+    for (size_t i = 0; i < recs.size(); ++i) {
+        const HaltRecord &r = recs[i];
+        if (r.detected_ns != detected)
+            std::cerr << "[!] node " << r.id << " reports another detection "
+                      << "time\n";
+        if (r.halt_ns > last_halt->halt_ns) last_halt = &r;
+        if (r.exit_ns > last_exit->exit_ns) last_exit = &r;
+        if (r.quiet_ns >= 0 &&
+            (last_quiet == nullptr || r.quiet_ns > last_quiet->quiet_ns))
+            last_quiet = &r;
+        exits.push_back(r.exit_ns - detected);
+        long long &d = depth_halt[r.depth];
+        d = std::max(d, r.halt_ns - detected);
+    }
+    std::sort(exits.begin(), exits.end());
+
+    // the computation ended with the last APP handled or turn passive
+    if (last_quiet != nullptr)
+        std::cout << "[*] termination detected "
+                  << us(detected - last_quiet->quiet_ns) << " us after the "
+                  << "last node went quiet (node " << last_quiet->id << ")\n";
+
+    std::cout << "[*] " << recs.size() << " nodes halted; detection -> "
+              << "last exit " << us(last_exit->exit_ns - detected)
+              << " us (node " << last_exit->id << ", depth "
+              << last_exit->depth << "), median exit "
+              << us(exits[exits.size() / 2]) << " us\n";
+    std::cout << "[*] HALT reached the last node after "
+              << us(last_halt->halt_ns - detected) << " us (node "
+              << last_halt->id << ", depth " << last_halt->depth << ")\n";
+    for (std::map<int, long long>::iterator it = depth_halt.begin();
+         it != depth_halt.end(); ++it) {
+        std::cout << "    depth " << it->first << ": HALT by " << us(it->second)
+                  << " us\n";
+    }
+    return 0;
+}
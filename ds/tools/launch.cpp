@@ -0,0 +1,423 @@
+/****************************************************************************
+ * file: launch.cpp
+ * author: luke le
+ * description:
+ *     starts every node of a config at once and holds them at a start
+ *     barrier. Nodes on this host are forked directly; the others go over
+ *     ssh with at most --parallel sessions in flight. Each node reports
+ *     over the control channel (control_channel.hpp) when it is up and
+ *     when its links are established. Once all are ready the driver
+ *     releases them together and prints how long each phase took.
+ * usage:
+ *     launch <config> [options] [-- node options]
+ *         --exe=PATH          node binary, relative to --dir (build/proj1)
+ *         --dir=DIR           working directory on every host (cwd)
+ *         --user=NAME         ssh user ($USER)
+ *         --domain=SUFFIX     appended to host names without a dot
+ *         --parallel=K        ssh sessions in flight (32)
+ *         --group             one process per host running all its ids
+ *         --control-host=H    name the nodes reach this driver by
+ *                             (127.0.0.1 if every node is local, else
+ *                             this host's name)
+ *         --control-port=P    control port (any free one)
+ *         --ready-timeout=S   seconds to wait for every node (120)
+ *         --go-delay-ms=N     start instant after the release (50)
+ * notes:
+ *     node output goes to <dir>/logs/stdout-<id>.log and stderr-<id>.log
+ *     (stdout-host-<host>.log with --group). When the timeout expires, the
+ *     nodes that are not ready are named and the rest are released
+ *     anyway. A node never hangs at the barrier: it starts on its own
+ *     once the driver exits.
+ ****************************************************************************/
+#include "config.hpp"
+#include "control_channel.hpp"
+#include "shutdown_signal.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <map>
+#include <netdb.h>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+    struct LaunchOptions {
+        std::string exe;
+        std::string dir;
+        std::string user;
+        std::string domain;
+        std::string control_host;
+        int parallel;
+        int control_port;
+        int ready_timeout_s;
+        int go_delay_ms;
+        bool group;
+        std::vector<std::string> node_args;
+
+        LaunchOptions()
+            : exe("build/proj1"), parallel(32), control_port(0),
+              ready_timeout_s(120), go_delay_ms(50), group(false) {}
+    };
+
+    // one process to start: a node, or every node of a host with --group
+    struct Launch {
+        std::string host;
+        bool local;
+        std::vector<int> ids;
+        std::string label;    // log file suffix
+        pid_t pid;
+    };
+
+    const char *value_of(const char *arg, const char *name) {
+        size_t len = std::strlen(name);
+        if (std::strncmp(arg, name, len) != 0 || arg[len] != '=') return nullptr;
+        return arg + len + 1;
+    } // value_of()
+
+    double ms(int64_t ns) { return ns / 1e6; }
+
+    std::string ids_text(const std::vector<int> &ids) {
+        std::ostringstream out;
+        for (size_t i = 0; i < ids.size(); ++i) out << (i ? "," : "") << ids[i];
+        return out.str();
+    } // ids_text()
+
+    /**
+     * @brief names this host answers to: its hostname, the short form
+     *        and the canonical (fully qualified) name
+     */
+    std::vector<std::string> local_names() {
+        std::vector<std::string> names;
+        names.push_back("localhost");
+        char buf[256] = {0};
+        if (::gethostname(buf, sizeof(buf) - 1) != 0) return names;
+        names.push_back(buf);
+        const std::string full(buf);
+        names.push_back(full.substr(0, full.find('.')));
+
+        struct addrinfo hints, *res = nullptr;
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_flags = AI_CANONNAME;
+        if (::getaddrinfo(buf, nullptr, &hints, &res) == 0 && res) {
+            if (res->ai_canonname) names.push_back(res->ai_canonname);
+            ::freeaddrinfo(res);
+        }
+        return names;
+    } // local_names()
+
+    bool is_local(const std::string &host,
+                  const std::vector<std::string> &names) {
+        if (host.compare(0, 4, "127.") == 0) return true;
+        return std::find(names.begin(), names.end(), host) != names.end();
+    } // is_local()
+
+    /**
+     * @brief fork the node process itself, detached from this terminal
+     */
+    pid_t start_local(const Launch &l, const LaunchOptions &o,
+                      const std::vector<std::string> &args) {
+        const std::string out = "logs/stdout-" + l.label + ".log";
+        const std::string err = "logs/stderr-" + l.label + ".log";
+        std::vector<char *> argv;
+        for (size_t i = 0; i < args.size(); ++i)
+            argv.push_back(const_cast<char *>(args[i].c_str()));
+        argv.push_back(nullptr);
+
+        const pid_t pid = ::fork();
+        if (pid != 0) return pid;
+        if (::chdir(o.dir.c_str()) != 0) _exit(127);
+        ::mkdir("logs", 0755);
+        const int fo = ::open(out.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        const int fe = ::open(err.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        const int fi = ::open("/dev/null", O_RDONLY);
+        if (fo < 0 || fe < 0 || fi < 0) _exit(127);
+        ::dup2(fi, 0);
+        ::dup2(fo, 1);
+        ::dup2(fe, 2);
+        ::setsid();
+        ::execv(argv[0], argv.data());
+        std::perror("[!] exec");
+        _exit(127);
+    } // start_local()
+
+    /**
+     * @brief ssh to the host and leave the node running there; the ssh
+     *        session exits as soon as the node is started
+     */
+    pid_t start_remote(const Launch &l, const LaunchOptions &o,
+                       const std::vector<std::string> &args) {
+        std::ostringstream cmd;
+        cmd << "cd '" << o.dir << "' && mkdir -p logs && nohup setsid";
+        for (size_t i = 0; i < args.size(); ++i) cmd << " " << args[i];
+        cmd << " > logs/stdout-" << l.label << ".log 2> logs/stderr-"
+            << l.label << ".log < /dev/null &";
+        const std::string target =
+            o.user.empty() ? l.host : o.user + "@" + l.host;
+        const std::string remote = cmd.str();
+
+        const pid_t pid = ::fork();
+        if (pid != 0) return pid;
+        const int fi = ::open("/dev/null", O_RDWR);
+        if (fi >= 0) {
+            ::dup2(fi, 0);
+            ::dup2(fi, 1);
+        }
+        ::execlp("ssh", "ssh", "-n", "-o", "BatchMode=yes", "-o",
+                 "ConnectTimeout=10", target.c_str(), remote.c_str(),
+                 static_cast<char *>(nullptr));
+        std::perror("[!] exec ssh");
+        _exit(127);
+    } // start_remote()
+
+    /**
+     * @brief median, last arrival and the node that arrived last
+     */
+    void summarize(const std::vector<int64_t> &at, int64_t t0, double &median,
+                   double &last, int &slowest) {
+        std::vector<int64_t> seen;
+        slowest = -1;
+        for (size_t i = 0; i < at.size(); ++i) {
+            if (at[i] < 0) continue;
+            seen.push_back(at[i] - t0);
+            if (slowest < 0 || at[i] > at[slowest]) slowest = static_cast<int>(i);
+        }
+        median = last = 0;
+        if (seen.empty()) return;
+        std::sort(seen.begin(), seen.end());
+        median = ms(seen[seen.size() / 2]);
+        last = ms(seen.back());
+    } // summarize()
+
+    void usage(const char *prog) {
+        std::cerr << "usage: " << prog << " <config> [--exe=PATH] [--dir=DIR] "
+                  << "[--user=NAME] [--domain=SUFFIX]\n"
+                  << "       [--parallel=K] [--group] [--control-host=H] "
+                  << "[--control-port=P]\n"
+                  << "       [--ready-timeout=S] [--go-delay-ms=N] "
+                  << "[-- node options]\n";
+    } // usage()
+
+} // end anonymous namespace
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+    LaunchOptions o;
+    char cwd[4096];
+    o.dir = ::getcwd(cwd, sizeof(cwd)) ? cwd : ".";
+    if (const char *u = std::getenv("USER")) o.user = u;
+
+    for (int i = 2; i < argc; ++i) {
+        const char *arg = argv[i];
+        const char *v = nullptr;
+        bool ok = true;
+        if (std::strcmp(arg, "--") == 0) {
+            for (++i; i < argc; ++i) o.node_args.push_back(argv[i]);
+        } else if ((v = value_of(arg, "--exe"))) {
+            o.exe = v;
+        } else if ((v = value_of(arg, "--dir"))) {
+            o.dir = v;
+        } else if ((v = value_of(arg, "--user"))) {
+            o.user = v;
+        } else if ((v = value_of(arg, "--domain"))) {
+            o.domain = v;
+        } else if ((v = value_of(arg, "--control-host"))) {
+            o.control_host = v;
+        } else if ((v = value_of(arg, "--parallel"))) {
+            o.parallel = std::atoi(v);
+            ok = o.parallel > 0;
+        } else if ((v = value_of(arg, "--control-port"))) {
+            o.control_port = std::atoi(v);
+            ok = o.control_port >= 0 && o.control_port < 65536;
+        } else if ((v = value_of(arg, "--ready-timeout"))) {
+            o.ready_timeout_s = std::atoi(v);
+            ok = o.ready_timeout_s > 0;
+        } else if ((v = value_of(arg, "--go-delay-ms"))) {
+            o.go_delay_ms = std::atoi(v);
+            ok = o.go_delay_ms >= 0;
+        } else if (std::strcmp(arg, "--group") == 0) {
+            o.group = true;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            std::cerr << "[!] invalid option: " << arg << "\n";
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    Config cfg;
+    if (!parse_config(argv[1], cfg)) return 1;
+
+    // one launch per node, or per host with --group
+    const std::vector<std::string> names = local_names();
+    std::vector<Launch> launches;
+    std::map<std::string, size_t> by_host;
+    bool all_local = true;
+    for (int id = 0; id < cfg.n; ++id) {
+        std::string host = cfg.nodes[id].host;
+        if (!o.domain.empty() && host.find('.') == std::string::npos &&
+            host != "localhost")
+            host += o.domain;
+        if (o.group && by_host.count(host)) {
+            launches[by_host[host]].ids.push_back(id);
+            continue;
+        }
+        Launch l;
+        l.host = host;
+        l.local = is_local(host, names) || is_local(cfg.nodes[id].host, names);
+        l.ids.push_back(id);
+        l.label = o.group ? "host-" + host : std::to_string(id);
+        l.pid = -1;
+        all_local = all_local && l.local;
+        by_host[host] = launches.size();
+        launches.push_back(l);
+    }
+    // highest ids first: with the default --setup=ordered a node dials its
+    // higher-id neighbors, which are then already listening
+    std::reverse(launches.begin(), launches.end());
+    if (o.control_host.empty())
+        o.control_host = all_local ? "127.0.0.1" : names.size() > 1 ? names[1]
+                                                                    : "localhost";
+
+    ControlServer server;
+    if (!server.listen(o.control_port)) return 1;
+    const std::string control =
+        "--control=" + o.control_host + ":" + std::to_string(server.port());
+
+    // ---- launch and collect reports at the same time ----
+    const int64_t t0 = ShutdownSignal::now_ns();
+    const int64_t deadline = t0 + o.ready_timeout_s * 1000000000LL;
+    std::vector<int64_t> up_at(cfg.n, -1), ready_at(cfg.n, -1);
+    std::vector<ControlEvent> ready_ev(cfg.n);
+    std::vector<char> failed(cfg.n, 0);
+    std::map<pid_t, size_t> ssh_pid, node_pid;
+    int ups = 0, readies = 0, failures = 0, remote = 0;
+    int64_t launched_at = -1;
+    size_t next = 0, in_flight = 0;
+
+    while (readies + failures < cfg.n && ShutdownSignal::now_ns() < deadline) {
+        while (next < launches.size() &&
+               (launches[next].local || in_flight < static_cast<size_t>(o.parallel))) {
+            Launch &l = launches[next];
+            std::vector<std::string> args;
+            args.push_back(o.exe);
+            args.push_back(ids_text(l.ids));     // a list runs hosted
+            args.insert(args.end(), o.node_args.begin(), o.node_args.end());
+            args.push_back(control);
+            if (l.local) {
+                l.pid = start_local(l, o, args);
+                node_pid[l.pid] = next;
+            } else {
+                l.pid = start_remote(l, o, args);
+                ssh_pid[l.pid] = next;
+                ++in_flight;
+                ++remote;
+            }
+            if (l.pid < 0) {
+                std::perror("[!] fork");
+                return 1;
+            }
+            ++next;
+        }
+
+        // ssh sessions end once their node is started; a local node that
+        // exits before the barrier has failed
+        int status = 0;
+        pid_t pid;
+        while ((pid = ::waitpid(-1, &status, WNOHANG)) > 0) {
+            std::map<pid_t, size_t>::iterator it = ssh_pid.find(pid);
+            const bool ssh = it != ssh_pid.end();
+            if (!ssh) it = node_pid.find(pid);
+            if (it == node_pid.end()) continue;
+            const Launch &l = launches[it->second];
+            if (ssh) --in_flight;
+            if (!ssh || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                std::cerr << "[!] " << (ssh ? "ssh to " : "process on ")
+                          << l.host << " for node(s) " << ids_text(l.ids)
+                          << " failed\n";
+                for (size_t k = 0; k < l.ids.size(); ++k) {
+                    if (ready_at[l.ids[k]] >= 0 || failed[l.ids[k]]) continue;
+                    failed[l.ids[k]] = 1;
+                    ++failures;
+                }
+            }
+        }
+        if (launched_at < 0 && next == launches.size() && in_flight == 0)
+            launched_at = ShutdownSignal::now_ns();
+
+        std::vector<ControlEvent> events;
+        server.poll(10, events);
+        for (size_t k = 0; k < events.size(); ++k) {
+            const ControlEvent &ev = events[k];
+            if (ev.id >= cfg.n) continue;
+            if (ev.kind == ControlEvent::UP && up_at[ev.id] < 0) {
+                up_at[ev.id] = ev.at_ns;
+                ++ups;
+            } else if (ev.kind == ControlEvent::READY && ready_at[ev.id] < 0) {
+                ready_at[ev.id] = ev.at_ns;
+                ready_ev[ev.id] = ev;
+                ++readies;
+            }
+        }
+    }
+    if (launched_at < 0) launched_at = ShutdownSignal::now_ns();
+
+    // ---- barrier ----
+    const int64_t released_at = ShutdownSignal::now_ns();
+    const size_t reached = server.release(
+        ShutdownSignal::wall_ns() + o.go_delay_ms * 1000000LL);
+
+    // ---- per-phase timings ----
+    double median = 0, last = 0;
+    int slowest = -1;
+    std::cout << "[*] launch: " << launches.size() << " processes for "
+              << cfg.n << " nodes (" << launches.size() - remote
+              << " local, " << remote << " over ssh, " << o.parallel
+              << " in parallel) in " << ms(launched_at - t0) << " ms\n";
+    summarize(up_at, t0, median, last, slowest);
+    std::cout << "[*] up: " << ups << "/" << cfg.n << " nodes, last at "
+              << last << " ms (median " << median << " ms, slowest node "
+              << slowest << ")\n";
+    summarize(ready_at, t0, median, last, slowest);
+    int64_t max_setup = 0;
+    int max_setup_node = -1;
+    for (int id = 0; id < cfg.n; ++id) {
+        if (ready_at[id] < 0) continue;
+        const ControlEvent &ev = ready_ev[id];
+        if (ev.setup_us > max_setup) {
+            max_setup = ev.setup_us;
+            max_setup_node = id;
+        }
+        if (ev.links < ev.expected)
+            std::cerr << "[~] node " << id << " has " << ev.links << " of "
+                      << ev.expected << " links\n";
+    }
+    std::cout << "[*] links: " << readies << "/" << cfg.n
+              << " nodes ready, last at " << last << " ms (median " << median
+              << " ms, slowest node " << slowest << "); longest setup "
+              << max_setup / 1000.0 << " ms (node " << max_setup_node << ")\n";
+    if (readies < cfg.n) {
+        std::cerr << "[!] not ready:";
+        for (int id = 0; id < cfg.n; ++id)
+            if (ready_at[id] < 0) std::cerr << " " << id;
+        std::cerr << "\n";
+    }
+    std::cout << "[+] barrier released to " << reached << " processes at "
+              << ms(released_at - t0) << " ms; computation starts "
+              << o.go_delay_ms << " ms later\n";
+    return readies == cfg.n ? 0 : 1;
+}
@@ -0,0 +1,111 @@
+/****************************************************************************
+ * file: logfmt.cpp
+ * author: luke le
+ * description:
+ *     formats binary logs (logs/<config>-<id>.log.bin, written with
+ *     --log=binary) as text or JSON lines. Several logs are merged into one
+ *     stream ordered by wall-clock time.
+ * usage:
+ *     logfmt logs/config-*.log.bin             text, one record per line
+ *     logfmt --json logs/config-3.log.bin      JSON lines
+ * notes:
+ *     text lines are "<seconds>.<us> n<node> t<thread> [*] message"; node
+ *     is "-" for records not tied to a node (e.g. the host's own lines).
+ ****************************************************************************/
+#include "logger.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+    bool earlier(const LogEntry &a, const LogEntry &b) {
+        return a.wall_ns < b.wall_ns;
+    } // earlier()
+
+    const char *level_name(LogLevel l) {
+        switch (l) {
+        case LEVEL_DEBUG: return "debug";
+        case LEVEL_INFO: return "info";
+        case LEVEL_WARN: return "warn";
+        default: return "error";
+        }
+    } // level_name()
+
+    std::string json_escape(const std::string &s) {
+        std::string out;
+        for (size_t i = 0; i < s.size(); ++i) {
+            const unsigned char c = static_cast<unsigned char>(s[i]);
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += s[i];
+            } else if (c < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out += buf;
+            } else {
+                out += s[i];
+            }
+        }
+        return out;
+    } // json_escape()
+
+    void print_text(const LogEntry &e) {
+        char stamp[48];
+        std::snprintf(stamp, sizeof(stamp), "%lld.%06lld",
+                      static_cast<long long>(e.wall_ns / 1000000000),
+                      static_cast<long long>(e.wall_ns % 1000000000 / 1000));
+        std::cout << stamp << " n"
+                  << (e.node >= 0 ? std::to_string(e.node) : "-") << " t"
+                  << e.thread << " " << format_log_line(e) << "\n";
+    } // print_text()
+
+    void print_json(const LogEntry &e) {
+        std::cout << "{\"ts_ns\":" << e.wall_ns << ",\"node\":" << e.node
+                  << ",\"thread\":" << e.thread << ",\"level\":\""
+                  << level_name(e.level) << "\",\"file\":\""
+                  << json_escape(e.file) << "\",\"line\":" << e.line
+                  << ",\"msg\":\"" << json_escape(format_log(e.fmt, e.args))
+                  << "\",\"suppressed\":" << e.suppressed << "}\n";
+    } // print_json()
+
+} // end anonymous namespace
+
+int main(int argc, char *argv[]) {
+    bool json = false;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--json") == 0) json = true;
+        else paths.push_back(argv[i]);
+    }
+    if (paths.empty()) {
+        std::cerr << "usage: " << argv[0] << " [--json] <log.bin>...\n";
+        return 1;
+    }
+
+    // each reader keeps the formats its records point to
+    std::vector<LogReader *> readers;
+    std::vector<LogEntry> entries;
+    bool ok = true;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        LogReader *r = new LogReader();
+        readers.push_back(r);
+        if (!r->open(paths[i])) {
+            ok = false;
+            continue;
+        }
+        LogEntry e;
+        while (r->next(e)) entries.push_back(e);
+    }
+    std::stable_sort(entries.begin(), entries.end(), earlier);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (json) print_json(entries[i]);
+        else print_text(entries[i]);
+    }
+    for (size_t i = 0; i < readers.size(); ++i) delete readers[i];
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,193 @@
+/****************************************************************************
+ * file: topogen.cpp
+ * author: luke le
+ * description:
+ *     writes synthetic configs for scale experiments: ring, 2D torus,
+ *     random regular, Erdos-Renyi and scale-free (Barabasi-Albert)
+ *     topologies on localhost ports.
+ * usage:
+ *     topogen <kind> <n> [options]
+ *         kind: ring | torus | random-regular | erdos-renyi | scale-free
+ *         --degree=D      regular degree / expected degree / 2 * BA m (4)
+ *         --p=P           Erdos-Renyi link probability (from degree)
+ *         --rows=R        torus rows (closest divisor to sqrt(n))
+ *         --seed=S        seed for the random kinds (1)
+ *         --hosts=A,B,..  hosts assigned round robin (localhost)
+ *         --base-port=P   node i listens on P + i (10000)
+ *         --globals=a,b,c,d,e  minPerActive, maxPerActive,
+ *                         minSendDelay, snapshotDelay, maxNumber
+ *                         (6,10,100,2000,15 as in ds/config.txt)
+ *         -o PATH         write to PATH instead of stdout
+ * notes:
+ *     the default ports stay below Linux's ephemeral range (32768+) for
+ *     up to 22768 nodes, so listeners do not collide with the source
+ *     ports of outgoing connects. A summary (links, degrees, depth of the
+ *     BFS tree from node 0) goes to stderr.
+ ****************************************************************************/
+#include "topology_gen.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+    const char *value_of(const char *arg, const char *name) {
+        size_t len = std::strlen(name);
+        if (std::strncmp(arg, name, len) != 0 || arg[len] != '=') return nullptr;
+        return arg + len + 1;
+    } // value_of()
+
+    bool parse_long(const char *s, long long &out) {
+        char *end = nullptr;
+        out = std::strtoll(s, &end, 10);
+        return *s != '\0' && *end == '\0';
+    } // parse_long()
+
+    std::vector<std::string> split(const std::string &s, char sep) {
+        std::vector<std::string> parts;
+        std::istringstream in(s);
+        std::string part;
+        while (std::getline(in, part, sep))
+            if (!part.empty()) parts.push_back(part);
+        return parts;
+    } // split()
+
+    /**
+     * @brief depth of the BFS tree rooted at node 0
+     */
+    int bfs_depth(const Config &cfg) {
+        std::vector<int> depth(cfg.n, -1), queue(1, 0);
+        depth[0] = 0;
+        int deepest = 0;
+        for (size_t q = 0; q < queue.size(); ++q) {
+            const int u = queue[q];
+            const NeighborRange row = cfg.neighbors[u];
+            for (const int *v = row.begin(); v != row.end(); ++v) {
+                if (depth[*v] >= 0) continue;
+                depth[*v] = depth[u] + 1;
+                deepest = std::max(deepest, depth[*v]);
+                queue.push_back(*v);
+            }
+        }
+        return deepest;
+    } // bfs_depth()
+
+    void usage(const char *prog) {
+        std::cerr << "usage: " << prog << " <ring|torus|random-regular|"
+                  << "erdos-renyi|scale-free> <n> [--degree=D] [--p=P]\n"
+                  << "       [--rows=R] [--seed=S] [--hosts=A,B,...] "
+                  << "[--base-port=P]\n"
+                  << "       [--globals=min,max,delay,snapshot,maxNumber] "
+                  << "[-o PATH]\n";
+    } // usage()
+
+} // end anonymous namespace
+
+int main(int argc, char *argv[]) {
+    TopologySpec spec;
+    long long num = 0;
+    if (argc < 3 || !parse_topology_kind(argv[1], spec.kind) ||
+        !parse_long(argv[2], num) || num < 2 || num > 10000000) {
+        usage(argv[0]);
+        return 1;
+    }
+    spec.n = static_cast<int>(num);
+
+    Config cfg;
+    cfg.minPerActive = 6;
+    cfg.maxPerActive = 10;
+    cfg.minSendDelay_ms = 100;
+    cfg.snapshotDelay_ms = 2000;
+    cfg.maxNumber = 15;
+    std::string out_path;
+
+    for (int i = 3; i < argc; ++i) {
+        const char *arg = argv[i];
+        const char *v = nullptr;
+        bool ok = true;
+        if ((v = value_of(arg, "--degree"))) {
+            ok = parse_long(v, num) && num >= 0 && num < spec.n;
+            spec.degree = static_cast<int>(num);
+        } else if ((v = value_of(arg, "--p"))) {
+            char *end = nullptr;
+            spec.p = std::strtod(v, &end);
+            ok = *v != '\0' && *end == '\0' && spec.p >= 0.0 && spec.p <= 1.0;
+        } else if ((v = value_of(arg, "--rows"))) {
+            ok = parse_long(v, num) && num > 0 && num <= spec.n;
+            spec.rows = static_cast<int>(num);
+        } else if ((v = value_of(arg, "--seed"))) {
+            ok = parse_long(v, num);
+            spec.seed = static_cast<uint64_t>(num);
+        } else if ((v = value_of(arg, "--hosts"))) {
+            spec.hosts = split(v, ',');
+            ok = !spec.hosts.empty();
+        } else if ((v = value_of(arg, "--base-port"))) {
+            ok = parse_long(v, num) && num > 0 && num < 65536;
+            spec.base_port = static_cast<int>(num);
+        } else if ((v = value_of(arg, "--globals"))) {
+            std::vector<std::string> g = split(v, ',');
+            long long vals[5];
+            ok = g.size() == 5;
+            for (size_t k = 0; ok && k < 5; ++k)
+                ok = parse_long(g[k].c_str(), vals[k]) && vals[k] >= 0;
+            if (ok) {
+                cfg.minPerActive = static_cast<int>(vals[0]);
+                cfg.maxPerActive = static_cast<int>(vals[1]);
+                cfg.minSendDelay_ms = static_cast<int>(vals[2]);
+                cfg.snapshotDelay_ms = static_cast<int>(vals[3]);
+                cfg.maxNumber = static_cast<int>(vals[4]);
+            }
+        } else if (std::strcmp(arg, "-o") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            std::cerr << "[!] invalid option: " << arg << "\n";
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!generate_topology(spec, cfg)) return 1;
+
+    std::ostringstream comment;
+    comment << "generated: topogen";
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-o") == 0) {
+            ++i;
+            continue;
+        }
+        comment << " " << argv[i];
+    }
+
+    if (out_path.empty()) {
+        write_config(std::cout, cfg, comment.str());
+    } else {
+        std::ofstream out(out_path.c_str(), std::ios::trunc);
+        write_config(out, cfg, comment.str());
+        if (!out.flush()) {
+            std::cerr << "[!] cannot write " << out_path << "\n";
+            return 1;
+        }
+    }
+
+    size_t min_deg = cfg.neighbors[0].size(), max_deg = min_deg;
+    for (int i = 1; i < cfg.n; ++i) {
+        min_deg = std::min(min_deg, cfg.neighbors[i].size());
+        max_deg = std::max(max_deg, cfg.neighbors[i].size());
+    }
+    std::cerr << "[+] " << argv[1] << ": " << cfg.n << " nodes, "
+              << cfg.neighbors.entries() / 2 << " links, degree " << min_deg
+              << ".." << max_deg << " (mean "
+              << static_cast<double>(cfg.neighbors.entries()) / cfg.n
+              << "), BFS depth " << bfs_depth(cfg) << " from node 0\n";
+    return 0;
+}
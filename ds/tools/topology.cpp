@@ -0,0 +1,146 @@
+/****************************************************************************
+ * file: topology.cpp
+ * author: luke le
+ * description:
+ *     compiles a config file into the binary topology image that nodes
+ *     load with --topology=PATH, inspects existing images, and generates
+ *     the fixed_topology.hpp header for a proj1 specialized to one config.
+ * usage:
+ *     topology compile <config> [image]
+ *     topology check <image> [config]
+ *     topology show <image>
+ *     topology header <config> <header>
+ * notes:
+ *     compile defaults the image to the config path with its extension
+ *     replaced by .topo. check loads the image the way a node does
+ *     (including the staleness test against config, if given) and reports
+ *     how long that took.
+ *
+ *     header is run by CMake when FIXED_TOPOLOGY is ON; it writes n and
+ *     the CSR adjacency as constants, and the header is only rewritten
+ *     when its content changes so an unchanged config does not rebuild
+ *     proj1.
+ ****************************************************************************/
+#include "topology_image.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace {
+
+    std::string default_image(const std::string &config) {
+        const size_t slash = config.find_last_of('/');
+        const size_t dot = config.find_last_of('.');
+        if (dot == std::string::npos ||
+            (slash != std::string::npos && dot < slash))
+            return config + ".topo";
+        return config.substr(0, dot) + ".topo";
+    } // default_image()
+
+    /**
+     * @brief write n and the adjacency of cfg as C++11 constants
+     */
+    std::string fixed_topology_header(const Config &cfg,
+                                      const std::string &config) {
+        const std::vector<uint32_t> &offsets = cfg.neighbors.offsets();
+        const std::vector<int> &targets = cfg.neighbors.targets();
+        size_t max_degree = 0;
+        for (int i = 0; i < cfg.n; ++i)
+            if (cfg.neighbors[i].size() > max_degree)
+                max_degree = cfg.neighbors[i].size();
+
+        std::ostringstream out;
+        out << "// generated by `topology header " << config
+            << "`; do not edit\n"
+            << "#ifndef FIXED_TOPOLOGY_HPP\n#define FIXED_TOPOLOGY_HPP\n\n"
+            << "#include <cstddef>\n\nnamespace fixed_topology {\n\n"
+            << "constexpr size_t n = " << cfg.n << ";\n"
+            << "constexpr size_t max_degree = " << max_degree << ";\n"
+            << "constexpr size_t entries = " << targets.size() << ";\n\n"
+            << "// neighbors of node i: targets[offsets[i] .. offsets[i + 1])\n"
+            << "constexpr unsigned offsets[n + 1] = {";
+        for (size_t i = 0; i < offsets.size(); ++i)
+            out << (i % 12 ? " " : "\n    ") << offsets[i] << ",";
+        out << "\n};\nconstexpr int targets[entries + 1] = {";
+        for (size_t i = 0; i < targets.size(); ++i)
+            out << (i % 12 ? " " : "\n    ") << targets[i] << ",";
+        out << "\n    -1   // keeps the array non-empty\n};\n\n"
+            << "} // namespace fixed_topology\n\n#endif // FIXED_TOPOLOGY_HPP\n";
+        return out.str();
+    } // fixed_topology_header()
+
+    void usage(const char *prog) {
+        std::cerr << "usage: " << prog << " compile <config> [image]\n"
+                  << "       " << prog << " check <image> [config]\n"
+                  << "       " << prog << " show <image>\n"
+                  << "       " << prog << " header <config> <header>\n";
+    } // usage()
+
+} // end anonymous namespace
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        usage(argv[0]);
+        return 1;
+    }
+    const std::string cmd = argv[1];
+
+    if (cmd == "compile") {
+        const std::string image = argc > 3 ? argv[3] : default_image(argv[2]);
+        if (!compile_topology(argv[2], image)) return 1;
+        std::cout << "[+] " << argv[2] << " -> " << image << "\n";
+        return 0;
+    }
+
+    if (cmd == "header" && argc > 3) {
+        Config cfg;
+        if (!parse_config(argv[2], cfg)) return 1;
+        const std::string text = fixed_topology_header(cfg, argv[2]);
+
+        std::ifstream old(argv[3]);
+        std::ostringstream current;
+        current << old.rdbuf();
+        if (old && current.str() == text) return 0;    // leave mtime alone
+        old.close();
+
+        std::ofstream out(argv[3], std::ios::trunc);
+        out << text;
+        if (!out.flush()) {
+            std::cerr << "[!] cannot write " << argv[3] << "\n";
+            return 1;
+        }
+        std::cout << "[+] " << argv[2] << " -> " << argv[3] << " (n = "
+                  << cfg.n << ")\n";
+        return 0;
+    }
+
+    if (cmd == "check" || cmd == "show") {
+        const std::string config = cmd == "check" && argc > 3 ? argv[3] : "";
+        Config cfg;
+        const std::chrono::steady_clock::time_point t0 =
+            std::chrono::steady_clock::now();
+        if (!load_topology(argv[2], config, cfg)) return 1;
+        const double us = std::chrono::duration<double, std::micro>(
+                              std::chrono::steady_clock::now() - t0)
+                              .count();
+
+        if (cmd == "show") {
+            print_config(cfg);
+            return 0;
+        }
+        int unresolved = 0;
+        for (size_t i = 0; i < cfg.nodes.size(); ++i)
+            unresolved += cfg.nodes[i].addr == 0;
+        std::cout << "[+] " << argv[2] << ": " << cfg.n << " nodes, "
+                  << cfg.neighbors.entries() / 2 << " links, " << unresolved
+                  << " unresolved hosts; loaded in " << us << " us\n";
+        return 0;
+    }
+
+    usage(argv[0]);
+    return 1;
+}
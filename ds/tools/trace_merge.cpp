@@ -0,0 +1,242 @@
+/****************************************************************************
+ * file: trace_merge.cpp
+ * author: luke le
+ * description:
+ *     merges the event traces of all nodes (logs/<config>-<id>.trace, from
+ *     --trace) into one Chrome trace JSON file for chrome://tracing or
+ *     ui.perfetto.dev: one process per node, one track per thread, and an
+ *     arrow from every APP send to its receipt.
+ * usage:
+ *     trace_merge logs/config-*.trace                  JSON on stdout
+ *     trace_merge -o trace.json logs/config-*.trace
+ * notes:
+ *     timestamps are mapped to wall-clock time with the clock pair each
+ *     trace recorded when it started. Nodes on different machines may
+ *     still disagree by more than a message latency, so the files are then
+ *     shifted, forward only, until every APP receipt comes no earlier than
+ *     its send; sends and receipts are paired by the sender's own vector
+ *     clock entry, which the receiver read from the frame.
+ ****************************************************************************/
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+    struct Event {
+        TraceRecord r;
+        size_t file;
+        int64_t wall_ns;          // before the per-file shift
+    };
+
+    // (sender, receiver, sender's clock entry)
+    struct FlowKey {
+        int from;
+        int to;
+        int64_t seq;
+        bool operator<(const FlowKey &o) const {
+            if (from != o.from) return from < o.from;
+            if (to != o.to) return to < o.to;
+            return seq < o.seq;
+        }
+    };
+
+    struct Flow {
+        int send;                 // event index, -1 if not seen
+        int recv;
+    };
+
+    bool load(const std::string &path, size_t file, std::vector<Event> &out) {
+        TraceReader reader;
+        if (!reader.open(path)) return false;
+        const int64_t offset = reader.wall_anchor() - reader.monotonic_anchor();
+        Event e;
+        e.file = file;
+        while (reader.next(e.r)) {
+            e.wall_ns = e.r.ts_ns + offset;
+            out.push_back(e);
+        }
+        return true;
+    } // load()
+
+    /**
+     * @brief shift files forward until no APP is received before it was
+     *        sent; returns how many pairs needed a shift.
+     */
+    size_t align(const std::vector<Event> &events,
+                 const std::map<FlowKey, Flow> &flows,
+                 std::vector<int64_t> &shift) {
+        size_t violations = 0;
+        // each pass settles at least one more file along any causal chain
+        for (size_t pass = 0; pass <= shift.size(); ++pass) {
+            bool changed = false;
+            for (std::map<FlowKey, Flow>::const_iterator it = flows.begin();
+                 it != flows.end(); ++it) {
+                if (it->second.send < 0 || it->second.recv < 0) continue;
+                const Event &s = events[it->second.send];
+                const Event &r = events[it->second.recv];
+                if (s.file == r.file) continue;     // one clock already
+                const int64_t sent = s.wall_ns + shift[s.file];
+                const int64_t got = r.wall_ns + shift[r.file];
+                if (got >= sent) continue;
+                shift[r.file] += sent - got;
+                changed = true;
+                if (pass == 0) ++violations;
+            }
+            if (!changed) break;
+        }
+        return violations;
+    } // align()
+
+    std::string json_escape(const std::string &s) {
+        std::string out;
+        for (size_t i = 0; i < s.size(); ++i) {
+            if (s[i] == '"' || s[i] == '\\') out += '\\';
+            out += s[i];
+        }
+        return out;
+    } // json_escape()
+
+    std::string micros(int64_t ns) {
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "%lld.%03lld",
+                      static_cast<long long>(ns / 1000),
+                      static_cast<long long>(ns % 1000));
+        return buf;
+    } // micros()
+
+    // a node's events go to its own process; the host's own to one per file
+    int pid_of(const Event &e) {
+        return e.r.node >= 0 ? e.r.node : 1000000 + static_cast<int>(e.file);
+    } // pid_of()
+
+} // end anonymous namespace
+
+int main(int argc, char *argv[]) {
+    std::string out_path;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc) out_path = argv[++i];
+        else paths.push_back(argv[i]);
+    }
+    if (paths.empty()) {
+        std::cerr << "usage: " << argv[0] << " [-o out.json] <trace>...\n";
+        return 1;
+    }
+
+    std::vector<Event> events;
+    for (size_t f = 0; f < paths.size(); ++f)
+        if (!load(paths[f], f, events)) return 1;
+
+    std::map<FlowKey, Flow> flows;
+    for (size_t i = 0; i < events.size(); ++i) {
+        const TraceRecord &r = events[i].r;
+        if (r.phase != 's' && r.phase != 'f') continue;
+        FlowKey k;
+        k.from = r.phase == 's' ? r.node : r.peer;
+        k.to = r.phase == 's' ? r.peer : r.node;
+        k.seq = r.arg;
+        std::map<FlowKey, Flow>::iterator it = flows.find(k);
+        if (it == flows.end()) {
+            Flow fl = {-1, -1};
+            it = flows.insert(std::make_pair(k, fl)).first;
+        }
+        (r.phase == 's' ? it->second.send : it->second.recv) =
+            static_cast<int>(i);
+    }
+
+    std::vector<int64_t> shift(paths.size(), 0);
+    const size_t violations = align(events, flows, shift);
+    for (size_t f = 0; f < shift.size(); ++f) {
+        if (shift[f] > 0)
+            std::cerr << "[*] " << paths[f] << " shifted by "
+                      << shift[f] / 1000 << " us to keep sends before receipts\n";
+    }
+    if (violations)
+        std::cerr << "[*] " << violations << " messages were received before "
+                  << "they were sent on unshifted clocks\n";
+
+    int64_t t0 = 0;
+    for (size_t i = 0; i < events.size(); ++i) {
+        const int64_t t = events[i].wall_ns + shift[events[i].file];
+        if (i == 0 || t < t0) t0 = t;
+    }
+
+    std::ostringstream json;
+    json << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    std::map<int, size_t> named_pids;
+    std::map<std::pair<int, int>, size_t> named_tids;
+    size_t paired = 0;
+    for (size_t i = 0; i < events.size(); ++i) {
+        const Event &e = events[i];
+        const TraceRecord &r = e.r;
+        const int pid = pid_of(e);
+        // threads are numbered per file
+        const int tid = static_cast<int>(e.file) * 10000 +
+                        static_cast<int>(r.thread);
+
+        if (!named_pids.count(pid)) {
+            named_pids[pid] = e.file;
+            json << (first ? "\n" : ",\n") << "{\"name\":\"process_name\","
+                 << "\"ph\":\"M\",\"pid\":" << pid << ",\"args\":{\"name\":\""
+                 << (r.node >= 0 ? "node " + std::to_string(r.node)
+                                 : "host " + json_escape(paths[e.file]))
+                 << "\"}}";
+            first = false;
+        }
+        if (!named_tids.count(std::make_pair(pid, tid))) {
+            named_tids[std::make_pair(pid, tid)] = e.file;
+            json << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+                 << ",\"tid\":" << tid << ",\"args\":{\"name\":\"thread "
+                 << r.thread << "\"}}";
+        }
+
+        const std::string ts = micros(e.wall_ns + shift[e.file] - t0);
+        if (r.phase == 's' || r.phase == 'f') {
+            // only arrows with both ends
+            FlowKey k;
+            k.from = r.phase == 's' ? r.node : r.peer;
+            k.to = r.phase == 's' ? r.peer : r.node;
+            k.seq = r.arg;
+            const Flow &fl = flows.find(k)->second;
+            if (fl.send < 0 || fl.recv < 0) continue;
+            if (r.phase == 'f') ++paired;
+            json << ",\n{\"name\":\"" << json_escape(r.name)
+                 << "\",\"cat\":\"flow\",\"ph\":\"" << r.phase << "\""
+                 << (r.phase == 'f' ? ",\"bp\":\"e\"" : "") << ",\"id\":\""
+                 << k.from << ">" << k.to << ":" << k.seq << "\",\"pid\":"
+                 << pid << ",\"tid\":" << tid << ",\"ts\":" << ts << "}";
+            continue;
+        }
+        json << ",\n{\"name\":\"" << json_escape(r.name) << "\",\"ph\":\""
+             << r.phase << "\",\"pid\":" << pid << ",\"tid\":" << tid
+             << ",\"ts\":" << ts;
+        if (r.phase == 'X') json << ",\"dur\":" << micros(r.dur_ns);
+        if (r.phase == 'i') json << ",\"s\":\"t\"";
+        json << ",\"args\":{\"arg\":" << r.arg << "}}";
+    }
+    json << "\n]}\n";
+
+    if (out_path.empty()) {
+        std::cout << json.str();
+    } else {
+        std::ofstream out(out_path.c_str(), std::ios::trunc);
+        out << json.str();
+        if (!out) {
+            std::cerr << "[!] cannot write " << out_path << "\n";
+            return 1;
+        }
+    }
+    std::cerr << "[+] " << events.size() << " events from " << paths.size()
+              << " traces, " << paired << " messages paired\n";
+    return 0;
+}
@@ -0,0 +1,134 @@
+/****************************************************************************
+ * file: adjacency.hpp
+ * author: luke le
+ * description:
+ *     declares the compressed sparse row (CSR) neighbor table behind
+ *     Config::neighbors.
+ * notes:
+ *     all neighbor lists live in one targets array, row i being
+ *     targets[offsets[i] .. offsets[i + 1]). Each row is kept sorted and
+ *     free of duplicates, so membership is a binary search and the whole
+ *     topology costs two allocations instead of one per node.
+ *
+ *     the table keeps the shape of the vector<vector<int>> it replaced:
+ *     cfg.neighbors[i] is a range with begin/end/size/operator[], can be
+ *     compared with a vector<int>, and on a non-const table a row can be
+ *     replaced by assigning a vector to it. Ranges point into the table
+ *     and are invalidated by any change to it.
+ ****************************************************************************/
+#ifndef ADJACENCY_HPP
+#define ADJACENCY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+class Adjacency;
+
+/**
+ * @brief read-only view of one node's sorted neighbor list.
+ */
+class NeighborRange {
+public:
+    NeighborRange(const int *first, const int *last)
+        : first_(first), last_(last) {}
+
+    const int *begin() const { return first_; }
+    const int *end() const { return last_; }
+    size_t size() const { return static_cast<size_t>(last_ - first_); }
+    bool empty() const { return first_ == last_; }
+    int operator[](size_t k) const { return first_[k]; }
+
+    /**
+     * @brief binary search for j in this row.
+     */
+    bool contains(int j) const;
+
+protected:
+    const int *first_;
+    const int *last_;
+};
+
+bool operator==(const NeighborRange &a, const std::vector<int> &b);
+bool operator!=(const NeighborRange &a, const std::vector<int> &b);
+
+/**
+ * @brief a row of a non-const table; assigning a vector replaces the row.
+ */
+class NeighborRow : public NeighborRange {
+public:
+    NeighborRow(Adjacency &owner, size_t row);
+    NeighborRow &operator=(const std::vector<int> &row);
+
+private:
+    Adjacency &owner_;
+    size_t row_;
+};
+
+/**
+ * @class Adjacency
+ * @brief CSR neighbor table: offsets (n + 1 entries) and targets.
+ */
+class Adjacency {
+public:
+    Adjacency();
+
+    /**
+     * @brief build from per-node lists; each row is sorted and
+     *        deduplicated, ids are not range-checked (see
+     *        check_bidirectional_neighbors()).
+     */
+    Adjacency(const std::vector<std::vector<int>> &lists);
+    Adjacency(std::initializer_list<std::vector<int>> lists);
+
+    size_t size() const { return offsets_.size() - 1; }
+    bool empty() const { return size() == 0; }
+
+    /**
+     * @brief total number of (directed) entries, i.e. 2|E| for a
+     *        bidirectional topology.
+     */
+    size_t entries() const { return targets_.size(); }
+
+    NeighborRange operator[](size_t i) const;
+    NeighborRow operator[](size_t i);
+
+    /**
+     * @brief true if j is in node i's neighbor list; O(log degree).
+     */
+    bool contains(int i, int j) const;
+
+    // --- building row by row (the config loader): add() the entries of
+    // the next row, then close_row() sorts and deduplicates them ---
+    void clear();
+    void reserve(size_t rows, size_t entries);
+    void add(int j) { targets_.push_back(j); }
+    void close_row();
+
+    /**
+     * @brief append one more row.
+     */
+    void push_back(const std::vector<int> &row);
+
+    /**
+     * @brief replace row i (O(entries); meant for tests and tools).
+     */
+    void assign_row(size_t i, const std::vector<int> &row);
+
+    /**
+     * @brief replace the whole table with raw CSR arrays (offsets has
+     *        rows + 1 entries); rows must already be sorted and unique.
+     */
+    void assign(const uint32_t *offsets, size_t rows, const int *targets);
+
+    // raw arrays, e.g. for the binary topology image
+    const std::vector<uint32_t> &offsets() const { return offsets_; }
+    const std::vector<int> &targets() const { return targets_; }
+
+private:
+    std::vector<uint32_t> offsets_;
+    std::vector<int> targets_;
+}; // Adjacency class
+
+#endif // ADJACENCY_HPP
@@ -0,0 +1,87 @@
+/****************************************************************************
+ * file: channel_recorder.hpp
+ * author: luke le
+ * description:
+ *     declares a bounded-memory recorder for the in-transit messages of one
+ *     incoming channel during a Chandy-Lamport snapshot.
+ * notes:
+ *     frames are stored back to back in a fixed-capacity byte ring as
+ *     <u32 length><bytes>. When an append would push the ring past its
+ *     memory limit, the oldest records are moved to a spill file so memory
+ *     stays bounded no matter how much traffic a channel carries while its
+ *     marker is outstanding. Reading back yields spilled records first,
+ *     preserving FIFO order.
+ ****************************************************************************/
+#ifndef CHANNEL_RECORDER_HPP
+#define CHANNEL_RECORDER_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * @class ChannelRecorder
+ * @brief records the frames received on one channel, spilling to disk.
+ */
+class ChannelRecorder {
+public:
+    /**
+     * @brief construct an empty recorder.
+     *
+     * @param mem_limit_bytes capacity of the in-memory ring; records that
+     *        would not fit push older ones out to the spill file.
+     * @param spill_path file used for spilled records; created on first
+     *        spill and removed by clear().
+     */
+    ChannelRecorder(size_t mem_limit_bytes, const std::string &spill_path);
+
+    /**
+     * @brief close and remove the spill file, if any.
+     */
+    ~ChannelRecorder();
+
+    /**
+     * @brief append one frame to the channel state.
+     *
+     * @param frame encoded message as received on the channel.
+     */
+    void append(const std::string &frame);
+
+    /**
+     * @brief read every recorded frame back, oldest first.
+     *
+     * @param out vector that receives the frames (cleared first).
+     * @return false if the spill file could not be read.
+     */
+    bool read_all(std::vector<std::string> &out) const;
+
+    /**
+     * @brief drop all records and delete the spill file.
+     */
+    void clear();
+
+    size_t count() const { return count_; }          // total records
+    size_t spilled() const { return spilled_; }      // records on disk
+    size_t bytes_in_memory() const { return used_; } // ring occupancy
+
+private:
+    std::vector<char> ring_;   // fixed-capacity byte ring
+    size_t head_;              // offset of the oldest record
+    size_t used_;              // bytes currently stored in the ring
+    size_t count_;
+    size_t spilled_;
+    std::string spill_path_;
+    std::FILE *spill_;
+
+    void ring_write(const char *src, size_t len);
+    void ring_read(size_t off, char *dst, size_t len) const;
+    bool spill_oldest();
+    bool spill_direct(const std::string &frame);
+
+    // non-copyable: owns a file handle
+    ChannelRecorder(const ChannelRecorder &);
+    ChannelRecorder &operator=(const ChannelRecorder &);
+}; // ChannelRecorder class
+
+#endif // CHANNEL_RECORDER_HPP
@@ -8,6 +8,7 @@
 #ifndef CONFIG_HPP
 #define CONFIG_HPP
 
+#include "adjacency.hpp"
 #include "node.hpp"
 #include <vector>
 
@@ -48,7 +49,9 @@
  * @param maxNumber         maximum number of total messages a node can send.
  * @param nodes             vector of NodeInfo structures describing each node
  *                          (ID, hostname, port).
- * @param neighbors         adjacency list representing neighbors of each node.
+ * @param neighbors         neighbors of each node as a CSR table; rows are
+ *                          sorted, cfg.neighbors[i] iterates like the
+ *                          vector<int> it used to be.
  * @param config_name       base name of the configuration file (without
  *                          extension).
  */
@@ -59,7 +62,7 @@ struct Config {
     int snapshotDelay_ms;
     int maxNumber;
     std::vector<NodeInfo> nodes;
-    std::vector<std::vector<int>> neighbors;
+    Adjacency neighbors;
     std::string config_name;
 };
 
@@ -0,0 +1,147 @@
+/****************************************************************************
+ * file: control_channel.hpp
+ * author: luke le
+ * description:
+ *     the TCP side channel between the launch driver (ds/tools/launch.cpp)
+ *     and its nodes: each node reports when it is up and when its links
+ *     are established, then waits at a start barrier until the driver
+ *     releases every node at once.
+ * notes:
+ *     one line per message:
+ *       node -> driver   UP <id>
+ *                        READY <id> <links> <expected> <setup_us>
+ *       driver -> node   GO <start_wall_ns>
+ *     a node sleeps until start_wall_ns (CLOCK_REALTIME) after GO, so the
+ *     time the driver needs to write GO to every connection does not skew
+ *     the start; across hosts the instant is only as good as clock sync.
+ *     A node whose driver goes away starts anyway instead of hanging.
+ ****************************************************************************/
+#ifndef CONTROL_CHANNEL_HPP
+#define CONTROL_CHANNEL_HPP
+
+#include "shutdown_signal.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief one UP or READY report as the driver sees it.
+ *
+ * @param links / expected / setup_us READY only: links established, links
+ *        the config asks for, and the time spent establishing them.
+ * @param at_ns driver's CLOCK_MONOTONIC time of arrival.
+ */
+struct ControlEvent {
+    enum Kind { UP, READY };
+    Kind kind;
+    int id;
+    int links;
+    int expected;
+    int64_t setup_us;
+    int64_t at_ns;
+};
+
+/**
+ * @brief parse one line of node -> driver traffic (without the newline).
+ *
+ * @return false if the line is not a well-formed UP or READY.
+ */
+bool parse_control_line(const std::string &line, ControlEvent &ev);
+
+/**
+ * @class ControlServer
+ * @brief driver end: accepts node connections, collects their reports and
+ *        releases the barrier.
+ */
+class ControlServer {
+public:
+    ControlServer();
+    ~ControlServer();
+
+    /**
+     * @brief listen on every interface.
+     *
+     * @param port TCP port, 0 for any free one (see port()).
+     * @return false (with a message) if the socket cannot be set up.
+     */
+    bool listen(int port);
+
+    int port() const { return port_; }
+
+    /**
+     * @brief accept connections and read reports for up to timeout_ms.
+     *
+     * @param timeout_ms longest wait for the first report; 0 only polls.
+     * @param events reports that arrived are appended here.
+     * @return number of events appended.
+     */
+    size_t poll(int timeout_ms, std::vector<ControlEvent> &events);
+
+    /**
+     * @brief send GO to every connected node.
+     *
+     * @param start_wall_ns instant the nodes begin at.
+     * @return connections the GO was written to.
+     */
+    size_t release(int64_t start_wall_ns);
+
+    size_t connections() const { return conns_.size(); }
+
+private:
+    struct Conn {
+        int fd;
+        std::string buf;
+    };
+
+    int fd_;
+    int port_;
+    std::vector<Conn> conns_;
+
+    void drop(size_t i);
+
+    ControlServer(const ControlServer &);
+    ControlServer &operator=(const ControlServer &);
+}; // ControlServer class
+
+/**
+ * @class ControlClient
+ * @brief node end of the control channel.
+ */
+class ControlClient {
+public:
+    ControlClient();
+    ~ControlClient();
+
+    /**
+     * @brief connect to the driver.
+     *
+     * @param endpoint "host:port" as given by --control=.
+     * @return false (with a message) if the driver cannot be reached.
+     */
+    bool connect(const std::string &endpoint);
+
+    bool report_up(int id);
+    bool report_ready(int id, int links, int expected, int64_t setup_us);
+
+    /**
+     * @brief block until GO, then until its start instant.
+     *
+     * @param shutdown node shutdown; ends the wait early.
+     * @return false if shutdown was triggered, true otherwise (including a
+     *         lost driver, which is reported on stderr).
+     */
+    bool wait_go(const ShutdownSignal &shutdown);
+
+    void close();
+
+private:
+    int fd_;
+
+    bool send_line(const std::string &line);
+
+    ControlClient(const ControlClient &);
+    ControlClient &operator=(const ControlClient &);
+}; // ControlClient class
+
+#endif // CONTROL_CHANNEL_HPP
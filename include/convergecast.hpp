@@ -0,0 +1,136 @@
+/****************************************************************************
+ * file: convergecast.hpp
+ * author: luke le
+ * description:
+ *     declares the collection of per-node snapshot state at node 0.
+ * notes:
+ *     two strategies are supported so they can be compared on the same run:
+ *       TREE   every node waits for its children in the BFS spanning tree,
+ *              merges their aggregates into its own and sends ONE record to
+ *              its parent: n - 1 STATE messages per snapshot.
+ *       FLOOD  every node sends its own state to every neighbor and each
+ *              node forwards every state it has not seen before to all
+ *              other neighbors: up to n * 2|E| STATE messages per snapshot.
+ *     like SnapshotManager the collector is passive: MapProtocol feeds it
+ *     under its own mutex and sends the returned frames itself.
+ ****************************************************************************/
+#ifndef CONVERGECAST_HPP
+#define CONVERGECAST_HPP
+
+#include "config.hpp"
+#include "message.hpp"
+#include "spanning_tree.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+/**
+ * @brief how snapshot states travel to the root.
+ */
+enum CollectMode { COLLECT_TREE, COLLECT_FLOOD };
+
+/**
+ * @brief one STATE frame the caller has to send.
+ *
+ * @param to    neighbor to send to.
+ * @param state aggregate to encode with encode_state_message().
+ */
+struct StateSend {
+    int to;
+    SnapshotState state;
+};
+
+/**
+ * @class Convergecast
+ * @brief merges snapshot states on their way to the root.
+ */
+class Convergecast {
+public:
+    /**
+     * @param cfg parsed configuration (topology).
+     * @param node_id id of the owning node.
+     * @param mode tree convergecast or naive flooding.
+     * @param root node that collects the global state.
+     */
+    Convergecast(const Config &cfg, int node_id,
+                 CollectMode mode = COLLECT_TREE, int root = 0);
+
+    /**
+     * @brief same, on a tree built once and shared by every node of a
+     *        NodeHost instead of one BFS per node.
+     *
+     * @param tree BFS tree of cfg; its root collects the global state.
+     */
+    Convergecast(const Config &cfg, int node_id,
+                 const std::shared_ptr<const SpanningTree> &tree,
+                 CollectMode mode = COLLECT_TREE);
+
+    /**
+     * @brief the BFS tree computed from the config.
+     */
+    const SpanningTree &tree() const { return *tree_; }
+
+    /**
+     * @brief this node finished its local snapshot.
+     *
+     * @param st local state (nodes == 1).
+     * @param out frames to send are appended here.
+     */
+    void local_done(const SnapshotState &st, std::vector<StateSend> &out);
+
+    /**
+     * @brief a STATE frame arrived from a neighbor.
+     *
+     * @param from neighbor the frame came from.
+     * @param st decoded state.
+     * @param out frames to send are appended here.
+     */
+    void received(int from, const SnapshotState &st,
+                  std::vector<StateSend> &out);
+
+    /**
+     * @brief root only: take the next completed global state.
+     *
+     * @param global receives the merged state of every reachable node.
+     * @return false if no snapshot has completed since the last call.
+     */
+    bool pop_complete(SnapshotState &global);
+
+    /**
+     * @brief STATE frames this node has produced so far.
+     */
+    uint64_t sent() const { return sent_; }
+
+    CollectMode mode() const { return mode_; }
+
+private:
+    struct Pending {
+        SnapshotState agg;
+        int waiting;          // TREE: children not yet reported
+        bool local;           // own state merged in
+        std::set<int> seen;   // FLOOD: origins already forwarded
+    };
+
+    const int id_;
+    const int n_;
+    const CollectMode mode_;
+    const std::vector<int> neighbors_;
+    std::shared_ptr<const SpanningTree> tree_;
+    std::map<int, Pending> pending_;   // snapshot id -> partial aggregate
+    std::set<int> done_;               // recently completed snapshot ids
+    std::deque<SnapshotState> complete_;
+    uint64_t sent_;
+
+    Pending &pending_for(int snapshot_id);
+    void merge(Pending &p, const SnapshotState &st);
+    void try_forward(int snapshot_id, std::vector<StateSend> &out);
+    void mark_done(int snapshot_id);
+    void flood(const SnapshotState &st, int except,
+               std::vector<StateSend> &out);
+}; // Convergecast class
+
+#endif // CONVERGECAST_HPP
@@ -0,0 +1,65 @@
+/****************************************************************************
+ * file: cut_checker.hpp
+ * author: luke le
+ * description:
+ *     declares the consistency check for one recorded global snapshot.
+ * notes:
+ *     a snapshot k is a consistent cut iff no node has seen more events of
+ *     node i than node i itself had recorded:
+ *
+ *         for all i, j:   vc_j[i] <= vc_i[i]
+ *
+ *     with the n clocks stored row-major (row j = clock of node j) this is
+ *     "every row is <= the diagonal", i.e. n element-wise vector compares
+ *     of length n. The compares use SSE2 (or AVX2 when the build enables
+ *     it); define CUT_CHECK_SCALAR to force the plain loop.
+ ****************************************************************************/
+#ifndef CUT_CHECKER_HPP
+#define CUT_CHECKER_HPP
+
+#include <vector>
+
+/**
+ * @brief where a cut is inconsistent: node j's clock claims more events of
+ *        node i than node i recorded.
+ *
+ * @param i     node whose entry is violated.
+ * @param j     node whose clock is ahead.
+ * @param seen  vc_j[i].
+ * @param own   vc_i[i].
+ */
+struct CutViolation {
+    int i;
+    int j;
+    int seen;
+    int own;
+};
+
+/**
+ * @class CutChecker
+ * @brief checks n x n clock matrices; one instance per thread (it owns a
+ *        scratch copy of the diagonal).
+ */
+class CutChecker {
+public:
+    /**
+     * @brief check one snapshot.
+     *
+     * @param clocks n * n clock entries, row j = node j's clock.
+     * @param n number of nodes.
+     * @param v filled with the first violation (lowest j, then lowest i).
+     * @return true if the cut is consistent.
+     */
+    bool check(const int *clocks, int n, CutViolation &v);
+
+    /**
+     * @brief name of the compare kernel compiled in ("avx2", "sse2",
+     *        "scalar").
+     */
+    static const char *kernel();
+
+private:
+    std::vector<int> diag_;
+};
+
+#endif // CUT_CHECKER_HPP
@@ -0,0 +1,313 @@
+/****************************************************************************
+ * file: logger.hpp
+ * author: luke le
+ * description:
+ *     declares the asynchronous structured logger of the node: log calls
+ *     encode their arguments into a per-thread lock-free ring, and one
+ *     flusher thread formats them in batches, either as the familiar
+ *     "[*] ..." lines on stdout/stderr or as a binary log that
+ *     ds/tools/logfmt.cpp formats after the run.
+ * usage:
+ *     LOG_INFO(id_, "Node {} established {} / {} links.", id_, n, expected);
+ *     LOG_EVERY(LEVEL_WARN, 1000, id_, "send to {} failed", peer);
+ * notes:
+ *     "{}" in the format takes the next argument; integers, doubles,
+ *     C strings and std::string are supported. The format must be a string
+ *     literal: records keep a pointer to their call site, not a copy.
+ *
+ *     a call costs a level check, a clock read and a copy of its arguments
+ *     into the ring; the syscalls happen on the flusher. A full ring drops
+ *     the record (counted, and reported by the flusher) rather than block.
+ *     Before start() and after stop() records are formatted and written on
+ *     the calling thread, so tools and tests need no setup.
+ *
+ *     binary log: "MAPLOG1\n", then entries
+ *       'S' site  u32 id, u8 level, u32 line, str file, str format
+ *       'R' rec   u32 site, i32 node, i64 wall_ns, u32 thread,
+ *                 u32 suppressed, u32 arg bytes, args
+ *     where str is u32 length + bytes and args are (tag, value) pairs:
+ *     'i' i64, 'u' u64, 'd' double, 'c' char, 's' str. Little-endian.
+ ****************************************************************************/
+#ifndef LOGGER_HPP
+#define LOGGER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// "[.]", "[*]", "[~]", "[!]" in text output
+enum LogLevel { LEVEL_DEBUG, LEVEL_INFO, LEVEL_WARN, LEVEL_ERROR };
+
+/**
+ * @brief parse "debug", "info", "warn" or "error".
+ */
+bool parse_log_level(const std::string &text, LogLevel &level);
+
+/**
+ * @brief one log statement in the source; a static per call site.
+ *
+ * @param every_ms at most one record per this many ms from the site (0:
+ *        no limit); the next one that passes carries the suppressed count.
+ */
+struct LogSite {
+    LogLevel level;
+    const char *fmt;
+    const char *file;
+    int line;
+    int every_ms;
+    std::atomic<int64_t> next_ns;
+    std::atomic<uint32_t> suppressed;
+};
+
+/**
+ * @brief one record as the flusher or LogReader sees it.
+ */
+struct LogEntry {
+    LogLevel level;
+    int node;                  // -1: not tied to a node
+    int64_t wall_ns;
+    uint32_t thread;           // small per-process thread number
+    uint32_t suppressed;
+    const char *fmt;
+    std::string file;
+    int line;
+    std::string args;          // encoded, see the file header
+};
+
+/**
+ * @brief expand the "{}" placeholders of fmt with encoded args.
+ *
+ * @return the message; placeholders without an argument stay "{}", extra
+ *         arguments are appended.
+ */
+std::string format_log(const char *fmt, const std::string &args);
+
+/**
+ * @brief "[*] message" (plus the suppressed note), without newline.
+ */
+std::string format_log_line(const LogEntry &e);
+
+namespace logdetail {
+
+    inline size_t arg_bytes(const char *s) { return 5 + std::strlen(s); }
+    inline size_t arg_bytes(char *s) { return 5 + std::strlen(s); }
+    inline size_t arg_bytes(const std::string &s) { return 5 + s.size(); }
+    inline size_t arg_bytes(double) { return 9; }
+    inline size_t arg_bytes(char) { return 2; }
+    template <typename T>
+    size_t arg_bytes(T) {
+        static_assert(std::is_integral<T>::value || std::is_enum<T>::value,
+                      "log arguments: integers, double, char, strings");
+        return 9;
+    }
+
+    inline char *put_str(char *p, const char *s, uint32_t n) {
+        *p++ = 's';
+        std::memcpy(p, &n, 4);
+        std::memcpy(p + 4, s, n);
+        return p + 4 + n;
+    }
+    inline char *put_arg(char *p, const char *s) {
+        return put_str(p, s, static_cast<uint32_t>(std::strlen(s)));
+    }
+    inline char *put_arg(char *p, char *s) {
+        return put_str(p, s, static_cast<uint32_t>(std::strlen(s)));
+    }
+    inline char *put_arg(char *p, const std::string &s) {
+        return put_str(p, s.data(), static_cast<uint32_t>(s.size()));
+    }
+    inline char *put_arg(char *p, double v) {
+        *p++ = 'd';
+        std::memcpy(p, &v, 8);
+        return p + 8;
+    }
+    inline char *put_arg(char *p, char v) {
+        *p++ = 'c';
+        *p++ = v;
+        return p;
+    }
+    template <typename T>
+    char *put_arg(char *p, T v) {
+        if (std::is_signed<T>::value || std::is_enum<T>::value) {
+            const int64_t x = static_cast<int64_t>(v);
+            *p++ = 'i';
+            std::memcpy(p, &x, 8);
+        } else {
+            const uint64_t x = static_cast<uint64_t>(v);
+            *p++ = 'u';
+            std::memcpy(p, &x, 8);
+        }
+        return p + 8;
+    }
+
+    inline size_t args_bytes() { return 0; }
+    template <typename T, typename... Rest>
+    size_t args_bytes(const T &v, const Rest &... rest) {
+        return arg_bytes(v) + args_bytes(rest...);
+    }
+    inline char *put_args(char *p) { return p; }
+    template <typename T, typename... Rest>
+    char *put_args(char *p, const T &v, const Rest &... rest) {
+        return put_args(put_arg(p, v), rest...);
+    }
+
+} // namespace logdetail
+
+/**
+ * @class Logger
+ * @brief the process-wide logger: per-thread rings and one flusher.
+ */
+class Logger {
+public:
+    static Logger &global();
+
+    /**
+     * @brief true if records at level l are kept; one relaxed load.
+     */
+    static bool enabled(LogLevel l) {
+        return static_cast<int>(l) >= min_level_.load(std::memory_order_relaxed);
+    }
+    static void set_level(LogLevel l) {
+        min_level_.store(static_cast<int>(l), std::memory_order_relaxed);
+    }
+
+    ~Logger();
+
+    /**
+     * @brief start the flusher.
+     *
+     * @param binary_path write the binary log here (and WARN/ERROR also as
+     *        text on stderr); empty: text on stdout (DEBUG/INFO) and
+     *        stderr (WARN/ERROR), as the lines always were.
+     * @param flush_ms longest a record waits in its ring.
+     * @return false (with a message) if the binary log cannot be opened.
+     */
+    bool start(const std::string &binary_path = "", int flush_ms = 20);
+
+    /**
+     * @brief write out everything queued and stop the flusher; idempotent.
+     */
+    void stop();
+
+    // records dropped because a ring was full
+    uint64_t dropped() const;
+
+    /**
+     * @brief the entry point of the LOG_* macros.
+     */
+    template <typename... Args>
+    void log(LogSite &site, int node, const char * /* fmt, in site */,
+             const Args &... args) {
+        uint32_t suppressed = 0;
+        if (site.every_ms > 0 && !pass_rate_limit(site, suppressed)) return;
+        Slot slot;
+        char *p = begin(site, node, suppressed,
+                        logdetail::args_bytes(args...), slot);
+        if (p == nullptr) return;
+        logdetail::put_args(p, args...);
+        commit(slot);
+    }
+
+private:
+    struct Ring;
+    struct Queued;
+
+    // where the record being written goes: the calling thread's ring, or
+    // scratch when the flusher is not running
+    struct Slot {
+        Ring *ring;
+        size_t tail;
+        std::string scratch;
+    };
+    static thread_local Ring *tls_ring_;
+    static std::atomic<int> min_level_;
+
+    std::atomic<bool> running_;
+    std::mutex control_m_;               // start/stop
+    std::mutex m_;                       // rings_, next_thread_
+    std::vector<Ring *> rings_;
+    uint32_t next_thread_;
+    std::mutex flush_m_;                 // stopping_; one flush at a time
+    std::condition_variable flush_cv_;
+    bool stopping_;
+    std::thread flusher_;
+    int flush_ms_;
+    FILE *binary_;
+    std::map<const LogSite *, uint32_t> site_ids_;   // binary log only
+    std::atomic<uint64_t> dropped_total_;
+
+    Logger();
+    static bool pass_rate_limit(LogSite &site, uint32_t &suppressed);
+    char *begin(LogSite &site, int node, uint32_t suppressed, size_t len,
+                Slot &slot);
+    void commit(Slot &slot);
+    Ring *thread_ring();
+    void flusher_loop();
+    void flush_once();
+    void emit(std::vector<Queued> &batch);
+
+    Logger(const Logger &);
+    Logger &operator=(const Logger &);
+}; // Logger class
+
+/**
+ * @class LogReader
+ * @brief reads a binary log written with Logger::start(path).
+ */
+class LogReader {
+public:
+    LogReader();
+    ~LogReader();
+
+    bool open(const std::string &path);
+
+    /**
+     * @brief the next record, with its site resolved.
+     *
+     * @return false at the end of the log (or on a damaged entry, which is
+     *         reported).
+     */
+    bool next(LogEntry &e);
+
+private:
+    struct Site {
+        LogLevel level;
+        int line;
+        std::string file;
+        std::string fmt;
+    };
+    FILE *in_;
+    std::string path_;
+    std::map<uint32_t, Site> sites_;
+
+    LogReader(const LogReader &);
+    LogReader &operator=(const LogReader &);
+}; // LogReader class
+
+#define LOG_FIRST_(first, ...) first
+#define LOG_AT_(level, every, node, ...)                                    \
+    do {                                                                    \
+        if (Logger::enabled(level)) {                                       \
+            static LogSite log_site_ = {level, LOG_FIRST_(__VA_ARGS__, 0),  \
+                                        __FILE__, __LINE__, every, {0}, {0}}; \
+            Logger::global().log(log_site_, node, __VA_ARGS__);            \
+        }                                                                   \
+    } while (0)
+
+#define LOG_DEBUG(node, ...) LOG_AT_(LEVEL_DEBUG, 0, node, __VA_ARGS__)
+#define LOG_INFO(node, ...) LOG_AT_(LEVEL_INFO, 0, node, __VA_ARGS__)
+#define LOG_WARN(node, ...) LOG_AT_(LEVEL_WARN, 0, node, __VA_ARGS__)
+#define LOG_ERROR(node, ...) LOG_AT_(LEVEL_ERROR, 0, node, __VA_ARGS__)
+// at most one record per every_ms from this call site
+#define LOG_EVERY(level, every_ms, node, ...)                               \
+    LOG_AT_(level, every_ms, node, __VA_ARGS__)
+
+#endif // LOGGER_HPP
@@ -2,62 +2,255 @@
 /****************************************************************************
  * file: map_protocol.hpp
  * description:
- *   Minimal scaffold: connections + initial snapshot (no lambdas).
+ *   Node engine: connections, MAP computation and Chandy-Lamport or
+ *   Lai-Yang snapshots (no lambdas).
  ****************************************************************************/
 #ifndef MAP_PROTOCOL_HPP
 #define MAP_PROTOCOL_HPP
 
 #include "config.hpp"
+#include "convergecast.hpp"
+#include "latency_histogram.hpp"
+#include "metrics.hpp"
+#include "options.hpp"
 #include "sctp_wrapper.hpp"
+#include "shutdown_signal.hpp"
 #include "snapshot_manager.hpp"
 #include "termination_manager.hpp"
+#include "vector_clock.hpp"
 
+#include <deque>
 #include <map>
 #include <vector>
 #include <mutex>
 #include <atomic>
+#include <condition_variable>
 #include <random>
 #include <string>
+#include <thread>
+
+class NodeHost;
+
+// timer events a NodeHost delivers to its nodes
+enum HostTimer { TIMER_WRITER, TIMER_SNAPSHOT };
 
 class MapProtocol {
 public:
-    MapProtocol(const Config& cfg, int node_id);
-    void run(); // blocking
-    TerminationManager termination_mgr_;
+    // cfg is not copied and must outlive the node; with a host the node
+    // runs hosted (see node_host.hpp) instead of through run()
+    MapProtocol(const Config& cfg, int node_id,
+                const Options& opts = Options(), NodeHost* host = nullptr);
+    void run(); // blocking, returns once stop() was called and threads exit
+
+    // request shutdown; async-signal-safe, wakes every thread at once
+    void stop();
+
+    // us from stop() until run() finished closing links (-1 if not yet)
+    int64_t exit_latency_us() const;
+
+    // --- hosted mode: driven by NodeHost workers instead of own threads ---
+    // connects links that leave the process (may block), records the
+    // initial state and schedules the first timers
+    void start();
+    void deliver(int from, const std::string& frame) { handle_frame(from, frame); }
+    void on_timer(int timer);
+    bool stopped() const { return shutdown_.triggered(); }
+    size_t channels() const { return peers_.size(); }
+    // closes remote links and writes the final reports
+    void finish();
+
+    // the snapshot ring is 64-byte aligned, more than plain new promises
+    // before C++17; NodeHost allocates its nodes on the heap
+    static void* operator new(size_t size);
+    static void operator delete(void* p);
 
 private:
     // --- connection setup ---
     void establish_connections();
 
     // accept loop run by a thread (no lambdas)
-    void acceptor_loop(std::atomic<bool>* accepting,
+    void acceptor_loop(ShutdownSignal* accepting_done,
                        int expected_links);
 
+    // whether this end dials the link to peer_id (see SetupMode)
+    bool dials(int peer_id) const;
+    // one connect + HELLO exchange; false if the peer is not reachable yet
+    bool dial_once(int nb);
+
+    // --- MAP computation ---
+    // one receiver thread per link, one writer thread for active intervals
+    void receive_loop(int peer_id);
+    void writer_loop();
+    // dispatch_frame(), then the frames it queued go out
+    void handle_frame(int from, const std::string& frame);
+    void dispatch_frame(int from, const std::string& frame);
+    void shutdown_threads();
+    void report_snapshot_stalls();
+    void begin_computation();
+
+    // one APP frame to peer (caller holds m_)
+    void send_app(int peer);
+    // frame to a neighbor: into the host's mailbox, or queued on the SCTP
+    // link's outbox for flush_outboxes() (caller holds m_); false if the
+    // neighbor has no link
+    bool send_to(int peer, const std::string& frame);
+    // write out queued frames; callers must not hold m_, so a full send
+    // buffer never stops the threads that drain the links
+    void flush_outboxes();
+    void flush_outbox(int peer);
+    // a queued frame the link could not send (caller holds m_)
+    void send_failed(int peer, const std::string& frame);
+    // hosted writer: one send of the active interval per TIMER_WRITER;
+    // returns ms until the next step, -1 once the node turned passive
+    int writer_step();
+    void wake_writer();
+    bool in_process(int peer_id) const;
+
+    // --- Chandy-Lamport snapshots (callers hold m_) ---
+    void snapshot_loop();                      // node 0 only
+    void snapshot_tick();
+    void take_local_snapshot(int snapshot_id);
+    void handle_marker(int from, int snapshot_id);
+
+    // --- Lai-Yang piggyback snapshots (callers hold m_) ---
+    void advance_epoch(int epoch);
+    void announce_epoch();
+
+    // --- convergecast of snapshot state to node 0 (callers hold m_) ---
+    void snapshot_finished(const SnapshotResult& r);
+    void handle_state(int from, const SnapshotState& st);
+    void send_states(const std::vector<StateSend>& out);
+    void report_global_snapshots();
+
+    // --- termination detection by weight throwing (callers hold m_) ---
+    void return_credit();
+    void check_termination();
+
+    // --- orderly halt down the spanning tree (callers hold m_) ---
+    void halt(int64_t detected_wall_ns);
+    void write_halt_record();
+
+    // --- one-way APP delay per link, --latency (callers hold m_) ---
+    void record_latency(int from, const std::string& frame);
+    void write_latency_report();
+
+    // keep s as the link to peer_id unless an association dialed by a lower
+    // id already exists; caller holds m_. Returns true if s was kept.
+    bool adopt_link(int peer_id, SCTPSocket& s, int dialer);
+
+    // --- metrics (metrics.hpp) ---
+    void register_metrics();
+    // SCTP send queue of the link to peer, for the exporter
+    static int64_t probe_send_queue(void* self, int peer);
+
     // --- utilities ---
     bool is_neighbor(int peer_id) const;
     void record_initial_snapshot();
 
     // handshake helpers
-    static std::string make_hello(int id);
+    static std::string make_hello(int id,
+                                  const std::string& notes = std::string());
     static bool parse_hello(const std::string& s, int& out_id);
+    // ";key=value" annotation of a HELLO, e.g. the send time for --latency
+    static bool find_hello_annotation(const std::string& s, const char* key,
+                                      long long& value);
 
 private:
-    // immutable config
-    const Config cfg_;
+    // read-only config, shared by every node a process hosts
+    const Config& cfg_;
     const int id_;
+    const Options opts_;
+    NodeHost* const host_;             // null: one node per process
 
-    // vector clock (size n)
-    std::vector<int> vc_;
+    // vector clock (size n; std::array when n is compiled in)
+    VectorClock vc_;
 
     // neighbor_id -> persistent SCTP link
     std::map<int, SCTPSocket> links_;
+    std::map<int, int> link_dialer_;   // neighbor_id -> id that dialed it
+
+    // frames for each neighbor in the order they were queued under m_;
+    // only the thread holding send_m writes to the link, and it sends
+    // until the queue is empty (see flush_outbox()). Built by the ctor
+    // and never modified afterwards.
+    struct Outbox {
+        std::mutex queue_m;
+        std::deque<std::string> frames;
+        std::mutex send_m;
+
+        void push(const std::string& frame) {
+            std::lock_guard<std::mutex> lk(queue_m);
+            frames.push_back(frame);
+        }
+        bool pop(std::string& frame) {
+            std::lock_guard<std::mutex> lk(queue_m);
+            if (frames.empty()) return false;
+            frame.swap(frames.front());
+            frames.pop_front();
+            return true;
+        }
+        bool empty() {
+            std::lock_guard<std::mutex> lk(queue_m);
+            return frames.empty();
+        }
+    };
+    std::map<int, Outbox> outboxes_;
 
     // listening socket (only during setup)
     SCTPSocket listen_sock_;
 
+    // what establish_connections() cost; printed with the link summary
+    struct SetupStats {
+        int dial_attempts;             // connect() calls
+        int retry_rounds;              // back-offs while peers came up
+        int associations;              // completed HELLO exchanges
+        int duplicates_closed;         // lost the adopt_link() race
+        int hellos_sent;
+        int64_t setup_us;
+        SetupStats()
+            : dial_attempts(0), retry_rounds(0), associations(0),
+              duplicates_closed(0), hellos_sent(0), setup_us(0) {}
+    };
+    SetupStats setup_stats_;
+
+    // ids in Metrics::global(), registered by the ctor; link_metrics_ has
+    // an entry for every neighbor and is never modified afterwards
+    struct LinkMetrics {
+        int sent;
+        int sent_bytes;
+        int received;
+        int received_bytes;
+        int dial_retries;
+        int connects;
+    };
+    struct NodeMetrics {
+        int active_intervals;
+        int snapshots;
+        int snapshot_latency_us_sum;   // root: start to global state
+        int snapshot_latency_us_count;
+        int clock_merges;
+        int clock_merge_ns_sum;        // sampled, see handle_frame()
+        int clock_merge_ns_count;
+    };
+    Metrics& metrics_;
+    std::map<int, LinkMetrics> link_metrics_;
+    NodeMetrics node_metrics_;
+
     // concurrency/state
     std::mutex m_;
-    std::atomic<bool> stop_;
+    std::condition_variable active_cv_;   // writer waits for is_active_
+    ShutdownSignal shutdown_;             // replaces the stop_ polling loop
+    std::vector<std::thread> receivers_;
+    std::thread writer_;
+    std::thread snapshot_thread_;
+    std::atomic<int64_t> exit_latency_us_;
+
+    // channels the snapshots cover: every SCTP link, plus in-process
+    // neighbors when hosted
+    std::vector<int> peers_;
+    int next_snapshot_id_;             // node 0
+    int burst_left_;                   // hosted writer, -1 between bursts
+    bool writer_pending_;              // hosted writer step scheduled
 
     // rng
     std::mt19937 rng_;
@@ -65,6 +258,39 @@ private:
     // output manager (writes logs/<config>-<id>.out)
     SnapshotManager snapshot_mgr_;
 
+    // BFS tree and in-network aggregation of snapshot state
+    Convergecast collector_;
+    std::map<int, int64_t> snapshot_start_ns_;   // root: id -> begin time
+
+    // piggyback mode: current epoch (colour), APP counters that give the
+    // channel state, and the newest epoch seen on each neighbor's frames
+    int epoch_;
+    long long app_sent_;
+    long long app_received_;
+    std::map<int, int> peer_epoch_;
+    uint64_t control_sent_;            // MARKER / EPOCH frames
+
+    // credit carried on APP frames; the root sees it all come back once
+    // the computation has terminated
+    TerminationManager termination_mgr_;
+    int64_t terminated_at_ns_;         // root: detection time, -1 before
+
+    // wall-clock times for logs/<config>-<id>.halt, -1 until HALT arrives
+    int64_t halt_detected_wall_ns_;    // root's detection, carried by HALT
+    int64_t halt_received_wall_ns_;
+    int64_t quiet_wall_ns_;            // last APP handled or turn passive
+
+    // --latency: delays of the APP frames received from each neighbor, and
+    // the neighbor's monotonic clock minus ours as the HELLO exchange
+    // estimated it (0 on the same host or in the same process)
+    struct LinkLatency {
+        LatencyHistogram delay;
+        int64_t offset_ns;
+        int64_t rtt_ns;                // -1: offset not estimated
+        LinkLatency() : offset_ns(0), rtt_ns(-1) {}
+    };
+    std::map<int, LinkLatency> link_latency_;
+
     bool is_active_;
     int messages_sent_;
     void initialize_state();
@@ -2,6 +2,7 @@
 #ifndef MESSAGE_HPP
 #define MESSAGE_HPP
 
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <sstream>
@@ -12,13 +13,29 @@ struct Message {
     std::string payload;
 };
 
+// aggregated snapshot state as it travels towards node 0: one node's local
+// state, or the merge of a whole subtree
+struct SnapshotState {
+    int snapshot_id;
+    int origin;           // node whose state (or subtree) this is
+    int nodes;            // local states merged in
+    int active;           // of which were active
+    long long in_transit; // APP frames recorded on channels
+};
+
 // --- Minimal helpers for APP messages: "APP|<sender>|v0,v1,...|<payload>"
-inline std::string encode_app_message(int sender_id,
-                                      const std::vector<int>& vc,
-                                      const std::string& payload)
+//
+// The sender field may carry annotations, "APP|<sender>;k=v;k=v|...", for
+// data piggybacked on APP traffic (e.g. the snapshot epoch). The sender id
+// is parsed with stoi, which stops at the first ';', so decode_app_message
+// reads annotated frames unchanged.
+inline std::string encode_annotated_app_message(int sender_id,
+                                                const std::string& annotations,
+                                                const std::vector<int>& vc,
+                                                const std::string& payload)
 {
     std::ostringstream oss;
-    oss << "APP|" << sender_id << "|";
+    oss << "APP|" << sender_id << annotations << "|";
     for (size_t i = 0; i < vc.size(); ++i) {
         if (i) oss << ",";
         oss << vc[i];
@@ -27,6 +44,99 @@ inline std::string encode_app_message(int sender_id,
     return oss.str();
 }
 
+inline std::string encode_app_message(int sender_id,
+                                      const std::vector<int>& vc,
+                                      const std::string& payload)
+{
+    return encode_annotated_app_message(sender_id, "", vc, payload);
+}
+
+// clock field "v0,v1,..." from raw entries, without an ostringstream
+inline void append_clock_text(std::string& out, const uint32_t* vc, size_t n)
+{
+    char digits[10];
+    for (size_t i = 0; i < n; ++i) {
+        if (i) out += ',';
+        uint32_t v = vc[i];
+        int len = 0;
+        do { digits[len++] = static_cast<char>('0' + v % 10); v /= 10; } while (v);
+        while (len) out += digits[--len];
+    }
+}
+
+// parse a clock field into out[0..n); entries past n are skipped like
+// decode_app_message's callers ignored them. Returns the number of
+// entries, or -1 on anything but digits and commas
+inline int parse_clock_text(const char* b, const char* e, uint32_t* out,
+                            size_t n)
+{
+    int count = 0;
+    while (b != e) {
+        if (*b == ',') { ++b; continue; }           // empty entries skipped
+        uint64_t v = 0;
+        const char* start = b;
+        while (b != e && *b >= '0' && *b <= '9' && v <= 0xffffffffULL)
+            v = v * 10 + static_cast<uint64_t>(*b++ - '0');
+        if (b == start || v > 0xffffffffULL || (b != e && *b != ','))
+            return -1;
+        if (static_cast<size_t>(count) < n) out[count] = static_cast<uint32_t>(v);
+        ++count;
+    }
+    return count;
+}
+
+// same frame as encode_annotated_app_message, from a raw uint32 clock
+inline std::string encode_annotated_app_message(int sender_id,
+                                                const std::string& annotations,
+                                                const uint32_t* vc, size_t n,
+                                                const std::string& payload)
+{
+    std::string out = "APP|" + std::to_string(sender_id) + annotations + "|";
+    out.reserve(out.size() + 11 * n + 1 + payload.size());
+    append_clock_text(out, vc, n);
+    out += '|';
+    out += payload;
+    return out;
+}
+
+// locate the clock field of an APP frame without copying it
+inline bool find_app_clock(const std::string& s, const char*& b,
+                           const char*& e)
+{
+    if (s.compare(0, 4, "APP|") != 0) return false;
+    size_t p2 = s.find('|', 4);
+    if (p2 == std::string::npos) return false;
+    size_t p3 = s.find('|', p2 + 1);
+    if (p3 == std::string::npos) return false;
+    b = s.data() + p2 + 1;
+    e = s.data() + p3;
+    return true;
+}
+
+// one annotation, ";<key>=<value>", to append to the sender field
+inline std::string app_annotation(const char* key, long long value)
+{
+    return std::string(";") + key + "=" + std::to_string(value);
+}
+
+// look up an annotation in the sender field; false if it is absent
+inline bool find_app_annotation(const std::string& s, const char* key,
+                                long long& value)
+{
+    size_t p1 = s.find('|');
+    if (p1 == std::string::npos) return false;
+    size_t p2 = s.find('|', p1 + 1);
+    if (p2 == std::string::npos) return false;
+
+    const std::string needle = std::string(";") + key + "=";
+    size_t at = s.find(needle, p1 + 1);
+    if (at == std::string::npos || at > p2) return false;
+    try {
+        value = std::stoll(s.substr(at + needle.size(), p2 - at - needle.size()));
+    } catch (...) { return false; }
+    return true;
+}
+
 inline bool decode_app_message(const std::string& s,
                                int &sender_id,
                                std::vector<int>& vc_out,
@@ -59,4 +169,189 @@ inline bool decode_app_message(const std::string& s,
     return true;
 }
 
+// --- Snapshot markers: "MARKER|<sender>|<snapshot_id>"
+inline bool is_app_message(const std::string& s)
+{
+    return s.compare(0, 4, "APP|") == 0;
+}
+
+inline bool is_marker_message(const std::string& s)
+{
+    return s.compare(0, 7, "MARKER|") == 0;
+}
+
+inline std::string encode_marker_message(int sender_id, int snapshot_id)
+{
+    return std::string("MARKER|") + std::to_string(sender_id) + "|" +
+           std::to_string(snapshot_id);
+}
+
+inline bool decode_marker_message(const std::string& s,
+                                  int &sender_id,
+                                  int &snapshot_id)
+{
+    if (!is_marker_message(s)) return false;
+    size_t p1 = 6;
+    size_t p2 = s.find('|', p1 + 1);
+    if (p2 == std::string::npos) return false;
+    try {
+        sender_id = std::stoi(s.substr(p1 + 1, p2 - (p1 + 1)));
+        snapshot_id = std::stoi(s.substr(p2 + 1));
+    } catch (...) { return false; }
+    return true;
+}
+
+// --- Epoch announcements (piggyback snapshots): "EPOCH|<sender>|<epoch>"
+inline bool is_epoch_message(const std::string& s)
+{
+    return s.compare(0, 6, "EPOCH|") == 0;
+}
+
+inline std::string encode_epoch_message(int sender_id, int epoch)
+{
+    return std::string("EPOCH|") + std::to_string(sender_id) + "|" +
+           std::to_string(epoch);
+}
+
+inline bool decode_epoch_message(const std::string& s,
+                                 int &sender_id,
+                                 int &epoch)
+{
+    if (!is_epoch_message(s)) return false;
+    size_t p1 = 5;
+    size_t p2 = s.find('|', p1 + 1);
+    if (p2 == std::string::npos) return false;
+    try {
+        sender_id = std::stoi(s.substr(p1 + 1, p2 - (p1 + 1)));
+        epoch = std::stoi(s.substr(p2 + 1));
+    } catch (...) { return false; }
+    return true;
+}
+
+// --- Returned termination credit: "CREDIT|<sender>|k0,k1,..." (weight 2^-k each)
+inline bool is_credit_message(const std::string& s)
+{
+    return s.compare(0, 7, "CREDIT|") == 0;
+}
+
+inline std::string encode_credit_message(int sender_id,
+                                         const std::vector<int>& credits)
+{
+    std::ostringstream oss;
+    oss << "CREDIT|" << sender_id << "|";
+    for (size_t i = 0; i < credits.size(); ++i) {
+        if (i) oss << ",";
+        oss << credits[i];
+    }
+    return oss.str();
+}
+
+inline bool decode_credit_message(const std::string& s,
+                                  int &sender_id,
+                                  std::vector<int>& credits)
+{
+    if (!is_credit_message(s)) return false;
+    size_t p1 = 6;
+    size_t p2 = s.find('|', p1 + 1);
+    if (p2 == std::string::npos) return false;
+    credits.clear();
+    try {
+        sender_id = std::stoi(s.substr(p1 + 1, p2 - (p1 + 1)));
+        std::istringstream ks(s.substr(p2 + 1));
+        std::string token;
+        while (std::getline(ks, token, ',')) {
+            if (!token.empty()) credits.push_back(std::stoi(token));
+        }
+    } catch (...) { return false; }
+    return true;
+}
+
+// --- Orderly shutdown after termination: "HALT|<sender>|<detected_wall_ns>"
+inline bool is_halt_message(const std::string& s)
+{
+    return s.compare(0, 5, "HALT|") == 0;
+}
+
+inline std::string encode_halt_message(int sender_id, long long detected_ns)
+{
+    return std::string("HALT|") + std::to_string(sender_id) + "|" +
+           std::to_string(detected_ns);
+}
+
+inline bool decode_halt_message(const std::string& s,
+                                int &sender_id,
+                                long long &detected_ns)
+{
+    if (!is_halt_message(s)) return false;
+    size_t p1 = 4;
+    size_t p2 = s.find('|', p1 + 1);
+    if (p2 == std::string::npos) return false;
+    try {
+        sender_id = std::stoi(s.substr(p1 + 1, p2 - (p1 + 1)));
+        detected_ns = std::stoll(s.substr(p2 + 1));
+    } catch (...) { return false; }
+    return true;
+}
+
+// --- Clock offset for --latency: "OFFSET|<sender>|<offset_ns>|<rtt_ns>",
+// the sender's monotonic clock minus the receiver's, as the dialer of the
+// link estimated it during the HELLO exchange
+inline bool is_offset_message(const std::string& s)
+{
+    return s.compare(0, 7, "OFFSET|") == 0;
+}
+
+inline std::string encode_offset_message(int sender_id, long long offset_ns,
+                                         long long rtt_ns)
+{
+    return std::string("OFFSET|") + std::to_string(sender_id) + "|" +
+           std::to_string(offset_ns) + "|" + std::to_string(rtt_ns);
+}
+
+inline bool decode_offset_message(const std::string& s,
+                                  int &sender_id,
+                                  long long &offset_ns,
+                                  long long &rtt_ns)
+{
+    if (!is_offset_message(s)) return false;
+    size_t p1 = 6;
+    size_t p2 = s.find('|', p1 + 1);
+    if (p2 == std::string::npos) return false;
+    size_t p3 = s.find('|', p2 + 1);
+    if (p3 == std::string::npos) return false;
+    try {
+        sender_id = std::stoi(s.substr(p1 + 1, p2 - (p1 + 1)));
+        offset_ns = std::stoll(s.substr(p2 + 1, p3 - (p2 + 1)));
+        rtt_ns = std::stoll(s.substr(p3 + 1));
+    } catch (...) { return false; }
+    return true;
+}
+
+// --- Snapshot state: "STATE|<sender>|<snapshot_id>|<origin>|<nodes>,<active>,<in_transit>"
+inline bool is_state_message(const std::string& s)
+{
+    return s.compare(0, 6, "STATE|") == 0;
+}
+
+inline std::string encode_state_message(int sender_id, const SnapshotState& st)
+{
+    std::ostringstream oss;
+    oss << "STATE|" << sender_id << "|" << st.snapshot_id << "|" << st.origin
+        << "|" << st.nodes << "," << st.active << "," << st.in_transit;
+    return oss.str();
+}
+
+inline bool decode_state_message(const std::string& s,
+                                 int &sender_id,
+                                 SnapshotState& st)
+{
+    if (!is_state_message(s)) return false;
+    std::istringstream iss(s.substr(6));
+    char bar1 = 0, bar2 = 0, bar3 = 0, c1 = 0, c2 = 0;
+    if (!(iss >> sender_id >> bar1 >> st.snapshot_id >> bar2 >> st.origin
+              >> bar3 >> st.nodes >> c1 >> st.active >> c2 >> st.in_transit))
+        return false;
+    return bar1 == '|' && bar2 == '|' && bar3 == '|' && c1 == ',' && c2 == ',';
+}
+
 #endif // MESSAGE_HPP
@@ -0,0 +1,240 @@
+/****************************************************************************
+ * file: metrics.hpp
+ * author: luke le
+ * description:
+ *     declares the process-wide metrics registry (counters, gauges and
+ *     probes read at export time) and the Unix-domain socket that serves
+ *     it while a node runs.
+ * notes:
+ *     a counter update is a relaxed load/store on a cell only the calling
+ *     thread writes: every thread gets its own block of cells the first
+ *     time it counts anything, and a read sums the blocks. Nothing on the
+ *     hot path takes a lock or a shared cache line. Registration takes the
+ *     registry mutex and is meant for setup, not for every message.
+ *
+ *     export formats:
+ *       Prometheus text  # HELP / # TYPE, then name{labels} value
+ *       JSON             {"metrics":[{"name":..,"labels":{..},"type":..,
+ *                                     "value":..}, ...]}
+ ****************************************************************************/
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include "shutdown_signal.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum MetricType { METRIC_COUNTER, METRIC_GAUGE, METRIC_PROBE };
+
+/**
+ * @brief gauge value computed when the registry is exported.
+ *
+ * @param ctx the pointer given to Metrics::probe().
+ * @param arg the integer given to Metrics::probe(), e.g. a peer id.
+ * @return current value; negative means not available and is exported
+ *         as -1.
+ */
+typedef int64_t (*MetricProbe)(void *ctx, int arg);
+
+/**
+ * @class Metrics
+ * @brief registry of named, labelled metrics shared by every node a
+ *        process runs.
+ *
+ * Metric ids stay valid for the life of the process; registering the same
+ * name and labels again returns the same id. Labels are given in
+ * Prometheus form, e.g. `node="3",peer="5"`.
+ */
+class Metrics {
+public:
+    // ids beyond this many are folded into a sink that is never exported
+    static const int kMaxMetrics = 1 << 18;
+
+    /**
+     * @brief the registry of this process.
+     */
+    static Metrics &global();
+
+    Metrics();
+    ~Metrics();
+
+    /**
+     * @brief register (or look up) a monotonically increasing counter.
+     *
+     * @param name metric name, e.g. map_link_messages_sent_total.
+     * @param labels label set without braces; may be empty.
+     * @param help one line for # HELP; the first registration's wins.
+     * @return id for add(); the sink id 0 once the registry is full.
+     */
+    int counter(const std::string &name, const std::string &labels,
+                const std::string &help);
+
+    /**
+     * @brief register (or look up) a gauge that set() overwrites.
+     */
+    int gauge(const std::string &name, const std::string &labels,
+              const std::string &help);
+
+    /**
+     * @brief register a gauge whose value fn computes at export time.
+     *
+     * fn runs on the exporting thread with the registry mutex held, so
+     * drop_probes(ctx) does not return while a call on ctx is running.
+     */
+    int probe(const std::string &name, const std::string &labels,
+              const std::string &help, MetricProbe fn, void *ctx, int arg);
+
+    /**
+     * @brief stop calling the probes registered with ctx; call it before
+     *        whatever they read goes away. Their metrics export as -1.
+     */
+    void drop_probes(void *ctx);
+
+    /**
+     * @brief add n to a counter from the calling thread's own cell.
+     */
+    void add(int id, uint64_t n = 1) {
+        std::atomic<uint64_t> *cells = thread_cells(id);
+        std::atomic<uint64_t> &c = cells[id & (kChunk - 1)];
+        c.store(c.load(std::memory_order_relaxed) + n,
+                std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief overwrite a gauge.
+     */
+    void set(int id, int64_t v) {
+        gauge_cell(id).store(v, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief current value: a counter summed over all threads, a gauge as
+     *        last set, a probe as computed now.
+     */
+    int64_t value(int id) const;
+
+    /**
+     * @brief render every metric.
+     */
+    std::string prometheus() const;
+    std::string json() const;
+
+    /**
+     * @brief write prometheus() or json() to path (truncating it).
+     *
+     * @return false (with a message) if the file cannot be written.
+     */
+    bool dump(const std::string &path, bool as_json) const;
+
+    size_t size() const;
+
+private:
+    static const int kChunk = 1024;                   // cells per chunk
+    static const int kChunks = kMaxMetrics / kChunk;
+
+    struct Desc {
+        std::string name;
+        std::string labels;
+        MetricType type;
+        MetricProbe fn;
+        void *ctx;
+        int arg;
+    };
+
+    // one per thread that ever counted; chunks are allocated by the owner
+    // on first use and read by exporters, so the pointers are atomic
+    struct Block {
+        std::atomic<std::atomic<uint64_t> *> chunks[kChunks];
+    };
+
+    const uint64_t serial_;            // tells registries apart in caches
+    mutable std::mutex m_;
+    std::vector<Desc> descs_;
+    std::map<std::string, int> by_key_;               // name{labels} -> id
+    std::map<std::string, std::string> help_;         // name -> help
+    std::map<std::thread::id, Block *> blocks_;
+    std::atomic<std::atomic<int64_t> *> gauges_[kChunks];
+    bool full_reported_;
+
+    int add_metric(const std::string &name, const std::string &labels,
+                   const std::string &help, MetricType type,
+                   MetricProbe fn, void *ctx, int arg);
+    // the calling thread's block of the registry it last counted in
+    struct ThreadCache {
+        uint64_t serial;
+        Block *block;
+    };
+    static thread_local ThreadCache tls_;
+
+    std::atomic<uint64_t> *thread_cells(int id) {
+        Block *b = tls_.serial == serial_ ? tls_.block : thread_block();
+        // only this thread stores its chunk pointers
+        std::atomic<uint64_t> *c =
+            b->chunks[id / kChunk].load(std::memory_order_relaxed);
+        return c ? c : new_chunk(b, id / kChunk);
+    }
+    Block *thread_block();
+    std::atomic<uint64_t> *new_chunk(Block *b, int chunk);
+    std::atomic<int64_t> &gauge_cell(int id) const {
+        return gauges_[id / kChunk].load(std::memory_order_acquire)
+            [id & (kChunk - 1)];
+    }
+    int64_t value_locked(int id) const;
+
+    Metrics(const Metrics &);
+    Metrics &operator=(const Metrics &);
+}; // Metrics class
+
+/**
+ * @class MetricsServer
+ * @brief serves a registry on a Unix-domain stream socket.
+ *
+ * A client connects and either writes "json\n" for JSON or sends nothing
+ * (or closes its write side) for Prometheus text; the server answers once
+ * and closes the connection, e.g.
+ * @code
+ *   socat - UNIX-CONNECT:logs/config-0.metrics.sock </dev/null
+ *   echo json | socat - UNIX-CONNECT:logs/config-0.metrics.sock
+ * @endcode
+ */
+class MetricsServer {
+public:
+    explicit MetricsServer(const Metrics &metrics = Metrics::global());
+    ~MetricsServer();
+
+    /**
+     * @brief bind path (replacing a stale socket file) and start serving
+     *        on a background thread.
+     *
+     * @return false (with a message) if the socket cannot be set up.
+     */
+    bool start(const std::string &path);
+
+    /**
+     * @brief stop serving and remove the socket file; idempotent.
+     */
+    void stop();
+
+    const std::string &path() const { return path_; }
+
+private:
+    const Metrics &metrics_;
+    std::string path_;
+    int fd_;
+    ShutdownSignal stop_;
+    std::thread thread_;
+
+    void serve();
+    void answer(int client);
+
+    MetricsServer(const MetricsServer &);
+    MetricsServer &operator=(const MetricsServer &);
+}; // MetricsServer class
+
+#endif // METRICS_HPP
@@ -1,6 +1,7 @@
 #ifndef NODE_HPP
 #define NODE_HPP
 
+#include <cstdint>
 #include <string>
 
 /**
@@ -16,11 +17,15 @@
  * @param host hostname or IP address of the node.
  * @param port TCP port number on which the node listens for incoming
  *        messages.
+ * @param addr IPv4 address of host in network byte order when it was
+ *        resolved ahead of time (topology image), 0 if it is resolved at
+ *        connect time.
  */
 struct NodeInfo {
     int id;
     std::string host;
     int port;
+    uint32_t addr;
 };
 
 #endif
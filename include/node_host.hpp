@@ -0,0 +1,167 @@
+/****************************************************************************
+ * file: node_host.hpp
+ * author: luke le
+ * description:
+ *     runs a set of node ids in one process: every hosted MapProtocol is a
+ *     state machine driven by a fixed pool of worker threads, the config
+ *     and BFS tree are shared read-only, and frames between hosted nodes
+ *     go through in-memory mailboxes instead of SCTP.
+ * usage:
+ *     proj1 0-999 --workers=8         (see ds/main.cpp)
+ * notes:
+ *     each node has one mailbox of frames and timer events, and is on the
+ *     run queue at most once, so a single worker handles it at a time and
+ *     in arrival order: channels stay FIFO, which the snapshots rely on.
+ *     A timer thread turns due writer and snapshot steps into mailbox
+ *     events, replacing the per-node writer and snapshot threads.
+ *
+ *     a neighbor outside the set is still reached over SCTP: the node
+ *     connects it during start() and a receiver thread per such link posts
+ *     its frames into the mailbox. Snapshot output is written synchronously
+ *     on the workers, since an async writer is one more thread per node.
+ ****************************************************************************/
+#ifndef NODE_HOST_HPP
+#define NODE_HOST_HPP
+
+#include "config.hpp"
+#include "options.hpp"
+#include "shutdown_signal.hpp"
+#include "spanning_tree.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+class MapProtocol;
+
+class NodeHost {
+public:
+    /**
+     * @param cfg parsed configuration; shared by every hosted node and
+     *        must outlive the host.
+     * @param ids node ids to run in this process.
+     * @param opts options for every hosted node.
+     * @param workers worker threads; 0 uses one per core.
+     */
+    NodeHost(const Config &cfg, const std::vector<int> &ids,
+             const Options &opts, int workers = 0);
+    ~NodeHost();
+
+    /**
+     * @brief start every hosted node and block until all of them halted or
+     *        stop() was called, then write their final reports.
+     *
+     * @return false (nothing started) if an id is out of range or repeated,
+     *         or the set is empty.
+     */
+    bool run();
+
+    /**
+     * @brief stop every hosted node; async-signal-safe.
+     */
+    void stop();
+
+    /**
+     * @brief true if node id runs in this process.
+     */
+    bool hosts(int id) const {
+        return id >= 0 && id < static_cast<int>(hosted_.size()) &&
+               hosted_[id];
+    }
+
+    /**
+     * @brief BFS tree from node 0, built once for all hosted nodes.
+     */
+    const std::shared_ptr<const SpanningTree> &tree() const { return tree_; }
+
+    int workers() const { return workers_; }
+
+    /**
+     * @brief frames handed from one hosted node to another so far.
+     */
+    uint64_t frames() const { return frames_.load(); }
+
+    /**
+     * @brief queue a frame for hosted node to; thread-safe.
+     *
+     * @param from sending neighbor (hosted or remote).
+     * @param to receiving hosted node.
+     * @param frame the frame as it would go over SCTP.
+     */
+    void post(int from, int to, const std::string &frame);
+
+    /**
+     * @brief queue a timer event (HostTimer) for node after delay_ms.
+     */
+    void schedule(int node, int timer, int delay_ms);
+
+private:
+    struct Event {
+        int from;        // sender of a frame, -1 for a timer event
+        int timer;
+        std::string frame;
+    };
+
+    struct Mailbox {
+        std::mutex m;
+        std::deque<Event> events;
+        bool queued;     // on ready_ or being drained by a worker
+        bool done;       // halted; only touched by the draining worker
+        Mailbox() : queued(false), done(false) {}
+    };
+
+    struct Timer {
+        int64_t due_ns;
+        int node;
+        int timer;
+        bool operator>(const Timer &o) const { return due_ns > o.due_ns; }
+    };
+
+    void push(int node, Event &ev);
+    void worker_loop();
+    void timer_loop();
+    void drain(int node);
+    void start_nodes();
+    // frames and timer events waiting in node's mailbox, for the exporter
+    static int64_t probe_inbox(void *self, int node);
+
+    const Config &cfg_;
+    const std::vector<int> ids_;
+    Options opts_;
+    const int workers_;
+    std::vector<char> hosted_;                        // by node id
+    std::shared_ptr<const SpanningTree> tree_;
+
+    // by node id, null for nodes in other processes
+    std::vector<std::unique_ptr<MapProtocol> > nodes_;
+    std::vector<std::unique_ptr<Mailbox> > boxes_;
+
+    // nodes with pending events, each at most once
+    std::mutex ready_m_;
+    std::condition_variable ready_cv_;
+    std::deque<int> ready_;
+
+    std::mutex timer_m_;
+    std::condition_variable timer_cv_;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer> >
+        timers_;
+
+    std::vector<std::thread> threads_;
+    ShutdownSignal shutdown_;          // all nodes halted, or stop()
+    std::atomic<bool> stopping_;       // workers and timer thread exit
+    std::atomic<int> halted_;
+    std::atomic<uint64_t> frames_;
+
+    // non-copyable: owns threads
+    NodeHost(const NodeHost &);
+    NodeHost &operator=(const NodeHost &);
+}; // NodeHost class
+
+#endif // NODE_HOST_HPP
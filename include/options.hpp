@@ -0,0 +1,121 @@
+/****************************************************************************
+ * file: options.hpp
+ * author: luke le
+ * description:
+ *     declares the runtime options a node accepts on its command line, as
+ *     opposed to the topology and MAP parameters read from the config file.
+ ****************************************************************************/
+#ifndef OPTIONS_HPP
+#define OPTIONS_HPP
+
+#include "convergecast.hpp"
+#include "logger.hpp"
+#include "snapshot_manager.hpp"
+#include "snapshot_writer.hpp"
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief who dials the link between two nodes during setup.
+ *
+ * SETUP_ORDERED  the lower id dials, the higher one only accepts: one
+ *                association and one HELLO exchange per edge.
+ * SETUP_BOTH     both ends dial and accept at once and the duplicate is
+ *                closed afterwards (the original scheme).
+ */
+enum SetupMode { SETUP_ORDERED, SETUP_BOTH };
+
+/**
+ * @brief per-run knobs that do not belong in the shared config file.
+ *
+ * Every field defaults to the behavior of a plain `proj1 <node_id>` run.
+ *
+ * @param snapshot_writer batching/durability of the .out writer
+ *        (--sync-snapshots, --snapshot-batch=N, --snapshot-flush-ms=N,
+ *        --fdatasync, --snapshot-format=text|binary).
+ * @param collect how local snapshot states reach node 0
+ *        (--collect=tree|flood).
+ * @param max_snapshots snapshot instances that may overlap
+ *        (--max-snapshots=N).
+ * @param snapshot_mode markers on every channel or an epoch piggybacked
+ *        on APP frames (--snapshot-mode=marker|piggyback).
+ * @param config config file to read instead of the one compiled in as
+ *        CONFIG_FILE_PATH (--config=PATH).
+ * @param topology compiled topology image to load instead of parsing the
+ *        config file (--topology=PATH, see ds/tools/topology.cpp).
+ * @param workers worker threads when one process hosts several nodes
+ *        (--workers=N, 0 = one per core; see node_host.hpp).
+ * @param control launch driver to report readiness to and wait for before
+ *        the computation starts (--control=HOST:PORT, set by
+ *        ds/tools/launch.cpp).
+ * @param setup which end of a link dials it (--setup=ordered|both).
+ * @param metrics_socket where the metrics are served while the node runs
+ *        (--metrics-socket=PATH|off; empty: logs/<config>-<id>.metrics.sock).
+ * @param metrics_json dump the metrics as JSON instead of Prometheus text
+ *        on exit (--metrics-format=text|json).
+ * @param log_binary write the log to logs/<config>-<id>.log.bin for
+ *        ds/tools/logfmt.cpp instead of as text (--log=text|binary).
+ * @param log_level least severe records kept
+ *        (--log-level=debug|info|warn|error).
+ * @param trace record an event trace to logs/<config>-<id>.trace
+ *        (--trace; needs a build with the TRACING option, see trace.hpp).
+ * @param latency stamp APP frames with their send time and report the
+ *        one-way delay per link at exit (--latency, see
+ *        latency_histogram.hpp).
+ */
+struct Options {
+    SnapshotWriterOptions snapshot_writer;
+    CollectMode collect;
+    int max_snapshots;
+    SnapshotMode snapshot_mode;
+    std::string config;
+    std::string topology;
+    int workers;
+    std::string control;
+    SetupMode setup;
+    std::string metrics_socket;
+    bool metrics_json;
+    bool log_binary;
+    LogLevel log_level;
+    bool trace;
+    bool latency;
+
+    Options()
+        : collect(COLLECT_TREE), max_snapshots(4),
+          snapshot_mode(SNAPSHOT_MARKER), workers(0),
+          setup(SETUP_ORDERED), metrics_json(false),
+          log_binary(false), log_level(LEVEL_INFO),
+          trace(false), latency(false) {}
+};
+
+/**
+ * @brief parse `--flag` / `--flag=value` arguments into an Options object.
+ *
+ * @param argc argument count as passed to main().
+ * @param argv argument vector as passed to main().
+ * @param first index of the first option argument.
+ * @param opts options to update; untouched fields keep their defaults.
+ * @return false (after printing the offending argument) on an unknown flag
+ *         or a malformed value.
+ */
+bool parse_options(int argc, char *argv[], int first, Options &opts);
+
+/**
+ * @brief parse the node ids a hosting process runs, e.g. "0-99,120,130".
+ *
+ * @param text comma-separated ids and inclusive ranges.
+ * @param ids receives the ids in the order given.
+ * @return false on a malformed list or an empty/reversed range; range
+ *         checks against n happen once the config is loaded.
+ */
+bool parse_node_ids(const std::string &text, std::vector<int> &ids);
+
+/**
+ * @brief print the option summary to stderr.
+ *
+ * @param prog program name for the usage line.
+ */
+void print_usage(const char *prog);
+
+#endif // OPTIONS_HPP
@@ -0,0 +1,52 @@
+/****************************************************************************
+ * file: probes.hpp
+ * author: luke le
+ * description:
+ *     declares the static tracepoints (USDT / SystemTap SDT, provider
+ *     proj1) that perf and bpftrace attach to in a running node, without
+ *     a rebuild or --trace.
+ * usage:
+ *     PROBE3(app_send, id_, peer, seq);
+ *
+ *     bpftrace -e 'usdt:build/proj1:proj1:app_recv { @[arg1] = count(); }'
+ *     perf buildid-cache --add build/proj1
+ *     perf record -e sdt_proj1:app_send -e sdt_proj1:app_recv -p <pid>
+ * notes:
+ *     a probe site is one nop plus an entry in the .note.stapsdt ELF
+ *     section that tells the tracer where the site is and where each
+ *     argument lives; attaching turns the nop into a breakpoint. Not
+ *     attached, a probe costs the nop and keeping its arguments in
+ *     registers, so arguments must be values already at hand.
+ *
+ *     the macros compile to nothing unless MAP_PROBES is defined (CMake
+ *     option PROBES, on by default, set when <sys/sdt.h> is found; it is
+ *     header-only, from systemtap-sdt-dev or systemtap-sdt-devel).
+ *
+ *     probes, arg0 is always the node id:
+ *       link_up          peer, id of the end that dialed the kept link
+ *       hello            peer, 1 if this end dialed
+ *       app_send         peer, sender's own clock entry (the frame's seq)
+ *       app_recv         peer, sender's own clock entry
+ *       state            1 active / 0 passive, APP frames sent so far
+ *       snapshot_begin   snapshot id (epoch in piggyback mode)
+ *       snapshot_end     snapshot id, APP frames found in transit; marker
+ *                        mode, once every channel's state is in
+ *       snapshot_global  snapshot id, us from its start (root only)
+ *       termination      APP frames sent (root, on detection)
+ *       halt             wall-clock ns of the detection HALT carries
+ ****************************************************************************/
+#ifndef PROBES_HPP
+#define PROBES_HPP
+
+#ifdef MAP_PROBES
+#include <sys/sdt.h>
+#define PROBE1(name, a) DTRACE_PROBE1(proj1, name, a)
+#define PROBE2(name, a, b) DTRACE_PROBE2(proj1, name, a, b)
+#define PROBE3(name, a, b, c) DTRACE_PROBE3(proj1, name, a, b, c)
+#else
+#define PROBE1(name, a) do {} while (0)
+#define PROBE2(name, a, b) do {} while (0)
+#define PROBE3(name, a, b, c) do {} while (0)
+#endif
+
+#endif // PROBES_HPP
@@ -14,6 +14,7 @@
 #ifndef SCTP_WRAPPER_HPP
 #define SCTP_WRAPPER_HPP
 
+#include <cstdint>
 #include <netinet/in.h>
 #include <string>
 
@@ -64,6 +65,18 @@ public:
      */
     ~SCTPSocket();
 
+    /**
+     * @brief transfer ownership of an open socket.
+     *
+     * The source is left in the empty state (no descriptor), so its
+     * destructor does not close the descriptor now owned by this object.
+     * Copying is disabled for the same reason.
+     *
+     * @param other socket whose descriptor and address are taken over.
+     */
+    SCTPSocket(SCTPSocket &&other);
+    SCTPSocket &operator=(SCTPSocket &&other);
+
     /**
      * @brief create a new SCTP socket in 1-to-1 mode.
      *
@@ -118,10 +131,32 @@ public:
      *
      * @param host hostname or IP address of the remote peer.
      * @param port remote port number to connect to.
-     * @return true if the connection succeeded, false otherwise.
+     * @return true if the connection succeeded, false otherwise. Failures
+     *         other than a refused connection are reported on stderr.
      */
     bool connect(const std::string &host, int port);
 
+    /**
+     * @brief connect to a remote SCTP endpoint whose address is known.
+     *
+     * Same as connect(host, port) without the name lookup, e.g. for an
+     * address taken from a compiled topology image.
+     *
+     * @param ipv4 IPv4 address of the remote peer in network byte order.
+     * @param port remote port number to connect to.
+     * @return true if the connection succeeded, false otherwise.
+     */
+    bool connect(uint32_t ipv4, int port);
+
+    /**
+     * @brief resolve a hostname to one IPv4 address.
+     *
+     * @param host hostname or dotted IPv4 address.
+     * @param ipv4 resolved address in network byte order.
+     * @return false (after printing the host) if it does not resolve.
+     */
+    static bool resolve(const std::string &host, uint32_t &ipv4);
+
     /**
      * @brief send a message over an established SCTP connection.
      *
@@ -136,8 +171,9 @@ public:
     /**
      * @brief receive a message from the SCTP socket.
      *
-     * Blocks until data is available, then uses sctp_recvmsg() to read up to
-     * 1024 bytes. The received bytes are stored in the provided string.
+     * Blocks until data is available, then calls sctp_recvmsg() until the
+     * end of the message (MSG_EOR), so messages of any size arrive whole.
+     * The received bytes are stored in the provided string.
      *
      * @param message output string to hold the received message.
      * @return true if data was received successfully, false otherwise.
@@ -151,6 +187,26 @@ public:
      */
     sockaddr_in get_peer_addr() const;
 
+    /**
+     * @brief get the underlying socket descriptor.
+     *
+     * Exposed so callers can wait on the socket with poll() alongside other
+     * descriptors (e.g. a shutdown eventfd) instead of blocking in
+     * receive() or accept().
+     *
+     * @return file descriptor, or -1 if the socket is not open.
+     */
+    int get_fd() const;
+
+    /**
+     * @brief DATA chunks the association has not delivered yet: queued for
+     *        sending plus sent but unacknowledged (SCTP_STATUS).
+     *
+     * @return chunk count, or -1 if the socket is closed or the kernel
+     *         does not report it.
+     */
+    int pending_chunks() const;
+
     /**
      * @brief close the SCTP socket if open.
      *
@@ -172,6 +228,10 @@ private:
      * messages.
      */
     void set_defaults();
+
+    // non-copyable: two objects must never close the same descriptor
+    SCTPSocket(const SCTPSocket &);
+    SCTPSocket &operator=(const SCTPSocket &);
 }; // SCTPSocket class
 
 #endif // SCTP_WRAPPER_HPP
@@ -0,0 +1,131 @@
+/****************************************************************************
+ * file: shutdown_signal.hpp
+ * author: luke le
+ * description:
+ *     declares a one-shot, event-driven shutdown signal built on a Linux
+ *     eventfd, used to wake every blocked thread of a node at once.
+ * notes:
+ *     the eventfd is written once and never drained, so it stays readable
+ *     for as long as the signal exists. Any thread that poll()s on it,
+ *     whether alone or alongside a socket descriptor, returns immediately
+ *     after trigger() with no polling interval involved.
+ ****************************************************************************/
+#ifndef SHUTDOWN_SIGNAL_HPP
+#define SHUTDOWN_SIGNAL_HPP
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @class ShutdownSignal
+ * @brief a level-triggered, one-shot wakeup shared by all node threads.
+ *
+ * Typical usage:
+ * @code
+ *   ShutdownSignal sig;
+ *   // worker thread
+ *   while (sig.wait_readable(sock_fd, -1) == ShutdownSignal::WAIT_READY) {
+ *       ... read from sock_fd ...
+ *   }
+ *   // any other thread, or a signal handler
+ *   sig.trigger();
+ * @endcode
+ */
+class ShutdownSignal {
+public:
+    /**
+     * @brief outcome of a wait on a descriptor and the shutdown signal.
+     */
+    enum WaitResult {
+        WAIT_READY,     // the watched descriptor is readable
+        WAIT_TIMEOUT,   // the timeout expired first
+        WAIT_SHUTDOWN   // the signal was triggered
+    };
+
+    /**
+     * @brief create the underlying eventfd in the untriggered state.
+     */
+    ShutdownSignal();
+
+    /**
+     * @brief close the underlying eventfd.
+     */
+    ~ShutdownSignal();
+
+    /**
+     * @brief trigger the signal and wake every waiting thread.
+     *
+     * Idempotent; only the first call records the trigger time. The call
+     * only performs an atomic exchange, clock_gettime() and write(), so it
+     * is safe to use from a signal handler.
+     */
+    void trigger();
+
+    /**
+     * @brief check whether trigger() has been called.
+     *
+     * @return true once the signal has been triggered.
+     */
+    bool triggered() const;
+
+    /**
+     * @brief block until the signal is triggered or the timeout expires.
+     *
+     * @param timeout_ms maximum time to wait in milliseconds; negative
+     *        waits forever, zero only checks.
+     * @return true if the signal was triggered, false on timeout.
+     */
+    bool wait_for(int timeout_ms) const;
+
+    /**
+     * @brief block until fd is readable, the signal fires, or a timeout.
+     *
+     * Shutdown takes priority: if both are ready, WAIT_SHUTDOWN is
+     * returned so callers can decide whether to drain.
+     *
+     * @param fd descriptor to watch for readability.
+     * @param timeout_ms maximum time to wait; negative waits forever.
+     * @return which event ended the wait.
+     */
+    WaitResult wait_readable(int fd, int timeout_ms) const;
+
+    /**
+     * @brief get the eventfd so callers can add it to their own poll sets.
+     *
+     * @return eventfd descriptor, or -1 if it could not be created.
+     */
+    int fd() const;
+
+    /**
+     * @brief monotonic time at which trigger() first ran.
+     *
+     * @return CLOCK_MONOTONIC timestamp in nanoseconds, 0 if untriggered.
+     */
+    int64_t triggered_at_ns() const;
+
+    /**
+     * @brief current CLOCK_MONOTONIC time, for latency measurements.
+     *
+     * @return timestamp in nanoseconds.
+     */
+    static int64_t now_ns();
+
+    /**
+     * @brief current CLOCK_REALTIME time, for timestamps compared across
+     *        processes or hosts (only as good as their clock sync).
+     *
+     * @return nanoseconds since the epoch.
+     */
+    static int64_t wall_ns();
+
+private:
+    int efd_;                          // eventfd, readable once triggered
+    std::atomic<bool> flag_;           // fast path for triggered()
+    std::atomic<int64_t> triggered_ns_;
+
+    // non-copyable: owns a descriptor
+    ShutdownSignal(const ShutdownSignal &);
+    ShutdownSignal &operator=(const ShutdownSignal &);
+}; // ShutdownSignal class
+
+#endif // SHUTDOWN_SIGNAL_HPP
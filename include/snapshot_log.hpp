@@ -0,0 +1,169 @@
+/****************************************************************************
+ * file: snapshot_log.hpp
+ * author: luke le
+ * description:
+ *     declares the append-only binary snapshot log (logs/<config>-<id>.snap)
+ *     and a zero-copy, mmap-based reader for it.
+ * notes:
+ *     layout (all fixed-width integers little endian):
+ *
+ *       header   8  magic "P1SNAPLG"
+ *                2  version (1)
+ *                2  reserved
+ *                4  node id
+ *                4  n (clock size)
+ *                4  keyframe interval k
+ *       records  varint body length, then the body:
+ *                1  kind (0 = delta, 1 = keyframe)
+ *                   zigzag varint snapshot id
+ *                   n zigzag varints: clock entries, absolute for keyframes,
+ *                   otherwise the difference to the previous snapshot
+ *       footer   (written on clean close only)
+ *                16 * m  sparse index: (u64 ordinal, u64 offset) of every
+ *                        keyframe, one per k records
+ *                8  offset of the index
+ *                4  m
+ *                4  magic "P1IX"
+ *
+ *     clocks only grow, so deltas are small and most entries take one
+ *     byte instead of a decimal number and a space. A file whose footer is
+ *     missing (crash) is still readable by scanning the records in order.
+ ****************************************************************************/
+#ifndef SNAPSHOT_LOG_HPP
+#define SNAPSHOT_LOG_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @class SnapshotLogEncoder
+ * @brief appends header, records and footer of a snapshot log to a buffer.
+ *
+ * The encoder keeps the previous clock and the byte offset of everything it
+ * has produced, so the caller only has to write the bytes out in order.
+ */
+class SnapshotLogEncoder {
+public:
+    /**
+     * @param node_id id stored in the header.
+     * @param n clock size stored in the header.
+     * @param keyframe_interval every k-th record is absolute and indexed.
+     */
+    SnapshotLogEncoder(int node_id, int n, uint32_t keyframe_interval = 64);
+
+    /**
+     * @brief append the file header.
+     */
+    void header(std::string &out);
+
+    /**
+     * @brief append one snapshot record.
+     *
+     * @param snapshot_id id of the snapshot.
+     * @param vc clock; must have n entries.
+     */
+    void record(int snapshot_id, const std::vector<int> &vc, std::string &out);
+
+    /**
+     * @brief append the sparse index and trailer.
+     */
+    void footer(std::string &out);
+
+private:
+    int node_id_;
+    int n_;
+    uint32_t interval_;
+    uint64_t offset_;                  // bytes produced so far
+    uint64_t count_;                   // records produced so far
+    std::vector<int> prev_;
+    std::vector<uint64_t> index_;      // ordinal, offset pairs
+    std::string body_;                 // scratch buffer
+};
+
+/**
+ * @class SnapshotReader
+ * @brief maps a snapshot log read-only and walks its records in place.
+ *
+ * Typical usage:
+ * @code
+ *   SnapshotReader r;
+ *   if (!r.open("logs/config-0.snap")) ...;
+ *   while (r.next()) use(r.snapshot_id(), r.clock());
+ * @endcode
+ */
+class SnapshotReader {
+public:
+    SnapshotReader();
+    ~SnapshotReader();
+
+    /**
+     * @brief map and validate a log file.
+     *
+     * @param path file to open.
+     * @return false (with a message on stderr) if the file is missing or
+     *         its header is not a version-1 snapshot log.
+     */
+    bool open(const std::string &path);
+
+    /**
+     * @brief unmap the file.
+     */
+    void close();
+
+    /**
+     * @brief decode the next record into clock().
+     *
+     * @return false at the end of the records or on a corrupt record.
+     */
+    bool next();
+
+    /**
+     * @brief position the reader so that next() yields record `ordinal`.
+     *
+     * Jumps to the closest preceding keyframe through the sparse index
+     * (or scans from the start if the file has no footer).
+     *
+     * @param ordinal zero-based record number.
+     * @return false if the file has fewer records.
+     */
+    bool seek(uint64_t ordinal);
+
+    /**
+     * @brief decode every remaining record as text, one clock per line, in
+     *        the format of logs/<config>-<id>.out.
+     *
+     * @param out stream to write to.
+     * @return number of records written.
+     */
+    uint64_t to_text(std::ostream &out);
+
+    int node_id() const { return node_id_; }
+    int n() const { return n_; }
+    bool indexed() const { return index_count_ > 0; }
+
+    // valid after next() returned true
+    int snapshot_id() const { return snapshot_id_; }
+    const std::vector<int> &clock() const { return clock_; }
+    uint64_t ordinal() const { return ordinal_ - 1; }
+
+private:
+    const unsigned char *base_;
+    size_t size_;
+    size_t records_begin_;
+    size_t records_end_;
+    const unsigned char *index_;     // points into the mapping
+    uint32_t index_count_;
+    size_t pos_;
+    uint64_t ordinal_;               // ordinal of the next record
+    int node_id_;
+    int n_;
+    int snapshot_id_;
+    std::vector<int> clock_;
+
+    SnapshotReader(const SnapshotReader &);
+    SnapshotReader &operator=(const SnapshotReader &);
+};
+
+#endif // SNAPSHOT_LOG_HPP
@@ -0,0 +1,314 @@
+/****************************************************************************
+ * file: snapshot_manager.hpp
+ * author: luke le
+ * description:
+ *     declares the per-node Chandy-Lamport snapshot engine and the writer
+ *     for logs/<config>-<id>.out.
+ * notes:
+ *     the manager is passive: MapProtocol calls it under its own mutex and
+ *     sends the markers itself. A snapshot goes through three steps:
+ *       1. begin_snapshot()   record local state, open every channel
+ *       2. record_in_transit() / close_channel()
+ *                             APP frames that arrive on a channel before
+ *                             its marker are channel state
+ *       3. finish_snapshot()  once every channel is closed, hand the
+ *                             recorded clock to the SnapshotWriter
+ *     several instances may be open at once, each identified by the
+ *     snapshot id its markers carry and with its own channel recorders, so
+ *     node 0 can start a snapshot before the previous one completed.
+ *     Finished clocks are still written in snapshot id order.
+ *     In piggyback mode (Lai-Yang) there are no markers and no channel
+ *     recording: record_local() writes the local state and channel state
+ *     is derived from sent/received counters by whoever collects it.
+ *     recording() is a single relaxed atomic load so the APP receive path
+ *     pays one branch when no snapshot is in progress.
+ ****************************************************************************/
+#ifndef SNAPSHOT_MANAGER_HPP
+#define SNAPSHOT_MANAGER_HPP
+
+#include "channel_recorder.hpp"
+#include "snapshot_writer.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+/**
+ * @brief how snapshot instances are delimited on the channels.
+ *
+ * SNAPSHOT_MARKER    Chandy-Lamport: a MARKER frame on every channel.
+ * SNAPSHOT_PIGGYBACK Lai-Yang: the snapshot epoch rides on APP frames; a
+ *                    node records before it handles the first APP frame
+ *                    of a newer epoch.
+ */
+enum SnapshotMode { SNAPSHOT_MARKER, SNAPSHOT_PIGGYBACK };
+
+/**
+ * @brief the outcome of one completed local snapshot.
+ *
+ * @param id          snapshot sequence number (carried on markers).
+ * @param vc          vector clock at the moment local state was recorded.
+ * @param active      whether the node was active at that moment.
+ * @param in_transit  APP frames recorded across all incoming channels.
+ * @param per_channel in-transit frame count per incoming channel.
+ */
+struct SnapshotResult {
+    int id;
+    std::vector<int> vc;
+    bool active;
+    size_t in_transit;
+    std::map<int, size_t> per_channel;
+};
+
+/**
+ * @brief time the calling (protocol) thread spent inside record_snapshot().
+ *
+ * @param records  snapshots handed to the writer.
+ * @param total_ns summed stall time.
+ * @param max_ns   worst single stall.
+ */
+struct SnapshotStallStats {
+    uint64_t records;
+    uint64_t total_ns;
+    uint64_t max_ns;
+};
+
+/**
+ * @class SnapshotManager
+ * @brief records local and channel state and writes snapshot output.
+ */
+class SnapshotManager {
+public:
+    /**
+     * @brief construct a manager and truncate logs/<config>-<id>.out (or
+     *        .snap for the binary format).
+     *
+     * @param node_id id of the owning node.
+     * @param config_name config file name without extension.
+     * @param n number of nodes (vector clock size).
+     * @param channel_mem_limit per-channel in-memory recording budget in
+     *        bytes before frames spill to logs/<config>-<id>.chan<peer>.<k>.
+     * @param writer_opts batching/durability/format of the output writer.
+     * @param max_instances snapshots that may be open at the same time.
+     */
+    SnapshotManager(int node_id, const std::string &config_name, int n,
+                    size_t channel_mem_limit = 64 * 1024,
+                    const SnapshotWriterOptions &writer_opts =
+                        SnapshotWriterOptions(),
+                    int max_instances = 4);
+
+    /**
+     * @brief queue one vector clock line for the .out file.
+     *
+     * Only copies the clock into the writer's ring; the write itself
+     * happens on the writer thread unless the writer runs synchronously.
+     *
+     * @param vc vector clock to write, space separated.
+     * @param snapshot_id id stored with the record (-1 for the initial
+     *        state).
+     */
+    void record_snapshot(const std::vector<int> &vc, int snapshot_id = -1);
+
+    /**
+     * @brief block until every recorded snapshot reached the .out file.
+     */
+    void flush();
+
+    /**
+     * @brief protocol-thread stall accumulated by record_snapshot().
+     */
+    const SnapshotStallStats &stall_stats() const { return stall_; }
+
+    /**
+     * @brief the underlying writer (for commit/batch counters).
+     */
+    const SnapshotWriter &writer() const { return writer_; }
+
+    /**
+     * @brief logs/<config>-<id>, the prefix of this node's output files.
+     */
+    const std::string &base_path() const { return base_path_; }
+
+    /**
+     * @brief declare the incoming channels (one per neighbor link).
+     *
+     * @param peers ids of the neighbors this node receives from.
+     */
+    void set_channels(const std::vector<int> &peers);
+
+    /**
+     * @brief record local state and start recording every channel for a
+     *        new snapshot instance.
+     *
+     * If max_instances snapshots are already open, the oldest is finished
+     * first with the channel state recorded so far, and a warning is
+     * printed. Callers that need that result check at_capacity() and
+     * finish the oldest instance themselves.
+     *
+     * @param snapshot_id id carried by the marker (or chosen by node 0).
+     * @param vc current vector clock.
+     * @param active whether the node is currently active.
+     */
+    void begin_snapshot(int snapshot_id, const std::vector<int> &vc,
+                        bool active);
+
+    /**
+     * @brief check whether the local state for a snapshot was recorded.
+     *
+     * @param snapshot_id id to test.
+     * @return true if this node already began (or finished) that snapshot.
+     */
+    bool has_begun(int snapshot_id) const;
+
+    /**
+     * @brief hot-path check: is any channel currently being recorded?
+     */
+    bool recording() const {
+        return recording_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief number of snapshot instances begun but not yet finished.
+     */
+    int open_instances() const {
+        return static_cast<int>(instances_.size());
+    }
+
+    /**
+     * @brief true if beginning another snapshot would cut one short.
+     */
+    bool at_capacity() const { return open_instances() >= max_instances_; }
+
+    /**
+     * @brief id of the oldest unfinished snapshot, -1 if none.
+     */
+    int oldest_open() const;
+
+    /**
+     * @brief record an APP frame in every open instance whose marker has not
+     *        arrived on that channel yet.
+     *
+     * @param from neighbor the frame arrived from.
+     * @param frame encoded APP message.
+     */
+    void record_in_transit(int from, const std::string &frame);
+
+    /**
+     * @brief stop recording a channel after its marker arrived.
+     *
+     * @param from neighbor whose marker was received.
+     * @param snapshot_id id carried by the marker.
+     * @return true if this call closed the snapshot's last open channel.
+     */
+    bool close_channel(int from, int snapshot_id);
+
+    /**
+     * @brief true if the snapshot is open and none of its channels is still
+     *        recording.
+     */
+    bool all_channels_closed(int snapshot_id) const;
+
+    /**
+     * @brief all_channels_closed() for the oldest open snapshot.
+     */
+    bool all_channels_closed() const;
+
+    /**
+     * @brief close one instance, queue its clock for writing and return
+     *        the result.
+     *
+     * Clocks are handed to the writer in snapshot id order: a snapshot
+     * that finishes before an older one is held back until that one is
+     * finished too.
+     *
+     * @param snapshot_id instance to finish.
+     */
+    SnapshotResult finish_snapshot(int snapshot_id);
+
+    /**
+     * @brief finish_snapshot() for the oldest open snapshot.
+     */
+    SnapshotResult finish_snapshot();
+
+    /**
+     * @brief piggyback mode: record and write local state only.
+     *
+     * @param snapshot_id epoch being recorded.
+     * @param vc current vector clock.
+     * @param active whether the node is currently active.
+     * @return the result (in_transit is 0; see SnapshotMode).
+     */
+    SnapshotResult record_local(int snapshot_id, const std::vector<int> &vc,
+                                bool active);
+
+    /**
+     * @brief result of the most recently finished snapshot.
+     */
+    const SnapshotResult &last_result() const { return last_; }
+
+    /**
+     * @brief number of snapshots finished so far.
+     */
+    int completed() const { return completed_; }
+
+    /**
+     * @brief read back the frames one instance recorded on one channel
+     *        (for tests and post-mortem inspection, valid until that
+     *        instance is finished).
+     */
+    bool channel_frames(int snapshot_id, int from,
+                        std::vector<std::string> &out) const;
+
+    /**
+     * @brief channel_frames() for the oldest open snapshot.
+     */
+    bool channel_frames(int from, std::vector<std::string> &out) const;
+
+private:
+    struct Channel {
+        bool open;
+        ChannelRecorder *rec;           // owned by slots_
+    };
+
+    // one open snapshot
+    struct Instance {
+        SnapshotResult local;           // state recorded by begin_snapshot()
+        int open_channels;
+        int slot;                       // index into slots_
+        std::map<int, Channel> channels;
+    };
+
+    // a reusable set of per-channel recorders; spill files are named
+    // .chan<peer>.<slot> so concurrent instances never share one
+    typedef std::map<int, std::unique_ptr<ChannelRecorder> > Slot;
+
+    const int id_;
+    const int n_;
+    const size_t channel_mem_limit_;
+    const int max_instances_;
+    std::string base_path_;         // logs/<config>-<id>
+    SnapshotWriter writer_;
+    SnapshotStallStats stall_;
+
+    std::atomic<bool> recording_;
+    std::vector<int> peers_;
+    std::map<int, Instance> instances_;      // open, by snapshot id
+    std::vector<Slot> slots_;
+    std::vector<int> free_slots_;
+    std::set<int> begun_;           // recently begun ids (out-of-order markers)
+    int begun_floor_;               // every id <= this counts as begun
+    std::map<int, std::vector<int> > held_;  // finished, waiting on older ids
+    int completed_;
+    SnapshotResult last_;
+
+    int acquire_slot();
+    void mark_begun(int snapshot_id);
+    void update_recording();
+    void release_held();
+}; // SnapshotManager class
+
+#endif // SNAPSHOT_MANAGER_HPP
@@ -0,0 +1,123 @@
+/****************************************************************************
+ * file: snapshot_merge.hpp
+ * author: luke le
+ * description:
+ *     declares the reader that lines up the snapshot files of one run
+ *     (text .out or binary .snap) by snapshot id.
+ * usage:
+ *     SnapshotMerge merge;
+ *     if (!merge.open(paths)) return 1;
+ *     std::vector<int> clocks(merge.n() * merge.n());
+ *     long long id;
+ *     while (merge.next(clocks.data(), id)) check(clocks, id);
+ *     if (!merge.finish()) ...;   // the files did not line up
+ * notes:
+ *     a .snap record carries its snapshot id; the initial state is written
+ *     with id -1 and counts as snapshot 0. A .out line has no id, so line k
+ *     counts as snapshot k (line 0 is the initial state); that holds
+ *     because SnapshotManager writes every node's records in id order.
+ *
+ *     a snapshot every file has is returned, one that some lack is counted
+ *     against them and skipped.
+ ****************************************************************************/
+#ifndef SNAPSHOT_MERGE_HPP
+#define SNAPSHOT_MERGE_HPP
+
+#include "snapshot_log.hpp"
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @class SnapshotFile
+ * @brief one node's snapshot file, text (.out) or binary (.snap).
+ */
+class SnapshotFile {
+public:
+    SnapshotFile();
+    ~SnapshotFile();
+
+    /**
+     * @brief open a file; the extension picks the format.
+     *
+     * @return false (with a message on stderr) if it cannot be opened.
+     */
+    bool open(const std::string &path);
+
+    /**
+     * @brief read the next clock into out[0..n) and its snapshot id.
+     *
+     * @return 1 on success, 0 at end of file, -1 on a malformed record.
+     */
+    int next(int *out, int n, long long &id);
+
+    const std::string &path() const { return path_; }
+
+private:
+    std::string path_;
+    std::FILE *fp_;
+    std::vector<char> buf_;
+    size_t len_;
+    size_t pos_;
+    bool binary_;
+    long long line_;               // id of the next .out record
+    SnapshotReader snap_;
+
+    bool refill();
+};
+
+/**
+ * @class SnapshotMerge
+ * @brief merges one run's snapshot files by id into n x n clock matrices,
+ *        row j = node j's clock.
+ */
+class SnapshotMerge {
+public:
+    SnapshotMerge();
+
+    /**
+     * @brief open one file per node, named ".../<config>-<id>.out" (or
+     *        ".snap"); every id 0..n-1 must be present once.
+     *
+     * @return false (with a message on stderr) otherwise.
+     */
+    bool open(const std::vector<std::string> &paths);
+
+    /**
+     * @brief number of nodes, i.e. of files.
+     */
+    int n() const { return n_; }
+
+    /**
+     * @brief the next snapshot every file has.
+     *
+     * @param clocks filled with n * n entries.
+     * @param id its snapshot id.
+     * @return false once every file is at its end (or unreadable).
+     */
+    bool next(int *clocks, long long &id);
+
+    /**
+     * @brief report, on stderr, what kept the files from lining up.
+     *
+     * @return false if a record was malformed, ids went backwards or a
+     *         file lacked a snapshot that the others have.
+     */
+    bool finish();
+
+private:
+    int n_;
+    std::vector<std::unique_ptr<SnapshotFile> > files_;
+    std::vector<int> head_;                // next record of every file
+    std::vector<long long> head_id_;
+    std::vector<bool> live_;
+    std::vector<long long> missing_;
+    std::vector<long long> first_missing_;
+    bool bad_;
+
+    bool advance(int j);
+};
+
+#endif // SNAPSHOT_MERGE_HPP
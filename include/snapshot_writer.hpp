@@ -0,0 +1,140 @@
+/****************************************************************************
+ * file: snapshot_writer.hpp
+ * author: luke le
+ * description:
+ *     declares the background, group-committing writer that persists
+ *     snapshot records to logs/<config>-<id>.out.
+ * notes:
+ *     the protocol thread only moves a record into an SPSC ring (and, if
+ *     the writer is asleep, signals it). Formatting, write() and the
+ *     optional fdatasync() run on the writer thread. Records are committed
+ *     in groups: once `batch` records are pending or `flush_ms` after the
+ *     first pending record, whichever comes first. With async disabled the
+ *     writer formats and writes inline, which is the old behavior and is
+ *     kept for comparison. Records are written either as text lines or in
+ *     the binary snapshot log format (see snapshot_log.hpp).
+ ****************************************************************************/
+#ifndef SNAPSHOT_WRITER_HPP
+#define SNAPSHOT_WRITER_HPP
+
+#include "snapshot_log.hpp"
+#include "spsc_ring.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief tuning knobs for SnapshotWriter.
+ *
+ * @param async         run a background writer thread (default true).
+ * @param batch         commit once this many records are pending.
+ * @param flush_ms      commit at most this long after the first pending
+ *                      record.
+ * @param fdatasync     call fdatasync() after every commit.
+ * @param ring_capacity slots in the producer/writer ring.
+ * @param binary        write the binary snapshot log instead of text.
+ */
+struct SnapshotWriterOptions {
+    bool async;
+    size_t batch;
+    int flush_ms;
+    bool fdatasync;
+    size_t ring_capacity;
+    bool binary;
+
+    SnapshotWriterOptions()
+        : async(true), batch(32), flush_ms(50), fdatasync(false),
+          ring_capacity(1024), binary(false) {}
+};
+
+/**
+ * @brief one snapshot as handed to the writer.
+ */
+struct SnapshotRecord {
+    int id;
+    std::vector<int> vc;
+};
+
+/**
+ * @class SnapshotWriter
+ * @brief persists snapshot records off the protocol thread.
+ */
+class SnapshotWriter {
+public:
+    /**
+     * @brief open (truncate) the output file and start the writer thread.
+     *
+     * @param path output file.
+     * @param opts batching, durability and format options.
+     * @param node_id node id recorded in a binary log header.
+     * @param n clock size recorded in a binary log header.
+     */
+    SnapshotWriter(const std::string &path, const SnapshotWriterOptions &opts,
+                   int node_id = 0, int n = 0);
+
+    /**
+     * @brief drain pending records and close the file.
+     */
+    ~SnapshotWriter();
+
+    /**
+     * @brief queue a record for writing; the record is moved from.
+     *
+     * Never blocks on I/O. If the ring is full the caller yields until the
+     * writer frees a slot, which only happens when the disk falls behind
+     * by ring_capacity snapshots.
+     *
+     * @param rec record to persist.
+     */
+    void submit(SnapshotRecord &rec);
+
+    /**
+     * @brief block until every submitted record has been committed.
+     */
+    void flush();
+
+    /**
+     * @brief drain, stop the writer thread, write the binary log footer (if
+     *        any) and close the file (idempotent).
+     */
+    void close();
+
+    uint64_t records_written() const { return written_.load(); }
+    uint64_t commits() const { return commits_.load(); }
+    uint64_t full_ring_waits() const { return full_waits_.load(); }
+
+private:
+    SnapshotWriterOptions opts_;
+    std::string path_;
+    int fd_;
+    SnapshotLogEncoder encoder_;        // binary format state
+
+    SpscRing<SnapshotRecord> ring_;
+    std::thread thread_;
+    std::mutex mu_;
+    std::condition_variable wake_;      // writer sleeps here
+    std::condition_variable drained_;   // flush() waits here
+    std::atomic<bool> sleeping_;
+    std::atomic<bool> idle_;            // asleep without a pending group
+    std::atomic<bool> stopping_;
+    std::atomic<uint64_t> submitted_;
+    std::atomic<uint64_t> written_;
+    std::atomic<uint64_t> commits_;
+    std::atomic<uint64_t> full_waits_;
+    std::atomic<int> flush_waiters_;
+
+    void run();
+    void commit(std::string &buf, uint64_t records);
+    void write_all(const std::string &buf);
+    void format(const SnapshotRecord &rec, std::string &out);
+
+    SnapshotWriter(const SnapshotWriter &);
+    SnapshotWriter &operator=(const SnapshotWriter &);
+}; // SnapshotWriter class
+
+#endif // SNAPSHOT_WRITER_HPP
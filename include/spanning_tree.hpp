@@ -0,0 +1,56 @@
+/****************************************************************************
+ * file: spanning_tree.hpp
+ * author: luke le
+ * description:
+ *     declares the BFS spanning tree every node derives from the shared
+ *     config during setup.
+ * notes:
+ *     every node reads the same config file, so every node computes the
+ *     same tree locally without exchanging a single message. Neighbors are
+ *     visited in ascending id order, which makes the tree deterministic.
+ ****************************************************************************/
+#ifndef SPANNING_TREE_HPP
+#define SPANNING_TREE_HPP
+
+#include "config.hpp"
+
+#include <vector>
+
+/**
+ * @brief a rooted BFS tree over Config::neighbors.
+ *
+ * @param root     id of the root (the snapshot initiator).
+ * @param parent   parent of each node; -1 for the root and for nodes the
+ *                 root cannot reach.
+ * @param children children of each node, ascending.
+ * @param depth    hop distance from the root; -1 if unreachable.
+ */
+struct SpanningTree {
+    int root;
+    std::vector<int> parent;
+    std::vector<std::vector<int>> children;
+    std::vector<int> depth;
+
+    /**
+     * @brief number of nodes the root reaches (including itself).
+     */
+    int reachable() const;
+
+    /**
+     * @brief number of levels below the root (0 for a single node).
+     */
+    int height() const;
+};
+
+/**
+ * @brief build a BFS spanning tree rooted at `root`.
+ *
+ * @param cfg parsed configuration (n and neighbors are used).
+ * @param root node id to root the tree at.
+ * @param tree output tree.
+ * @return false if root is out of range or some node is unreachable
+ *         (the tree over the reachable part is still filled in).
+ */
+bool build_spanning_tree(const Config &cfg, int root, SpanningTree &tree);
+
+#endif // SPANNING_TREE_HPP
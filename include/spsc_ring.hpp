@@ -0,0 +1,86 @@
+/****************************************************************************
+ * file: spsc_ring.hpp
+ * author: luke le
+ * description:
+ *     a bounded, lock-free single-producer/single-consumer ring buffer.
+ * notes:
+ *     one thread may push and one thread may pop concurrently without
+ *     locks. Several producer threads are fine as long as their pushes are
+ *     serialized by some other means (e.g. MapProtocol's mutex), since the
+ *     mutex already orders them. Capacity is rounded up to a power of two
+ *     so indices wrap with a mask instead of a division.
+ ****************************************************************************/
+#ifndef SPSC_RING_HPP
+#define SPSC_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+template <typename T>
+class SpscRing {
+public:
+    /**
+     * @brief construct an empty ring.
+     *
+     * @param capacity minimum number of slots (rounded up to 2^k).
+     */
+    explicit SpscRing(size_t capacity)
+        : head_(0), tail_(0) {
+        size_t cap = 1;
+        while (cap < capacity) cap <<= 1;
+        slots_.resize(cap);
+        mask_ = cap - 1;
+    }
+
+    /**
+     * @brief enqueue an item (producer side).
+     *
+     * @param item value to move into the ring; untouched on failure.
+     * @return false if the ring is full.
+     */
+    bool try_push(T &item) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) > mask_) return false;
+        slots_[tail & mask_] = std::move(item);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief dequeue the oldest item (consumer side).
+     *
+     * @param out receives the item.
+     * @return false if the ring is empty.
+     */
+    bool try_pop(T &out) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) return false;
+        out = std::move(slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief true if no item is queued (exact only on the consumer side).
+     */
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) ==
+               tail_.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    std::vector<T> slots_;
+    size_t mask_;
+    // producer and consumer indices on separate cache lines
+    alignas(64) std::atomic<size_t> head_;
+    alignas(64) std::atomic<size_t> tail_;
+
+    SpscRing(const SpscRing &);
+    SpscRing &operator=(const SpscRing &);
+}; // SpscRing class
+
+#endif // SPSC_RING_HPP
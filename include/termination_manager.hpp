@@ -0,0 +1,109 @@
+/****************************************************************************
+ * file: termination_manager.hpp
+ * author: luke le
+ * description:
+ *     declares weight-throwing (credit-recovery) termination detection
+ *     for the MAP computation.
+ * notes:
+ *     the root of the spanning tree (node 0, the node that starts active)
+ *     holds weight 1. Every APP frame carries part of its sender's weight
+ *     and a node that turns passive hands everything it holds to its tree
+ *     parent. A passive parent passes it on, an active one keeps it, since
+ *     it returns it itself once it turns passive. The weights of all nodes
+ *     and all frames in flight always add up to 1, so once the passive
+ *     root holds 1 again no node is active and no APP frame is in flight:
+ *     termination is detected one chain of CREDIT frames (at most the
+ *     tree height) after the last APP delivery.
+ *
+ *     weights are exact dyadic fractions. A credit is the exponent k of
+ *     2^-k, so splitting never loses precision and never underflows the
+ *     way a float or a fixed number of fraction bits would. A node keeps
+ *     its weight as a set of distinct exponents, i.e. the binary digits of
+ *     the fraction; adding a credit that is already present carries.
+ *     like Convergecast the manager is passive: MapProtocol feeds it under
+ *     its own mutex and sends the returned frames itself.
+ ****************************************************************************/
+#ifndef TERMINATION_MANAGER_HPP
+#define TERMINATION_MANAGER_HPP
+
+#include "spanning_tree.hpp"
+
+#include <cstdint>
+#include <set>
+#include <vector>
+
+/**
+ * @class TerminationManager
+ * @brief one node's share of the weight and what to do with it.
+ */
+class TerminationManager {
+public:
+    /**
+     * @param node_id id of the owning node.
+     * @param tree spanning tree credit is returned along; its root starts
+     *        with weight 1.
+     */
+    TerminationManager(int node_id, const SpanningTree &tree);
+
+    bool is_root() const { return root_; }
+    int parent() const { return parent_; }
+
+    /**
+     * @brief split off the credit for one outgoing APP frame.
+     *
+     * halves the smallest credit held: one half stays, the other travels
+     * with the frame.
+     *
+     * @return exponent k of the credit 2^-k, or -1 if this node holds no
+     *         weight (an active node always does).
+     */
+    int split_credit();
+
+    /**
+     * @brief an APP frame with credit 2^-k was delivered.
+     */
+    void receive_credit(int k);
+
+    /**
+     * @brief a CREDIT frame from a child was delivered.
+     *
+     * @param ks exponents the child returned.
+     */
+    void receive_returned(const std::vector<int> &ks);
+
+    /**
+     * @brief this node is passive: give up everything it holds.
+     *
+     * @param out exponents to send to parent() in one CREDIT frame.
+     * @return false for the root (it keeps its weight) or if nothing is
+     *         held.
+     */
+    bool release(std::vector<int> &out);
+
+    /**
+     * @brief root only: all weight is back, i.e. nothing is active or in
+     *        flight anywhere once the root itself is passive.
+     */
+    bool holds_all() const;
+
+    /**
+     * @brief weight held, as a double (for diagnostics only).
+     */
+    double weight() const;
+
+    /**
+     * @brief CREDIT frames this node has produced so far.
+     */
+    uint64_t returned() const { return returned_; }
+
+private:
+    const int id_;
+    const int parent_;
+    const bool root_;
+    std::set<int> credit_;   // distinct exponents, sum of 2^-k
+    uint64_t returned_;
+
+    void add(int k);
+}; // TerminationManager class
+
+#endif // TERMINATION_MANAGER_HPP
@@ -0,0 +1,94 @@
+/****************************************************************************
+ * file: topology_gen.hpp
+ * author: luke le
+ * description:
+ *     declares the synthetic topology generator behind ds/tools/topogen:
+ *     ring, 2D torus, random regular, Erdos-Renyi and Barabasi-Albert
+ *     graphs turned into a Config that parse_config() would accept.
+ * notes:
+ *     every generated graph is simple, bidirectional and connected. The
+ *     random kinds draw from a seeded mt19937_64 through their own
+ *     bounded/real helpers rather than <random>'s distributions, so one
+ *     seed gives the same topology with any standard library.
+ ****************************************************************************/
+#ifndef TOPOLOGY_GEN_HPP
+#define TOPOLOGY_GEN_HPP
+
+#include "config.hpp"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+enum TopologyKind {
+    TOPO_RING,              // i -- i + 1
+    TOPO_TORUS,             // rows x cols grid, wrapping both ways
+    TOPO_RANDOM_REGULAR,    // every node has exactly `degree` neighbors
+    TOPO_ERDOS_RENYI,       // each pair linked with probability p
+    TOPO_SCALE_FREE         // Barabasi-Albert preferential attachment
+};
+
+/**
+ * @brief what to generate.
+ *
+ * @param kind graph family.
+ * @param n number of nodes (>= 2).
+ * @param degree random regular: the degree (n * degree even, < n);
+ *        Erdos-Renyi: expected degree when p is not set; scale free:
+ *        twice the links each new node brings (m = degree / 2, >= 1).
+ * @param p Erdos-Renyi link probability; negative = degree / (n - 1).
+ * @param rows torus rows (must divide n); 0 = the divisor of n closest
+ *        to sqrt(n).
+ * @param seed seed for the random kinds.
+ * @param hosts host names handed out round robin (default localhost).
+ * @param base_port node i listens on base_port + i.
+ */
+struct TopologySpec {
+    TopologyKind kind;
+    int n;
+    int degree;
+    double p;
+    int rows;
+    uint64_t seed;
+    std::vector<std::string> hosts;
+    int base_port;
+
+    TopologySpec()
+        : kind(TOPO_RING), n(0), degree(4), p(-1.0), rows(0), seed(1),
+          hosts(1, "localhost"), base_port(10000) {}
+};
+
+/**
+ * @brief map "ring", "torus", "random-regular", "erdos-renyi" or
+ *        "scale-free" to a TopologyKind.
+ *
+ * @return false if name is none of them.
+ */
+bool parse_topology_kind(const std::string &name, TopologyKind &kind);
+
+/**
+ * @brief generate the node table and neighbor lists of cfg.
+ *
+ * Sets cfg.n, cfg.nodes and cfg.neighbors; the MAP globals and
+ * config_name are left to the caller.
+ *
+ * @param spec what to generate.
+ * @param cfg config to fill.
+ * @return false (after printing why) if the parameters admit no such
+ *         graph, e.g. an odd n * degree for a random regular graph or a
+ *         port range past 65535.
+ */
+bool generate_topology(const TopologySpec &spec, Config &cfg);
+
+/**
+ * @brief write cfg in the config file format.
+ *
+ * @param out stream to write to.
+ * @param cfg config with globals, nodes and neighbors set.
+ * @param comment first line, written as a '#' comment (may be empty).
+ */
+void write_config(std::ostream &out, const Config &cfg,
+                  const std::string &comment);
+
+#endif // TOPOLOGY_GEN_HPP
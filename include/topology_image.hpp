@@ -0,0 +1,66 @@
+/****************************************************************************
+ * file: topology_image.hpp
+ * author: luke le
+ * description:
+ *     declares the compiled binary form of a config file: globals, a node
+ *     table with addresses resolved ahead of time, and the CSR neighbor
+ *     arrays, laid out so a node can mmap and check it instead of parsing
+ *     the text config at startup.
+ * notes:
+ *     an image is produced once per config by `topology compile` and then
+ *     read by every node (--topology=PATH). It records the size, mtime and
+ *     content hash of the config it came from; a node whose config no
+ *     longer matches rejects the image and falls back to parse_config().
+ *
+ *     images use the compiling host's byte order and are rejected, not
+ *     converted, on a host with another one.
+ ****************************************************************************/
+#ifndef TOPOLOGY_IMAGE_HPP
+#define TOPOLOGY_IMAGE_HPP
+
+#include "config.hpp"
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief bump whenever the on-disk layout changes; older images are then
+ *        rejected as stale.
+ */
+const uint32_t TOPOLOGY_IMAGE_VERSION = 1;
+
+/**
+ * @brief parse a config file, resolve every host and write the image.
+ *
+ * The image is written to a temporary file and renamed over image_path,
+ * so nodes that are mapping the previous image never see a partial one.
+ * A host that does not resolve is stored without an address and resolved
+ * by the node at connect time instead.
+ *
+ * @param config_path text config to compile.
+ * @param image_path where to write the image.
+ * @return false (after printing why) if the config does not parse or the
+ *         image cannot be written.
+ */
+bool compile_topology(const std::string &config_path,
+                      const std::string &image_path);
+
+/**
+ * @brief mmap and validate an image and fill cfg from it.
+ *
+ * Checks the header, every section bound, the payload hash and the ids
+ * in the node and neighbor tables. The config the image was compiled
+ * from is then stat()ed: a matching size and mtime accept the image
+ * right away, otherwise its content hash decides. If config_path cannot
+ * be read at all, or is empty, the image is trusted on its own.
+ *
+ * @param image_path image written by compile_topology().
+ * @param config_path text config the image should describe.
+ * @param cfg filled only if the image is accepted.
+ * @return false (after printing why) if the image is missing, corrupt,
+ *         from another version or stale.
+ */
+bool load_topology(const std::string &image_path,
+                   const std::string &config_path, Config &cfg);
+
+#endif // TOPOLOGY_IMAGE_HPP
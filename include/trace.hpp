@@ -0,0 +1,233 @@
+/****************************************************************************
+ * file: trace.hpp
+ * author: luke le
+ * description:
+ *     declares the event tracer: fixed-size events (scopes, instants and
+ *     the two ends of every APP message) go into a ring per thread and a
+ *     background thread writes them to logs/<config>-<id>.trace.
+ *     ds/tools/trace_merge.cpp turns the traces of all nodes into one
+ *     Chrome/Perfetto trace (chrome://tracing, ui.perfetto.dev).
+ * usage:
+ *     TRACE_SCOPE(id_, "establish_connections", 0);
+ *     TRACE_INSTANT(id_, "active", messages_sent_);
+ *     TRACE_FLOW_OUT(id_, "app", peer, vc_[id_]);   // in the send scope
+ *     TRACE_FLOW_IN(id_, "app", from, clock[from]);  // in the decode scope
+ * notes:
+ *     the macros compile to nothing unless MAP_TRACING is defined (CMake
+ *     option TRACING, on by default); compiled in, they cost one relaxed
+ *     load until Tracer::start() runs (--trace). Names must be string
+ *     literals.
+ *
+ *     a flow is keyed by (sender, receiver, sender's own clock entry), which
+ *     the receiver reads from the frame's vector clock; trace_merge uses the
+ *     pairs to draw arrows and to shift processes whose clocks disagree so
+ *     no message arrives before it was sent.
+ *
+ *     trace file: "MAPTRC1\n", i64 monotonic ns and i64 wall ns read at
+ *     start, then entries
+ *       'N' name  u32 id, u32 length, bytes
+ *       'E' event u32 name, u32 thread, i64 ts, i64 dur, i64 arg,
+ *                 i32 node, i32 peer, u8 phase
+ *     with ts in CLOCK_MONOTONIC ns and phase one of 'X' (scope), 'i'
+ *     (instant), 's' (flow out), 'f' (flow in). Little-endian.
+ ****************************************************************************/
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include "shutdown_signal.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief one traced event, as written by the node.
+ */
+struct TraceEvent {
+    int64_t ts_ns;
+    int64_t dur_ns;        // 'X' only
+    const char *name;
+    int64_t arg;           // flows: the sender's own clock entry
+    int32_t node;
+    int32_t peer;          // flows: the other end; -1 otherwise
+    char phase;
+};
+
+/**
+ * @brief one event as read back from a trace file.
+ */
+struct TraceRecord {
+    std::string name;
+    uint32_t thread;
+    int64_t ts_ns;
+    int64_t dur_ns;
+    int64_t arg;
+    int node;
+    int peer;
+    char phase;
+};
+
+/**
+ * @class Tracer
+ * @brief the process-wide tracer: a ring per thread and one writer.
+ */
+class Tracer {
+public:
+    static Tracer &global();
+
+    /**
+     * @brief true while events are recorded; one relaxed load.
+     */
+    static bool on() { return on_.load(std::memory_order_relaxed); }
+
+    ~Tracer();
+
+    /**
+     * @brief start recording into path (truncated).
+     *
+     * @return false (with a message) if the file cannot be opened.
+     */
+    bool start(const std::string &path);
+
+    /**
+     * @brief stop recording and write out what is queued; idempotent.
+     */
+    void stop();
+
+    // events lost because a ring was full
+    uint64_t dropped() const { return dropped_.load(); }
+
+    void record(const TraceEvent &e);
+
+private:
+    struct Ring;
+    static std::atomic<bool> on_;
+    static thread_local Ring *tls_ring_;
+
+    std::mutex control_m_;               // start/stop
+    std::mutex m_;                       // rings_, next_thread_
+    std::vector<Ring *> rings_;
+    uint32_t next_thread_;
+    std::mutex flush_m_;                 // stopping_
+    std::condition_variable flush_cv_;
+    bool stopping_;
+    std::thread writer_;
+    FILE *out_;
+    std::map<const char *, uint32_t> names_;
+    std::atomic<uint64_t> dropped_;
+
+    Tracer();
+    Ring *thread_ring();
+    void writer_loop();
+    void drain();
+
+    Tracer(const Tracer &);
+    Tracer &operator=(const Tracer &);
+}; // Tracer class
+
+/**
+ * @class TraceScope
+ * @brief records an 'X' event covering its own lifetime.
+ */
+class TraceScope {
+public:
+    TraceScope(int node, const char *name, int64_t arg)
+        : name_(Tracer::on() ? name : nullptr), node_(node), arg_(arg),
+          t0_(name_ ? ShutdownSignal::now_ns() : 0) {}
+    ~TraceScope() {
+        if (name_ == nullptr) return;
+        TraceEvent e;
+        e.ts_ns = t0_;
+        e.dur_ns = ShutdownSignal::now_ns() - t0_;
+        e.name = name_;
+        e.arg = arg_;
+        e.node = node_;
+        e.peer = -1;
+        e.phase = 'X';
+        Tracer::global().record(e);
+    }
+
+private:
+    const char *name_;       // null: not recording
+    int node_;
+    int64_t arg_;
+    int64_t t0_;
+
+    TraceScope(const TraceScope &);
+    TraceScope &operator=(const TraceScope &);
+}; // TraceScope class
+
+/**
+ * @brief record a point event (instant or flow end) if tracing is on.
+ */
+inline void trace_point(char phase, int node, const char *name, int peer,
+                        int64_t arg) {
+    if (!Tracer::on()) return;
+    TraceEvent e;
+    e.ts_ns = ShutdownSignal::now_ns();
+    e.dur_ns = 0;
+    e.name = name;
+    e.arg = arg;
+    e.node = node;
+    e.peer = peer;
+    e.phase = phase;
+    Tracer::global().record(e);
+}
+
+/**
+ * @class TraceReader
+ * @brief reads a trace file written by Tracer.
+ */
+class TraceReader {
+public:
+    TraceReader();
+    ~TraceReader();
+
+    bool open(const std::string &path);
+
+    /**
+     * @brief the next event; false at the end (or on a damaged entry, which
+     *        is reported).
+     */
+    bool next(TraceRecord &r);
+
+    // clocks read together when the trace started
+    int64_t monotonic_anchor() const { return mono_anchor_; }
+    int64_t wall_anchor() const { return wall_anchor_; }
+
+private:
+    FILE *in_;
+    std::string path_;
+    int64_t mono_anchor_;
+    int64_t wall_anchor_;
+    std::map<uint32_t, std::string> names_;
+
+    TraceReader(const TraceReader &);
+    TraceReader &operator=(const TraceReader &);
+}; // TraceReader class
+
+#define TRACE_CAT2_(a, b) a##b
+#define TRACE_CAT_(a, b) TRACE_CAT2_(a, b)
+
+#ifdef MAP_TRACING
+#define TRACE_SCOPE(node, name, arg)                                        \
+    TraceScope TRACE_CAT_(trace_scope_, __LINE__)(node, name, arg)
+#define TRACE_INSTANT(node, name, arg) trace_point('i', node, name, -1, arg)
+#define TRACE_FLOW_OUT(node, name, peer, seq)                               \
+    trace_point('s', node, name, peer, seq)
+#define TRACE_FLOW_IN(node, name, peer, seq)                                \
+    trace_point('f', node, name, peer, seq)
+#else
+#define TRACE_SCOPE(node, name, arg) do {} while (0)
+#define TRACE_INSTANT(node, name, arg) do {} while (0)
+#define TRACE_FLOW_OUT(node, name, peer, seq) do {} while (0)
+#define TRACE_FLOW_IN(node, name, peer, seq) do {} while (0)
+#endif
+
+#endif // TRACE_HPP
@@ -0,0 +1,116 @@
+/****************************************************************************
+ * file: vector_clock.hpp
+ * author: luke le
+ * description:
+ *     vector clocks for the node engine: a fixed-size one for a topology
+ *     whose n is known when proj1 is compiled, and a heap-allocated one
+ *     for everything else. VectorClock names the one this build uses.
+ * notes:
+ *     both have the same interface, so MapProtocol does not care which
+ *     one it got. With FIXED_TOPOLOGY defined (cmake -DFIXED_TOPOLOGY=ON)
+ *     n comes from the generated fixed_topology.hpp: clocks are
+ *     std::array<uint32_t, n>, merge() is a loop of constant length the
+ *     compiler can unroll and vectorize, and the clock parsed from each
+ *     APP frame lives on the stack instead of the heap.
+ ****************************************************************************/
+#ifndef VECTOR_CLOCK_HPP
+#define VECTOR_CLOCK_HPP
+
+#include "message.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+template <size_t N>
+class FixedVectorClock {
+public:
+    /**
+     * @brief all-zero clock; n is checked against N once at startup (see
+     *        ds/main.cpp), not here.
+     */
+    explicit FixedVectorClock(size_t n = N) {
+        (void)n;
+        values_.fill(0);
+    }
+
+    size_t size() const { return N; }
+    uint32_t operator[](size_t i) const { return values_[i]; }
+    void tick(size_t i) { ++values_[i]; }
+
+    /**
+     * @brief component-wise max with another clock.
+     */
+    void merge(const FixedVectorClock &other) {
+        for (size_t i = 0; i < N; ++i)
+            values_[i] = values_[i] < other.values_[i] ? other.values_[i]
+                                                       : values_[i];
+    }
+
+    /**
+     * @brief replace the entries with a frame's "v0,v1,..." field; missing
+     *        entries are 0, extra ones ignored.
+     *
+     * @return false if the field is malformed.
+     */
+    bool parse(const char *b, const char *e) {
+        values_.fill(0);
+        return parse_clock_text(b, e, values_.data(), N) >= 0;
+    }
+
+    void append_to(std::string &out) const {
+        append_clock_text(out, values_.data(), N);
+    }
+    const uint32_t *data() const { return values_.data(); }
+    std::vector<int> to_vector() const {
+        return std::vector<int>(values_.begin(), values_.end());
+    }
+
+private:
+    std::array<uint32_t, N> values_;
+};
+
+class DynamicVectorClock {
+public:
+    explicit DynamicVectorClock(size_t n) : values_(n, 0) {}
+
+    size_t size() const { return values_.size(); }
+    uint32_t operator[](size_t i) const { return values_[i]; }
+    void tick(size_t i) { ++values_[i]; }
+
+    void merge(const DynamicVectorClock &other) {
+        const size_t n = values_.size() < other.values_.size()
+                             ? values_.size()
+                             : other.values_.size();
+        for (size_t i = 0; i < n; ++i)
+            values_[i] = values_[i] < other.values_[i] ? other.values_[i]
+                                                       : values_[i];
+    }
+
+    bool parse(const char *b, const char *e) {
+        values_.assign(values_.size(), 0);
+        return parse_clock_text(b, e, values_.data(), values_.size()) >= 0;
+    }
+
+    void append_to(std::string &out) const {
+        append_clock_text(out, values_.data(), values_.size());
+    }
+    const uint32_t *data() const { return values_.data(); }
+    std::vector<int> to_vector() const {
+        return std::vector<int>(values_.begin(), values_.end());
+    }
+
+private:
+    std::vector<uint32_t> values_;
+};
+
+#ifdef FIXED_TOPOLOGY
+#include "fixed_topology.hpp"   // `topology header <config> <out>`
+typedef FixedVectorClock<fixed_topology::n> VectorClock;
+#else
+typedef DynamicVectorClock VectorClock;
+#endif
+
+#endif // VECTOR_CLOCK_HPP
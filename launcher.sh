@@ -4,6 +4,9 @@ IFS=$'\n\t'
 
 CONFIG_FILE="ds/config.txt"
 EXECUTABLE="build/proj1"
+TOPOLOGY_TOOL="build/ds/tools/topology"
+TOPOLOGY_IMAGE="ds/config.topo"
+LAUNCH_TOOL="build/ds/tools/launch"
 REMOTE_DIR="$HOME/project"       # adjust if paths differ
 LOG_DIR="$REMOTE_DIR/logs"
 SSH_USER="lbl190001"
@@ -64,6 +67,13 @@ for ((i=0; i<NUM_NODES; i++)); do
   NODE_PORTS[i]="$port"
 done
 
+# compile the config once so nodes mmap it instead of parsing it (skipped
+# if the tool was not built; nodes then parse the config as before)
+NODE_ARGS=""
+if [[ -x "$TOPOLOGY_TOOL" ]] && "$TOPOLOGY_TOOL" compile "$CONFIG_FILE" "$TOPOLOGY_IMAGE"; then
+  NODE_ARGS="--topology=$TOPOLOGY_IMAGE"
+fi
+
 # identify this host and helper functions
 local_host_short=$(hostname -s 2>/dev/null || echo "")
 local_host_full=$(hostname -f 2>/dev/null || echo "")
@@ -76,13 +86,22 @@ is_local_host() {
 # create logs directory (shared NFS)
 mkdir -p "$LOG_DIR"
 
+# the native driver starts all nodes concurrently, waits until every node
+# has its links and then releases them together; the ssh loop below is
+# only the fallback for a build without tools
+if [[ -x "$LAUNCH_TOOL" ]]; then
+  echo "[-] launching nodes with $LAUNCH_TOOL..."
+  exec "$LAUNCH_TOOL" "$CONFIG_FILE" --exe="$EXECUTABLE" --dir="$REMOTE_DIR" \
+    --user="$SSH_USER" --domain="$DOMAIN_SUFFIX" -- $NODE_ARGS
+fi
+
 launch_local() {
   local node_id="$1"
   echo "  - launching node $node_id on $(hostname -f) [local]"
   (
     cd "$REMOTE_DIR"
     mkdir -p logs
-    nohup setsid "$EXECUTABLE" "$node_id" \
+    nohup setsid "$EXECUTABLE" "$node_id" $NODE_ARGS \
       > "logs/stdout-$node_id.log" \
       2> "logs/stderr-$node_id.log" < /dev/null &
   ) &>/dev/null
@@ -96,7 +115,7 @@ launch_remote() {
     set -e
     cd \"$REMOTE_DIR\"
     mkdir -p logs
-    nohup setsid \"$EXECUTABLE\" $node_id \
+    nohup setsid \"$EXECUTABLE\" $node_id $NODE_ARGS \
       > logs/stdout-$node_id.log \
       2> logs/stderr-$node_id.log < /dev/null &
     disown || true
@@ -0,0 +1,107 @@
+/****************************************************************************
+ * file: adjacency.cpp
+ * author: luke le
+ * description:
+ *     implements the CSR neighbor table.
+ ****************************************************************************/
+#include "adjacency.hpp"
+
+#include <algorithm>
+
+bool NeighborRange::contains(int j) const {
+    return std::binary_search(first_, last_, j);
+} // contains()
+
+bool operator==(const NeighborRange &a, const std::vector<int> &b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+} // operator==()
+
+bool operator!=(const NeighborRange &a, const std::vector<int> &b) {
+    return !(a == b);
+} // operator!=()
+
+NeighborRow::NeighborRow(Adjacency &owner, size_t row)
+    : NeighborRange(static_cast<const Adjacency &>(owner)[row]),
+      owner_(owner),
+      row_(row) {}
+
+NeighborRow &NeighborRow::operator=(const std::vector<int> &row) {
+    owner_.assign_row(row_, row);
+    const NeighborRange now = static_cast<const Adjacency &>(owner_)[row_];
+    first_ = now.begin();
+    last_ = now.end();
+    return *this;
+} // operator=()
+
+Adjacency::Adjacency() : offsets_(1, 0) {}
+
+Adjacency::Adjacency(const std::vector<std::vector<int>> &lists)
+    : offsets_(1, 0) {
+    for (size_t i = 0; i < lists.size(); ++i) push_back(lists[i]);
+} // Adjacency()
+
+Adjacency::Adjacency(std::initializer_list<std::vector<int>> lists)
+    : offsets_(1, 0) {
+    for (std::initializer_list<std::vector<int>>::const_iterator it =
+             lists.begin();
+         it != lists.end(); ++it) {
+        push_back(*it);
+    }
+} // Adjacency()
+
+NeighborRange Adjacency::operator[](size_t i) const {
+    const int *base = targets_.data();
+    return NeighborRange(base + offsets_[i], base + offsets_[i + 1]);
+} // operator[]()
+
+NeighborRow Adjacency::operator[](size_t i) {
+    return NeighborRow(*this, i);
+} // operator[]()
+
+bool Adjacency::contains(int i, int j) const {
+    if (i < 0 || static_cast<size_t>(i) >= size()) return false;
+    return (*this)[i].contains(j);
+} // contains()
+
+void Adjacency::clear() {
+    offsets_.assign(1, 0);
+    targets_.clear();
+} // clear()
+
+void Adjacency::reserve(size_t rows, size_t entries) {
+    offsets_.reserve(rows + 1);
+    targets_.reserve(entries);
+} // reserve()
+
+void Adjacency::close_row() {
+    std::vector<int>::iterator first = targets_.begin() + offsets_.back();
+    std::sort(first, targets_.end());
+    targets_.erase(std::unique(first, targets_.end()), targets_.end());
+    offsets_.push_back(static_cast<uint32_t>(targets_.size()));
+} // close_row()
+
+void Adjacency::push_back(const std::vector<int> &row) {
+    targets_.insert(targets_.end(), row.begin(), row.end());
+    close_row();
+} // push_back()
+
+void Adjacency::assign_row(size_t i, const std::vector<int> &row) {
+    std::vector<int> sorted(row);
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    const size_t first = offsets_[i], last = offsets_[i + 1];
+    targets_.erase(targets_.begin() + first, targets_.begin() + last);
+    targets_.insert(targets_.begin() + first, sorted.begin(), sorted.end());
+
+    const int64_t delta = static_cast<int64_t>(sorted.size()) -
+                          static_cast<int64_t>(last - first);
+    for (size_t k = i + 1; k < offsets_.size(); ++k)
+        offsets_[k] = static_cast<uint32_t>(offsets_[k] + delta);
+} // assign_row()
+
+void Adjacency::assign(const uint32_t *offsets, size_t rows,
+                       const int *targets) {
+    offsets_.assign(offsets, offsets + rows + 1);
+    targets_.assign(targets, targets + offsets[rows]);
+} // assign()
@@ -0,0 +1,127 @@
+/****************************************************************************
+ * file: channel_recorder.cpp
+ * author: luke le
+ * description:
+ *     implements the bounded-memory channel-state recorder.
+ ****************************************************************************/
+#include "channel_recorder.hpp"
+
+#include <cstring>
+#include <iostream>
+
+namespace {
+    const size_t kHeader = sizeof(uint32_t);   // length prefix per record
+} // end anonymous namespace
+
+ChannelRecorder::ChannelRecorder(size_t mem_limit_bytes,
+                                 const std::string &spill_path)
+    : ring_(mem_limit_bytes < 2 * kHeader ? 2 * kHeader : mem_limit_bytes),
+      head_(0), used_(0), count_(0), spilled_(0),
+      spill_path_(spill_path), spill_(nullptr) {
+} // ChannelRecorder()
+
+ChannelRecorder::~ChannelRecorder() {
+    clear();
+} // ~ChannelRecorder()
+
+void ChannelRecorder::ring_write(const char *src, size_t len) {
+    const size_t cap = ring_.size();
+    size_t pos = (head_ + used_) % cap;
+    size_t first = len < cap - pos ? len : cap - pos;
+    std::memcpy(&ring_[pos], src, first);
+    std::memcpy(&ring_[0], src + first, len - first);
+    used_ += len;
+} // ring_write()
+
+void ChannelRecorder::ring_read(size_t off, char *dst, size_t len) const {
+    const size_t cap = ring_.size();
+    size_t pos = (head_ + off) % cap;
+    size_t first = len < cap - pos ? len : cap - pos;
+    std::memcpy(dst, &ring_[pos], first);
+    std::memcpy(dst + first, &ring_[0], len - first);
+} // ring_read()
+
+bool ChannelRecorder::spill_direct(const std::string &frame) {
+    if (!spill_) {
+        spill_ = std::fopen(spill_path_.c_str(), "w+b");
+        if (!spill_) {
+            std::cerr << "[!] cannot open channel spill file: "
+                      << spill_path_ << "\n";
+            return false;
+        }
+    }
+    uint32_t len = static_cast<uint32_t>(frame.size());
+    if (std::fwrite(&len, kHeader, 1, spill_) != 1) return false;
+    if (len && std::fwrite(frame.data(), len, 1, spill_) != 1) return false;
+    ++spilled_;
+    return true;
+} // spill_direct()
+
+bool ChannelRecorder::spill_oldest() {
+    if (used_ == 0) return false;
+    uint32_t len = 0;
+    ring_read(0, reinterpret_cast<char *>(&len), kHeader);
+    std::string frame(len, '\0');
+    if (len) ring_read(kHeader, &frame[0], len);
+
+    head_ = (head_ + kHeader + len) % ring_.size();
+    used_ -= kHeader + len;
+    return spill_direct(frame);
+} // spill_oldest()
+
+void ChannelRecorder::append(const std::string &frame) {
+    const size_t need = kHeader + frame.size();
+    ++count_;
+
+    // a frame larger than the whole ring goes straight to disk, after the
+    // ring's contents so the spill file stays in arrival order
+    if (need > ring_.size()) {
+        while (used_ > 0) spill_oldest();
+        spill_direct(frame);
+        return;
+    }
+    while (ring_.size() - used_ < need) spill_oldest();
+
+    uint32_t len = static_cast<uint32_t>(frame.size());
+    ring_write(reinterpret_cast<const char *>(&len), kHeader);
+    ring_write(frame.data(), frame.size());
+} // append()
+
+bool ChannelRecorder::read_all(std::vector<std::string> &out) const {
+    out.clear();
+    out.reserve(count_);
+
+    // spilled records are always older than the ones still in memory
+    if (spill_) {
+        std::fflush(spill_);
+        std::rewind(spill_);
+        for (size_t i = 0; i < spilled_; ++i) {
+            uint32_t len = 0;
+            if (std::fread(&len, kHeader, 1, spill_) != 1) return false;
+            std::string frame(len, '\0');
+            if (len && std::fread(&frame[0], len, 1, spill_) != 1) return false;
+            out.push_back(frame);
+        }
+        std::fseek(spill_, 0, SEEK_END);
+    }
+
+    size_t off = 0;
+    while (off < used_) {
+        uint32_t len = 0;
+        ring_read(off, reinterpret_cast<char *>(&len), kHeader);
+        std::string frame(len, '\0');
+        if (len) ring_read(off + kHeader, &frame[0], len);
+        out.push_back(frame);
+        off += kHeader + len;
+    }
+    return true;
+} // read_all()
+
+void ChannelRecorder::clear() {
+    head_ = used_ = count_ = spilled_ = 0;
+    if (spill_) {
+        std::fclose(spill_);
+        spill_ = nullptr;
+        std::remove(spill_path_.c_str());
+    }
+} // clear()
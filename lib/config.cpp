@@ -13,10 +13,14 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cstring>
+#include <fcntl.h>
 #include <fstream>
 #include <iostream>
-#include <sstream>
 #include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 using namespace std;
 
@@ -27,44 +31,82 @@ using namespace std;
 namespace {
 
     /**
-     * @brief trim leading and trailing whitespace from a string
-     *
-     * @param s input string.
-     * @return a copy of the string with whitespace removed from both ends
+     * @brief a run of characters inside the mapped config file; lets the
+     *        loader look at a line without copying it
      */
-    string trim(const string &s) {
-        size_t a = s.find_first_not_of(" \t\r\n");
-        // in C++, npos is a special constant defined in the std::string class
-        // that represents “not found” or an invalid position.
-        if (a == string::npos) return "";
-        size_t b = s.find_last_not_of(" \t\r\n");
-        return s.substr(a, b - a + 1);
-    } // trim()
+    struct Span {
+        const char *b;
+        const char *e;
+
+        bool empty() const { return b == e; }
+        string str() const { return string(b, e); }
+    };
+
+    bool is_trim_space(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    } // is_trim_space()
 
     /**
-     * @brief remove everything after the first '#' character (for comments)
-     *
-     * @param line input string.
-     * @return the line trimmed without trailing comments
+     * @brief trim leading and trailing whitespace from a span
      */
-    string strip_comments(const string &line) {
-        size_t hash = line.find('#');
-        if (hash != string::npos)
-            return trim(line.substr(0, hash));
-        return line;
-    } // strip_comments()
+    Span trim_span(Span s) {
+        while (s.b != s.e && is_trim_space(*s.b)) ++s.b;
+        while (s.e != s.b && is_trim_space(*(s.e - 1))) --s.e;
+        return s;
+    } // trim_span()
 
     /**
-     * @brief determine if a line is considered a valid config line; a valid
-     *        line starts with a digit
+     * @brief drop everything from the first '#' on (for comments)
+     */
+    Span strip_comments_span(Span s) {
+        const void *hash = std::memchr(s.b, '#', s.e - s.b);
+        if (!hash) return s;
+        Span head = {s.b, static_cast<const char *>(hash)};
+        return trim_span(head);
+    } // strip_comments_span()
+
+    bool is_valid_span(Span s) {
+        return !s.empty() && isdigit(static_cast<unsigned char>(*s.b));
+    } // is_valid_span()
+
+    /**
+     * @brief read the next whitespace-separated int, like `istream >> int`
      *
-     * @param line input string.
-     * @return true if valid, false otherwise.
+     * @param s remaining input; advanced past the number on success.
+     * @param out parsed value.
+     * @return false if no number starts here or it overflows an int.
      */
-    bool is_valid_line(const string &line) {
-        // if line is not empty, accesses the first char of the string
-        return !line.empty() && isdigit(static_cast<unsigned char>(line[0]));
-    } // is_valid_line()
+    bool next_int(Span &s, int &out) {
+        const char *p = s.b;
+        while (p != s.e && isspace(static_cast<unsigned char>(*p))) ++p;
+        bool neg = false;
+        if (p != s.e && (*p == '-' || *p == '+')) neg = (*p++ == '-');
+        if (p == s.e || !isdigit(static_cast<unsigned char>(*p))) return false;
+
+        long long v = 0;
+        for (; p != s.e && isdigit(static_cast<unsigned char>(*p)); ++p) {
+            v = v * 10 + (*p - '0');
+            if (v > 2147483648LL) return false;
+        }
+        if (neg) v = -v;
+        if (v > 2147483647LL) return false;
+        out = static_cast<int>(v);
+        s.b = p;
+        return true;
+    } // next_int()
+
+    /**
+     * @brief read the next whitespace-separated word, like `istream >> str`
+     */
+    bool next_word(Span &s, Span &word) {
+        const char *p = s.b;
+        while (p != s.e && isspace(static_cast<unsigned char>(*p))) ++p;
+        word.b = p;
+        while (p != s.e && !isspace(static_cast<unsigned char>(*p))) ++p;
+        word.e = p;
+        s.b = p;
+        return !word.empty();
+    } // next_word()
 
     /**
      * @brief extract the filename without its extension from a path
@@ -84,59 +126,68 @@ namespace {
     } // get_filename_no_ext()
 
     /**
-     * @brief attempt to open a file for reading
-     *
-     * @param path path to file
-     * @param in input file stream
-     * @return true if file was opened successfully, false otherwise.
+     * @brief read-only view of a whole config file, mmapped so the loader
+     *        never copies it
      */
-    bool open_file(const string &path, ifstream &in) {
-        in.open(path);
-        if (!in.is_open()) {
-            cerr << "[!] cannot open config file: " << path << "\n";
-            return false;
+    class MappedFile {
+    public:
+        MappedFile() : data_(nullptr), size_(0), mapped_(false) {}
+        ~MappedFile() {
+            if (mapped_) ::munmap(const_cast<char *>(data_), size_);
         }
-        return true;
-    } // open_file()
 
-    /**
-     * @brief read all lines from a file stream, clean them, and filter valid
-     *        config lines
-     *
-     * @param in open file stream.
-     * @return vector of valid, trimmed lines.
-     */
-    vector<string> clean_valid_lines(istream &in) {
-        vector<string> lines;
-        string line;
-        while (getline(in, line)) {
-            line = trim(line);
-            if (line.empty()) continue;
-            line = strip_comments(line);
-            if (is_valid_line(line))
-                lines.push_back(line);
+        bool open(const string &path) {
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            struct stat st;
+            if (fd < 0 || ::fstat(fd, &st) != 0) {
+                if (fd >= 0) ::close(fd);
+                cerr << "[!] cannot open config file: " << path << "\n";
+                return false;
+            }
+            size_ = static_cast<size_t>(st.st_size);
+            if (size_ > 0) {
+                void *m = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (m == MAP_FAILED) {
+                    ::close(fd);
+                    cerr << "[!] cannot map config file: " << path << "\n";
+                    return false;
+                }
+                ::madvise(m, size_, MADV_SEQUENTIAL);
+                data_ = static_cast<const char *>(m);
+                mapped_ = true;
+            }
+            ::close(fd);    // the mapping keeps the file alive
+            return true;
         }
-        return lines;
-    } // clean_valid_lines()
+
+        const char *data() const { return data_; }
+        size_t size() const { return size_; }
+
+    private:
+        const char *data_;
+        size_t size_;
+        bool mapped_;
+    };
 
     /**
-     * @brief top-level helper, reads valid lines from a file and extract
-     *        config name
+     * @brief one pass over the file: find the valid config lines in place
      *
-     * @param path path to config file
-     * @param validLines output vector with valid lines
-     * @param configName output config name
-     * @return true if file opened and contained valid lines, false otherwise
+     * @param data file contents.
+     * @param size byte count.
+     * @param lines output; trimmed, comment-free spans into data.
      */
-    bool read_valid_lines(const string &path, vector<string> &validLines,
-            string &configName) {
-        ifstream in;
-        if (!open_file(path, in)) return false;
-        configName = get_filename_no_ext(path);
-        validLines = clean_valid_lines(in);
-        in.close();
-        return !validLines.empty();
-    } // read_valid_lines()
+    void scan_valid_lines(const char *data, size_t size, vector<Span> &lines) {
+        const char *p = data, *end = data + size;
+        while (p != end) {
+            const char *nl = static_cast<const char *>(
+                std::memchr(p, '\n', end - p));
+            Span line = {p, nl ? nl : end};
+            p = nl ? nl + 1 : end;
+
+            line = strip_comments_span(trim_span(line));
+            if (is_valid_span(line)) lines.push_back(line);
+        }
+    } // scan_valid_lines()
 
     /**
      * @brief parse the first line of the config file
@@ -145,57 +196,85 @@ namespace {
      * @param cfg config structure to fill
      * @return true if parsing succeeded, false otherwise
      */
-    bool parse_globals(const string &line, Config &cfg) {
-        istringstream iss(line);
-        if (!(iss >> cfg.n >> cfg.minPerActive >> cfg.maxPerActive 
-                  >> cfg.minSendDelay_ms >> cfg.snapshotDelay_ms 
-                  >> cfg.maxNumber)) {
+    bool parse_globals(Span line, Config &cfg) {
+        if (!(next_int(line, cfg.n) && next_int(line, cfg.minPerActive) &&
+              next_int(line, cfg.maxPerActive) &&
+              next_int(line, cfg.minSendDelay_ms) &&
+              next_int(line, cfg.snapshotDelay_ms) &&
+              next_int(line, cfg.maxNumber))) {
             cerr << "[!] invalid first config line\n";
             return false;
         }
         return true;
     } // parse_globals()
 
+    /**
+     * @brief parse one node definition line into 'cfg.nodes'
+     *
+     * @param line "<id> <host> <port>".
+     * @param cfg config structure to fill; cfg.nodes already sized.
+     * @return true if the line parsed and the id is in range.
+     */
+    bool parse_node(Span line, Config &cfg) {
+        const Span whole = line;
+        int id, port;
+        Span host;
+        if (!next_int(line, id) || !next_word(line, host) ||
+            !next_int(line, port) || id < 0 || id >= cfg.n) {
+            cerr << "[!] invalid node line: " << whole.str() << "\n";
+            return false;
+        }
+        NodeInfo &node = cfg.nodes[id];
+        node.id = id;
+        node.host.assign(host.b, host.e);
+        node.port = port;
+        node.addr = 0;
+        return true;
+    } // parse_node()
+
+    /**
+     * @brief parse the neighbor list of node k as the next CSR row; stops
+     *        at the first token that is not a number, skips ids that are
+     *        out of range or k
+     */
+    void parse_neighbor_line(Span line, int k, Config &cfg) {
+        int nb;
+        while (next_int(line, nb)) {
+            if (nb >= 0 && nb < cfg.n && nb != k)
+                cfg.neighbors.add(nb);
+        }
+        cfg.neighbors.close_row();
+    } // parse_neighbor_line()
+
     /**
      * @brief parse the node definition lines and populate 'cfg.nodes'
      *
-     * @param lines vector of node definition lines.
+     * @param lines node definition lines, n of them.
      * @param cfg config structure to fill.
      * @return true if all node lines parsed successfully, false otherwise.
      */
-    bool parse_nodes(const vector<string> &lines, Config &cfg) {
+    bool parse_nodes(const Span *lines, Config &cfg) {
         cfg.nodes.resize(cfg.n);
-        for (int i = 0; i < cfg.n; ++i) {
-            istringstream iss(lines[i]);
-            int id; string host; int port;
-            if (!(iss >> id >> host >> port)) {
-                cerr << "[!] invalid node line: " << lines[i] << "\n";
-                return false;
-            }
-            cfg.nodes[id] = {id, host, port};
-        }
+        for (int i = 0; i < cfg.n; ++i)
+            if (!parse_node(lines[i], cfg)) return false;
         return true;
     } // parse_nodes
 
     /**
      * @brief parse neighbor definitions for each node
      *
-     * @param lines Vector of neighbor lines
+     * @param lines neighbor lines, n of them.
      * @param cfg Config structure to fill
      * @return always true (invalid neighbors are skipped silently)
      */
-    bool parse_neighbors(const vector<string> &lines, Config &cfg) {
-        cfg.neighbors.assign(cfg.n, vector<int>());
-        for (int k = 0; k < cfg.n; ++k) {
-            istringstream iss(lines[k]);
-            int nb;
-            while (iss >> nb) {
-                if (nb >= 0 && nb < cfg.n && nb != k)
-                    cfg.neighbors[k].push_back(nb);
-            }
-        }
+    bool parse_neighbors(const Span *lines, Config &cfg) {
+        cfg.neighbors.clear();
+        cfg.neighbors.reserve(cfg.n, 0);
+        for (int k = 0; k < cfg.n; ++k)
+            parse_neighbor_line(lines[k], k, cfg);
         return true;
     } // parse_neighbors()
+
     
     /**
      * @brief verifies that all neighbor relationships in the config are
@@ -204,17 +283,29 @@ namespace {
      * Ensures that if node i lists node j as a neighbor, then node j also
      * lists node i as a neighbor; prints any inconsistencies found.
      *
+     * Rows are sorted, so scanning the sources i in ascending order visits
+     * the entries of every row j that should hold i in ascending order
+     * too: one cursor per row that only ever moves forward turns the check
+     * into a single merge, O(n + E), instead of a search per edge.
+     *
      * @param cfg configuration structure containing neighbors
      * @return true if all neighbor relations are bidirectional,
      *         false otherwise
      */
     bool check_bidirectional_neighbors(const Config &cfg) {
         bool allBidirectional = true;
-    
-        for (size_t i = 0; i < cfg.neighbors.size(); ++i) {
-            for (int j : cfg.neighbors[i]) {
+        const Adjacency &adj = cfg.neighbors;
+        const int n = static_cast<int>(adj.size());
+        const int *targets = adj.targets().data();
+        const vector<uint32_t> &offsets = adj.offsets();
+
+        // cursor[j]: first entry of row j not yet matched against a source
+        vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+
+        for (int i = 0; i < n; ++i) {
+            for (int j : adj[i]) {
                 // check bounds
-                if (j < 0 || static_cast<size_t>(j) >= cfg.neighbors.size()) {
+                if (j < 0 || j >= n) {
                     cerr << "[!] invalid neighbor index: node " << i
                          << " references out-of-range node " << j << "\n";
                     allBidirectional = false;
@@ -222,71 +313,184 @@ namespace {
                 }
 
                 // check that node j lists i as a neighbor
-                const auto &nbrsOfJ = cfg.neighbors[j];
-                if (find(nbrsOfJ.begin(), nbrsOfJ.end(),
-                            static_cast<int>(i)) == nbrsOfJ.end()) {
-                    cerr << "[!] neighbor mismatch: (node " << i
-                         << ") lists " << j
-                         << " but (node " << j
-                         << ") does not list " << i << "\n";
-                    allBidirectional = false;
-                }
+                uint32_t &c = cursor[j];
+                while (c < offsets[j + 1] && targets[c] < i) ++c;
+                if (c < offsets[j + 1] && targets[c] == i) continue;
+                cerr << "[!] neighbor mismatch: (node " << i
+                     << ") lists " << j
+                     << " but (node " << j
+                     << ") does not list " << i << "\n";
+                allBidirectional = false;
             }
         }
         return allBidirectional;
     } // check_bidirectional_neighbors()
 
+#ifdef ENABLE_TESTS
+    // line-at-a-time, string-based variants of the helpers above; the
+    // loader itself never copies a line, the unit tests exercise these
+
+    Span span_of(const string &s) {
+        Span sp = {s.data(), s.data() + s.size()};
+        return sp;
+    } // span_of()
+
+    /**
+     * @brief trim leading and trailing whitespace from a string
+     *
+     * @param s input string.
+     * @return a copy of the string with whitespace removed from both ends
+     */
+    string trim(const string &s) {
+        return trim_span(span_of(s)).str();
+    } // trim()
+
+    /**
+     * @brief remove everything after the first '#' character (for comments)
+     *
+     * @param line input string.
+     * @return the line trimmed without trailing comments
+     */
+    string strip_comments(const string &line) {
+        return strip_comments_span(span_of(line)).str();
+    } // strip_comments()
+
+    /**
+     * @brief determine if a line is considered a valid config line; a valid
+     *        line starts with a digit
+     *
+     * @param line input string.
+     * @return true if valid, false otherwise.
+     */
+    bool is_valid_line(const string &line) {
+        return is_valid_span(span_of(line));
+    } // is_valid_line()
+
+    /**
+     * @brief attempt to open a file for reading
+     *
+     * @param path path to file
+     * @param in input file stream
+     * @return true if file was opened successfully, false otherwise.
+     */
+    bool open_file(const string &path, ifstream &in) {
+        in.open(path);
+        if (!in.is_open()) {
+            cerr << "[!] cannot open config file: " << path << "\n";
+            return false;
+        }
+        return true;
+    } // open_file()
+
+    /**
+     * @brief read all lines from a file stream, clean them, and filter valid
+     *        config lines
+     *
+     * @param in open file stream.
+     * @return vector of valid, trimmed lines.
+     */
+    vector<string> clean_valid_lines(istream &in) {
+        vector<string> lines;
+        string line;
+        while (getline(in, line)) {
+            Span s = strip_comments_span(trim_span(span_of(line)));
+            if (is_valid_span(s))
+                lines.push_back(s.str());
+        }
+        return lines;
+    } // clean_valid_lines()
+
+    /**
+     * @brief top-level helper, reads valid lines from a file and extract
+     *        config name
+     *
+     * @param path path to config file
+     * @param validLines output vector with valid lines
+     * @param configName output config name
+     * @return true if file opened and contained valid lines, false otherwise
+     */
+    bool read_valid_lines(const string &path, vector<string> &validLines,
+            string &configName) {
+        ifstream in;
+        if (!open_file(path, in)) return false;
+        configName = get_filename_no_ext(path);
+        validLines = clean_valid_lines(in);
+        in.close();
+        return !validLines.empty();
+    } // read_valid_lines()
+
+    /**
+     * @brief spans over a vector of owned lines, for the string-based
+     *        entry points
+     */
+    vector<Span> spans_of(const vector<string> &lines) {
+        vector<Span> spans;
+        spans.reserve(lines.size());
+        for (size_t i = 0; i < lines.size(); ++i)
+            spans.push_back(span_of(lines[i]));
+        return spans;
+    } // spans_of()
+#endif // ENABLE_TESTS
+
 } // end anonymous namespace
 
 /**
- * 1. read all valid, non-empty, non-comment lines from the file using
- *    `read_valid_lines()`. If no valid lines are found, returns false.
+ * 1. map the file and collect the valid, non-empty, non-comment lines as
+ *    spans into the mapping with `scan_valid_lines()`; nothing is copied.
+ *    If no valid lines are found, returns false.
  * 2. parse the first line (global settings) with `parse_globals()`.
  *    If parsing fails, returns false.
  * 3. check that the number of valid lines is sufficient for `n` nodes:
  *    - Expected lines: 1 (globals) + n (nodes) + n (neighbors) = 2*n + 1
  *    - If there are fewer lines, return false.
  * 4. slice the valid lines into:
- *    - Node lines (`validLines[1]` to `validLines[n]`)
- *    - Neighbor lines (`validLines[n+1]` to `validLines[2*n]`)
+ *    - Node lines (`lines[1]` to `lines[n]`)
+ *    - Neighbor lines (`lines[n+1]` to `lines[2*n]`)
  * 5. parse the node definitions using `parse_nodes()`.
  *    If parsing fails, return false.
  * 6. parse the neighbor definitions using `parse_neighbors()`.
  *    Always returns true, but still checked for consistency.
  * 7. check that the config file contains bidirectional nodes.
  * 8. if all steps succeed, return true.
+ *
+ * numbers and hostnames are tokenized in place, so the only allocations
+ * are the span table and the Config itself; for a 100k-node topology this
+ * is what keeps parsing out of every node's startup time.
  */
 bool parse_config(const string &path, Config &cfg) {
-    vector<string> validLines;
+    MappedFile file;
+    vector<Span> lines;
 
-    // 1: read valid, trimmed lines from file
-    if (!read_valid_lines(path, validLines, cfg.config_name)) {
+    // 1: find valid, trimmed lines in the mapped file
+    if (file.open(path)) {
+        cfg.config_name = get_filename_no_ext(path);
+        scan_valid_lines(file.data(), file.size(), lines);
+    }
+    if (lines.empty()) {
         cerr << "[!] no valid lines found in config\n";
         return false;
     }
 
     // 2: parse global settings
-    if (!parse_globals(validLines[0], cfg)) return false;
+    if (!parse_globals(lines[0], cfg)) return false;
 
     // 3: check number of valid lines
     size_t expected = static_cast<size_t>(2 * cfg.n + 1);
-    if (validLines.size() < expected) {
+    if (cfg.n < 0 || lines.size() < expected) {
         cerr << "[!] config has fewer than expected valid lines. expected >= "
-             << expected << " got " << validLines.size() << "\n";
+             << expected << " got " << lines.size() << "\n";
         return false;
     }
 
     // 4: slice lines into nodes and neighbors
-    auto nodeBegin = validLines.begin() + 1;
-    auto nodeEnd = nodeBegin + cfg.n;
-    auto neighborBegin = nodeEnd;
-    auto neighborEnd = neighborBegin + cfg.n;
+    const Span *nodeLines = &lines[1];
+    const Span *neighborLines = nodeLines + cfg.n;
 
     // 5: parse node definitions
-    if (!parse_nodes({nodeBegin, nodeEnd}, cfg)) return false;
+    if (!parse_nodes(nodeLines, cfg)) return false;
 
     // 6: parse neighbor definitions
-    if (!parse_neighbors({neighborBegin, neighborEnd}, cfg)) return false;
+    if (!parse_neighbors(neighborLines, cfg)) return false;
 
     // 7: ensure bidirectional topology
     if (!check_bidirectional_neighbors(cfg)) {
@@ -336,9 +540,6 @@ void print_config(const Config &cfg) {
     }
 } // print_config()
 
-
-
-
 // the following exposes internals for testing (if enabled):
 #ifdef ENABLE_TESTS
 
@@ -365,13 +566,13 @@ bool testable_read_valid_lines(const string &path, vector<string> &validLines,
 { return read_valid_lines(path, validLines, configName); }
 
 bool testable_parse_globals(const string &line, Config &cfg)
-{ return parse_globals(line, cfg); }
+{ return parse_globals(span_of(line), cfg); }
 
 bool testable_parse_nodes(const vector<string> &lines, Config &cfg)
-{ return parse_nodes(lines, cfg); }
+{ return parse_nodes(spans_of(lines).data(), cfg); }
 
 bool testable_parse_neighbors(const vector<string> &lines, Config &cfg)
-{ return parse_neighbors(lines, cfg); }
+{ return parse_neighbors(spans_of(lines).data(), cfg); }
 
 bool testable_check_bidirectional_neighbors(const Config &cfg)
 { return check_bidirectional_neighbors(cfg); }
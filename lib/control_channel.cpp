@@ -0,0 +1,248 @@
+/****************************************************************************
+ * file: control_channel.cpp
+ * author: luke le
+ * description:
+ *     implements the launch driver's control channel over plain TCP.
+ ****************************************************************************/
+#include "control_channel.hpp"
+#include "sctp_wrapper.hpp"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+    // longest a node sleeps for a GO whose instant lies in the future
+    const int64_t kMaxStartDelayNs = 10LL * 1000 * 1000 * 1000;
+
+    bool write_all(int fd, const std::string &s) {
+        size_t off = 0;
+        while (off < s.size()) {
+            const ssize_t n = ::send(fd, s.data() + off, s.size() - off,
+                                     MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            off += static_cast<size_t>(n);
+        }
+        return true;
+    } // write_all()
+
+} // end anonymous namespace
+
+bool parse_control_line(const std::string &line, ControlEvent &ev) {
+    std::istringstream in(line);
+    std::string kind;
+    if (!(in >> kind >> ev.id) || ev.id < 0) return false;
+    ev.links = ev.expected = 0;
+    ev.setup_us = 0;
+    ev.at_ns = 0;
+    if (kind == "UP") {
+        ev.kind = ControlEvent::UP;
+    } else if (kind == "READY") {
+        ev.kind = ControlEvent::READY;
+        if (!(in >> ev.links >> ev.expected >> ev.setup_us)) return false;
+    } else {
+        return false;
+    }
+    std::string extra;
+    return !(in >> extra);
+} // parse_control_line()
+
+// -------------------- driver end --------------------
+ControlServer::ControlServer() : fd_(-1), port_(0) {}
+
+ControlServer::~ControlServer() {
+    for (size_t i = 0; i < conns_.size(); ++i) ::close(conns_[i].fd);
+    if (fd_ >= 0) ::close(fd_);
+} // ~ControlServer()
+
+bool ControlServer::listen(int port) {
+    fd_ = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (fd_ < 0) {
+        std::perror("[!] control socket");
+        return false;
+    }
+    const int on = 1;
+    ::setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    socklen_t len = sizeof(addr);
+    if (::bind(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+        ::listen(fd_, 1024) != 0 ||
+        ::getsockname(fd_, reinterpret_cast<sockaddr *>(&addr), &len) != 0) {
+        std::cerr << "[!] control port " << port << ": "
+                  << std::strerror(errno) << "\n";
+        return false;
+    }
+    port_ = ntohs(addr.sin_port);
+    return true;
+} // listen()
+
+void ControlServer::drop(size_t i) {
+    ::close(conns_[i].fd);
+    conns_[i] = conns_.back();
+    conns_.pop_back();
+} // drop()
+
+size_t ControlServer::poll(int timeout_ms, std::vector<ControlEvent> &events) {
+    const size_t before = events.size();
+    std::vector<struct pollfd> pfds(conns_.size() + 1);
+    pfds[0].fd = fd_;
+    for (size_t i = 0; i < conns_.size(); ++i) pfds[i + 1].fd = conns_[i].fd;
+    for (size_t i = 0; i < pfds.size(); ++i) {
+        pfds[i].events = POLLIN;
+        pfds[i].revents = 0;
+    }
+    if (::poll(pfds.data(), pfds.size(), timeout_ms) <= 0) return 0;
+    const int64_t now = ShutdownSignal::now_ns();
+
+    // walk backwards: drop() moves the last connection into the gap
+    for (size_t i = conns_.size(); i-- > 0;) {
+        if (!(pfds[i + 1].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+        char chunk[4096];
+        const ssize_t n = ::recv(conns_[i].fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) {
+            drop(i);
+            continue;
+        }
+        std::string &buf = conns_[i].buf;
+        buf.append(chunk, static_cast<size_t>(n));
+        size_t start = 0, nl;
+        while ((nl = buf.find('\n', start)) != std::string::npos) {
+            ControlEvent ev;
+            if (parse_control_line(buf.substr(start, nl - start), ev)) {
+                ev.at_ns = now;
+                events.push_back(ev);
+            } else {
+                std::cerr << "[~] control: ignoring \""
+                          << buf.substr(start, nl - start) << "\"\n";
+            }
+            start = nl + 1;
+        }
+        buf.erase(0, start);
+    }
+
+    if (pfds[0].revents & POLLIN) {
+        const int c = ::accept(fd_, nullptr, nullptr);
+        if (c >= 0) {
+            const int on = 1;
+            ::setsockopt(c, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+            Conn conn;
+            conn.fd = c;
+            conns_.push_back(conn);
+        }
+    }
+    return events.size() - before;
+} // poll()
+
+size_t ControlServer::release(int64_t start_wall_ns) {
+    const std::string go = "GO " + std::to_string(start_wall_ns) + "\n";
+    size_t sent = 0;
+    for (size_t i = 0; i < conns_.size(); ++i)
+        sent += write_all(conns_[i].fd, go);
+    return sent;
+} // release()
+
+// -------------------- node end --------------------
+ControlClient::ControlClient() : fd_(-1) {}
+
+ControlClient::~ControlClient() {
+    close();
+} // ~ControlClient()
+
+void ControlClient::close() {
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+} // close()
+
+bool ControlClient::connect(const std::string &endpoint) {
+    const size_t colon = endpoint.rfind(':');
+    const int port = colon == std::string::npos
+                         ? 0
+                         : std::atoi(endpoint.c_str() + colon + 1);
+    uint32_t ipv4 = 0;
+    if (port <= 0 || port > 65535) {
+        std::cerr << "[!] control endpoint is not host:port: " << endpoint
+                  << "\n";
+        return false;
+    }
+    if (!SCTPSocket::resolve(endpoint.substr(0, colon), ipv4)) return false;
+
+    fd_ = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = ipv4;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (fd_ < 0 ||
+        ::connect(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+        std::cerr << "[!] cannot reach the launch driver at " << endpoint
+                  << ": " << std::strerror(errno) << "\n";
+        close();
+        return false;
+    }
+    const int on = 1;
+    ::setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    return true;
+} // connect()
+
+bool ControlClient::send_line(const std::string &line) {
+    return fd_ >= 0 && write_all(fd_, line + "\n");
+} // send_line()
+
+bool ControlClient::report_up(int id) {
+    return send_line("UP " + std::to_string(id));
+} // report_up()
+
+bool ControlClient::report_ready(int id, int links, int expected,
+                                 int64_t setup_us) {
+    std::ostringstream line;
+    line << "READY " << id << " " << links << " " << expected << " "
+         << setup_us;
+    return send_line(line.str());
+} // report_ready()
+
+bool ControlClient::wait_go(const ShutdownSignal &shutdown) {
+    std::string buf;
+    while (fd_ >= 0 && buf.find('\n') == std::string::npos) {
+        const ShutdownSignal::WaitResult r = shutdown.wait_readable(fd_, -1);
+        if (r == ShutdownSignal::WAIT_SHUTDOWN) return false;
+        char chunk[256];
+        const ssize_t n = ::recv(fd_, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            std::cerr << "[~] launch driver went away; starting without "
+                      << "the barrier\n";
+            close();
+            return true;
+        }
+        buf.append(chunk, static_cast<size_t>(n));
+    }
+    if (fd_ < 0) return true;
+    close();                  // the barrier is all the channel is for
+
+    long long start = 0;
+    if (std::sscanf(buf.c_str(), "GO %lld", &start) != 1) {
+        std::cerr << "[~] unexpected control message; starting now\n";
+        return true;
+    }
+    int64_t wait_ns = start - ShutdownSignal::wall_ns();
+    if (wait_ns > kMaxStartDelayNs) wait_ns = kMaxStartDelayNs;
+    if (wait_ns > 0 && shutdown.wait_for(static_cast<int>(wait_ns / 1000000)))
+        return false;
+    return !shutdown.triggered();
+} // wait_go()
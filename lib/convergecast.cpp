@@ -0,0 +1,158 @@
+/****************************************************************************
+ * file: convergecast.cpp
+ * author: luke le
+ * description:
+ *     implements tree convergecast and naive flooding of snapshot state.
+ ****************************************************************************/
+#include "convergecast.hpp"
+#include "logger.hpp"
+
+
+namespace {
+    // snapshots whose states never all arrive (a link died) are dropped
+    // once this many newer ones are pending
+    const size_t kMaxPending = 64;
+} // end anonymous namespace
+
+Convergecast::Convergecast(const Config &cfg, int node_id, CollectMode mode,
+                           int root)
+    : id_(node_id),
+      n_(cfg.n),
+      mode_(mode),
+      neighbors_(cfg.neighbors[node_id].begin(),
+                 cfg.neighbors[node_id].end()),
+      sent_(0) {
+    std::shared_ptr<SpanningTree> tree(new SpanningTree());
+    build_spanning_tree(cfg, root, *tree);
+    tree_ = tree;
+} // Convergecast()
+
+Convergecast::Convergecast(const Config &cfg, int node_id,
+                           const std::shared_ptr<const SpanningTree> &tree,
+                           CollectMode mode)
+    : id_(node_id),
+      n_(cfg.n),
+      mode_(mode),
+      neighbors_(cfg.neighbors[node_id].begin(),
+                 cfg.neighbors[node_id].end()),
+      tree_(tree),
+      sent_(0) {
+} // Convergecast()
+
+Convergecast::Pending &Convergecast::pending_for(int snapshot_id) {
+    std::map<int, Pending>::iterator it = pending_.find(snapshot_id);
+    if (it != pending_.end()) return it->second;
+
+    if (pending_.size() >= kMaxPending) {
+        LOG_ERROR(id_, "{} dropping incomplete snapshot state {}", id_,
+                  pending_.begin()->first);
+        pending_.erase(pending_.begin());
+    }
+    Pending &p = pending_[snapshot_id];
+    p.agg.snapshot_id = snapshot_id;
+    p.agg.origin = id_;
+    p.agg.nodes = p.agg.active = 0;
+    p.agg.in_transit = 0;
+    p.waiting = static_cast<int>(tree_->children[id_].size());
+    p.local = false;
+    return p;
+} // pending_for()
+
+void Convergecast::merge(Pending &p, const SnapshotState &st) {
+    p.agg.nodes += st.nodes;
+    p.agg.active += st.active;
+    p.agg.in_transit += st.in_transit;
+} // merge()
+
+void Convergecast::mark_done(int snapshot_id) {
+    // flooded duplicates keep arriving after a snapshot completed; without
+    // this they would open a fresh entry and be forwarded all over again
+    done_.insert(snapshot_id);
+    if (done_.size() > kMaxPending) done_.erase(done_.begin());
+} // mark_done()
+
+void Convergecast::flood(const SnapshotState &st, int except,
+                         std::vector<StateSend> &out) {
+    for (size_t i = 0; i < neighbors_.size(); ++i) {
+        if (neighbors_[i] == except) continue;
+        StateSend s;
+        s.to = neighbors_[i];
+        s.state = st;
+        out.push_back(s);
+        ++sent_;
+    }
+} // flood()
+
+void Convergecast::try_forward(int snapshot_id, std::vector<StateSend> &out) {
+    std::map<int, Pending>::iterator it = pending_.find(snapshot_id);
+    if (it == pending_.end()) return;
+    Pending &p = it->second;
+
+    if (mode_ == COLLECT_FLOOD) {
+        // only the root aggregates; everyone is done once every origin
+        // passed through
+        if (static_cast<int>(p.seen.size()) < n_) return;
+        if (id_ == tree_->root) complete_.push_back(p.agg);
+        mark_done(snapshot_id);
+        pending_.erase(it);
+        return;
+    }
+
+    if (!p.local || p.waiting > 0) return;
+    if (id_ == tree_->root) {
+        complete_.push_back(p.agg);
+    } else if (tree_->parent[id_] >= 0) {
+        StateSend s;
+        s.to = tree_->parent[id_];
+        s.state = p.agg;
+        out.push_back(s);
+        ++sent_;
+    }
+    mark_done(snapshot_id);
+    pending_.erase(it);
+} // try_forward()
+
+void Convergecast::local_done(const SnapshotState &st,
+                              std::vector<StateSend> &out) {
+    if (done_.count(st.snapshot_id)) return;
+    Pending &p = pending_for(st.snapshot_id);
+    p.local = true;
+
+    if (mode_ == COLLECT_FLOOD) {
+        p.seen.insert(id_);
+        if (id_ == tree_->root) merge(p, st);
+        flood(st, -1, out);
+    } else {
+        merge(p, st);
+    }
+    try_forward(st.snapshot_id, out);
+} // local_done()
+
+void Convergecast::received(int from, const SnapshotState &st,
+                            std::vector<StateSend> &out) {
+    if (done_.count(st.snapshot_id)) return;
+    if (mode_ == COLLECT_FLOOD) {
+        Pending &p = pending_for(st.snapshot_id);
+        if (!p.seen.insert(st.origin).second) return;   // already forwarded
+        if (id_ == tree_->root) merge(p, st);
+        flood(st, from, out);
+        try_forward(st.snapshot_id, out);
+        return;
+    }
+
+    if (from < 0 || from >= n_ || tree_->parent[from] != id_) {
+        LOG_ERROR(id_, "{} STATE from non-child {} ignored", id_, from);
+        return;
+    }
+    Pending &p = pending_for(st.snapshot_id);
+    merge(p, st);
+    --p.waiting;
+    try_forward(st.snapshot_id, out);
+} // received()
+
+bool Convergecast::pop_complete(SnapshotState &global) {
+    if (complete_.empty()) return false;
+    global = complete_.front();
+    complete_.pop_front();
+    return true;
+} // pop_complete()
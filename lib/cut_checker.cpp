@@ -0,0 +1,74 @@
+/****************************************************************************
+ * file: cut_checker.cpp
+ * author: luke le
+ * description:
+ *     implements the vectorized consistent-cut check.
+ ****************************************************************************/
+#include "cut_checker.hpp"
+
+#if !defined(CUT_CHECK_SCALAR) && defined(__AVX2__)
+#include <immintrin.h>
+#define CUT_CHECK_AVX2 1
+#elif !defined(CUT_CHECK_SCALAR) && defined(__SSE2__)
+#include <emmintrin.h>
+#define CUT_CHECK_SSE2 1
+#endif
+
+namespace {
+
+    /**
+     * @brief first index where row[i] > diag[i], or -1
+     */
+    int first_above(const int *row, const int *diag, int n) {
+        int i = 0;
+#if defined(CUT_CHECK_AVX2)
+        for (; i + 8 <= n; i += 8) {
+            __m256i r = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i *>(row + i));
+            __m256i d = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i *>(diag + i));
+            if (_mm256_movemask_epi8(_mm256_cmpgt_epi32(r, d))) break;
+        }
+#elif defined(CUT_CHECK_SSE2)
+        for (; i + 4 <= n; i += 4) {
+            __m128i r = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(row + i));
+            __m128i d = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(diag + i));
+            if (_mm_movemask_epi8(_mm_cmpgt_epi32(r, d))) break;
+        }
+#endif
+        // tail, or pinpoint the lane inside the block that failed
+        for (; i < n; ++i) {
+            if (row[i] > diag[i]) return i;
+        }
+        return -1;
+    } // first_above()
+
+} // end anonymous namespace
+
+bool CutChecker::check(const int *clocks, int n, CutViolation &v) {
+    diag_.resize(n);
+    for (int i = 0; i < n; ++i) diag_[i] = clocks[i * n + i];
+
+    for (int j = 0; j < n; ++j) {
+        const int i = first_above(clocks + j * n, diag_.data(), n);
+        if (i < 0) continue;
+        v.i = i;
+        v.j = j;
+        v.seen = clocks[j * n + i];
+        v.own = diag_[i];
+        return false;
+    }
+    return true;
+} // check()
+
+const char *CutChecker::kernel() {
+#if defined(CUT_CHECK_AVX2)
+    return "avx2";
+#elif defined(CUT_CHECK_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+} // kernel()
@@ -0,0 +1,70 @@
+/****************************************************************************
+ * file: latency_histogram.cpp
+ * author: luke le
+ * description:
+ *     implements the log-bucketed latency histogram.
+ ****************************************************************************/
+#include "latency_histogram.hpp"
+
+namespace {
+
+    const int kSub = 1 << LatencyHistogram::kSubBits;
+
+    int highest_bit(uint64_t v) {
+        return 63 - __builtin_clzll(v);
+    } // highest_bit()
+
+} // end anonymous namespace
+
+LatencyHistogram::LatencyHistogram()
+    : counts_(kBuckets, 0), count_(0), negatives_(0), max_(0) {}
+
+int LatencyHistogram::bucket_of(uint64_t ns) {
+    if (ns < static_cast<uint64_t>(kSub)) return static_cast<int>(ns);
+    // [2^b, 2^(b+1)) is split into kSub buckets of 2^(b - kSubBits)
+    const int shift = highest_bit(ns) - kSubBits;
+    return ((shift + 1) << kSubBits) +
+           static_cast<int>((ns >> shift) & (kSub - 1));
+} // bucket_of()
+
+uint64_t LatencyHistogram::bucket_floor(int bucket) {
+    if (bucket < kSub) return static_cast<uint64_t>(bucket);
+    const int shift = (bucket >> kSubBits) - 1;
+    return static_cast<uint64_t>(kSub + (bucket & (kSub - 1))) << shift;
+} // bucket_floor()
+
+void LatencyHistogram::record(int64_t ns) {
+    if (ns < 0) {
+        ++negatives_;
+        ns = 0;
+    }
+    ++counts_[bucket_of(static_cast<uint64_t>(ns))];
+    ++count_;
+    if (ns > max_) max_ = ns;
+} // record()
+
+void LatencyHistogram::merge(const LatencyHistogram &other) {
+    for (int b = 0; b < kBuckets; ++b) counts_[b] += other.counts_[b];
+    count_ += other.count_;
+    negatives_ += other.negatives_;
+    if (other.max_ > max_) max_ = other.max_;
+} // merge()
+
+int64_t LatencyHistogram::percentile(double pct) const {
+    if (count_ == 0) return 0;
+    // the rank-th smallest value, 1-based
+    uint64_t rank = static_cast<uint64_t>(pct / 100.0 * count_ + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > count_) rank = count_;
+    uint64_t seen = 0;
+    for (int b = 0; b < kBuckets; ++b) {
+        seen += counts_[b];
+        if (seen < rank) continue;
+        const uint64_t lo = bucket_floor(b);
+        const uint64_t width =
+            b < kSub ? 1 : uint64_t(1) << ((b >> kSubBits) - 1);
+        const int64_t mid = static_cast<int64_t>(lo + width / 2);
+        return mid < max_ ? mid : max_;
+    }
+    return max_;
+} // percentile()
@@ -0,0 +1,524 @@
+/****************************************************************************
+ * file: logger.cpp
+ * author: luke le
+ * description:
+ *     implements the asynchronous logger: the per-thread byte rings, the
+ *     flusher and its text and binary sinks, and the reader of binary logs.
+ * notes:
+ *     a ring is single-producer/single-consumer: its thread appends records
+ *     at tail, the flusher consumes them from head. Both offsets only grow;
+ *     a record never wraps, so one that does not fit before the end of the
+ *     buffer leaves a zero size word there and starts again at offset 0.
+ ****************************************************************************/
+#include "logger.hpp"
+#include "shutdown_signal.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <iostream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+thread_local Logger::Ring *Logger::tls_ring_ = nullptr;
+std::atomic<int> Logger::min_level_(LEVEL_INFO);
+
+struct Logger::Ring {
+    char *buf;
+    size_t cap;                              // power of two
+    uint32_t thread;
+    size_t head_seen;                        // producer's copy of head
+    std::atomic<bool> retired;               // its thread has exited
+    std::atomic<uint64_t> dropped;
+    // padded apart rather than alignas(64): `new` in C++11 does not honour
+    // extended alignment
+    char pad0[64];
+    std::atomic<size_t> head;                // written by the flusher
+    char pad1[64];
+    std::atomic<size_t> tail;                // written by the owner
+    char pad2[64];
+};
+
+struct Logger::Queued {
+    const LogSite *site;
+    LogEntry e;
+
+    bool operator<(const Queued &o) const { return e.wall_ns < o.e.wall_ns; }
+};
+
+namespace {
+
+    const size_t kRingBytes = 1 << 16;
+
+    // what precedes the arguments of a record in a ring or in scratch
+    struct RecordHeader {
+        uint32_t size;             // header + args, rounded up to 8; 0: wrap
+        int32_t node;
+        const LogSite *site;
+        int64_t wall_ns;
+        uint32_t suppressed;
+        uint32_t args;
+    };
+
+    const char kMagic[] = "MAPLOG1\n";
+
+    size_t round8(size_t n) { return (n + 7) & ~static_cast<size_t>(7); }
+
+    // marks its thread's ring retired when the thread exits
+    struct RingOwner {
+        std::atomic<bool> *retired;
+        ~RingOwner() {
+            if (retired) retired->store(true, std::memory_order_release);
+        }
+    };
+    thread_local RingOwner t_owner = {nullptr};
+
+    void write_all(int fd, const std::string &s) {
+        size_t off = 0;
+        while (off < s.size()) {
+            const ssize_t n = ::write(fd, s.data() + off, s.size() - off);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return;
+            off += static_cast<size_t>(n);
+        }
+    } // write_all()
+
+    const char *level_prefix(LogLevel l) {
+        switch (l) {
+        case LEVEL_DEBUG: return "[.] ";
+        case LEVEL_INFO: return "[*] ";
+        case LEVEL_WARN: return "[~] ";
+        default: return "[!] ";
+        }
+    } // level_prefix()
+
+    // the text of one encoded argument at args[i]; advances i
+    bool decode_arg(const std::string &args, size_t &i, std::string &out) {
+        if (i >= args.size()) return false;
+        const char tag = args[i++];
+        char buf[32];
+        if (tag == 'c') {
+            if (i + 1 > args.size()) return false;
+            out += args[i++];
+            return true;
+        }
+        if (tag == 's') {
+            uint32_t n;
+            if (i + 4 > args.size()) return false;
+            std::memcpy(&n, args.data() + i, 4);
+            if (i + 4 + n > args.size()) return false;
+            out.append(args, i + 4, n);
+            i += 4 + n;
+            return true;
+        }
+        if (i + 8 > args.size()) return false;
+        if (tag == 'i') {
+            int64_t v;
+            std::memcpy(&v, args.data() + i, 8);
+            std::snprintf(buf, sizeof(buf), "%lld", static_cast<long long>(v));
+        } else if (tag == 'u') {
+            uint64_t v;
+            std::memcpy(&v, args.data() + i, 8);
+            std::snprintf(buf, sizeof(buf), "%llu",
+                          static_cast<unsigned long long>(v));
+        } else if (tag == 'd') {
+            double v;
+            std::memcpy(&v, args.data() + i, 8);
+            std::snprintf(buf, sizeof(buf), "%g", v);
+        } else {
+            return false;
+        }
+        i += 8;
+        out += buf;
+        return true;
+    } // decode_arg()
+
+    void put_u32(std::string &out, uint32_t v) {
+        out.append(reinterpret_cast<const char *>(&v), 4);
+    } // put_u32()
+
+    void put_str(std::string &out, const char *s, size_t n) {
+        put_u32(out, static_cast<uint32_t>(n));
+        out.append(s, n);
+    } // put_str()
+
+    bool get(FILE *in, void *p, size_t n) {
+        return n == 0 || std::fread(p, 1, n, in) == n;
+    } // get()
+
+    bool get_str(FILE *in, std::string &s) {
+        uint32_t n;
+        if (!get(in, &n, 4) || n > (1u << 24)) return false;
+        s.resize(n);
+        return n == 0 || get(in, &s[0], n);
+    } // get_str()
+
+} // end anonymous namespace
+
+bool parse_log_level(const std::string &text, LogLevel &level) {
+    if (text == "debug") level = LEVEL_DEBUG;
+    else if (text == "info") level = LEVEL_INFO;
+    else if (text == "warn") level = LEVEL_WARN;
+    else if (text == "error") level = LEVEL_ERROR;
+    else return false;
+    return true;
+} // parse_log_level()
+
+std::string format_log(const char *fmt, const std::string &args) {
+    std::string out;
+    size_t i = 0;
+    bool have = true;
+    for (const char *p = fmt; *p; ++p) {
+        if (p[0] == '{' && p[1] == '}') {
+            if (!have || !decode_arg(args, i, out)) {
+                have = false;
+                out += "{}";
+            }
+            ++p;
+        } else {
+            out += *p;
+        }
+    }
+    // arguments without a placeholder are kept rather than lost
+    while (have && i < args.size()) {
+        out += ' ';
+        have = decode_arg(args, i, out);
+    }
+    return out;
+} // format_log()
+
+std::string format_log_line(const LogEntry &e) {
+    std::string line = level_prefix(e.level);
+    line += format_log(e.fmt, e.args);
+    if (e.suppressed > 0)
+        line += " (" + std::to_string(e.suppressed) + " similar suppressed)";
+    return line;
+} // format_log_line()
+
+// -------------------- logger --------------------
+Logger &Logger::global() {
+    static Logger logger;
+    return logger;
+} // global()
+
+Logger::Logger()
+    : running_(false), next_thread_(0), stopping_(false), flush_ms_(20),
+      binary_(nullptr), dropped_total_(0) {}
+
+Logger::~Logger() {
+    stop();
+    for (size_t i = 0; i < rings_.size(); ++i) {
+        delete[] rings_[i]->buf;
+        delete rings_[i];
+    }
+    rings_.clear();
+    tls_ring_ = nullptr;
+} // ~Logger()
+
+bool Logger::start(const std::string &binary_path, int flush_ms) {
+    std::lock_guard<std::mutex> lk(control_m_);
+    if (running_.load()) return true;
+    if (!binary_path.empty()) {
+        const size_t slash = binary_path.rfind('/');
+        if (slash != std::string::npos)
+            ::mkdir(binary_path.substr(0, slash).c_str(), 0755);
+        binary_ = std::fopen(binary_path.c_str(), "wb");
+        if (binary_ == nullptr) {
+            std::cerr << "[!] cannot open log " << binary_path << ": "
+                      << std::strerror(errno) << "\n";
+            return false;
+        }
+        std::fwrite(kMagic, 1, sizeof(kMagic) - 1, binary_);
+        site_ids_.clear();
+    }
+    // lines already written through the streams come first
+    std::cout.flush();
+    flush_ms_ = flush_ms > 0 ? flush_ms : 1;
+    stopping_ = false;
+    running_.store(true, std::memory_order_release);
+    flusher_ = std::thread(&Logger::flusher_loop, this);
+    return true;
+} // start()
+
+void Logger::stop() {
+    std::lock_guard<std::mutex> lk(control_m_);
+    if (!flusher_.joinable()) return;
+    running_.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> fl(flush_m_);
+        stopping_ = true;
+    }
+    flush_cv_.notify_all();
+    flusher_.join();
+    if (binary_) {
+        std::fclose(binary_);
+        binary_ = nullptr;
+    }
+} // stop()
+
+uint64_t Logger::dropped() const {
+    return dropped_total_.load();
+} // dropped()
+
+bool Logger::pass_rate_limit(LogSite &site, uint32_t &suppressed) {
+    const int64_t now = ShutdownSignal::now_ns();
+    int64_t next = site.next_ns.load(std::memory_order_relaxed);
+    if (now < next ||
+        !site.next_ns.compare_exchange_strong(
+            next, now + static_cast<int64_t>(site.every_ms) * 1000000)) {
+        site.suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    suppressed = site.suppressed.exchange(0, std::memory_order_relaxed);
+    return true;
+} // pass_rate_limit()
+
+Logger::Ring *Logger::thread_ring() {
+    Ring *r = new Ring;
+    r->buf = new char[kRingBytes];
+    r->cap = kRingBytes;
+    r->head_seen = 0;
+    r->retired.store(false);
+    r->dropped.store(0);
+    r->head.store(0);
+    r->tail.store(0);
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        r->thread = next_thread_++;
+        rings_.push_back(r);
+    }
+    t_owner.retired = &r->retired;
+    tls_ring_ = r;
+    return r;
+} // thread_ring()
+
+char *Logger::begin(LogSite &site, int node, uint32_t suppressed, size_t len,
+                    Slot &slot) {
+    RecordHeader h;
+    h.size = static_cast<uint32_t>(round8(sizeof(RecordHeader) + len));
+    h.node = node;
+    h.site = &site;
+    h.wall_ns = ShutdownSignal::wall_ns();
+    h.suppressed = suppressed;
+    h.args = static_cast<uint32_t>(len);
+
+    if (!running_.load(std::memory_order_acquire)) {
+        slot.ring = nullptr;
+        slot.scratch.resize(sizeof(RecordHeader) + len);
+        std::memcpy(&slot.scratch[0], &h, sizeof(h));
+        return &slot.scratch[0] + sizeof(RecordHeader);
+    }
+
+    Ring *r = tls_ring_ ? tls_ring_ : thread_ring();
+    size_t tail = r->tail.load(std::memory_order_relaxed);
+    size_t pos = tail & (r->cap - 1);
+    const size_t pad = pos + h.size > r->cap ? r->cap - pos : 0;
+    const size_t end = tail + pad + h.size;
+    if (end - r->head_seen > r->cap)
+        r->head_seen = r->head.load(std::memory_order_acquire);
+    if (h.size > r->cap / 4 || end - r->head_seen > r->cap) {
+        r->dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    if (pad) {
+        const uint32_t wrap = 0;
+        std::memcpy(r->buf + pos, &wrap, 4);
+        tail += pad;
+        pos = 0;
+    }
+    std::memcpy(r->buf + pos, &h, sizeof(h));
+    slot.ring = r;
+    slot.tail = tail + h.size;
+    return r->buf + pos + sizeof(RecordHeader);
+} // begin()
+
+void Logger::commit(Slot &slot) {
+    if (slot.ring) {
+        slot.ring->tail.store(slot.tail, std::memory_order_release);
+        return;
+    }
+    // no flusher: format and write on this thread
+    RecordHeader h;
+    std::memcpy(&h, slot.scratch.data(), sizeof(h));
+    LogEntry e;
+    e.level = h.site->level;
+    e.fmt = h.site->fmt;
+    e.suppressed = h.suppressed;
+    e.args.assign(slot.scratch, sizeof(RecordHeader), h.args);
+    write_all(e.level >= LEVEL_WARN ? 2 : 1, format_log_line(e) + "\n");
+} // commit()
+
+void Logger::flusher_loop() {
+    std::unique_lock<std::mutex> lk(flush_m_);
+    while (!stopping_) {
+        flush_cv_.wait_for(lk, std::chrono::milliseconds(flush_ms_));
+        lk.unlock();
+        flush_once();
+        lk.lock();
+    }
+    lk.unlock();
+    flush_once();
+} // flusher_loop()
+
+void Logger::flush_once() {
+    std::vector<Ring *> rings;
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        rings = rings_;
+    }
+
+    std::vector<Queued> batch;
+    std::vector<Ring *> done;
+    uint64_t dropped = 0;
+    for (size_t k = 0; k < rings.size(); ++k) {
+        Ring *r = rings[k];
+        // a retired ring gets no more records once the flag is seen
+        const bool retired = r->retired.load(std::memory_order_acquire);
+        size_t head = r->head.load(std::memory_order_relaxed);
+        const size_t tail = r->tail.load(std::memory_order_acquire);
+        while (head < tail) {
+            const size_t pos = head & (r->cap - 1);
+            RecordHeader h;
+            std::memcpy(&h.size, r->buf + pos, 4);
+            if (h.size == 0) {                  // wrap
+                head += r->cap - pos;
+                continue;
+            }
+            std::memcpy(&h, r->buf + pos, sizeof(h));
+            Queued q;
+            q.site = h.site;
+            q.e.level = h.site->level;
+            q.e.node = h.node;
+            q.e.wall_ns = h.wall_ns;
+            q.e.thread = r->thread;
+            q.e.suppressed = h.suppressed;
+            q.e.fmt = h.site->fmt;
+            q.e.file = h.site->file;
+            q.e.line = h.site->line;
+            q.e.args.assign(r->buf + pos + sizeof(RecordHeader), h.args);
+            batch.push_back(q);
+            head += h.size;
+        }
+        r->head.store(head, std::memory_order_release);
+        dropped += r->dropped.exchange(0, std::memory_order_relaxed);
+        if (retired) done.push_back(r);
+    }
+
+    if (!done.empty()) {
+        std::lock_guard<std::mutex> lk(m_);
+        for (size_t k = 0; k < done.size(); ++k) {
+            rings_.erase(std::find(rings_.begin(), rings_.end(), done[k]));
+            delete[] done[k]->buf;
+            delete done[k];
+        }
+    }
+
+    // records from different threads interleave by the time they were made
+    std::stable_sort(batch.begin(), batch.end());
+    emit(batch);
+    if (dropped) {
+        dropped_total_.fetch_add(dropped);
+        write_all(2, "[~] logger dropped " + std::to_string(dropped) +
+                         " records (ring full)\n");
+    }
+} // flush_once()
+
+void Logger::emit(std::vector<Queued> &batch) {
+    std::string out, err, bin;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        const LogEntry &e = batch[i].e;
+        if (binary_) {
+            std::map<const LogSite *, uint32_t>::iterator id =
+                site_ids_.find(batch[i].site);
+            if (id == site_ids_.end()) {
+                const uint32_t next = static_cast<uint32_t>(site_ids_.size());
+                id = site_ids_.insert(std::make_pair(batch[i].site, next)).first;
+                bin += 'S';
+                put_u32(bin, next);
+                bin += static_cast<char>(e.level);
+                put_u32(bin, static_cast<uint32_t>(e.line));
+                put_str(bin, e.file.data(), e.file.size());
+                put_str(bin, e.fmt, std::strlen(e.fmt));
+            }
+            bin += 'R';
+            put_u32(bin, id->second);
+            put_u32(bin, static_cast<uint32_t>(e.node));
+            bin.append(reinterpret_cast<const char *>(&e.wall_ns), 8);
+            put_u32(bin, e.thread);
+            put_u32(bin, e.suppressed);
+            put_str(bin, e.args.data(), e.args.size());
+            if (e.level >= LEVEL_WARN) err += format_log_line(e) + "\n";
+        } else {
+            (e.level >= LEVEL_WARN ? err : out) += format_log_line(e) + "\n";
+        }
+    }
+    if (!bin.empty()) {
+        std::fwrite(bin.data(), 1, bin.size(), binary_);
+        std::fflush(binary_);
+    }
+    write_all(1, out);
+    write_all(2, err);
+} // emit()
+
+// -------------------- reader --------------------
+LogReader::LogReader() : in_(nullptr) {}
+
+LogReader::~LogReader() {
+    if (in_) std::fclose(in_);
+} // ~LogReader()
+
+bool LogReader::open(const std::string &path) {
+    if (in_) std::fclose(in_);
+    sites_.clear();
+    path_ = path;
+    in_ = std::fopen(path.c_str(), "rb");
+    if (in_ == nullptr) {
+        std::cerr << "[!] cannot open " << path << "\n";
+        return false;
+    }
+    char magic[sizeof(kMagic) - 1];
+    if (!get(in_, magic, sizeof(magic)) ||
+        std::memcmp(magic, kMagic, sizeof(magic)) != 0) {
+        std::cerr << "[!] " << path << " is not a binary log\n";
+        std::fclose(in_);
+        in_ = nullptr;
+        return false;
+    }
+    return true;
+} // open()
+
+bool LogReader::next(LogEntry &e) {
+    if (in_ == nullptr) return false;
+    int kind;
+    while ((kind = std::fgetc(in_)) == 'S') {
+        uint32_t id, line;
+        unsigned char level;
+        Site s;
+        if (!get(in_, &id, 4) || !get(in_, &level, 1) || !get(in_, &line, 4) ||
+            !get_str(in_, s.file) || !get_str(in_, s.fmt) ||
+            level > LEVEL_ERROR) {
+            std::cerr << "[!] " << path_ << ": damaged site entry\n";
+            return false;
+        }
+        s.level = static_cast<LogLevel>(level);
+        s.line = static_cast<int>(line);
+        sites_[id] = s;
+    }
+    if (kind == EOF) return false;
+
+    uint32_t site, node;
+    std::map<uint32_t, Site>::const_iterator it;
+    if (kind != 'R' || !get(in_, &site, 4) || !get(in_, &node, 4) ||
+        !get(in_, &e.wall_ns, 8) || !get(in_, &e.thread, 4) ||
+        !get(in_, &e.suppressed, 4) || !get_str(in_, e.args) ||
+        (it = sites_.find(site)) == sites_.end()) {
+        std::cerr << "[!] " << path_ << ": damaged record\n";
+        return false;
+    }
+    e.node = static_cast<int32_t>(node);
+    e.level = it->second.level;
+    e.fmt = it->second.fmt.c_str();
+    e.file = it->second.file;
+    e.line = it->second.line;
+    return true;
+} // next()
@@ -1,5 +1,11 @@
 // lib/map_protocol.cpp
 #include "map_protocol.hpp"
+#include "control_channel.hpp"
+#include "message.hpp"
+#include "logger.hpp"
+#include "node_host.hpp"
+#include "probes.hpp"
+#include "trace.hpp"
 
 #include <iostream>
 #include <chrono>
@@ -8,12 +14,36 @@
 #include <string>
 #include <condition_variable>
 #include <thread>
+#include <fstream>
+#include <functional>
+#include <cstdlib>
+#include <new>
+#include <poll.h>
 
 using namespace std;
 
+namespace {
+
+    // nodes that booted the same kernel share CLOCK_MONOTONIC, so their
+    // send stamps need no offset; 0 if the boot id cannot be read
+    long long read_boot_id() {
+        std::ifstream in("/proc/sys/kernel/random/boot_id");
+        std::string text;
+        if (!std::getline(in, text) || text.empty()) return 0;
+        return static_cast<long long>(
+            std::hash<std::string>()(text) & 0x7fffffffffffffffULL);
+    } // read_boot_id()
+
+    long long boot_id() {
+        static const long long id = read_boot_id();
+        return id;
+    } // boot_id()
+
+} // end anonymous namespace
+
 // -------------------- static helpers (no lambdas) --------------------
-std::string MapProtocol::make_hello(int id) {
-    return std::string("HELLO|") + std::to_string(id);
+std::string MapProtocol::make_hello(int id, const std::string& notes) {
+    return std::string("HELLO|") + std::to_string(id) + notes;
 }
 
 bool MapProtocol::parse_hello(const std::string& s, int& out_id) {
@@ -28,26 +58,120 @@ bool MapProtocol::parse_hello(const std::string& s, int& out_id) {
     return true;
 }
 
+bool MapProtocol::find_hello_annotation(const std::string& s, const char* key,
+                                        long long& value) {
+    const std::string k = std::string(";") + key + "=";
+    const size_t at = s.find(k);
+    if (s.compare(0, 6, "HELLO|") != 0 || at == std::string::npos)
+        return false;
+    char* end = nullptr;
+    value = std::strtoll(s.c_str() + at + k.size(), &end, 10);
+    return end != s.c_str() + at + k.size();
+}
+
 // -------------------- ctor --------------------
-MapProtocol::MapProtocol(const Config& cfg, int node_id)
+MapProtocol::MapProtocol(const Config& cfg, int node_id, const Options& opts,
+                         NodeHost* host)
     : cfg_(cfg),
       id_(node_id),
-      vc_(cfg.n, 0),
-      stop_(false),
+      opts_(opts),
+      host_(host),
+      vc_(cfg.n),
+      metrics_(Metrics::global()),
+      exit_latency_us_(-1),
+      next_snapshot_id_(1),
+      burst_left_(-1),
+      writer_pending_(false),
       rng_(static_cast<unsigned>(
           std::chrono::steady_clock::now().time_since_epoch().count()) ^
           static_cast<unsigned>(node_id * 0x9e3779b1u)),
-      snapshot_mgr_(node_id, cfg.config_name, cfg.n),
-      termination_mgr_(node_id, cfg.n) // ← Add this
+      snapshot_mgr_(node_id, cfg.config_name, cfg.n, 64 * 1024,
+                    opts.snapshot_writer, opts.max_snapshots),
+      collector_(host ? Convergecast(cfg, node_id, host->tree(), opts.collect)
+                      : Convergecast(cfg, node_id, opts.collect)),
+      epoch_(0),
+      app_sent_(0),
+      app_received_(0),
+      control_sent_(0),
+      termination_mgr_(node_id, collector_.tree()),
+      terminated_at_ns_(-1),
+      halt_detected_wall_ns_(-1),
+      halt_received_wall_ns_(-1),
+      quiet_wall_ns_(-1)
 {
-    std::cout.setf(std::ios::unitbuf);
-    std::cerr.setf(std::ios::unitbuf);
+    register_metrics();
+    // mutexes cannot move, so the outboxes are built in place up front
+    for (int nb : cfg_.neighbors[id_]) (void)outboxes_[nb];
+}
+
+void* MapProtocol::operator new(size_t size) {
+    void* p = nullptr;
+    if (::posix_memalign(&p, alignof(MapProtocol), size) != 0)
+        throw std::bad_alloc();
+    return p;
+}
+
+void MapProtocol::operator delete(void* p) {
+    std::free(p);
+}
+
+// -------------------- metrics --------------------
+void MapProtocol::register_metrics() {
+    const std::string node = "node=\"" + std::to_string(id_) + "\"";
+    for (int nb : cfg_.neighbors[id_]) {
+        const std::string l = node + ",peer=\"" + std::to_string(nb) + "\"";
+        LinkMetrics& lm = link_metrics_[nb];
+        lm.sent = metrics_.counter("map_link_messages_sent_total", l,
+                                   "frames sent on the link");
+        lm.sent_bytes = metrics_.counter("map_link_bytes_sent_total", l,
+                                         "frame bytes sent on the link");
+        lm.received = metrics_.counter("map_link_messages_received_total", l,
+                                       "frames received on the link");
+        lm.received_bytes = metrics_.counter(
+            "map_link_bytes_received_total", l,
+            "frame bytes received on the link");
+        lm.dial_retries = metrics_.counter(
+            "map_link_dial_retries_total", l,
+            "dials that found the peer not accepting yet");
+        lm.connects = metrics_.counter(
+            "map_link_connects_total", l,
+            "associations set up for the link; more than one means a "
+            "duplicate was closed");
+    }
+    NodeMetrics& nm = node_metrics_;
+    nm.active_intervals = metrics_.counter("map_active_intervals_total", node,
+                                           "passive to active transitions");
+    nm.snapshots = metrics_.counter("map_snapshots_total", node,
+                                    "local states recorded");
+    nm.snapshot_latency_us_sum = metrics_.counter(
+        "map_snapshot_latency_us_sum", node,
+        "root: us from a snapshot's start to its global state");
+    nm.snapshot_latency_us_count = metrics_.counter(
+        "map_snapshot_latency_us_count", node,
+        "root: global snapshots collected");
+    nm.clock_merges = metrics_.counter("map_clock_merges_total", node,
+                                       "vector clock merges");
+    nm.clock_merge_ns_sum = metrics_.counter(
+        "map_clock_merge_ns_sum", node, "ns spent in sampled clock merges");
+    nm.clock_merge_ns_count = metrics_.counter(
+        "map_clock_merge_ns_count", node, "clock merges timed (1 in 64)");
+}
+
+int64_t MapProtocol::probe_send_queue(void* self, int peer) {
+    // links_ is fixed once the computation starts, and run() drops the
+    // probes before it closes the links
+    const MapProtocol* p = static_cast<const MapProtocol*>(self);
+    std::map<int, SCTPSocket>::const_iterator it = p->links_.find(peer);
+    return it == p->links_.end() ? -1 : it->second.pending_chunks();
 }
 
 // -------------------- small utility --------------------
 bool MapProtocol::is_neighbor(int peer_id) const {
-    const std::vector<int>& nbs = cfg_.neighbors[id_];
-    return std::find(nbs.begin(), nbs.end(), peer_id) != nbs.end();
+    return cfg_.neighbors.contains(id_, peer_id);
+}
+
+bool MapProtocol::in_process(int peer_id) const {
+    return host_ != nullptr && host_->hosts(peer_id);
 }
 
 void MapProtocol::initialize_state() {
@@ -55,49 +179,97 @@ void MapProtocol::initialize_state() {
     // For now, make node 0 always active, others passive
     is_active_ = (id_ == 0);
     messages_sent_ = 0;
+    if (is_active_) metrics_.add(node_metrics_.active_intervals);
+
+    LOG_INFO(id_, "Node {} initial state: {}", id_,
+             is_active_ ? "ACTIVE" : "PASSIVE");
+}
 
-    std::cout << "[*] Node " << id_ << " initial state: "
-              << (is_active_ ? "ACTIVE" : "PASSIVE") << "\n";
+// -------------------- duplicate resolution --------------------
+bool MapProtocol::adopt_link(int peer_id, SCTPSocket& s, int dialer) {
+    // both ends may dial each other; each end applies the same rule (keep
+    // the association dialed by the lower id) so they keep the same one
+    std::map<int, SCTPSocket>::iterator it = links_.find(peer_id);
+    if (it == links_.end()) {
+        links_[peer_id] = std::move(s);
+        link_dialer_[peer_id] = dialer;
+        PROBE3(link_up, id_, peer_id, dialer);
+        return true;
+    }
+    ++setup_stats_.duplicates_closed;
+    if (dialer < link_dialer_[peer_id]) {
+        it->second = std::move(s);     // closes the losing association
+        link_dialer_[peer_id] = dialer;
+        PROBE3(link_up, id_, peer_id, dialer);
+        return true;
+    }
+    s.close();
+    return false;
 }
 
 // -------------------- acceptor thread function --------------------
-void MapProtocol::acceptor_loop(std::atomic<bool>* accepting,
+void MapProtocol::acceptor_loop(ShutdownSignal* accepting_done,
                                 int expected_links)
 {
-    using namespace std::chrono;
-    while (!stop_.load() && accepting->load()) {
-        SCTPSocket peer;
-        if (!listen_sock_.accept(peer)) {
-            std::this_thread::sleep_for(milliseconds(10));
-            continue;
+    TRACE_SCOPE(id_, "acceptor_loop", expected_links);
+    // wait on the listener, the end-of-setup signal and node shutdown at
+    // once, so neither a finished setup nor stop() waits on a timeout
+    struct pollfd pfds[3];
+    pfds[0].fd = listen_sock_.get_fd();
+    pfds[1].fd = accepting_done->fd();
+    pfds[2].fd = shutdown_.fd();
+
+    while (!shutdown_.triggered() && !accepting_done->triggered()) {
+        for (int i = 0; i < 3; ++i) {
+            pfds[i].events = POLLIN;
+            pfds[i].revents = 0;
         }
+        if (::poll(pfds, 3, -1) < 0) continue;   // EINTR
+        if (shutdown_.triggered() || accepting_done->triggered()) break;
+        if (!(pfds[0].revents & POLLIN)) continue;
+
+        SCTPSocket peer;
+        if (!listen_sock_.accept(peer)) continue;
 
         // Expect peer HELLO first
         std::string hello;
-        if (!peer.receive(hello)) {
+        if (shutdown_.wait_readable(peer.get_fd(), 5000) !=
+                ShutdownSignal::WAIT_READY ||
+            !peer.receive(hello)) {
             peer.close();
             continue;
         }
+        const int64_t hello_received_ns = ShutdownSignal::now_ns();
 
         int peer_id = -1;
-        if (!parse_hello(hello, peer_id) || !is_neighbor(peer_id)) {
+        if (!parse_hello(hello, peer_id) || !is_neighbor(peer_id) ||
+            in_process(peer_id)) {
             // malformed or not an expected neighbor
             peer.close();
             continue;
         }
+        PROBE3(hello, id_, peer_id, 0);
 
-        // Reply with our HELLO
-        (void)peer.send(make_hello(id_));
+        // Reply with our HELLO; a dialer that stamped its HELLO (--latency)
+        // gets our receive and send times back to estimate the clock offset
+        long long sent_ns = 0;
+        std::string notes;
+        if (find_hello_annotation(hello, "t", sent_ns)) {
+            notes = app_annotation("t", ShutdownSignal::now_ns()) +
+                    app_annotation("r", hello_received_ns) +
+                    app_annotation("b", boot_id());
+        }
+        (void)peer.send(make_hello(id_, notes));
+        TRACE_INSTANT(id_, "accept", peer_id);
 
-        // Store link if not present
+        // Store link if not present, or if it wins the duplicate race
         {
             std::lock_guard<std::mutex> lk(m_);
-            if (links_.find(peer_id) == links_.end()) {
-                links_[peer_id] = std::move(peer);
-                std::cout << "[+] " << id_ << " accepted from " << peer_id << "\n";
-            } else {
-                // duplicate (race with outbound) → close
-                peer.close();
+            ++setup_stats_.associations;
+            ++setup_stats_.hellos_sent;
+            metrics_.add(link_metrics_.find(peer_id)->second.connects);
+            if (adopt_link(peer_id, peer, peer_id)) {
+                LOG_INFO(id_, "{} accepted from {}", id_, peer_id);
             }
         }
 
@@ -107,10 +279,91 @@ void MapProtocol::acceptor_loop(std::atomic<bool>* accepting,
 }
 
 // -------------------- connection setup (no lambdas) --------------------
+bool MapProtocol::dials(int peer_id) const {
+    // ordered: each edge is dialed from its lower end only, so it gets one
+    // association and one HELLO exchange; both: each end dials and
+    // adopt_link() settles the race
+    return opts_.setup == SETUP_BOTH || id_ < peer_id;
+}
+
+bool MapProtocol::dial_once(int nb) {
+    TRACE_SCOPE(id_, "dial", nb);
+    const NodeInfo& info = cfg_.nodes[nb];
+    SCTPSocket s;
+    if (!s.create()) {
+        LOG_ERROR(id_, "{} failed to create socket for neighbor {}", id_, nb);
+        return false;
+    }
+    ++setup_stats_.dial_attempts;
+    // a compiled topology image already resolved the host
+    if (!(info.addr ? s.connect(info.addr, info.port)
+                    : s.connect(info.host, info.port))) {
+        metrics_.add(link_metrics_.find(nb)->second.dial_retries);
+        return false;
+    }
+
+    // Send our HELLO and expect theirs
+    const int64_t hello_sent_ns = ShutdownSignal::now_ns();
+    (void)s.send(make_hello(id_, opts_.latency
+                                     ? app_annotation("t", hello_sent_ns)
+                                     : std::string()));
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        ++setup_stats_.hellos_sent;
+    }
+    std::string hello;
+    int peer_id = -1;
+    if (!s.receive(hello) || !parse_hello(hello, peer_id) || peer_id != nb)
+        return false;   // handshake failed: s closes, the next round retries
+    const int64_t hello_received_ns = ShutdownSignal::now_ns();
+    PROBE3(hello, id_, nb, 1);
+
+    // NTP-style estimate of the peer's clock minus ours from the four
+    // stamps, within half the round trip; none needed on the same host
+    long long peer_sent = 0, peer_received = 0, peer_boot = 0;
+    int64_t offset = 0, rtt = -1;
+    if (find_hello_annotation(hello, "t", peer_sent) &&
+        find_hello_annotation(hello, "r", peer_received) &&
+        find_hello_annotation(hello, "b", peer_boot)) {
+        rtt = (hello_received_ns - hello_sent_ns) -
+              (peer_sent - peer_received);
+        if (peer_boot == 0 || peer_boot != boot_id()) {
+            offset = ((peer_received - hello_sent_ns) +
+                      (peer_sent - hello_received_ns)) / 2;
+        }
+    }
+
+    std::lock_guard<std::mutex> lk(m_);
+    ++setup_stats_.associations;
+    metrics_.add(link_metrics_.find(nb)->second.connects);
+    if (adopt_link(nb, s, id_)) {
+        LOG_INFO(id_, "{} connected to {} ({}:{})", id_, nb, info.host,
+                 info.port);
+        if (rtt >= 0) {
+            // the peer learns the same offset, seen from its side; queued
+            // until setup ends, so it goes out on the association both
+            // ends keep
+            link_latency_[nb].offset_ns = offset;
+            link_latency_[nb].rtt_ns = rtt;
+            (void)send_to(nb, encode_offset_message(id_, -offset, rtt));
+        }
+    }
+    return true;
+}
+
 void MapProtocol::establish_connections() {
+    TRACE_SCOPE(id_, "establish_connections", 0);
     using namespace std::chrono;
+    const steady_clock::time_point started = steady_clock::now();
 
-    const int expected_links = static_cast<int>(cfg_.neighbors[id_].size());
+    // hosted: neighbors in the same process are reached through the host
+    int expected_links = 0;
+    std::vector<int> pending;          // neighbors this node dials
+    for (int nb : cfg_.neighbors[id_]) {
+        if (in_process(nb)) continue;
+        ++expected_links;
+        if (dials(nb)) pending.push_back(nb);
+    }
 
     // 1) Bind + listen (retries to handle races/TIME_WAIT)
     bool bound_ok = false;
@@ -125,233 +378,957 @@ void MapProtocol::establish_connections() {
             listen_sock_.close();
             ++attempt;
             if (attempt >= kMaxBindRetries) {
-                std::cerr << "[!] Node " << id_ << " failed to bind after "
-                          << kMaxBindRetries << " attempts on port "
-                          << cfg_.nodes[id_].port << "\n";
+                LOG_ERROR(id_, "Node {} failed to bind after {} attempts on "
+                          "port {}", id_, kMaxBindRetries,
+                          cfg_.nodes[id_].port);
                 break;
             }
-            std::this_thread::sleep_for(milliseconds(200));
+            if (shutdown_.wait_for(200)) break;
         }
         if (bound_ok) {
             if (!listen_sock_.listen(16)) {
-                std::cerr << "[!] Failed to listen on SCTP socket\n";
+                LOG_ERROR(id_, "Failed to listen on SCTP socket");
             } else {
                 // Startup line per node so stdout-<id>.log always shows a first event
-                std::cout << "[*] " << id_ << " listening on port "
-                          << cfg_.nodes[id_].port << " with "
-                          << expected_links << " neighbors\n";
+                LOG_INFO(id_, "{} listening on port {} with {} neighbors",
+                         id_, cfg_.nodes[id_].port, expected_links);
             }
         }
     }
 
-    // 2) Start acceptor thread (only useful if we're listening)
-    std::atomic<bool> accepting(true);
+    // 2) Start acceptor thread (only useful if we're listening); in ordered
+    // mode it still takes a dial from a peer running --setup=both
+    ShutdownSignal accepting_done;
     std::thread acceptor_thread;
     if (bound_ok && expected_links > 0) {
         acceptor_thread = std::thread(&MapProtocol::acceptor_loop, this,
-                                      &accepting, expected_links);
+                                      &accepting_done, expected_links);
     }
 
-    // 3) Outgoing connects with HELLO handshake
-    for (size_t idx = 0; idx < cfg_.neighbors[id_].size(); ++idx) {
-        int nb = cfg_.neighbors[id_][idx];
-
-        // If acceptor already created it, skip
-        {
-            std::lock_guard<std::mutex> lk(m_);
-            if (links_.find(nb) != links_.end()) {
-                continue;
+    // 3) Outgoing connects with HELLO handshake, in rounds over every
+    // neighbor still missing: one peer that is not up yet costs one back-off
+    // per round instead of one per neighbor. The back-off starts short,
+    // since a peer that is merely slower than us comes up within ms.
+    const steady_clock::time_point deadline =
+        steady_clock::now() + seconds(40); // allow peers to come up
+    int backoff_ms = 5;
+    while (!pending.empty() && !shutdown_.triggered() &&
+           steady_clock::now() < deadline) {
+        std::vector<int> still;
+        for (size_t idx = 0; idx < pending.size(); ++idx) {
+            const int nb = pending[idx];
+            // If acceptor already created it, skip
+            {
+                std::lock_guard<std::mutex> lk(m_);
+                if (links_.find(nb) != links_.end()) continue;
             }
+            if (!dial_once(nb)) still.push_back(nb);
         }
+        pending.swap(still);
+        if (pending.empty()) break;
 
-        const NodeInfo& info = cfg_.nodes[nb];
-        const steady_clock::time_point deadline =
-            steady_clock::now() + seconds(40); // allow peers to come up
-
-        SCTPSocket s;
-        if (!s.create()) {
-            std::cerr << "[!] " << id_ << " failed to create socket for neighbor " << nb << "\n";
-            continue;
+        ++setup_stats_.retry_rounds;
+        if (setup_stats_.retry_rounds == 1) {
+            LOG_WARN(id_, "{} retrying connection to {} neighbor(s), first "
+                          "{} ({}:{})", id_, pending.size(), pending[0],
+                     cfg_.nodes[pending[0]].host, cfg_.nodes[pending[0]].port);
         }
+        if (shutdown_.wait_for(backoff_ms)) break;
+        backoff_ms = std::min(backoff_ms * 2, 200);
+    }
 
-        bool connected = false;
-        while (!stop_.load() && steady_clock::now() < deadline) {
-            // NEW: if acceptor already formed this link, stop retrying outbound
+    // 4) Grace for late accepts, wait until all expected links are formed
+    if (acceptor_thread.joinable()) {
+        while (true) {
             {
                 std::lock_guard<std::mutex> lk(m_);
-                if (links_.find(nb) != links_.end()) {
-                    connected = true;
+                if (static_cast<int>(links_.size()) >= expected_links) {
                     break;
                 }
             }
+            if (shutdown_.wait_for(5)) break;
+        }
+        accepting_done.trigger();
+        acceptor_thread.join();
+        LOG_INFO(id_, "Node {} acceptor thread joined.", id_);
+    }
+
+    // Only close listener if all links are made
+    if (static_cast<int>(links_.size()) >= expected_links) {
+        listen_sock_.close();
+    }
+
+    // links_ is final now: send what dial_once() queued (OFFSET frames)
+    flush_outboxes();
+
+    // 5) Summary
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        setup_stats_.setup_us = duration_cast<microseconds>(
+            steady_clock::now() - started).count();
+        LOG_INFO(id_, "Node {} established {} / {} links.", id_,
+                 links_.size(), expected_links);
+        LOG_INFO(id_, "Node {} setup ({}): {} ms, {} dials in {} retry "
+                      "rounds, {} associations, {} duplicates closed, {} "
+                      "HELLOs sent",
+                 id_, opts_.setup == SETUP_BOTH ? "both" : "ordered",
+                 setup_stats_.setup_us / 1000, setup_stats_.dial_attempts,
+                 setup_stats_.retry_rounds, setup_stats_.associations,
+                 setup_stats_.duplicates_closed, setup_stats_.hellos_sent);
 
-            std::cerr << "[~] " << id_ << " retrying connection to " << nb
-          << " (" << info.host << ":" << info.port << ")\n";
-            if (s.connect(info.host, info.port)) {
-                // Send our HELLO and expect theirs
-                (void)s.send(make_hello(id_));
-                std::string hello;
-                if (s.receive(hello)) {
-                    int peer_id = -1;
-                    if (parse_hello(hello, peer_id) && peer_id == nb) {
-                        std::lock_guard<std::mutex> lk(m_);
-                        if (links_.find(nb) == links_.end()) {
-                            links_[nb] = std::move(s);
-                            std::cout << "[+] " << id_ << " connected to "
-                                      << nb << " (" << info.host << ":" << info.port << ")\n";
-                        } else {
-                            // acceptor won the race; close outbound
-                            s.close();
-                        }
-                        connected = true;
-                        break;
-                    }
+        if (static_cast<int>(links_.size()) < expected_links) {
+            std::string missing;
+            for (int nb : cfg_.neighbors[id_]) {
+                if (links_.find(nb) == links_.end() && !in_process(nb)) {
+                    missing += std::to_string(nb) + " ";
                 }
-                // Handshake failed → recreate and retry
-                s.close();
-                s.create();
             }
-            std::this_thread::sleep_for(milliseconds(200));
+            LOG_ERROR(id_, "Node {} missing connections to: {}", id_, missing);
         }
+    }
+}
+
+// -------------------- output --------------------
+void MapProtocol::record_initial_snapshot() {
+    std::lock_guard<std::mutex> lk(m_);
+    // writes logs/<config>-<id>.out
+    snapshot_mgr_.record_snapshot(vc_.to_vector());
+}
 
-        if (!connected) {
-            // Only complain if we still don't have the link
+// -------------------- MAP computation --------------------
+void MapProtocol::handle_frame(int from, const std::string& frame) {
+    dispatch_frame(from, frame);
+    flush_outboxes();
+}
+
+void MapProtocol::dispatch_frame(int from, const std::string& frame) {
+    TRACE_SCOPE(id_, "handle_frame", from);
+    std::map<int, LinkMetrics>::const_iterator lm = link_metrics_.find(from);
+    if (lm != link_metrics_.end()) {
+        metrics_.add(lm->second.received);
+        metrics_.add(lm->second.received_bytes, frame.size());
+    }
+
+    if (is_marker_message(frame)) {
+        int sender = -1, snapshot_id = -1;
+        if (decode_marker_message(frame, sender, snapshot_id)) {
             std::lock_guard<std::mutex> lk(m_);
-            if (links_.find(nb) == links_.end()) {
-                std::cerr << "[!] " << id_ << " could not connect to neighbor "
-                          << nb << " (" << info.host << ":" << info.port
-                          << ") within timeout\n";
-            }
+            handle_marker(from, snapshot_id);
+            return;
         }
     }
 
-// 4) Grace for late accepts, wait until all expected links are formed
-if (acceptor_thread.joinable()) {
-    while (true) {
-        {
+    if (is_epoch_message(frame)) {
+        int sender = -1, epoch = -1;
+        if (decode_epoch_message(frame, sender, epoch)) {
             std::lock_guard<std::mutex> lk(m_);
-            if (static_cast<int>(links_.size()) >= expected_links) {
-                break;
+            advance_epoch(epoch);
+            return;
+        }
+    }
+
+    if (is_halt_message(frame)) {
+        int sender = -1;
+        long long detected = -1;
+        if (decode_halt_message(frame, sender, detected)) {
+            std::lock_guard<std::mutex> lk(m_);
+            halt(detected);
+            return;
+        }
+    }
+
+    if (is_credit_message(frame)) {
+        int sender = -1;
+        std::vector<int> credits;
+        if (decode_credit_message(frame, sender, credits)) {
+            std::lock_guard<std::mutex> lk(m_);
+            termination_mgr_.receive_returned(credits);
+            if (!is_active_) return_credit();
+            check_termination();
+            return;
+        }
+    }
+
+    if (is_offset_message(frame)) {
+        int sender = -1;
+        long long offset = 0, rtt = -1;
+        if (decode_offset_message(frame, sender, offset, rtt)) {
+            // with --setup=both each end may estimate; keep the tighter one
+            std::lock_guard<std::mutex> lk(m_);
+            LinkLatency& l = link_latency_[from];
+            if (l.rtt_ns < 0 || rtt < l.rtt_ns) {
+                l.offset_ns = offset;
+                l.rtt_ns = rtt;
             }
+            return;
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(50));
     }
-    accepting.store(false);
-    acceptor_thread.join();
-    std::cout << "[*] Node " << id_ << " acceptor thread joined.\n";
-}
 
-// Final connection summary
-{
+    if (is_state_message(frame)) {
+        int sender = -1;
+        SnapshotState st;
+        if (decode_state_message(frame, sender, st)) {
+            std::lock_guard<std::mutex> lk(m_);
+            handle_state(from, st);
+            return;
+        }
+    }
+
+    // the clock is parsed in place; with a compiled-in n it is on the stack
+    const char *clock_b = nullptr, *clock_e = nullptr;
+    VectorClock clock(cfg_.n);
+    bool parsed;
+    {
+        TRACE_SCOPE(id_, "decode", from);
+        parsed = find_app_clock(frame, clock_b, clock_e) &&
+                 clock.parse(clock_b, clock_e);
+    }
+    if (!parsed) {
+        LOG_EVERY(LEVEL_ERROR, 1000, id_, "{} dropped malformed frame from {}",
+                  id_, from);
+        return;
+    }
+    // the sender's own entry numbers its APP frames
+    TRACE_FLOW_IN(id_, "app", from, clock[from]);
+    PROBE3(app_recv, id_, from, clock[from]);
+
     std::lock_guard<std::mutex> lk(m_);
-    std::cout << "[*] Node " << id_ << " established "
-              << links_.size() << " / " << expected_links << " links.\n";
-
-    if (static_cast<int>(links_.size()) < expected_links) {
-        std::cerr << "[!] Node " << id_ << " missing connections to: ";
-        for (int nb : cfg_.neighbors[id_]) {
-            if (links_.find(nb) == links_.end()) {
-                std::cerr << nb << " ";
-            }
+    // channel state: APP frames that beat the channel's marker
+    if (snapshot_mgr_.recording()) snapshot_mgr_.record_in_transit(from, frame);
+
+    // Lai-Yang: a frame from a newer epoch is only handled after this node
+    // recorded its own state for that epoch
+    long long epoch = 0;
+    if (opts_.snapshot_mode == SNAPSHOT_PIGGYBACK &&
+        find_app_annotation(frame, "e", epoch)) {
+        int& seen = peer_epoch_[from];
+        if (epoch > seen) seen = static_cast<int>(epoch);
+        if (epoch > epoch_) advance_epoch(static_cast<int>(epoch));
+    }
+    ++app_received_;
+    quiet_wall_ns_ = ShutdownSignal::wall_ns();
+    if (opts_.latency) record_latency(from, frame);
+
+    long long credit = -1;
+    if (find_app_annotation(frame, "w", credit)) {
+        termination_mgr_.receive_credit(static_cast<int>(credit));
+    } else {
+        LOG_EVERY(LEVEL_ERROR, 1000, id_, "{} APP from {} carries no credit",
+                  id_, from);
+    }
+
+    // time one merge in 64: two clock reads cost about as much as a merge
+    {
+        TRACE_SCOPE(id_, "clock_merge", from);
+        if ((app_received_ & 63) == 0) {
+            const int64_t t0 = ShutdownSignal::now_ns();
+            vc_.merge(clock);
+            metrics_.add(node_metrics_.clock_merge_ns_sum,
+                         ShutdownSignal::now_ns() - t0);
+            metrics_.add(node_metrics_.clock_merge_ns_count);
+        } else {
+            vc_.merge(clock);
         }
-        std::cerr << "\n";
+    }
+    metrics_.add(node_metrics_.clock_merges);
+    vc_.tick(id_);
+
+    // a passive node turns active on receipt unless its budget is spent,
+    // in which case the credit goes straight back
+    if (!is_active_ && messages_sent_ < cfg_.maxNumber) {
+        is_active_ = true;
+        TRACE_INSTANT(id_, "active", from);
+        PROBE3(state, id_, 1, messages_sent_);
+        metrics_.add(node_metrics_.active_intervals);
+        wake_writer();
+    } else if (!is_active_) {
+        return_credit();
+        check_termination();
     }
 }
 
-// Only close listener if all links are made
-if (static_cast<int>(links_.size()) >= expected_links) {
-    listen_sock_.close();
+// -------------------- Chandy-Lamport --------------------
+void MapProtocol::take_local_snapshot(int snapshot_id) {
+    TRACE_SCOPE(id_, "snapshot_record", snapshot_id);
+    // too many instances open: cut the oldest short here, so its (partial)
+    // state still reaches the root
+    while (snapshot_mgr_.at_capacity()) {
+        const int oldest = snapshot_mgr_.oldest_open();
+        LOG_ERROR(id_, "{} {} snapshots open when {} began; finishing {} "
+                       "early", id_, snapshot_mgr_.open_instances(),
+                  snapshot_id, oldest);
+        snapshot_finished(snapshot_mgr_.finish_snapshot(oldest));
+    }
+    if (id_ == collector_.tree().root) {
+        snapshot_start_ns_[snapshot_id] = ShutdownSignal::now_ns();
+        if (snapshot_start_ns_.size() > 64)    // never completed
+            snapshot_start_ns_.erase(snapshot_start_ns_.begin());
+    }
+
+    // record state, then marker on every outgoing channel before any
+    // further APP send; both happen under m_, which orders them w.r.t. the
+    // writer thread
+    snapshot_mgr_.begin_snapshot(snapshot_id, vc_.to_vector(), is_active_);
+    PROBE2(snapshot_begin, id_, snapshot_id);
+    metrics_.add(node_metrics_.snapshots);
+    const std::string marker = encode_marker_message(id_, snapshot_id);
+    for (size_t i = 0; i < peers_.size(); ++i) {
+        if (!send_to(peers_[i], marker)) {
+            LOG_EVERY(LEVEL_ERROR, 1000, id_, "{} marker {} to {} failed",
+                      id_, snapshot_id, peers_[i]);
+        }
+        ++control_sent_;
+    }
+    if (snapshot_mgr_.all_channels_closed(snapshot_id))
+        snapshot_finished(snapshot_mgr_.finish_snapshot(snapshot_id));
 }
 
-// Final connection summary
-{
-    std::lock_guard<std::mutex> lk(m_);
-    std::cout << "[*] Node " << id_ << " established "
-              << links_.size() << " / " << expected_links << " links.\n";
-
-    if (static_cast<int>(links_.size()) < expected_links) {
-        std::cerr << "[!] Node " << id_ << " missing connections to: ";
-        for (int nb : cfg_.neighbors[id_]) {
-            if (links_.find(nb) == links_.end()) {
-                std::cerr << nb << " ";
-            }
+void MapProtocol::handle_marker(int from, int snapshot_id) {
+    // first marker of an instance: the channel it came on is recorded as
+    // empty for that instance; other open instances are unaffected
+    if (!snapshot_mgr_.has_begun(snapshot_id)) take_local_snapshot(snapshot_id);
+    if (snapshot_mgr_.close_channel(from, snapshot_id)) {
+        const SnapshotResult r = snapshot_mgr_.finish_snapshot(snapshot_id);
+        LOG_INFO(id_, "Node {} snapshot {} done ({} in transit)", id_, r.id,
+                 r.in_transit);
+        snapshot_finished(r);
+    }
+}
+
+// -------------------- Lai-Yang --------------------
+void MapProtocol::advance_epoch(int epoch) {
+    if (epoch <= epoch_) return;
+
+    // every skipped epoch gets the same local state: nothing happened here
+    // in between. All APP frames sent so far are from older epochs, all
+    // received so far were handled before this record, so the frames of
+    // epoch e still in flight are sum(sent) - sum(received) over all nodes
+    while (epoch_ < epoch) {
+        ++epoch_;
+        if (id_ == collector_.tree().root)
+            snapshot_start_ns_[epoch_] = ShutdownSignal::now_ns();
+        snapshot_mgr_.record_local(epoch_, vc_.to_vector(), is_active_);
+        PROBE2(snapshot_begin, id_, epoch_);
+        metrics_.add(node_metrics_.snapshots);
+
+        SnapshotState st;
+        st.snapshot_id = epoch_;
+        st.origin = id_;
+        st.nodes = 1;
+        st.active = is_active_ ? 1 : 0;
+        st.in_transit = app_sent_ - app_received_;
+
+        std::vector<StateSend> out;
+        collector_.local_done(st, out);
+        send_states(out);
+    }
+    announce_epoch();
+    report_global_snapshots();
+}
+
+void MapProtocol::announce_epoch() {
+    // APP traffic alone may never reach an idle node, so the epoch also goes
+    // down the spanning tree, but only to children that have not already
+    // shown it on an APP frame
+    const std::vector<int>& children = collector_.tree().children[id_];
+    for (size_t i = 0; i < children.size(); ++i) {
+        std::map<int, int>::iterator seen = peer_epoch_.find(children[i]);
+        if (seen != peer_epoch_.end() && seen->second >= epoch_) continue;
+
+        if (!send_to(children[i], encode_epoch_message(id_, epoch_))) {
+            LOG_EVERY(LEVEL_ERROR, 1000, id_, "{} epoch {} to {} failed", id_,
+                      epoch_, children[i]);
         }
-        std::cerr << "\n";
+        ++control_sent_;
     }
 }
 
-// Only close listener if all links are made
-if (static_cast<int>(links_.size()) >= expected_links) {
-    listen_sock_.close();
+// -------------------- convergecast --------------------
+void MapProtocol::snapshot_finished(const SnapshotResult& r) {
+    PROBE3(snapshot_end, id_, r.id, r.in_transit);
+    SnapshotState st;
+    st.snapshot_id = r.id;
+    st.origin = id_;
+    st.nodes = 1;
+    st.active = r.active ? 1 : 0;
+    st.in_transit = static_cast<long long>(r.in_transit);
+
+    std::vector<StateSend> out;
+    collector_.local_done(st, out);
+    send_states(out);
+    report_global_snapshots();
 }
 
-// Final connection summary
-{
-    std::lock_guard<std::mutex> lk(m_);
-    std::cout << "[*] Node " << id_ << " established "
-              << links_.size() << " / " << expected_links << " links.\n";
-
-    if (static_cast<int>(links_.size()) < expected_links) {
-        std::cerr << "[!] Node " << id_ << " missing connections to: ";
-        for (int nb : cfg_.neighbors[id_]) {
-            if (links_.find(nb) == links_.end()) {
-                std::cerr << nb << " ";
+void MapProtocol::handle_state(int from, const SnapshotState& st) {
+    std::vector<StateSend> out;
+    collector_.received(from, st, out);
+    send_states(out);
+    report_global_snapshots();
+}
+
+void MapProtocol::send_states(const std::vector<StateSend>& out) {
+    for (size_t i = 0; i < out.size(); ++i) {
+        if (!send_to(out[i].to, encode_state_message(id_, out[i].state))) {
+            LOG_EVERY(LEVEL_ERROR, 1000, id_, "{} STATE {} to {} failed", id_,
+                      out[i].state.snapshot_id, out[i].to);
+        }
+    }
+}
+
+void MapProtocol::report_global_snapshots() {
+    SnapshotState g;
+    while (collector_.pop_complete(g)) {
+        int64_t us = -1;
+        std::map<int, int64_t>::iterator it = snapshot_start_ns_.find(g.snapshot_id);
+        if (it != snapshot_start_ns_.end()) {
+            us = (ShutdownSignal::now_ns() - it->second) / 1000;
+            snapshot_start_ns_.erase(it);
+            metrics_.add(node_metrics_.snapshot_latency_us_sum, us);
+            metrics_.add(node_metrics_.snapshot_latency_us_count);
+        }
+        TRACE_INSTANT(id_, "global_snapshot", g.snapshot_id);
+        PROBE3(snapshot_global, id_, g.snapshot_id, us);
+        LOG_INFO(id_, "Global snapshot {}: {}/{} nodes, {} active, {} in "
+                      "transit, collected in {} us ({})",
+                 g.snapshot_id, g.nodes, cfg_.n, g.active, g.in_transit, us,
+                 collector_.mode() == COLLECT_TREE ? "tree" : "flood");
+    }
+}
+
+// -------------------- termination detection --------------------
+void MapProtocol::return_credit() {
+    // a passive node holds no weight: everything goes one hop up the tree
+    std::vector<int> credits;
+    if (!termination_mgr_.release(credits)) return;
+
+    // a credit is up to 11 digits and a comma; a long list goes in several
+    // frames, each within one read of SCTPSocket::receive()
+    const size_t kCreditsPerFrame = 64;
+    const int parent = termination_mgr_.parent();
+    for (size_t i = 0; i < credits.size(); i += kCreditsPerFrame) {
+        const std::vector<int> part(
+            credits.begin() + i,
+            credits.begin() + std::min(credits.size(), i + kCreditsPerFrame));
+        if (!send_to(parent, encode_credit_message(id_, part))) {
+            LOG_EVERY(LEVEL_ERROR, 1000, id_, "{} CREDIT to {} failed", id_,
+                      parent);
+        }
+    }
+}
+
+void MapProtocol::check_termination() {
+    if (!termination_mgr_.is_root() || is_active_ ||
+        terminated_at_ns_ >= 0 || !termination_mgr_.holds_all())
+        return;
+
+    terminated_at_ns_ = ShutdownSignal::now_ns();
+    TRACE_INSTANT(id_, "termination_detected", app_sent_);
+    PROBE2(termination, id_, app_sent_);
+    LOG_INFO(id_, "Termination detected at node {}: all nodes passive, no "
+                  "APP in transit ({} sent, {}/{} of own budget)",
+             id_, app_sent_, messages_sent_, cfg_.maxNumber);
+    halt(ShutdownSignal::wall_ns());
+}
+
+// -------------------- halt --------------------
+void MapProtocol::halt(int64_t detected_wall_ns) {
+    if (halt_received_wall_ns_ >= 0) return;    // only one HALT per node
+    halt_received_wall_ns_ = ShutdownSignal::wall_ns();
+    halt_detected_wall_ns_ = detected_wall_ns;
+    TRACE_INSTANT(id_, "halt", 0);
+    PROBE2(halt, id_, detected_wall_ns);
+
+    // children first, so the wave keeps moving while this node flushes;
+    // the frames are queued before stop() lets run() close the links
+    const std::vector<int>& children = collector_.tree().children[id_];
+    for (size_t i = 0; i < children.size(); ++i) {
+        if (!send_to(children[i], encode_halt_message(id_, detected_wall_ns))) {
+            LOG_ERROR(id_, "{} HALT to {} failed", id_, children[i]);
+        }
+    }
+    LOG_INFO(id_, "Node {} halting", id_);
+    stop();
+}
+
+void MapProtocol::write_halt_record() {
+    // logs/<config>-<id>.halt: id, tree depth, then the wall-clock ns of
+    // detection at the root, HALT receipt here and exit here, of the last
+    // APP handled or turn passive here (-1 if neither), and the APP
+    // frames this node sent
+    if (halt_received_wall_ns_ < 0) return;
+    const std::string path = snapshot_mgr_.base_path() + ".halt";
+    std::ofstream out(path.c_str(), std::ios::trunc);
+    if (!out) {
+        LOG_ERROR(id_, "cannot open halt record: {}", path);
+        return;
+    }
+    out << id_ << " " << collector_.tree().depth[id_] << " "
+        << halt_detected_wall_ns_ << " " << halt_received_wall_ns_ << " "
+        << ShutdownSignal::wall_ns() << " " << quiet_wall_ns_ << " "
+        << app_sent_ << "\n";
+}
+
+// -------------------- one-way APP delay (--latency) --------------------
+void MapProtocol::record_latency(int from, const std::string& frame) {
+    // the sender stamped its monotonic clock; the offset maps it to ours
+    long long sent_ns = 0;
+    if (!find_app_annotation(frame, "ts", sent_ns)) return;
+    LinkLatency& l = link_latency_[from];
+    l.delay.record(ShutdownSignal::now_ns() - (sent_ns - l.offset_ns));
+}
+
+void MapProtocol::write_latency_report() {
+    // logs/<config>-<id>.latency: one line per neighbor that sent APP
+    // frames, then "all" for the node; ns throughout, offset and rtt come
+    // from the HELLO exchange (rtt -1: in-process peer, nothing measured)
+    if (!opts_.latency) return;
+    const std::string path = snapshot_mgr_.base_path() + ".latency";
+    std::ofstream out(path.c_str(), std::ios::trunc);
+    if (!out) {
+        LOG_ERROR(id_, "cannot open latency report: {}", path);
+        return;
+    }
+    out << "# peer count p50 p99 p999 max negative offset rtt\n";
+    LatencyHistogram all;
+    for (std::map<int, LinkLatency>::const_iterator it =
+             link_latency_.begin();
+         it != link_latency_.end(); ++it) {
+        const LatencyHistogram& h = it->second.delay;
+        if (h.count() == 0) continue;
+        out << it->first << " " << h.count() << " " << h.percentile(50)
+            << " " << h.percentile(99) << " " << h.percentile(99.9) << " "
+            << h.max() << " " << h.negatives() << " " << it->second.offset_ns
+            << " " << it->second.rtt_ns << "\n";
+        all.merge(h);
+    }
+    out << "all " << all.count() << " " << all.percentile(50) << " "
+        << all.percentile(99) << " " << all.percentile(99.9) << " "
+        << all.max() << " " << all.negatives() << " 0 -1\n";
+    LOG_INFO(id_, "Node {} APP delay over {} frames: p50 {} us, p99 {} us, "
+             "p999 {} us, max {} us", id_, all.count(),
+             all.percentile(50) / 1000.0, all.percentile(99) / 1000.0,
+             all.percentile(99.9) / 1000.0, all.max() / 1000.0);
+}
+
+void MapProtocol::snapshot_loop() {
+    while (!shutdown_.wait_for(cfg_.snapshotDelay_ms)) {
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            snapshot_tick();
+        }
+        flush_outboxes();
+    }
+}
+
+void MapProtocol::snapshot_tick() {
+    // overlapping instances: a new snapshot starts on schedule even if
+    // earlier ones are still collecting channel state
+    if (opts_.snapshot_mode == SNAPSHOT_PIGGYBACK)
+        advance_epoch(epoch_ + 1);
+    else
+        take_local_snapshot(next_snapshot_id_++);
+}
+
+void MapProtocol::receive_loop(int peer_id) {
+    // links_ is no longer modified once the receivers start
+    SCTPSocket& link = links_.find(peer_id)->second;
+    std::string msg;
+
+    for (;;) {
+        ShutdownSignal::WaitResult r =
+            shutdown_.wait_readable(link.get_fd(), -1);
+        if (r == ShutdownSignal::WAIT_SHUTDOWN) break;
+        bool received;
+        {
+            TRACE_SCOPE(id_, "receive", peer_id);
+            received = link.receive(msg);
+        }
+        if (!received) {
+            LOG_WARN(id_, "{} link to {} closed by peer", id_, peer_id);
+            return;
+        }
+        if (msg.empty()) continue;
+        // hosted: the node's worker handles it, in order with its other frames
+        if (host_) host_->post(peer_id, id_, msg);
+        else handle_frame(peer_id, msg);
+    }
+
+    // drain whatever is already queued so no delivered frame is lost, but
+    // never block: the peer may be shutting down too
+    struct pollfd pfd;
+    pfd.fd = link.get_fd();
+    pfd.events = POLLIN;
+    for (;;) {
+        pfd.revents = 0;
+        if (::poll(&pfd, 1, 0) <= 0 || !(pfd.revents & POLLIN)) break;
+        if (!link.receive(msg) || msg.empty()) break;
+        if (host_) host_->post(peer_id, id_, msg);
+        else handle_frame(peer_id, msg);
+    }
+}
+
+void MapProtocol::writer_loop() {
+    const NeighborRange nbs = cfg_.neighbors[id_];
+    std::unique_lock<std::mutex> lk(m_);
+
+    while (!shutdown_.triggered()) {
+        while (!is_active_ && !shutdown_.triggered()) active_cv_.wait(lk);
+        if (shutdown_.triggered() || nbs.empty()) break;
+
+        // one active interval: a random burst to random neighbors
+        std::uniform_int_distribution<int> burst(cfg_.minPerActive,
+                                                 cfg_.maxPerActive);
+        std::uniform_int_distribution<size_t> pick(0, nbs.size() - 1);
+        const int count = burst(rng_);
+
+        {
+            TRACE_SCOPE(id_, "active_burst", count);
+            for (int k = 0; k < count && messages_sent_ < cfg_.maxNumber;
+                 ++k) {
+                const int peer = nbs[pick(rng_)];
+                if (links_.find(peer) == links_.end()) continue;
+                send_app(peer);
+
+                // minSendDelay between sends, cut short by shutdown
+                lk.unlock();
+                flush_outboxes();
+                bool stopping = shutdown_.wait_for(cfg_.minSendDelay_ms);
+                lk.lock();
+                if (stopping) break;
             }
         }
-        std::cerr << "\n";
+        is_active_ = false;
+        quiet_wall_ns_ = ShutdownSignal::wall_ns();
+        TRACE_INSTANT(id_, "passive", messages_sent_);
+        PROBE3(state, id_, 0, messages_sent_);
+        return_credit();
+        check_termination();
+        lk.unlock();
+        flush_outboxes();
+        lk.lock();
     }
 }
 
-// Only close listener if all links are made
-if (static_cast<int>(links_.size()) >= expected_links) {
-    listen_sock_.close();
+void MapProtocol::send_app(int peer) {
+    TRACE_SCOPE(id_, "send_app", peer);
+    vc_.tick(id_);
+    TRACE_FLOW_OUT(id_, "app", peer, vc_[id_]);
+    const int credit = termination_mgr_.split_credit();
+    std::string notes = app_annotation("w", credit);
+    if (opts_.snapshot_mode == SNAPSHOT_PIGGYBACK)
+        notes += app_annotation("e", epoch_);
+    if (opts_.latency)
+        notes += app_annotation("ts", ShutdownSignal::now_ns());
+    const std::string frame =
+        encode_annotated_app_message(id_, notes, vc_.data(), vc_.size(), "");
+    if (!send_to(peer, frame)) {
+        LOG_EVERY(LEVEL_ERROR, 1000, id_, "{} send to {} failed", id_, peer);
+        termination_mgr_.receive_credit(credit);   // never left
+    } else {
+        // counted when queued; send_failed() takes it back
+        ++app_sent_;
+        PROBE3(app_send, id_, peer, vc_[id_]);
+    }
+    ++messages_sent_;
 }
 
-    // 5) Summary
-    {
-        std::lock_guard<std::mutex> lk(m_);
-        std::cout << "[*] Node " << id_ << " established "
-                  << links_.size() << " / " << expected_links << " links.\n";
+bool MapProtocol::send_to(int peer, const std::string& frame) {
+    if (in_process(peer)) {
+        TRACE_SCOPE(id_, "send", peer);
+        host_->post(id_, peer, frame);
+        const LinkMetrics& lm = link_metrics_.find(peer)->second;
+        metrics_.add(lm.sent);
+        metrics_.add(lm.sent_bytes, frame.size());
+        return true;
+    }
+    // links_ is no longer modified once the computation starts; the
+    // socket send waits for flush_outboxes(), after m_ is released
+    if (links_.find(peer) == links_.end()) return false;
+    outboxes_.find(peer)->second.push(frame);
+    return true;
+}
 
+void MapProtocol::flush_outboxes() {
+    for (std::map<int, Outbox>::iterator it = outboxes_.begin();
+         it != outboxes_.end(); ++it) {
+        if (!it->second.empty()) flush_outbox(it->first);
+    }
+}
 
-        if (static_cast<int>(links_.size()) < expected_links) {
-            std::cerr << "[!] Node " << id_ << " missing connections to: ";
-            for (int nb : cfg_.neighbors[id_]) {
-                if (links_.find(nb) == links_.end()) {
-                    std::cerr << nb << " ";
-                }
+void MapProtocol::flush_outbox(int peer) {
+    // every frame was queued under m_, so sending them in queue order from
+    // one thread at a time keeps the order they were queued in. A thread
+    // that finds the link busy leaves its frames to the sender, which
+    // checks the queue again after letting go of send_m.
+    Outbox& ob = outboxes_.find(peer)->second;
+    SCTPSocket& link = links_.find(peer)->second;
+    bool failed = false;
+    std::string frame;
+    while (!ob.empty() && ob.send_m.try_lock()) {
+        while (ob.pop(frame)) {
+            bool sent;
+            {
+                TRACE_SCOPE(id_, "send", peer);
+                sent = link.send(frame);
+            }
+            if (sent) {
+                const LinkMetrics& lm = link_metrics_.find(peer)->second;
+                metrics_.add(lm.sent);
+                metrics_.add(lm.sent_bytes, frame.size());
+            } else {
+                std::lock_guard<std::mutex> lk(m_);
+                send_failed(peer, frame);
+                failed = true;
             }
-            std::cerr << "\n";
         }
+        ob.send_m.unlock();
     }
-{
-    std::lock_guard<std::mutex> lk(m_);
-    if (static_cast<int>(links_.size()) < expected_links) {
-        std::cerr << "[!] Node " << id_ << " missing connections to: ";
-        for (int nb : cfg_.neighbors[id_]) {
-            if (links_.find(nb) == links_.end()) {
-                std::cerr << nb << " ";
+    // returned credit may have been queued for another link
+    if (failed) flush_outboxes();
+}
+
+void MapProtocol::send_failed(int peer, const std::string& frame) {
+    LOG_EVERY(LEVEL_ERROR, 1000, id_, "{} send to {} failed", id_, peer);
+    long long credit = -1;
+    if (!is_app_message(frame) || !find_app_annotation(frame, "w", credit))
+        return;
+    // the APP frame never left: it is not in transit and its credit comes
+    // back here
+    --app_sent_;
+    termination_mgr_.receive_credit(static_cast<int>(credit));
+    if (!is_active_) {
+        return_credit();
+        check_termination();
+    }
+}
+
+// -------------------- hosted mode --------------------
+void MapProtocol::wake_writer() {
+    // caller holds m_
+    if (host_ == nullptr) {
+        active_cv_.notify_one();
+        return;
+    }
+    if (writer_pending_) return;
+    writer_pending_ = true;
+    host_->schedule(id_, TIMER_WRITER, 0);
+}
+
+int MapProtocol::writer_step() {
+    // writer_loop as a state machine: the same burst, one send per step
+    const NeighborRange nbs = cfg_.neighbors[id_];
+    if (!is_active_ || nbs.empty()) return -1;
+    if (burst_left_ < 0) {
+        std::uniform_int_distribution<int> burst(cfg_.minPerActive,
+                                                 cfg_.maxPerActive);
+        burst_left_ = burst(rng_);
+    }
+    if (burst_left_ > 0 && messages_sent_ < cfg_.maxNumber) {
+        std::uniform_int_distribution<size_t> pick(0, nbs.size() - 1);
+        send_app(nbs[pick(rng_)]);
+        --burst_left_;
+        return cfg_.minSendDelay_ms;
+    }
+    burst_left_ = -1;
+    is_active_ = false;
+    quiet_wall_ns_ = ShutdownSignal::wall_ns();
+    TRACE_INSTANT(id_, "passive", messages_sent_);
+    PROBE3(state, id_, 0, messages_sent_);
+    return_credit();
+    check_termination();
+    return -1;
+}
+
+void MapProtocol::on_timer(int timer) {
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        if (shutdown_.triggered()) return;
+        if (timer == TIMER_SNAPSHOT) {
+            snapshot_tick();
+            host_->schedule(id_, TIMER_SNAPSHOT, cfg_.snapshotDelay_ms);
+        } else {
+            writer_pending_ = false;
+            const int delay = writer_step();
+            if (delay >= 0 && !shutdown_.triggered()) {
+                writer_pending_ = true;
+                host_->schedule(id_, TIMER_WRITER, delay);
             }
         }
-        std::cerr << "\n";
     }
+    flush_outboxes();
 }
+
+void MapProtocol::start() {
+    // only links that leave the process need sockets
+    for (int nb : cfg_.neighbors[id_]) {
+        if (!in_process(nb)) {
+            establish_connections();
+            break;
+        }
+    }
+    for (int nb : cfg_.neighbors[id_]) {
+        if (in_process(nb) || links_.find(nb) != links_.end())
+            peers_.push_back(nb);
+    }
+    begin_computation();
+    if (shutdown_.triggered()) return;
+
+    for (std::map<int, SCTPSocket>::iterator it = links_.begin();
+         it != links_.end(); ++it) {
+        receivers_.push_back(
+            std::thread(&MapProtocol::receive_loop, this, it->first));
+    }
+    std::lock_guard<std::mutex> lk(m_);
+    if (is_active_) wake_writer();
+    if (id_ == 0 && cfg_.snapshotDelay_ms > 0)
+        host_->schedule(id_, TIMER_SNAPSHOT, cfg_.snapshotDelay_ms);
 }
 
-// -------------------- output --------------------
-void MapProtocol::record_initial_snapshot() {
+void MapProtocol::finish() {
+    shutdown_.trigger();      // the host may stop before this node halted
+    shutdown_threads();
+    report_snapshot_stalls();
+    write_halt_record();
+    write_latency_report();
+}
+
+// -------------------- shutdown --------------------
+void MapProtocol::stop() {
+    shutdown_.trigger();
+}
+
+int64_t MapProtocol::exit_latency_us() const {
+    return exit_latency_us_.load();
+}
+
+void MapProtocol::shutdown_threads() {
+    metrics_.drop_probes(this);        // they read the links closed below
+
+    // the writer sleeps on a condition variable, which eventfd cannot reach
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        active_cv_.notify_all();
+    }
+    if (writer_.joinable()) writer_.join();
+    if (snapshot_thread_.joinable()) snapshot_thread_.join();
+    for (size_t i = 0; i < receivers_.size(); ++i) {
+        if (receivers_[i].joinable()) receivers_[i].join();
+    }
+    receivers_.clear();
+
+    // HALT and returned credit queued by the last frames handled
+    flush_outboxes();
     std::lock_guard<std::mutex> lk(m_);
-    snapshot_mgr_.record_snapshot(vc_); // writes logs/<config>-<id>.out
+    for (std::map<int, SCTPSocket>::iterator it = links_.begin();
+         it != links_.end(); ++it) {
+        it->second.close();
+    }
+    listen_sock_.close();
+}
+
+void MapProtocol::report_snapshot_stalls() {
+    snapshot_mgr_.flush();
+    const SnapshotStallStats& st = snapshot_mgr_.stall_stats();
+    LOG_INFO(id_, "Node {} snapshot stall: {} records, avg {} ns, max {} ns "
+                  "({}, {} commits)",
+             id_, st.records, st.records ? st.total_ns / st.records : 0,
+             st.max_ns, opts_.snapshot_writer.async ? "async" : "sync",
+             snapshot_mgr_.writer().commits());
+    LOG_INFO(id_, "Node {} sent {} {} and {} STATE messages for {} snapshots "
+                  "({})",
+             id_, control_sent_,
+             opts_.snapshot_mode == SNAPSHOT_PIGGYBACK ? "EPOCH" : "MARKER",
+             collector_.sent(), snapshot_mgr_.completed(),
+             collector_.mode() == COLLECT_TREE ? "tree" : "flood");
+    LOG_INFO(id_, "Node {} returned credit {} times, holds weight {}", id_,
+             termination_mgr_.returned(), termination_mgr_.weight());
 }
 
 // -------------------- run --------------------
-void MapProtocol::run() {
-    establish_connections();
+void MapProtocol::begin_computation() {
     initialize_state();
+    {
+        const SpanningTree& t = collector_.tree();
+        LOG_INFO(id_, "Node {} tree parent {}, depth {}, {} children", id_,
+                 t.parent[id_], t.depth[id_], t.children[id_].size());
+    }
     record_initial_snapshot();
+    snapshot_mgr_.set_channels(peers_);
+
+    const std::string node = "node=\"" + std::to_string(id_) + "\"";
+    for (std::map<int, SCTPSocket>::iterator it = links_.begin();
+         it != links_.end(); ++it) {
+        metrics_.probe("map_link_send_queue_chunks",
+                       node + ",peer=\"" + std::to_string(it->first) + "\"",
+                       "DATA chunks queued or unacknowledged on the SCTP "
+                       "association", &MapProtocol::probe_send_queue, this,
+                       it->first);
+    }
+}
+
+void MapProtocol::run() {
+    // log lines are written by a background thread for the whole run
+    Logger::set_level(opts_.log_level);
+    Logger::global().start(opts_.log_binary
+                               ? snapshot_mgr_.base_path() + ".log.bin"
+                               : "");
+    if (opts_.trace)
+        Tracer::global().start(snapshot_mgr_.base_path() + ".trace");
+
+    // live counters for the whole run, dumped next to the other logs on exit
+    MetricsServer metrics_server(metrics_);
+    if (opts_.metrics_socket != "off") {
+        metrics_server.start(opts_.metrics_socket.empty()
+                                 ? snapshot_mgr_.base_path() + ".metrics.sock"
+                                 : opts_.metrics_socket);
+    }
 
-    // Keep alive so launcher captures stdout/stderr to logs/
-    while (!stop_.load()) {
-        std::this_thread::sleep_for(std::chrono::seconds(5));
+    // launched by ds/tools/launch: report in, and once the links are up
+    // wait for the driver to start every node at the same instant
+    ControlClient control;
+    const bool controlled = !opts_.control.empty() &&
+                            control.connect(opts_.control) &&
+                            control.report_up(id_);
+    const int64_t setup_ns = ShutdownSignal::now_ns();
+    establish_connections();
+    if (controlled) {
+        control.report_ready(id_, static_cast<int>(links_.size()),
+                             static_cast<int>(cfg_.neighbors[id_].size()),
+                             (ShutdownSignal::now_ns() - setup_ns) / 1000);
+        control.wait_go(shutdown_);
+    }
+    for (std::map<int, SCTPSocket>::iterator it = links_.begin();
+         it != links_.end(); ++it) {
+        peers_.push_back(it->first);
+    }
+    begin_computation();
+
+    if (!shutdown_.triggered()) {
+        for (size_t i = 0; i < peers_.size(); ++i) {
+            receivers_.push_back(
+                std::thread(&MapProtocol::receive_loop, this, peers_[i]));
+        }
+        writer_ = std::thread(&MapProtocol::writer_loop, this);
+        if (id_ == 0 && cfg_.snapshotDelay_ms > 0) {
+            snapshot_thread_ = std::thread(&MapProtocol::snapshot_loop, this);
+        }
     }
+
+    // Block until stop(); every thread watches the same eventfd
+    shutdown_.wait_for(-1);
+    shutdown_threads();
+    report_snapshot_stalls();       // flushes the snapshot writer
+    write_halt_record();
+    write_latency_report();
+    metrics_server.stop();
+    metrics_.dump(snapshot_mgr_.base_path() +
+                      (opts_.metrics_json ? ".metrics.json" : ".metrics"),
+                  opts_.metrics_json);
+
+    const int64_t us =
+        (ShutdownSignal::now_ns() - shutdown_.triggered_at_ns()) / 1000;
+    exit_latency_us_.store(us);
+    LOG_INFO(id_, "Node {} shut down in {} us", id_, us);
+    Tracer::global().stop();
+    Logger::global().stop();
 }
@@ -0,0 +1,339 @@
+/****************************************************************************
+ * file: metrics.cpp
+ * author: luke le
+ * description:
+ *     implements the metrics registry and its Unix-domain socket exporter.
+ ****************************************************************************/
+#include "metrics.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+thread_local Metrics::ThreadCache Metrics::tls_ = {0, nullptr};
+
+namespace {
+
+    std::atomic<uint64_t> g_next_serial(1);
+
+    // how long a client may take to ask for JSON before it gets text
+    const int kRequestWaitMs = 100;
+
+    const char *type_name(MetricType t) {
+        return t == METRIC_COUNTER ? "counter" : "gauge";
+    } // type_name()
+
+    // `node="3",peer="5"` -> {"node":"3","peer":"5"}; the values are
+    // already quoted and only carry ids and names, so they need no escaping
+    std::string labels_json(const std::string &labels) {
+        std::string out = "{";
+        size_t i = 0;
+        while (i < labels.size()) {
+            const size_t eq = labels.find('=', i);
+            if (eq == std::string::npos || eq + 1 >= labels.size()) break;
+            const size_t close = labels.find('"', eq + 2);
+            if (close == std::string::npos) break;
+            if (out.size() > 1) out += ",";
+            out += "\"" + labels.substr(i, eq - i) + "\":" +
+                   labels.substr(eq + 1, close - eq);
+            i = close + 2;                 // past the quote and the comma
+        }
+        return out + "}";
+    } // labels_json()
+
+    std::string json_escape(const std::string &s) {
+        std::string out;
+        for (size_t i = 0; i < s.size(); ++i) {
+            if (s[i] == '"' || s[i] == '\\') out += '\\';
+            out += s[i];
+        }
+        return out;
+    } // json_escape()
+
+} // end anonymous namespace
+
+// -------------------- registry --------------------
+Metrics &Metrics::global() {
+    static Metrics registry;
+    return registry;
+} // global()
+
+Metrics::Metrics()
+    : serial_(g_next_serial.fetch_add(1)), full_reported_(false) {
+    for (int i = 0; i < kChunks; ++i) gauges_[i].store(nullptr);
+    // id 0 is the sink that absorbs updates once the registry is full
+    add_metric("", "", "", METRIC_COUNTER, nullptr, nullptr, 0);
+} // Metrics()
+
+Metrics::~Metrics() {
+    for (std::map<std::thread::id, Block *>::iterator it = blocks_.begin();
+         it != blocks_.end(); ++it) {
+        for (int i = 0; i < kChunks; ++i) delete[] it->second->chunks[i].load();
+        delete it->second;
+    }
+    for (int i = 0; i < kChunks; ++i) delete[] gauges_[i].load();
+} // ~Metrics()
+
+int Metrics::add_metric(const std::string &name, const std::string &labels,
+                        const std::string &help, MetricType type,
+                        MetricProbe fn, void *ctx, int arg) {
+    std::lock_guard<std::mutex> lk(m_);
+    const std::string key = name + "{" + labels + "}";
+    std::map<std::string, int>::iterator found = by_key_.find(key);
+    if (found != by_key_.end()) {
+        Desc &d = descs_[found->second];
+        if (type == METRIC_PROBE) {            // re-attach to a new owner
+            d.fn = fn;
+            d.ctx = ctx;
+            d.arg = arg;
+        }
+        return found->second;
+    }
+    if (descs_.size() >= static_cast<size_t>(kMaxMetrics)) {
+        if (!full_reported_)
+            std::cerr << "[~] metrics registry full; " << key
+                      << " and later metrics are not exported\n";
+        full_reported_ = true;
+        return 0;
+    }
+
+    const int id = static_cast<int>(descs_.size());
+    if (gauges_[id / kChunk].load() == nullptr)
+        gauges_[id / kChunk].store(new std::atomic<int64_t>[kChunk]());
+    gauge_cell(id).store(0);
+
+    Desc d;
+    d.name = name;
+    d.labels = labels;
+    d.type = type;
+    d.fn = fn;
+    d.ctx = ctx;
+    d.arg = arg;
+    descs_.push_back(d);
+    by_key_[key] = id;
+    if (!help_.count(name)) help_[name] = help;
+    return id;
+} // add_metric()
+
+int Metrics::counter(const std::string &name, const std::string &labels,
+                     const std::string &help) {
+    return add_metric(name, labels, help, METRIC_COUNTER, nullptr, nullptr, 0);
+} // counter()
+
+int Metrics::gauge(const std::string &name, const std::string &labels,
+                   const std::string &help) {
+    return add_metric(name, labels, help, METRIC_GAUGE, nullptr, nullptr, 0);
+} // gauge()
+
+int Metrics::probe(const std::string &name, const std::string &labels,
+                   const std::string &help, MetricProbe fn, void *ctx,
+                   int arg) {
+    return add_metric(name, labels, help, METRIC_PROBE, fn, ctx, arg);
+} // probe()
+
+void Metrics::drop_probes(void *ctx) {
+    std::lock_guard<std::mutex> lk(m_);
+    for (size_t i = 0; i < descs_.size(); ++i) {
+        if (descs_[i].type == METRIC_PROBE && descs_[i].ctx == ctx) {
+            descs_[i].fn = nullptr;
+            descs_[i].ctx = nullptr;
+        }
+    }
+} // drop_probes()
+
+Metrics::Block *Metrics::thread_block() {
+    // first update from this thread in this registry: find or make its
+    // block (a thread id reused after an exit takes over the old block)
+    std::lock_guard<std::mutex> lk(m_);
+    Block *&b = blocks_[std::this_thread::get_id()];
+    if (b == nullptr) {
+        b = new Block;
+        for (int i = 0; i < kChunks; ++i) b->chunks[i].store(nullptr);
+    }
+    tls_.serial = serial_;
+    tls_.block = b;
+    return b;
+} // thread_block()
+
+std::atomic<uint64_t> *Metrics::new_chunk(Block *b, int chunk) {
+    std::atomic<uint64_t> *c = new std::atomic<uint64_t>[kChunk]();
+    b->chunks[chunk].store(c, std::memory_order_release);
+    return c;
+} // new_chunk()
+
+int64_t Metrics::value_locked(int id) const {
+    const Desc &d = descs_[id];
+    if (d.type == METRIC_GAUGE) return gauge_cell(id).load();
+    if (d.type == METRIC_PROBE) {
+        if (d.fn == nullptr) return -1;
+        const int64_t v = d.fn(d.ctx, d.arg);
+        return v < 0 ? -1 : v;
+    }
+    uint64_t sum = 0;
+    for (std::map<std::thread::id, Block *>::const_iterator it =
+             blocks_.begin();
+         it != blocks_.end(); ++it) {
+        const std::atomic<uint64_t> *c =
+            it->second->chunks[id / kChunk].load(std::memory_order_acquire);
+        if (c) sum += c[id & (kChunk - 1)].load(std::memory_order_relaxed);
+    }
+    return static_cast<int64_t>(sum);
+} // value_locked()
+
+int64_t Metrics::value(int id) const {
+    std::lock_guard<std::mutex> lk(m_);
+    if (id <= 0 || static_cast<size_t>(id) >= descs_.size()) return 0;
+    return value_locked(id);
+} // value()
+
+size_t Metrics::size() const {
+    std::lock_guard<std::mutex> lk(m_);
+    return descs_.size() - 1;
+} // size()
+
+std::string Metrics::prometheus() const {
+    std::lock_guard<std::mutex> lk(m_);
+    // a family's samples must be contiguous: group by name, in the order
+    // the names were first registered
+    std::vector<std::string> order;
+    std::map<std::string, std::vector<int> > family;
+    for (size_t i = 1; i < descs_.size(); ++i) {
+        std::vector<int> &ids = family[descs_[i].name];
+        if (ids.empty()) order.push_back(descs_[i].name);
+        ids.push_back(static_cast<int>(i));
+    }
+
+    std::ostringstream out;
+    for (size_t f = 0; f < order.size(); ++f) {
+        const std::vector<int> &ids = family[order[f]];
+        const std::map<std::string, std::string>::const_iterator help =
+            help_.find(order[f]);
+        if (help != help_.end() && !help->second.empty())
+            out << "# HELP " << order[f] << " " << help->second << "\n";
+        out << "# TYPE " << order[f] << " "
+            << type_name(descs_[ids[0]].type) << "\n";
+        for (size_t k = 0; k < ids.size(); ++k) {
+            const Desc &d = descs_[ids[k]];
+            out << d.name;
+            if (!d.labels.empty()) out << "{" << d.labels << "}";
+            out << " " << value_locked(ids[k]) << "\n";
+        }
+    }
+    return out.str();
+} // prometheus()
+
+std::string Metrics::json() const {
+    std::lock_guard<std::mutex> lk(m_);
+    std::ostringstream out;
+    out << "{\"metrics\":[";
+    for (size_t i = 1; i < descs_.size(); ++i) {
+        const Desc &d = descs_[i];
+        out << (i > 1 ? ",\n" : "\n") << "{\"name\":\"" << json_escape(d.name)
+            << "\",\"labels\":" << labels_json(d.labels) << ",\"type\":\""
+            << type_name(d.type) << "\",\"value\":"
+            << value_locked(static_cast<int>(i)) << "}";
+    }
+    out << "\n]}\n";
+    return out.str();
+} // json()
+
+bool Metrics::dump(const std::string &path, bool as_json) const {
+    std::ofstream out(path.c_str(), std::ios::trunc);
+    out << (as_json ? json() : prometheus());
+    out.close();
+    if (!out) {
+        std::cerr << "[!] cannot write metrics to " << path << "\n";
+        return false;
+    }
+    return true;
+} // dump()
+
+// -------------------- exporter --------------------
+MetricsServer::MetricsServer(const Metrics &metrics)
+    : metrics_(metrics), fd_(-1) {}
+
+MetricsServer::~MetricsServer() {
+    stop();
+} // ~MetricsServer()
+
+bool MetricsServer::start(const std::string &path) {
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "[!] metrics socket path too long (max "
+                  << sizeof(addr.sun_path) - 1 << "): " << path << "\n";
+        return false;
+    }
+    // a socket left by a node that crashed is replaced, anything else kept
+    struct stat st;
+    if (::lstat(path.c_str(), &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            std::cerr << "[!] metrics socket path exists and is not a "
+                      << "socket: " << path << "\n";
+            return false;
+        }
+        ::unlink(path.c_str());
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size());
+
+    fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd_ < 0 ||
+        ::bind(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+        ::listen(fd_, 16) != 0) {
+        std::cerr << "[!] metrics socket " << path << ": "
+                  << std::strerror(errno) << "\n";
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    path_ = path;
+    thread_ = std::thread(&MetricsServer::serve, this);
+    return true;
+} // start()
+
+void MetricsServer::stop() {
+    stop_.trigger();
+    if (thread_.joinable()) thread_.join();
+    if (fd_ >= 0) {
+        ::close(fd_);
+        ::unlink(path_.c_str());
+    }
+    fd_ = -1;
+} // stop()
+
+void MetricsServer::serve() {
+    while (stop_.wait_readable(fd_, -1) == ShutdownSignal::WAIT_READY) {
+        const int client = ::accept(fd_, nullptr, nullptr);
+        if (client < 0) continue;
+        answer(client);
+        ::close(client);
+    }
+} // serve()
+
+void MetricsServer::answer(int client) {
+    bool as_json = false;
+    if (stop_.wait_readable(client, kRequestWaitMs) ==
+        ShutdownSignal::WAIT_READY) {
+        char req[64];
+        const ssize_t n = ::recv(client, req, sizeof(req) - 1, MSG_DONTWAIT);
+        as_json = n >= 4 && std::strncmp(req, "json", 4) == 0;
+    }
+    const std::string body = as_json ? metrics_.json() : metrics_.prometheus();
+    size_t off = 0;
+    while (off < body.size()) {
+        const ssize_t n = ::send(client, body.data() + off, body.size() - off,
+                                 MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        off += static_cast<size_t>(n);
+    }
+} // answer()
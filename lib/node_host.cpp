@@ -0,0 +1,309 @@
+/****************************************************************************
+ * file: node_host.cpp
+ * author: luke le
+ * description:
+ *     implements NodeHost: mailboxes, the worker pool and the timer thread
+ *     that run many MapProtocol state machines in one process.
+ ****************************************************************************/
+#include "node_host.hpp"
+#include "control_channel.hpp"
+#include "logger.hpp"
+#include "map_protocol.hpp"
+#include "metrics.hpp"
+#include "trace.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <sys/resource.h>
+
+namespace {
+
+    // events a worker handles for one node before moving on, so a node
+    // with a long backlog cannot starve the others
+    const int kBatch = 64;
+
+    /**
+     * @brief every node keeps an eventfd and its snapshot file open, so
+     *        the default 1024 descriptors run out at a few hundred nodes
+     */
+    void raise_fd_limit(size_t nodes) {
+        struct rlimit rl;
+        if (::getrlimit(RLIMIT_NOFILE, &rl) != 0) return;
+        const rlim_t want = static_cast<rlim_t>(nodes) * 4 + 64;
+        if (rl.rlim_cur >= want) return;
+        rl.rlim_cur = rl.rlim_max != RLIM_INFINITY && rl.rlim_max < want
+                          ? rl.rlim_max
+                          : want;
+        if (::setrlimit(RLIMIT_NOFILE, &rl) != 0 || rl.rlim_cur < want)
+            std::cerr << "[~] open file limit " << rl.rlim_cur
+                      << " may be too low for " << nodes << " nodes\n";
+    } // raise_fd_limit()
+
+    int default_workers(int workers) {
+        if (workers > 0) return workers;
+        const int cores = static_cast<int>(std::thread::hardware_concurrency());
+        return cores > 0 ? cores : 1;
+    } // default_workers()
+
+} // end anonymous namespace
+
+NodeHost::NodeHost(const Config &cfg, const std::vector<int> &ids,
+                   const Options &opts, int workers)
+    : cfg_(cfg),
+      ids_(ids),
+      opts_(opts),
+      workers_(default_workers(workers)),
+      hosted_(cfg.n, 0),
+      nodes_(cfg.n),
+      boxes_(cfg.n),
+      stopping_(false),
+      halted_(0),
+      frames_(0) {
+    opts_.snapshot_writer.async = false;     // no writer thread per node
+} // NodeHost()
+
+NodeHost::~NodeHost() {
+    Metrics::global().drop_probes(this);
+    stopping_.store(true);
+    {
+        std::lock_guard<std::mutex> lk(ready_m_);
+        ready_cv_.notify_all();
+    }
+    {
+        std::lock_guard<std::mutex> lk(timer_m_);
+        timer_cv_.notify_all();
+    }
+    for (size_t i = 0; i < threads_.size(); ++i)
+        if (threads_[i].joinable()) threads_[i].join();
+} // ~NodeHost()
+
+void NodeHost::stop() {
+    shutdown_.trigger();
+} // stop()
+
+void NodeHost::push(int node, Event &ev) {
+    Mailbox &box = *boxes_[node];
+    {
+        std::lock_guard<std::mutex> lk(box.m);
+        box.events.push_back(std::move(ev));
+        if (box.queued) return;
+        box.queued = true;
+    }
+    std::lock_guard<std::mutex> lk(ready_m_);
+    ready_.push_back(node);
+    ready_cv_.notify_one();
+} // push()
+
+void NodeHost::post(int from, int to, const std::string &frame) {
+    if (!hosts(to)) {
+        LOG_EVERY(LEVEL_ERROR, 1000, from, "frame from {} to {}, which is "
+                                            "not hosted here", from, to);
+        return;
+    }
+    Event ev;
+    ev.from = from;
+    ev.timer = -1;
+    ev.frame = frame;
+    push(to, ev);
+    if (hosts(from)) frames_.fetch_add(1, std::memory_order_relaxed);
+} // post()
+
+int64_t NodeHost::probe_inbox(void *self, int node) {
+    Mailbox &box = *static_cast<NodeHost *>(self)->boxes_[node];
+    std::lock_guard<std::mutex> lk(box.m);
+    return static_cast<int64_t>(box.events.size());
+} // probe_inbox()
+
+void NodeHost::schedule(int node, int timer, int delay_ms) {
+    Timer t;
+    t.due_ns = ShutdownSignal::now_ns() +
+               static_cast<int64_t>(delay_ms) * 1000000;
+    t.node = node;
+    t.timer = timer;
+    std::lock_guard<std::mutex> lk(timer_m_);
+    const bool earliest = timers_.empty() || t.due_ns < timers_.top().due_ns;
+    timers_.push(t);
+    if (earliest) timer_cv_.notify_one();
+} // schedule()
+
+void NodeHost::timer_loop() {
+    std::unique_lock<std::mutex> lk(timer_m_);
+    while (!stopping_.load()) {
+        if (timers_.empty()) {
+            timer_cv_.wait(lk);
+            continue;
+        }
+        const int64_t wait_ns = timers_.top().due_ns - ShutdownSignal::now_ns();
+        if (wait_ns > 0) {
+            timer_cv_.wait_for(lk, std::chrono::nanoseconds(wait_ns));
+            continue;
+        }
+        const Timer t = timers_.top();
+        timers_.pop();
+
+        // push() takes the mailbox lock; never hold timer_m_ across it
+        lk.unlock();
+        Event ev;
+        ev.from = -1;
+        ev.timer = t.timer;
+        push(t.node, ev);
+        lk.lock();
+    }
+} // timer_loop()
+
+void NodeHost::drain(int node) {
+    Mailbox &box = *boxes_[node];
+    MapProtocol &proto = *nodes_[node];
+
+    for (int k = 0; k < kBatch; ++k) {
+        Event ev;
+        {
+            std::lock_guard<std::mutex> lk(box.m);
+            if (box.events.empty()) {
+                box.queued = false;
+                return;
+            }
+            ev = std::move(box.events.front());
+            box.events.pop_front();
+        }
+        if (ev.from >= 0) proto.deliver(ev.from, ev.frame);
+        else proto.on_timer(ev.timer);
+
+        if (!box.done && proto.stopped()) {
+            box.done = true;
+            if (halted_.fetch_add(1) + 1 == static_cast<int>(ids_.size()))
+                shutdown_.trigger();
+        }
+    }
+
+    // batch used up: back of the queue, still marked queued
+    std::lock_guard<std::mutex> lk(ready_m_);
+    ready_.push_back(node);
+    ready_cv_.notify_one();
+} // drain()
+
+void NodeHost::worker_loop() {
+    for (;;) {
+        int node = -1;
+        {
+            std::unique_lock<std::mutex> lk(ready_m_);
+            while (ready_.empty() && !stopping_.load()) ready_cv_.wait(lk);
+            if (stopping_.load()) return;
+            node = ready_.front();
+            ready_.pop_front();
+        }
+        drain(node);
+    }
+} // worker_loop()
+
+void NodeHost::start_nodes() {
+    // a node with neighbors in other processes blocks in its connection
+    // setup until they come up, so those start side by side
+    std::vector<std::thread> setup;
+    for (size_t i = 0; i < ids_.size(); ++i) {
+        const int id = ids_[i];
+        bool remote = false;
+        for (int nb : cfg_.neighbors[id]) remote = remote || !hosts(nb);
+        if (remote)
+            setup.push_back(std::thread(&MapProtocol::start, nodes_[id].get()));
+        else
+            nodes_[id]->start();
+    }
+    for (size_t i = 0; i < setup.size(); ++i) setup[i].join();
+} // start_nodes()
+
+bool NodeHost::run() {
+    for (size_t i = 0; i < ids_.size(); ++i) {
+        const int id = ids_[i];
+        if (id < 0 || id >= cfg_.n) {
+            std::cerr << "[!] node " << id << " is not in the config (n = "
+                      << cfg_.n << ")\n";
+            return false;
+        }
+        if (hosted_[id]) {
+            std::cerr << "[!] node " << id << " listed twice\n";
+            return false;
+        }
+        hosted_[id] = 1;
+    }
+    if (ids_.empty()) return false;
+
+    raise_fd_limit(ids_.size());
+    std::shared_ptr<SpanningTree> tree(new SpanningTree());
+    build_spanning_tree(cfg_, 0, *tree);
+    tree_ = tree;
+
+    Metrics &metrics = Metrics::global();
+    for (size_t i = 0; i < ids_.size(); ++i) {
+        const int id = ids_[i];
+        boxes_[id].reset(new Mailbox());
+        nodes_[id].reset(new MapProtocol(cfg_, id, opts_, this));
+        metrics.probe("map_inbox_depth",
+                      "node=\"" + std::to_string(id) + "\"",
+                      "hosted: frames and timer events waiting for the node",
+                      &NodeHost::probe_inbox, this, id);
+    }
+    // one log, registry, socket and dump for the whole process
+    const std::string base = "logs/" + cfg_.config_name + "-host-" +
+                             std::to_string(ids_.front());
+    Logger::set_level(opts_.log_level);
+    Logger::global().start(opts_.log_binary ? base + ".log.bin" : "");
+    if (opts_.trace) Tracer::global().start(base + ".trace");
+    MetricsServer metrics_server(metrics);
+    if (opts_.metrics_socket != "off") {
+        metrics_server.start(opts_.metrics_socket.empty()
+                                 ? base + ".metrics.sock"
+                                 : opts_.metrics_socket);
+    }
+    LOG_INFO(-1, "hosting {} of {} nodes on {} workers", ids_.size(), cfg_.n,
+             workers_);
+
+    // the launch driver's barrier covers the whole process: every hosted
+    // node reports, and the workers only start once GO arrives
+    ControlClient control;
+    bool controlled = !opts_.control.empty() && control.connect(opts_.control);
+    for (size_t i = 0; controlled && i < ids_.size(); ++i)
+        controlled = control.report_up(ids_[i]);
+
+    const int64_t t0 = ShutdownSignal::now_ns();
+    start_nodes();
+    if (controlled) {
+        const int64_t setup_us = (ShutdownSignal::now_ns() - t0) / 1000;
+        for (size_t i = 0; i < ids_.size(); ++i) {
+            const int id = ids_[i];
+            control.report_ready(id, static_cast<int>(nodes_[id]->channels()),
+                                 static_cast<int>(cfg_.neighbors[id].size()),
+                                 setup_us);
+        }
+        control.wait_go(shutdown_);
+    }
+    threads_.push_back(std::thread(&NodeHost::timer_loop, this));
+    for (int w = 0; w < workers_; ++w)
+        threads_.push_back(std::thread(&NodeHost::worker_loop, this));
+
+    // every hosted node halted, or SIGINT/SIGTERM
+    shutdown_.wait_for(-1);
+    const int64_t ms = (ShutdownSignal::now_ns() - t0) / 1000000;
+    stopping_.store(true);
+    {
+        std::lock_guard<std::mutex> lk(ready_m_);
+        ready_cv_.notify_all();
+    }
+    {
+        std::lock_guard<std::mutex> lk(timer_m_);
+        timer_cv_.notify_all();
+    }
+    for (size_t i = 0; i < threads_.size(); ++i) threads_[i].join();
+    threads_.clear();
+
+    for (size_t i = 0; i < ids_.size(); ++i) nodes_[ids_[i]]->finish();
+    metrics_server.stop();
+    metrics.drop_probes(this);
+    metrics.dump(base + (opts_.metrics_json ? ".metrics.json" : ".metrics"),
+                 opts_.metrics_json);
+    LOG_INFO(-1, "host: {}/{} nodes halted after {} ms, {} frames passed in "
+                 "memory", halted_.load(), ids_.size(), ms, frames_.load());
+    Tracer::global().stop();
+    Logger::global().stop();
+    return true;
+} // run()
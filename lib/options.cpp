@@ -0,0 +1,177 @@
+/****************************************************************************
+ * file: options.cpp
+ * author: luke le
+ * description:
+ *     implements command-line option parsing for proj1.
+ ****************************************************************************/
+#include "options.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+namespace {
+
+    /**
+     * @brief match "--name=value" and return a pointer to value
+     *
+     * @param arg argument to test
+     * @param name flag name including the leading dashes
+     * @return pointer into arg after '=', or nullptr if arg is not name=
+     */
+    const char *value_of(const char *arg, const char *name) {
+        size_t len = strlen(name);
+        if (strncmp(arg, name, len) != 0 || arg[len] != '=') return nullptr;
+        return arg + len + 1;
+    } // value_of()
+
+    /**
+     * @brief parse a non-negative integer option value
+     *
+     * @param s text to parse
+     * @param out parsed value
+     * @return true if s was a complete non-negative integer
+     */
+    bool parse_count(const char *s, long &out) {
+        char *end = nullptr;
+        out = strtol(s, &end, 10);
+        return *s != '\0' && *end == '\0' && out >= 0;
+    } // parse_count()
+
+} // end anonymous namespace
+
+bool parse_options(int argc, char *argv[], int first, Options &opts) {
+    for (int i = first; i < argc; ++i) {
+        const char *arg = argv[i];
+        const char *v = nullptr;
+        long num = 0;
+        bool ok = true;
+
+        if (strcmp(arg, "--sync-snapshots") == 0) {
+            opts.snapshot_writer.async = false;
+        } else if (strcmp(arg, "--fdatasync") == 0) {
+            opts.snapshot_writer.fdatasync = true;
+        } else if (strcmp(arg, "--trace") == 0) {
+            opts.trace = true;
+        } else if (strcmp(arg, "--latency") == 0) {
+            opts.latency = true;
+        } else if ((v = value_of(arg, "--snapshot-batch"))) {
+            ok = parse_count(v, num) && num > 0;
+            if (ok) opts.snapshot_writer.batch = static_cast<size_t>(num);
+        } else if ((v = value_of(arg, "--snapshot-format"))) {
+            ok = strcmp(v, "text") == 0 || strcmp(v, "binary") == 0;
+            if (ok) opts.snapshot_writer.binary = strcmp(v, "binary") == 0;
+        } else if ((v = value_of(arg, "--collect"))) {
+            ok = strcmp(v, "tree") == 0 || strcmp(v, "flood") == 0;
+            if (ok) opts.collect = strcmp(v, "flood") == 0 ? COLLECT_FLOOD
+                                                           : COLLECT_TREE;
+        } else if ((v = value_of(arg, "--snapshot-mode"))) {
+            ok = strcmp(v, "marker") == 0 || strcmp(v, "piggyback") == 0;
+            if (ok) opts.snapshot_mode = strcmp(v, "piggyback") == 0
+                                             ? SNAPSHOT_PIGGYBACK
+                                             : SNAPSHOT_MARKER;
+        } else if ((v = value_of(arg, "--max-snapshots"))) {
+            ok = parse_count(v, num) && num > 0;
+            if (ok) opts.max_snapshots = static_cast<int>(num);
+        } else if ((v = value_of(arg, "--config"))) {
+            ok = *v != '\0';
+            if (ok) opts.config = v;
+        } else if ((v = value_of(arg, "--topology"))) {
+            ok = *v != '\0';
+            if (ok) opts.topology = v;
+        } else if ((v = value_of(arg, "--control"))) {
+            ok = strchr(v, ':') != nullptr;
+            if (ok) opts.control = v;
+        } else if ((v = value_of(arg, "--setup"))) {
+            ok = strcmp(v, "ordered") == 0 || strcmp(v, "both") == 0;
+            if (ok) opts.setup = strcmp(v, "both") == 0 ? SETUP_BOTH
+                                                        : SETUP_ORDERED;
+        } else if ((v = value_of(arg, "--metrics-socket"))) {
+            ok = *v != '\0';
+            if (ok) opts.metrics_socket = v;
+        } else if ((v = value_of(arg, "--metrics-format"))) {
+            ok = strcmp(v, "text") == 0 || strcmp(v, "json") == 0;
+            if (ok) opts.metrics_json = strcmp(v, "json") == 0;
+        } else if ((v = value_of(arg, "--log"))) {
+            ok = strcmp(v, "text") == 0 || strcmp(v, "binary") == 0;
+            if (ok) opts.log_binary = strcmp(v, "binary") == 0;
+        } else if ((v = value_of(arg, "--log-level"))) {
+            ok = parse_log_level(v, opts.log_level);
+        } else if ((v = value_of(arg, "--workers"))) {
+            ok = parse_count(v, num) && num <= 4096;
+            if (ok) opts.workers = static_cast<int>(num);
+        } else if ((v = value_of(arg, "--snapshot-flush-ms"))) {
+            ok = parse_count(v, num);
+            if (ok) opts.snapshot_writer.flush_ms = static_cast<int>(num);
+        } else {
+            ok = false;
+        }
+
+        if (!ok) {
+            cerr << "[!] invalid option: " << arg << "\n";
+            return false;
+        }
+    }
+    return true;
+} // parse_options()
+
+bool parse_node_ids(const std::string &text, std::vector<int> &ids) {
+    const char *p = text.c_str();
+    for (;;) {
+        char *end = nullptr;
+        const long first = strtol(p, &end, 10);
+        if (end == p || first < 0) return false;
+        long last = first;
+        if (*end == '-') {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first) return false;
+        }
+        if (last - first >= 10000000) return false;
+        for (long id = first; id <= last; ++id)
+            ids.push_back(static_cast<int>(id));
+        if (*end == '\0') return true;
+        if (*end != ',') return false;
+        p = end + 1;
+    }
+} // parse_node_ids()
+
+void print_usage(const char *prog) {
+    cerr << "usage: " << prog << " <node_id> [options]\n"
+         << "       " << prog << " <ids> [options]     host several nodes in"
+         << " one process;\n"
+         << "                          ids: all, or a list like 0-99,120\n"
+         << "  --sync-snapshots        write snapshots on the protocol thread\n"
+         << "  --snapshot-batch=N      group-commit after N snapshots (32)\n"
+         << "  --snapshot-flush-ms=N   or N ms after the first pending (50)\n"
+         << "  --fdatasync             fdatasync() after every commit\n"
+         << "  --snapshot-format=F     text (.out, default) or binary (.snap)\n"
+         << "  --collect=M             gather snapshot state over the BFS\n"
+         << "                          tree (default) or by flooding\n"
+         << "  --max-snapshots=N       snapshots that may overlap (4)\n"
+         << "  --snapshot-mode=M       marker (Chandy-Lamport, default) or\n"
+         << "                          piggyback (Lai-Yang, no markers)\n"
+         << "  --config=PATH           read this config file instead of the\n"
+         << "                          one compiled in\n"
+         << "  --topology=PATH         load a compiled topology image instead\n"
+         << "                          of parsing the config file\n"
+         << "  --workers=N             threads for a multi-node process\n"
+         << "                          (one per core)\n"
+         << "  --control=HOST:PORT     report to the launch driver and wait\n"
+         << "                          for its start barrier\n"
+         << "  --setup=M               ordered (lower id dials, default) or\n"
+         << "                          both (each end dials, race resolved)\n"
+         << "  --metrics-socket=PATH   serve metrics here, or off (default\n"
+         << "                          logs/<config>-<id>.metrics.sock)\n"
+         << "  --metrics-format=F      exit dump: text (Prometheus, default)\n"
+         << "                          or json\n"
+         << "  --log=F                 text on stdout/stderr (default) or\n"
+         << "                          binary (logs/<config>-<id>.log.bin)\n"
+         << "  --log-level=L           debug, info (default), warn or error\n"
+         << "  --trace                 record an event timeline to\n"
+         << "                          logs/<config>-<id>.trace\n"
+         << "  --latency               report one-way APP delays per link to\n"
+         << "                          logs/<config>-<id>.latency\n";
+} // print_usage()
@@ -11,6 +11,7 @@
  *     API, while enabling SCTP features like reliable message delivery.
  ****************************************************************************/
 #include "sctp_wrapper.hpp"
+#include "logger.hpp"
 
 #include <arpa/inet.h>
 #include <errno.h>
@@ -35,6 +36,25 @@ SCTPSocket::~SCTPSocket() {
     close();
 } // ~SCTPSocket()
 
+// moving hands the descriptor over and empties the source, otherwise the
+// moved-from temporary would close the fd stored in links_
+SCTPSocket::SCTPSocket(SCTPSocket &&other) : sockfd(other.sockfd) {
+    addr = other.addr;
+    other.sockfd = -1;
+    std::memset(&other.addr, 0, sizeof(other.addr));
+} // SCTPSocket(SCTPSocket&&)
+
+SCTPSocket &SCTPSocket::operator=(SCTPSocket &&other) {
+    if (this != &other) {
+        close();
+        sockfd = other.sockfd;
+        addr = other.addr;
+        other.sockfd = -1;
+        std::memset(&other.addr, 0, sizeof(other.addr));
+    }
+    return *this;
+} // operator=(SCTPSocket&&)
+
 bool SCTPSocket::create() {
     // creates a stream-oriented (SOCK_STREAM) socket bc the internet said to
     // do so. The scoket is configured for IPv4 addresses (AF_INET), as there
@@ -155,7 +175,8 @@ bool SCTPSocket::accept(SCTPSocket &clientSocket) {
     //   connections later
     int clientFd = ::accept(sockfd, (sockaddr*)&clientAddr, &len);
     if (clientFd < 0) {
-        std::cerr << "[!] failed to accept SCTP connection\n";
+        LOG_EVERY(LEVEL_ERROR, 1000, -1, "failed to accept SCTP connection "
+                                          "({})", strerror(errno));
         return false;
     }
 
@@ -170,7 +191,7 @@ bool SCTPSocket::accept(SCTPSocket &clientSocket) {
     return true;
 } // accept()
 
-bool SCTPSocket::connect(const std::string &host, int port) {
+bool SCTPSocket::resolve(const std::string &host, uint32_t &ipv4) {
     // addrinfo is a POSIX structure used for host name resolution
     // (used by getaddrinfo()). 'hints' tells resolver what kind of address
     // to look for. 'res' will hold the results returned by getaddrinfo()
@@ -187,26 +208,37 @@ bool SCTPSocket::connect(const std::string &host, int port) {
         std::cerr << "[!] failed to resolve host: " << host << "\n";
         return false;
     }
-    struct sockaddr_in *ipv4 = (struct sockaddr_in *)res->ai_addr;
+    ipv4 = ((struct sockaddr_in *)res->ai_addr)->sin_addr.s_addr;
+    freeaddrinfo(res);  // frees memory allocated by getaddrinfo()
+    return true;
+} // resolve()
 
+bool SCTPSocket::connect(const std::string &host, int port) {
+    uint32_t ipv4 = 0;
+    return resolve(host, ipv4) && connect(ipv4, port);
+} // connect()
+
+bool SCTPSocket::connect(uint32_t ipv4, int port) {
     // sets `addr` struct to the destination host and port, which is converted
     // to network byte order with htons() so it’s consistent across arch
     addr.sin_family = AF_INET;
-    addr.sin_addr = ipv4->sin_addr;
+    addr.sin_addr.s_addr = ipv4;
     addr.sin_port = htons(port);
 
     // performs the SCTP association handshake with kernel connect()
     bool success = (::connect(sockfd, (sockaddr*)&addr, sizeof(addr)) == 0);
-    if (!success) {
+    // a refused connect is the normal case while the peer is still starting;
+    // callers retry and report a peer that never comes up
+    if (!success && errno != ECONNREFUSED) {
         int err = errno;
-        std::cerr << "[!] failed to connect to " << host << ":" << port
-                  << " (" << strerror(err) << ")\n";
+        char host[INET_ADDRSTRLEN] = "?";
+        inet_ntop(AF_INET, &addr.sin_addr, host, sizeof(host));
+        LOG_EVERY(LEVEL_ERROR, 1000, -1, "failed to connect to {}:{} ({})",
+                  host, port, strerror(err));
         if (err == EPROTONOSUPPORT || err == EAFNOSUPPORT) {
-            std::cerr << "[!] SCTP not supported on this system\n";
+            LOG_ERROR(-1, "SCTP not supported on this system");
         }
     }
-
-    freeaddrinfo(res);  // frees memory allocated by getaddrinfo()
     return success;
 } // connect()
 
@@ -223,7 +255,8 @@ bool SCTPSocket::send(const std::string &message) {
         int ret = sctp_sendmsg(sockfd, data + totalSent, len - totalSent,
                                nullptr, 0, 0, 0, 0, 0, 0);
         if (ret <= 0) {
-            std::perror("sctp_sendmsg");
+            LOG_EVERY(LEVEL_ERROR, 1000, -1, "sctp_sendmsg: {}",
+                      strerror(errno));
             return false;
         }
         totalSent += ret;
@@ -232,36 +265,55 @@ bool SCTPSocket::send(const std::string &message) {
 } // send()
 
 bool SCTPSocket::receive(std::string &message) {
-    char buffer[1024];
-    std::memset(buffer, 0, sizeof(buffer));
-    int flags = 0;
+    char buffer[4096];
     struct sockaddr_in peerAddr;
     socklen_t len = sizeof(peerAddr);
 
-    int ret = sctp_recvmsg(sockfd, buffer, sizeof(buffer),
-                           (sockaddr*)&peerAddr, &len, nullptr, &flags);
-    if (ret < 0) {
-        int err = errno;
-        // TIMEOUT or interrupted: not fatal—just say “no message” this tick.
-        if (err == EAGAIN || err == EWOULDBLOCK || err == EINTR) {
-            message.clear();
-            return true;  // keep socket alive
+    // a message larger than the buffer is delivered in pieces; only the
+    // last one carries MSG_EOR, so keep reading until it does
+    message.clear();
+    for (;;) {
+        int flags = 0;
+        int ret = sctp_recvmsg(sockfd, buffer, sizeof(buffer),
+                               (sockaddr*)&peerAddr, &len, nullptr, &flags);
+        if (ret < 0) {
+            int err = errno;
+            // TIMEOUT or interrupted: not fatal—just say “no message” this
+            // tick, unless part of a message is already in
+            if (err == EAGAIN || err == EWOULDBLOCK || err == EINTR) {
+                if (message.empty()) return true;  // keep socket alive
+                continue;
+            }
+            LOG_EVERY(LEVEL_ERROR, 1000, -1, "sctp_recvmsg: {}", strerror(err));
+            return false;    // real error -> close this socket
         }
-        std::perror("[!] sctp_recvmsg");
-        return false;    // real error -> close this socket
-    }
-    if (ret == 0) {
-        // graceful close by peer
-        return false;
+        if (ret == 0) {
+            // graceful close by peer
+            return false;
+        }
+        message.append(buffer, ret);
+        if (flags & MSG_EOR) return true;
     }
-    message.assign(buffer, ret);
-    return true;
 }
 
 sockaddr_in SCTPSocket::get_peer_addr() const {
     return addr;
 } // get_peer_addr()
 
+int SCTPSocket::get_fd() const {
+    return sockfd;
+} // get_fd()
+
+int SCTPSocket::pending_chunks() const {
+    if (sockfd < 0) return -1;
+    struct sctp_status status;
+    std::memset(&status, 0, sizeof(status));
+    socklen_t len = sizeof(status);
+    if (getsockopt(sockfd, IPPROTO_SCTP, SCTP_STATUS, &status, &len) != 0)
+        return -1;
+    return status.sstat_penddata + status.sstat_unackdata;
+} // pending_chunks()
+
 void SCTPSocket::close() {
     // closees the SCTP socket if open; closes the underlying file descriptor
     // and resets it to -1.
@@ -0,0 +1,101 @@
+/****************************************************************************
+ * file: shutdown_signal.cpp
+ * author: luke le
+ * description:
+ *     implements the eventfd-backed shutdown signal.
+ ****************************************************************************/
+#include "shutdown_signal.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+ShutdownSignal::ShutdownSignal()
+    : efd_(::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+      flag_(false),
+      triggered_ns_(0) {
+    if (efd_ < 0) std::perror("[!] eventfd");
+} // ShutdownSignal()
+
+ShutdownSignal::~ShutdownSignal() {
+    if (efd_ >= 0) ::close(efd_);
+} // ~ShutdownSignal()
+
+void ShutdownSignal::trigger() {
+    bool expected = false;
+    if (!flag_.compare_exchange_strong(expected, true)) return;
+    triggered_ns_.store(now_ns());
+
+    // the counter is never read back, so the eventfd stays readable and
+    // every present and future poll() on it returns at once
+    if (efd_ >= 0) {
+        uint64_t one = 1;
+        ssize_t rc = ::write(efd_, &one, sizeof(one));
+        (void)rc;
+    }
+} // trigger()
+
+bool ShutdownSignal::triggered() const {
+    return flag_.load();
+} // triggered()
+
+bool ShutdownSignal::wait_for(int timeout_ms) const {
+    if (triggered()) return true;
+    if (efd_ < 0) return triggered();
+
+    struct pollfd pfd;
+    pfd.fd = efd_;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    int rc;
+    do {
+        rc = ::poll(&pfd, 1, timeout_ms);
+    } while (rc < 0 && errno == EINTR && !triggered());
+    return triggered();
+} // wait_for()
+
+ShutdownSignal::WaitResult ShutdownSignal::wait_readable(int fd,
+                                                         int timeout_ms) const {
+    if (triggered()) return WAIT_SHUTDOWN;
+
+    struct pollfd pfds[2];
+    pfds[0].fd = fd;
+    pfds[0].events = POLLIN;
+    pfds[0].revents = 0;
+    pfds[1].fd = efd_;          // poll() ignores negative descriptors
+    pfds[1].events = POLLIN;
+    pfds[1].revents = 0;
+
+    int rc;
+    do {
+        rc = ::poll(pfds, 2, timeout_ms);
+    } while (rc < 0 && errno == EINTR && !triggered());
+
+    if (triggered()) return WAIT_SHUTDOWN;
+    if (rc == 0) return WAIT_TIMEOUT;
+    // errors and hangups count as "ready" so the caller's read reports them
+    return WAIT_READY;
+} // wait_readable()
+
+int ShutdownSignal::fd() const {
+    return efd_;
+} // fd()
+
+int64_t ShutdownSignal::triggered_at_ns() const {
+    return triggered_ns_.load();
+} // triggered_at_ns()
+
+int64_t ShutdownSignal::now_ns() {
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+} // now_ns()
+
+int64_t ShutdownSignal::wall_ns() {
+    struct timespec ts;
+    ::clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+} // wall_ns()
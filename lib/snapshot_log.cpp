@@ -0,0 +1,261 @@
+/****************************************************************************
+ * file: snapshot_log.cpp
+ * author: luke le
+ * description:
+ *     implements the binary snapshot log encoder and mmap-based reader.
+ ****************************************************************************/
+#include "snapshot_log.hpp"
+
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+    const char kMagic[8] = {'P', '1', 'S', 'N', 'A', 'P', 'L', 'G'};
+    const char kIndexMagic[4] = {'P', '1', 'I', 'X'};
+    const uint16_t kVersion = 1;
+    const size_t kHeaderSize = 24;
+    const size_t kTrailerSize = 16;     // index offset, count, magic
+    const size_t kIndexEntry = 16;      // ordinal, offset
+
+    // fixed-width little-endian helpers; byte-wise so the format does not
+    // depend on host endianness or alignment
+    void put_le(uint64_t v, int bytes, std::string &out) {
+        for (int i = 0; i < bytes; ++i)
+            out += static_cast<char>((v >> (8 * i)) & 0xff);
+    }
+
+    uint64_t get_le(const unsigned char *p, int bytes) {
+        uint64_t v = 0;
+        for (int i = 0; i < bytes; ++i)
+            v |= static_cast<uint64_t>(p[i]) << (8 * i);
+        return v;
+    }
+
+    // LEB128: 7 bits per byte, high bit set on every byte but the last
+    void put_varint(uint64_t v, std::string &out) {
+        while (v >= 0x80) {
+            out += static_cast<char>((v & 0x7f) | 0x80);
+            v >>= 7;
+        }
+        out += static_cast<char>(v);
+    }
+
+    bool get_varint(const unsigned char *&p, const unsigned char *end,
+                    uint64_t &v) {
+        v = 0;
+        for (int shift = 0; p < end && shift < 64; shift += 7) {
+            unsigned char b = *p++;
+            v |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if (!(b & 0x80)) return true;
+        }
+        return false;
+    }
+
+    // zigzag maps small negative deltas to small unsigned values
+    uint64_t zigzag(int64_t v) {
+        return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+    }
+
+    int64_t unzigzag(uint64_t v) {
+        return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+    }
+
+} // end anonymous namespace
+
+// -------------------- encoder --------------------
+SnapshotLogEncoder::SnapshotLogEncoder(int node_id, int n,
+                                       uint32_t keyframe_interval)
+    : node_id_(node_id),
+      n_(n < 0 ? 0 : n),
+      interval_(keyframe_interval ? keyframe_interval : 1),
+      offset_(0),
+      count_(0),
+      prev_(n_, 0) {
+} // SnapshotLogEncoder()
+
+void SnapshotLogEncoder::header(std::string &out) {
+    out.append(kMagic, sizeof(kMagic));
+    put_le(kVersion, 2, out);
+    put_le(0, 2, out);
+    put_le(static_cast<uint32_t>(node_id_), 4, out);
+    put_le(static_cast<uint32_t>(n_), 4, out);
+    put_le(interval_, 4, out);
+    offset_ += kHeaderSize;
+} // header()
+
+void SnapshotLogEncoder::record(int snapshot_id, const std::vector<int> &vc,
+                                std::string &out) {
+    const bool key = (count_ % interval_) == 0;
+    body_.clear();
+    body_ += static_cast<char>(key ? 1 : 0);
+    put_varint(zigzag(snapshot_id), body_);
+    for (int i = 0; i < n_; ++i) {
+        int64_t v = i < static_cast<int>(vc.size()) ? vc[i] : 0;
+        put_varint(zigzag(key ? v : v - prev_[i]), body_);
+        prev_[i] = static_cast<int>(v);
+    }
+
+    if (key) {
+        index_.push_back(count_);
+        index_.push_back(offset_);
+    }
+    const size_t before = out.size();
+    put_varint(body_.size(), out);
+    out += body_;
+    offset_ += out.size() - before;
+    ++count_;
+} // record()
+
+void SnapshotLogEncoder::footer(std::string &out) {
+    const uint64_t index_offset = offset_;
+    for (size_t i = 0; i < index_.size(); ++i) put_le(index_[i], 8, out);
+    put_le(index_offset, 8, out);
+    put_le(static_cast<uint32_t>(index_.size() / 2), 4, out);
+    out.append(kIndexMagic, sizeof(kIndexMagic));
+    offset_ += index_.size() * 8 + kTrailerSize;
+} // footer()
+
+// -------------------- reader --------------------
+SnapshotReader::SnapshotReader()
+    : base_(nullptr), size_(0), records_begin_(0), records_end_(0),
+      index_(nullptr), index_count_(0), pos_(0), ordinal_(0),
+      node_id_(-1), n_(0), snapshot_id_(-1) {
+} // SnapshotReader()
+
+SnapshotReader::~SnapshotReader() {
+    close();
+} // ~SnapshotReader()
+
+bool SnapshotReader::open(const std::string &path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "[!] cannot open snapshot log: " << path << "\n";
+        return false;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(kHeaderSize)) {
+        std::cerr << "[!] snapshot log too short: " << path << "\n";
+        ::close(fd);
+        return false;
+    }
+    void *m = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);    // the mapping keeps the file alive
+    if (m == MAP_FAILED) {
+        std::perror("[!] mmap(snapshot log)");
+        return false;
+    }
+    base_ = static_cast<const unsigned char *>(m);
+    size_ = static_cast<size_t>(st.st_size);
+
+    if (std::memcmp(base_, kMagic, sizeof(kMagic)) != 0 ||
+        get_le(base_ + 8, 2) != kVersion) {
+        std::cerr << "[!] not a version " << kVersion << " snapshot log: "
+                  << path << "\n";
+        close();
+        return false;
+    }
+    node_id_ = static_cast<int>(get_le(base_ + 12, 4));
+    n_ = static_cast<int>(get_le(base_ + 16, 4));
+    records_begin_ = kHeaderSize;
+    records_end_ = size_;
+
+    // the footer is optional: only trust it if it is self-consistent
+    if (size_ >= kHeaderSize + kTrailerSize &&
+        std::memcmp(base_ + size_ - 4, kIndexMagic, 4) == 0) {
+        uint64_t off = get_le(base_ + size_ - kTrailerSize, 8);
+        uint64_t count = get_le(base_ + size_ - 8, 4);
+        if (off >= kHeaderSize &&
+            off + count * kIndexEntry + kTrailerSize == size_) {
+            records_end_ = static_cast<size_t>(off);
+            index_ = base_ + off;
+            index_count_ = static_cast<uint32_t>(count);
+        }
+    }
+
+    return seek(0) || records_begin_ == records_end_;
+} // open()
+
+void SnapshotReader::close() {
+    if (base_) ::munmap(const_cast<unsigned char *>(base_), size_);
+    base_ = nullptr;
+    index_ = nullptr;
+    size_ = records_begin_ = records_end_ = pos_ = 0;
+    index_count_ = 0;
+    ordinal_ = 0;
+} // close()
+
+bool SnapshotReader::next() {
+    if (!base_ || pos_ >= records_end_) return false;
+    const unsigned char *p = base_ + pos_;
+    const unsigned char *end = base_ + records_end_;
+
+    uint64_t len = 0;
+    if (!get_varint(p, end, len) || len == 0 ||
+        len > static_cast<uint64_t>(end - p))
+        return false;                         // truncated tail after a crash
+    const unsigned char *body_end = p + len;
+
+    const bool key = *p++ == 1;
+    uint64_t v = 0;
+    if (!get_varint(p, body_end, v)) return false;
+    snapshot_id_ = static_cast<int>(unzigzag(v));
+
+    if (static_cast<int>(clock_.size()) != n_) clock_.assign(n_, 0);
+    for (int i = 0; i < n_; ++i) {
+        if (!get_varint(p, body_end, v)) return false;
+        int64_t d = unzigzag(v);
+        clock_[i] = static_cast<int>(key ? d : clock_[i] + d);
+    }
+
+    pos_ = static_cast<size_t>(body_end - base_);
+    ++ordinal_;
+    return true;
+} // next()
+
+bool SnapshotReader::seek(uint64_t ordinal) {
+    if (!base_) return false;
+    pos_ = records_begin_;
+    ordinal_ = 0;
+    clock_.assign(n_, 0);
+
+    // closest keyframe at or before `ordinal` (entries are sorted)
+    if (index_count_ > 0) {
+        uint32_t lo = 0, hi = index_count_;
+        while (hi - lo > 1) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            if (get_le(index_ + mid * kIndexEntry, 8) <= ordinal) lo = mid;
+            else hi = mid;
+        }
+        uint64_t key_ord = get_le(index_ + lo * kIndexEntry, 8);
+        uint64_t key_off = get_le(index_ + lo * kIndexEntry + 8, 8);
+        if (key_ord <= ordinal && key_off >= records_begin_ &&
+            key_off < records_end_) {
+            pos_ = static_cast<size_t>(key_off);
+            ordinal_ = key_ord;
+        }
+    }
+
+    while (ordinal_ < ordinal) {
+        if (!next()) return false;
+    }
+    return pos_ < records_end_;
+} // seek()
+
+uint64_t SnapshotReader::to_text(std::ostream &out) {
+    uint64_t written = 0;
+    while (next()) {
+        for (int i = 0; i < n_; ++i) {
+            if (i) out << ' ';
+            out << clock_[i];
+        }
+        out << '\n';
+        ++written;
+    }
+    return written;
+} // to_text()
@@ -0,0 +1,250 @@
+/****************************************************************************
+ * file: snapshot_manager.cpp
+ * author: luke le
+ * description:
+ *     implements the Chandy-Lamport snapshot engine and .out writer.
+ ****************************************************************************/
+#include "snapshot_manager.hpp"
+#include "logger.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <iostream>
+#include <sys/stat.h>
+
+namespace {
+    // ids below the newest 256 are assumed begun; markers are never that
+    // far out of order
+    const size_t kBegunWindow = 256;
+
+    // the writer opens logs/<...>.out, so logs/ must exist before it does
+    std::string make_base_path(const std::string &config_name, int node_id) {
+        if (::mkdir("logs", 0755) != 0 && errno != EEXIST)
+            std::perror("[!] mkdir(logs)");
+        return "logs/" + config_name + "-" + std::to_string(node_id);
+    }
+} // end anonymous namespace
+
+SnapshotManager::SnapshotManager(int node_id, const std::string &config_name,
+                                 int n, size_t channel_mem_limit,
+                                 const SnapshotWriterOptions &writer_opts,
+                                 int max_instances)
+    : id_(node_id),
+      n_(n),
+      channel_mem_limit_(channel_mem_limit),
+      max_instances_(max_instances > 0 ? max_instances : 1),
+      base_path_(make_base_path(config_name, node_id)),
+      writer_(base_path_ + (writer_opts.binary ? ".snap" : ".out"),
+              writer_opts, node_id, n),
+      recording_(false),
+      begun_floor_(-1),
+      completed_(0) {
+    stall_.records = stall_.total_ns = stall_.max_ns = 0;
+} // SnapshotManager()
+
+void SnapshotManager::record_snapshot(const std::vector<int> &vc,
+                                      int snapshot_id) {
+    if (static_cast<int>(vc.size()) != n_)
+        LOG_ERROR(id_, "{} snapshot clock has {} entries, expected {}", id_,
+                  vc.size(), n_);
+    using namespace std::chrono;
+    const steady_clock::time_point t0 = steady_clock::now();
+
+    SnapshotRecord rec;
+    rec.id = snapshot_id;
+    rec.vc = vc;
+    writer_.submit(rec);
+
+    const uint64_t ns = static_cast<uint64_t>(
+        duration_cast<nanoseconds>(steady_clock::now() - t0).count());
+    ++stall_.records;
+    stall_.total_ns += ns;
+    if (ns > stall_.max_ns) stall_.max_ns = ns;
+} // record_snapshot()
+
+void SnapshotManager::flush() {
+    writer_.flush();
+} // flush()
+
+void SnapshotManager::set_channels(const std::vector<int> &peers) {
+    peers_ = peers;
+    instances_.clear();
+    slots_.clear();
+    free_slots_.clear();
+    update_recording();
+} // set_channels()
+
+int SnapshotManager::acquire_slot() {
+    if (!free_slots_.empty()) {
+        int slot = free_slots_.back();
+        free_slots_.pop_back();
+        return slot;
+    }
+    const int slot = static_cast<int>(slots_.size());
+    slots_.push_back(Slot());
+    for (size_t i = 0; i < peers_.size(); ++i) {
+        slots_[slot][peers_[i]].reset(new ChannelRecorder(
+            channel_mem_limit_, base_path_ + ".chan" +
+                                    std::to_string(peers_[i]) + "." +
+                                    std::to_string(slot)));
+    }
+    return slot;
+} // acquire_slot()
+
+void SnapshotManager::update_recording() {
+    bool any = false;
+    for (std::map<int, Instance>::const_iterator it = instances_.begin();
+         it != instances_.end() && !any; ++it) {
+        any = it->second.open_channels > 0;
+    }
+    recording_.store(any);
+} // update_recording()
+
+void SnapshotManager::begin_snapshot(int snapshot_id,
+                                     const std::vector<int> &vc,
+                                     bool active) {
+    if (instances_.count(snapshot_id)) return;
+    if (at_capacity()) {
+        // the oldest instance's local state is already part of its cut, but
+        // its unclosed channels are cut short
+        LOG_ERROR(id_, "{} {} snapshots open when {} began; finishing {} "
+                       "early", id_, instances_.size(), snapshot_id,
+                  oldest_open());
+        finish_snapshot(oldest_open());
+    }
+
+    mark_begun(snapshot_id);
+
+    Instance &inst = instances_[snapshot_id];
+    inst.local.id = snapshot_id;
+    inst.local.vc = vc;
+    inst.local.active = active;
+    inst.local.in_transit = 0;
+    inst.slot = acquire_slot();
+    inst.open_channels = 0;
+
+    Slot &slot = slots_[inst.slot];
+    for (Slot::iterator it = slot.begin(); it != slot.end(); ++it) {
+        Channel &ch = inst.channels[it->first];
+        ch.open = true;
+        ch.rec = it->second.get();
+        ch.rec->clear();
+        ++inst.open_channels;
+    }
+    update_recording();
+} // begin_snapshot()
+
+void SnapshotManager::mark_begun(int snapshot_id) {
+    begun_.insert(snapshot_id);
+    if (begun_.size() > kBegunWindow) {
+        begun_floor_ = std::max(begun_floor_, *begun_.begin());
+        begun_.erase(begun_.begin());
+    }
+} // mark_begun()
+
+bool SnapshotManager::has_begun(int snapshot_id) const {
+    return snapshot_id <= begun_floor_ || begun_.count(snapshot_id) > 0;
+} // has_begun()
+
+int SnapshotManager::oldest_open() const {
+    return instances_.empty() ? -1 : instances_.begin()->first;
+} // oldest_open()
+
+void SnapshotManager::record_in_transit(int from, const std::string &frame) {
+    // a frame belongs to every instance whose marker it beat
+    for (std::map<int, Instance>::iterator it = instances_.begin();
+         it != instances_.end(); ++it) {
+        std::map<int, Channel>::iterator ch = it->second.channels.find(from);
+        if (ch != it->second.channels.end() && ch->second.open)
+            ch->second.rec->append(frame);
+    }
+} // record_in_transit()
+
+bool SnapshotManager::close_channel(int from, int snapshot_id) {
+    std::map<int, Instance>::iterator it = instances_.find(snapshot_id);
+    if (it == instances_.end()) return false;
+    std::map<int, Channel>::iterator ch = it->second.channels.find(from);
+    if (ch == it->second.channels.end() || !ch->second.open) return false;
+
+    // only the call that closes the last channel reports completion
+    ch->second.open = false;
+    if (--it->second.open_channels > 0) return false;
+    update_recording();
+    return true;
+} // close_channel()
+
+bool SnapshotManager::all_channels_closed(int snapshot_id) const {
+    std::map<int, Instance>::const_iterator it = instances_.find(snapshot_id);
+    return it != instances_.end() && it->second.open_channels == 0;
+} // all_channels_closed()
+
+bool SnapshotManager::all_channels_closed() const {
+    return all_channels_closed(oldest_open());
+} // all_channels_closed()
+
+void SnapshotManager::release_held() {
+    // write finished clocks in id order, but never wait on an instance that
+    // is still open for one that is not
+    while (!held_.empty() &&
+           (instances_.empty() ||
+            held_.begin()->first < instances_.begin()->first)) {
+        record_snapshot(held_.begin()->second, held_.begin()->first);
+        held_.erase(held_.begin());
+    }
+} // release_held()
+
+SnapshotResult SnapshotManager::finish_snapshot(int snapshot_id) {
+    std::map<int, Instance>::iterator it = instances_.find(snapshot_id);
+    if (it == instances_.end()) return last_;
+    Instance &inst = it->second;
+
+    for (std::map<int, Channel>::iterator ch = inst.channels.begin();
+         ch != inst.channels.end(); ++ch) {
+        size_t c = ch->second.rec->count();
+        inst.local.per_channel[ch->first] = c;
+        inst.local.in_transit += c;
+        ch->second.rec->clear();
+    }
+    free_slots_.push_back(inst.slot);
+
+    last_ = inst.local;
+    held_[snapshot_id] = inst.local.vc;
+    instances_.erase(it);
+    update_recording();
+    release_held();
+    ++completed_;
+    return last_;
+} // finish_snapshot()
+
+SnapshotResult SnapshotManager::record_local(int snapshot_id,
+                                            const std::vector<int> &vc,
+                                            bool active) {
+    last_.id = snapshot_id;
+    last_.vc = vc;
+    last_.active = active;
+    last_.in_transit = 0;
+    last_.per_channel.clear();
+    mark_begun(snapshot_id);
+    record_snapshot(vc, snapshot_id);
+    ++completed_;
+    return last_;
+} // record_local()
+
+SnapshotResult SnapshotManager::finish_snapshot() {
+    return finish_snapshot(oldest_open());
+} // finish_snapshot()
+
+bool SnapshotManager::channel_frames(int snapshot_id, int from,
+                                     std::vector<std::string> &out) const {
+    std::map<int, Instance>::const_iterator it = instances_.find(snapshot_id);
+    if (it == instances_.end()) return false;
+    std::map<int, Channel>::const_iterator ch = it->second.channels.find(from);
+    if (ch == it->second.channels.end()) return false;
+    return ch->second.rec->read_all(out);
+} // channel_frames()
+
+bool SnapshotManager::channel_frames(int from,
+                                     std::vector<std::string> &out) const {
+    return channel_frames(oldest_open(), from, out);
+} // channel_frames()
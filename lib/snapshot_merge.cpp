@@ -0,0 +1,188 @@
+/****************************************************************************
+ * file: snapshot_merge.cpp
+ * author: luke le
+ * description:
+ *     implements reading snapshot files and lining them up by id.
+ ****************************************************************************/
+#include "snapshot_merge.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+
+    /**
+     * @brief node id from ".../<config>-<id>.out" or ".snap"
+     */
+    int node_id_of(const std::string &path) {
+        size_t dot = path.rfind('.');
+        size_t dash = path.rfind('-', dot);
+        if (dot == std::string::npos || dash == std::string::npos) return -1;
+        char *end = nullptr;
+        long id = std::strtol(path.c_str() + dash + 1, &end, 10);
+        if (end != path.c_str() + dot || id < 0) return -1;
+        return static_cast<int>(id);
+    } // node_id_of()
+
+} // end anonymous namespace
+
+SnapshotFile::SnapshotFile()
+    : fp_(nullptr), len_(0), pos_(0), binary_(false), line_(0) {}
+
+SnapshotFile::~SnapshotFile() {
+    if (fp_) std::fclose(fp_);
+} // ~SnapshotFile()
+
+bool SnapshotFile::open(const std::string &path) {
+    path_ = path;
+    binary_ = path.size() > 5 &&
+              path.compare(path.size() - 5, 5, ".snap") == 0;
+    if (binary_) return snap_.open(path);
+    fp_ = std::fopen(path.c_str(), "rb");
+    if (!fp_) std::cerr << "[!] cannot open " << path << "\n";
+    buf_.resize(1 << 20);
+    return fp_ != nullptr;
+} // open()
+
+int SnapshotFile::next(int *out, int n, long long &id) {
+    if (binary_) {
+        if (!snap_.next()) return 0;
+        if (snap_.n() != n) return -1;
+        std::copy(snap_.clock().begin(), snap_.clock().end(), out);
+        // the initial state is recorded with id -1; it is snapshot 0, as
+        // the first line of a .out file is
+        id = std::max<long long>(snap_.snapshot_id(), 0);
+        return 1;
+    }
+    id = line_++;
+
+    // hand-rolled integer scan over a 1 MiB buffer; istream parsing would
+    // dominate the run time
+    int got = 0;
+    bool in_num = false, neg = false, any = false;
+    long v = 0;
+    for (;;) {
+        if (pos_ == len_ && !refill()) break;
+        const char ch = buf_[pos_++];
+        if (ch >= '0' && ch <= '9') {
+            v = v * 10 + (ch - '0');
+            in_num = any = true;
+            continue;
+        }
+        if (ch == '-' && !in_num) {
+            neg = true;
+            continue;
+        }
+        if (in_num) {
+            if (got == n) return -1;
+            out[got++] = static_cast<int>(neg ? -v : v);
+            v = 0;
+            in_num = neg = false;
+        }
+        if (ch == '\n') {
+            if (!any) continue;           // blank line
+            return got == n ? 1 : -1;
+        }
+    }
+    if (in_num) {
+        if (got == n) return -1;
+        out[got++] = static_cast<int>(neg ? -v : v);
+    }
+    if (!any) return 0;
+    return got == n ? 1 : -1;
+} // next()
+
+bool SnapshotFile::refill() {
+    len_ = std::fread(buf_.data(), 1, buf_.size(), fp_);
+    pos_ = 0;
+    return len_ > 0;
+} // refill()
+
+SnapshotMerge::SnapshotMerge() : n_(0), bad_(false) {}
+
+bool SnapshotMerge::open(const std::vector<std::string> &paths) {
+    // order files by node id; every id 0..n-1 must be present once
+    n_ = static_cast<int>(paths.size());
+    files_.clear();
+    files_.resize(n_);
+    for (int p = 0; p < n_; ++p) {
+        const int id = node_id_of(paths[p]);
+        if (id < 0 || id >= n_ || files_[id]) {
+            std::cerr << "[!] " << paths[p] << ": expected one file per node "
+                      << "id 0.." << n_ - 1 << "\n";
+            return false;
+        }
+        files_[id].reset(new SnapshotFile());
+        if (!files_[id]->open(paths[p])) return false;
+    }
+
+    head_.assign(static_cast<size_t>(n_) * n_, 0);
+    head_id_.assign(n_, -1);
+    live_.assign(n_, false);
+    missing_.assign(n_, 0);
+    first_missing_.assign(n_, -1);
+    bad_ = false;
+    for (int j = 0; j < n_; ++j) live_[j] = advance(j);
+    return true;
+} // open()
+
+bool SnapshotMerge::next(int *clocks, long long &id) {
+    for (;;) {
+        long long low = LLONG_MAX;
+        for (int j = 0; j < n_; ++j)
+            if (live_[j] && head_id_[j] < low) low = head_id_[j];
+        if (low == LLONG_MAX) return false;
+
+        int have = 0;
+        for (int j = 0; j < n_; ++j)
+            if (live_[j] && head_id_[j] == low) ++have;
+        if (have == n_) std::copy(head_.begin(), head_.end(), clocks);
+
+        for (int j = 0; j < n_; ++j) {
+            if (live_[j] && head_id_[j] == low) {
+                live_[j] = advance(j);
+            } else if (missing_[j]++ == 0) {
+                first_missing_[j] = low;
+            }
+        }
+        if (have == n_) {
+            id = low;
+            return true;
+        }
+    }
+} // next()
+
+bool SnapshotMerge::finish() {
+    for (int j = 0; j < n_; ++j) {
+        if (missing_[j] == 0) continue;
+        std::cerr << "[!] " << files_[j]->path() << " has no record of "
+                  << missing_[j] << " snapshot(s) the others have, the first "
+                  << "is snapshot " << first_missing_[j] << "\n";
+        bad_ = true;
+    }
+    return !bad_;
+} // finish()
+
+bool SnapshotMerge::advance(int j) {
+    // read the next record of node j into its row of head_; false at end of
+    // file, or on a malformed record or an id not above the previous one
+    const long long prev = head_id_[j];
+    long long id = -1;
+    const int status = files_[j]->next(
+        head_.data() + static_cast<size_t>(j) * n_, n_, id);
+    if (status == 0) return false;
+    if (status < 0) {
+        std::cerr << "[!] " << files_[j]->path() << ": malformed record "
+                  << "after snapshot " << prev << "\n";
+    } else if (id <= prev) {
+        std::cerr << "[!] " << files_[j]->path() << ": snapshot " << id
+                  << " follows snapshot " << prev << "\n";
+    } else {
+        head_id_[j] = id;
+        return true;
+    }
+    bad_ = true;
+    return false;
+} // advance()
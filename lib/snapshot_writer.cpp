@@ -0,0 +1,191 @@
+/****************************************************************************
+ * file: snapshot_writer.cpp
+ * author: luke le
+ * description:
+ *     implements the background, group-committing snapshot writer.
+ ****************************************************************************/
+#include "snapshot_writer.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <iostream>
+#include <unistd.h>
+
+SnapshotWriter::SnapshotWriter(const std::string &path,
+                               const SnapshotWriterOptions &opts,
+                               int node_id, int n)
+    : opts_(opts),
+      path_(path),
+      fd_(::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)),
+      encoder_(node_id, n),
+      ring_(opts.ring_capacity),
+      sleeping_(false),
+      idle_(true),
+      stopping_(false),
+      submitted_(0),
+      written_(0),
+      commits_(0),
+      full_waits_(0),
+      flush_waiters_(0) {
+    if (fd_ < 0) {
+        std::cerr << "[!] cannot open snapshot file: " << path << "\n";
+    }
+    if (opts_.batch == 0) opts_.batch = 1;
+    if (opts_.binary) {
+        std::string header;
+        encoder_.header(header);
+        write_all(header);
+    }
+    if (opts_.async) thread_ = std::thread(&SnapshotWriter::run, this);
+} // SnapshotWriter()
+
+SnapshotWriter::~SnapshotWriter() {
+    close();
+} // ~SnapshotWriter()
+
+void SnapshotWriter::format(const SnapshotRecord &rec, std::string &out) {
+    if (opts_.binary) {
+        encoder_.record(rec.id, rec.vc, out);
+        return;
+    }
+    for (size_t i = 0; i < rec.vc.size(); ++i) {
+        if (i) out += ' ';
+        out += std::to_string(rec.vc[i]);
+    }
+    out += '\n';
+} // format()
+
+void SnapshotWriter::write_all(const std::string &buf) {
+    size_t off = 0;
+    while (fd_ >= 0 && off < buf.size()) {
+        ssize_t n = ::write(fd_, buf.data() + off, buf.size() - off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::perror("[!] snapshot write");
+            break;
+        }
+        off += static_cast<size_t>(n);
+    }
+} // write_all()
+
+void SnapshotWriter::commit(std::string &buf, uint64_t records) {
+    // one write() per group instead of one flush per snapshot
+    write_all(buf);
+    if (opts_.fdatasync && fd_ >= 0) ::fdatasync(fd_);
+    buf.clear();
+
+    written_.fetch_add(records);
+    commits_.fetch_add(1);
+    if (opts_.async) {
+        std::lock_guard<std::mutex> lk(mu_);
+        drained_.notify_all();
+    }
+} // commit()
+
+void SnapshotWriter::submit(SnapshotRecord &rec) {
+    submitted_.fetch_add(1);
+    if (!opts_.async) {
+        std::string buf;
+        format(rec, buf);
+        commit(buf, 1);
+        return;
+    }
+
+    while (!ring_.try_push(rec)) {
+        full_waits_.fetch_add(1);
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            wake_.notify_one();
+        }
+        std::this_thread::yield();
+    }
+
+    // pairs with the fence in run(): either we see the writer asleep, or it
+    // sees our record before going to sleep. A writer that already holds a
+    // pending group wakes on its own timer, so it is only woken for the
+    // first record of a group or once a full batch is queued.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load() &&
+        (idle_.load() || submitted_.load() - written_.load() >= opts_.batch)) {
+        std::lock_guard<std::mutex> lk(mu_);
+        wake_.notify_one();
+    }
+} // submit()
+
+void SnapshotWriter::run() {
+    using namespace std::chrono;
+    std::string buf;
+    uint64_t pending = 0;
+    steady_clock::time_point first = steady_clock::now();
+    SnapshotRecord rec;
+
+    for (;;) {
+        while (ring_.try_pop(rec)) {
+            if (pending == 0) first = steady_clock::now();
+            format(rec, buf);
+            if (++pending >= opts_.batch) {
+                commit(buf, pending);
+                pending = 0;
+            }
+        }
+
+        const bool stop = stopping_.load();
+        const bool flushing = stop || flush_waiters_.load() > 0;
+        if (pending > 0 &&
+            (flushing || steady_clock::now() - first >=
+                             milliseconds(opts_.flush_ms))) {
+            commit(buf, pending);
+            pending = 0;
+        }
+        if (stop && ring_.empty()) break;
+
+        std::unique_lock<std::mutex> lk(mu_);
+        idle_.store(pending == 0);
+        sleeping_.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (ring_.empty() && !stopping_.load() &&
+            (pending == 0 || flush_waiters_.load() == 0)) {
+            if (pending > 0)
+                wake_.wait_until(lk, first + milliseconds(opts_.flush_ms));
+            else
+                wake_.wait(lk);
+        }
+        sleeping_.store(false);
+    }
+} // run()
+
+void SnapshotWriter::flush() {
+    if (!opts_.async) return;
+    const uint64_t target = submitted_.load();
+    std::unique_lock<std::mutex> lk(mu_);
+    // a registered waiter makes run() commit at once instead of waiting for
+    // the batch window
+    flush_waiters_.fetch_add(1);
+    while (written_.load() < target && !stopping_.load()) {
+        wake_.notify_one();
+        drained_.wait_for(lk, std::chrono::milliseconds(opts_.flush_ms));
+    }
+    flush_waiters_.fetch_sub(1);
+} // flush()
+
+void SnapshotWriter::close() {
+    if (thread_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            stopping_.store(true);
+            wake_.notify_one();
+        }
+        thread_.join();
+    }
+    if (fd_ >= 0) {
+        if (opts_.binary) {
+            std::string footer;
+            encoder_.footer(footer);
+            write_all(footer);
+        }
+        ::close(fd_);
+        fd_ = -1;
+    }
+} // close()
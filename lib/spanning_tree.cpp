@@ -0,0 +1,61 @@
+/****************************************************************************
+ * file: spanning_tree.cpp
+ * author: luke le
+ * description:
+ *     implements BFS spanning tree construction over the config topology.
+ ****************************************************************************/
+#include "spanning_tree.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+int SpanningTree::reachable() const {
+    int count = 0;
+    for (size_t i = 0; i < depth.size(); ++i) {
+        if (depth[i] >= 0) ++count;
+    }
+    return count;
+} // reachable()
+
+int SpanningTree::height() const {
+    int h = 0;
+    for (size_t i = 0; i < depth.size(); ++i) h = std::max(h, depth[i]);
+    return h;
+} // height()
+
+bool build_spanning_tree(const Config &cfg, int root, SpanningTree &tree) {
+    tree.root = root;
+    tree.parent.assign(cfg.n, -1);
+    tree.depth.assign(cfg.n, -1);
+    tree.children.assign(cfg.n, std::vector<int>());
+    if (root < 0 || root >= cfg.n) {
+        std::cerr << "[!] spanning tree root " << root << " out of range\n";
+        return false;
+    }
+
+    // plain BFS; the frontier vector doubles as the queue
+    std::vector<int> queue(1, root);
+    tree.depth[root] = 0;
+    for (size_t head = 0; head < queue.size(); ++head) {
+        const int u = queue[head];
+        if (u >= static_cast<int>(cfg.neighbors.size())) continue;
+
+        // rows are sorted, so children come out in ascending order
+        const NeighborRange nbs = cfg.neighbors[u];
+        for (size_t i = 0; i < nbs.size(); ++i) {
+            const int v = nbs[i];
+            if (v < 0 || v >= cfg.n || tree.depth[v] >= 0) continue;
+            tree.depth[v] = tree.depth[u] + 1;
+            tree.parent[v] = u;
+            tree.children[u].push_back(v);
+            queue.push_back(v);
+        }
+    }
+
+    if (static_cast<int>(queue.size()) != cfg.n) {
+        std::cerr << "[!] spanning tree from " << root << " reaches only "
+                  << queue.size() << " of " << cfg.n << " nodes\n";
+        return false;
+    }
+    return true;
+} // build_spanning_tree()
@@ -0,0 +1,73 @@
+/****************************************************************************
+ * file: termination_manager.cpp
+ * author: luke le
+ * description:
+ *     implements weight-throwing termination detection with exact dyadic
+ *     credits.
+ ****************************************************************************/
+#include "termination_manager.hpp"
+#include "logger.hpp"
+
+#include <cmath>
+
+TerminationManager::TerminationManager(int node_id, const SpanningTree &tree)
+    : id_(node_id),
+      parent_(tree.parent[node_id]),
+      root_(node_id == tree.root),
+      returned_(0) {
+    if (root_) credit_.insert(0);   // 2^0 = all of the weight
+} // TerminationManager()
+
+void TerminationManager::add(int k) {
+    // binary addition: 2^-k + 2^-k = 2^-(k-1)
+    while (credit_.erase(k)) --k;
+    if (k < 0) {
+        LOG_ERROR(id_, "{} holds more than the total weight", id_);
+        k = 0;
+    }
+    credit_.insert(k);
+} // add()
+
+int TerminationManager::split_credit() {
+    if (credit_.empty()) {
+        LOG_ERROR(id_, "{} sends APP without holding weight", id_);
+        return -1;
+    }
+    // the smallest credit is the largest exponent, so k + 1 is free
+    std::set<int>::iterator last = --credit_.end();
+    const int k = *last + 1;
+    credit_.erase(last);
+    credit_.insert(k);
+    return k;
+} // split_credit()
+
+void TerminationManager::receive_credit(int k) {
+    if (k < 0) return;
+    add(k);
+} // receive_credit()
+
+void TerminationManager::receive_returned(const std::vector<int> &ks) {
+    for (size_t i = 0; i < ks.size(); ++i) receive_credit(ks[i]);
+} // receive_returned()
+
+bool TerminationManager::release(std::vector<int> &out) {
+    out.clear();
+    if (is_root() || credit_.empty()) return false;
+    out.assign(credit_.begin(), credit_.end());
+    credit_.clear();
+    ++returned_;
+    return true;
+} // release()
+
+bool TerminationManager::holds_all() const {
+    return credit_.size() == 1 && *credit_.begin() == 0;
+} // holds_all()
+
+double TerminationManager::weight() const {
+    double w = 0.0;
+    for (std::set<int>::const_iterator it = credit_.begin();
+         it != credit_.end(); ++it) {
+        w += std::ldexp(1.0, -*it);
+    }
+    return w;
+} // weight()
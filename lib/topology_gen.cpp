@@ -0,0 +1,362 @@
+/****************************************************************************
+ * file: topology_gen.cpp
+ * author: luke le
+ * description:
+ *     implements the synthetic topology generator.
+ * notes:
+ *     each kind builds plain edge lists first; connect_components() then
+ *     joins whatever pieces a random kind left and Adjacency sorts the
+ *     rows. Random regular graphs are joined by swapping edge endpoints,
+ *     which keeps every degree; Erdos-Renyi graphs by linking each extra
+ *     component to the largest one.
+ ****************************************************************************/
+#include "topology_gen.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <unordered_set>
+
+using namespace std;
+
+namespace {
+
+    typedef vector<vector<int>> EdgeLists;
+
+    /**
+     * @brief seeded source of bounded integers and reals; mt19937_64 is
+     *        fully specified, the reductions below are ours
+     */
+    class Random {
+    public:
+        explicit Random(uint64_t seed) : mt_(seed) {}
+
+        // uniform in [0, bound), rejection against modulo bias
+        uint64_t below(uint64_t bound) {
+            const uint64_t limit = ~uint64_t(0) - (~uint64_t(0) % bound);
+            uint64_t x;
+            do { x = mt_(); } while (x >= limit);
+            return x % bound;
+        }
+
+        // uniform in [0, 1)
+        double real() { return (mt_() >> 11) * (1.0 / 9007199254740992.0); }
+
+    private:
+        mt19937_64 mt_;
+    };
+
+    uint64_t edge_key(int a, int b) {
+        if (a > b) swap(a, b);
+        return (static_cast<uint64_t>(a) << 32) | static_cast<uint32_t>(b);
+    } // edge_key()
+
+    void link(EdgeLists &adj, int a, int b) {
+        adj[a].push_back(b);
+        adj[b].push_back(a);
+    } // link()
+
+    void unlink(EdgeLists &adj, int a, int b) {
+        adj[a].erase(find(adj[a].begin(), adj[a].end(), b));
+        adj[b].erase(find(adj[b].begin(), adj[b].end(), a));
+    } // unlink()
+
+    /**
+     * @brief label each node with its component; returns the count
+     */
+    int components(const EdgeLists &adj, vector<int> &label) {
+        label.assign(adj.size(), -1);
+        vector<int> queue;
+        int count = 0;
+        for (size_t s = 0; s < adj.size(); ++s) {
+            if (label[s] >= 0) continue;
+            label[s] = count;
+            queue.assign(1, static_cast<int>(s));
+            for (size_t q = 0; q < queue.size(); ++q) {
+                const vector<int> &row = adj[queue[q]];
+                for (size_t k = 0; k < row.size(); ++k) {
+                    if (label[row[k]] < 0) {
+                        label[row[k]] = count;
+                        queue.push_back(row[k]);
+                    }
+                }
+            }
+            ++count;
+        }
+        return count;
+    } // components()
+
+    /**
+     * @brief join the components of adj. keep_degrees swaps a link in one
+     *        component with a link in the next (a-b, c-d -> a-c, b-d);
+     *        otherwise each component is linked to the largest one
+     */
+    bool connect_components(EdgeLists &adj, bool keep_degrees, Random &rng) {
+        vector<int> label;
+        for (int round = 0; round < 1000; ++round) {
+            const int count = components(adj, label);
+            if (count == 1) return true;
+
+            vector<vector<int>> members(count);
+            for (size_t i = 0; i < label.size(); ++i)
+                members[label[i]].push_back(static_cast<int>(i));
+
+            if (!keep_degrees) {
+                // hang every piece off the largest one, so the links added
+                // do not string the pieces into one long path
+                int giant = 0;
+                for (int c = 1; c < count; ++c)
+                    if (members[c].size() > members[giant].size()) giant = c;
+                const vector<int> &g = members[giant];
+                for (int c = 0; c < count; ++c) {
+                    if (c == giant) continue;
+                    link(adj, g[rng.below(g.size())],
+                         members[c][rng.below(members[c].size())]);
+                }
+                continue;
+            }
+            for (int c = 1; c < count; ++c) {
+                const vector<int> &x = members[c - 1], &y = members[c];
+                const int a = x[rng.below(x.size())];
+                const int c2 = y[rng.below(y.size())];
+                // regular components have no isolated nodes (degree >= 1)
+                const int b = adj[a][rng.below(adj[a].size())];
+                const int d = adj[c2][rng.below(adj[c2].size())];
+                unlink(adj, a, b);
+                unlink(adj, c2, d);
+                link(adj, a, c2);
+                link(adj, b, d);
+            }
+            // a swap that cut a bridge may leave pieces; go around again
+        }
+        cerr << "[!] could not connect the generated graph\n";
+        return false;
+    } // connect_components()
+
+    void ring(int n, EdgeLists &adj) {
+        for (int i = 0; i < n; ++i) link(adj, i, (i + 1) % n);
+    } // ring()
+
+    bool torus(int n, int rows, EdgeLists &adj) {
+        if (rows == 0) {
+            for (int r = 1; r * r <= n; ++r)
+                if (n % r == 0) rows = r;
+        }
+        if (rows < 1 || n % rows != 0) {
+            cerr << "[!] torus rows " << rows << " do not divide n = " << n
+                 << "\n";
+            return false;
+        }
+        const int cols = n / rows;
+        for (int r = 0; r < rows; ++r) {
+            for (int c = 0; c < cols; ++c) {
+                const int i = r * cols + c;
+                // right and down; Adjacency drops the doubles of a 2-wide
+                // dimension, and a 1-wide one links nothing
+                if (cols > 1) link(adj, i, r * cols + (c + 1) % cols);
+                if (rows > 1) link(adj, i, ((r + 1) % rows) * cols + c);
+            }
+        }
+        return true;
+    } // torus()
+
+    /**
+     * @brief pair up n * d endpoint stubs at random, never creating a
+     *        self-loop or a double link; restart if the last stubs cannot
+     *        be paired
+     */
+    bool random_regular(int n, int d, Random &rng, EdgeLists &adj) {
+        if (d < 1 || d >= n || (static_cast<long long>(n) * d) % 2 != 0) {
+            cerr << "[!] no simple " << d << "-regular graph on " << n
+                 << " nodes\n";
+            return false;
+        }
+        if (d < 2 && n > 2) {
+            cerr << "[!] a 1-regular graph on more than 2 nodes is never "
+                 << "connected\n";
+            return false;
+        }
+        for (int attempt = 0; attempt < 100; ++attempt) {
+            vector<int> stubs;
+            stubs.reserve(static_cast<size_t>(n) * d);
+            for (int i = 0; i < n; ++i) stubs.insert(stubs.end(), d, i);
+            unordered_set<uint64_t> edges;
+            for (size_t i = 0; i < adj.size(); ++i) adj[i].clear();
+
+            bool stuck = false;
+            while (!stubs.empty() && !stuck) {
+                for (int tries = 0;; ++tries) {
+                    if (tries == 100) {
+                        stuck = true;
+                        break;
+                    }
+                    size_t x = rng.below(stubs.size());
+                    size_t y = rng.below(stubs.size());
+                    const int u = stubs[x], v = stubs[y];
+                    if (u == v || !edges.insert(edge_key(u, v)).second)
+                        continue;
+                    link(adj, u, v);
+                    if (x < y) swap(x, y);      // remove the later one first
+                    stubs[x] = stubs.back();
+                    stubs.pop_back();
+                    stubs[y] = stubs.back();
+                    stubs.pop_back();
+                    break;
+                }
+            }
+            if (!stuck) return connect_components(adj, true, rng);
+        }
+        cerr << "[!] could not pair up a " << d << "-regular graph\n";
+        return false;
+    } // random_regular()
+
+    /**
+     * @brief G(n, p) by geometric skipping (Batagelj and Brandes), so the
+     *        cost follows the number of links rather than n^2
+     */
+    bool erdos_renyi(int n, double p, Random &rng, EdgeLists &adj) {
+        if (!(p >= 0.0 && p <= 1.0)) {
+            cerr << "[!] link probability " << p << " not in [0, 1]\n";
+            return false;
+        }
+        if (p >= 1.0) {
+            for (int v = 1; v < n; ++v)
+                for (int w = 0; w < v; ++w) link(adj, v, w);
+        } else if (p > 0.0) {
+            const double lq = log(1.0 - p);
+            long long v = 1, w = -1;
+            while (v < n) {
+                const double skip = floor(log(1.0 - rng.real()) / lq);
+                if (skip >= static_cast<double>(n) * n) break;   // past the end
+                w += 1 + static_cast<long long>(skip);
+                while (w >= v && v < n) {
+                    w -= v;
+                    ++v;
+                }
+                if (v < n) link(adj, static_cast<int>(v), static_cast<int>(w));
+            }
+        }
+        return connect_components(adj, false, rng);
+    } // erdos_renyi()
+
+    /**
+     * @brief Barabasi-Albert: a clique of m + 1 nodes, then each new node
+     *        links to m distinct nodes picked in proportion to degree
+     */
+    bool scale_free(int n, int m, Random &rng, EdgeLists &adj) {
+        if (m < 1 || m >= n) {
+            cerr << "[!] scale-free graph needs 1 <= degree / 2 < n\n";
+            return false;
+        }
+        vector<int> ends;   // node v appears once per link it has
+        for (int v = 1; v <= m; ++v) {
+            for (int w = 0; w < v; ++w) {
+                link(adj, v, w);
+                ends.push_back(v);
+                ends.push_back(w);
+            }
+        }
+        vector<int> picked;
+        for (int v = m + 1; v < n; ++v) {
+            picked.clear();
+            while (static_cast<int>(picked.size()) < m) {
+                const int t = ends[rng.below(ends.size())];
+                if (find(picked.begin(), picked.end(), t) == picked.end())
+                    picked.push_back(t);
+            }
+            for (size_t k = 0; k < picked.size(); ++k) {
+                link(adj, v, picked[k]);
+                ends.push_back(v);
+                ends.push_back(picked[k]);
+            }
+        }
+        return true;
+    } // scale_free()
+
+} // end anonymous namespace
+
+bool parse_topology_kind(const string &name, TopologyKind &kind) {
+    if (name == "ring") kind = TOPO_RING;
+    else if (name == "torus") kind = TOPO_TORUS;
+    else if (name == "random-regular") kind = TOPO_RANDOM_REGULAR;
+    else if (name == "erdos-renyi") kind = TOPO_ERDOS_RENYI;
+    else if (name == "scale-free") kind = TOPO_SCALE_FREE;
+    else return false;
+    return true;
+} // parse_topology_kind()
+
+bool generate_topology(const TopologySpec &spec, Config &cfg) {
+    const int n = spec.n;
+    if (n < 2) {
+        cerr << "[!] a topology needs at least 2 nodes\n";
+        return false;
+    }
+    if (spec.base_port < 1 || spec.base_port + static_cast<long long>(n) - 1 >
+                                  65535) {
+        cerr << "[!] ports " << spec.base_port << ".."
+             << spec.base_port + static_cast<long long>(n) - 1
+             << " do not fit in 1..65535\n";
+        return false;
+    }
+    if (spec.hosts.empty()) {
+        cerr << "[!] no hosts to place nodes on\n";
+        return false;
+    }
+
+    Random rng(spec.seed);
+    EdgeLists adj(n);
+    bool ok = false;
+    switch (spec.kind) {
+    case TOPO_RING:
+        ring(n, adj);
+        ok = true;
+        break;
+    case TOPO_TORUS:
+        ok = torus(n, spec.rows, adj);
+        break;
+    case TOPO_RANDOM_REGULAR:
+        ok = random_regular(n, spec.degree, rng, adj);
+        break;
+    case TOPO_ERDOS_RENYI:
+        ok = erdos_renyi(n,
+                         spec.p >= 0.0 ? spec.p
+                                       : static_cast<double>(spec.degree) /
+                                             (n - 1),
+                         rng, adj);
+        break;
+    case TOPO_SCALE_FREE:
+        ok = scale_free(n, spec.degree / 2, rng, adj);
+        break;
+    }
+    if (!ok) return false;
+
+    cfg.n = n;
+    cfg.nodes.resize(n);
+    for (int i = 0; i < n; ++i) {
+        NodeInfo &node = cfg.nodes[i];
+        node.id = i;
+        node.host = spec.hosts[i % spec.hosts.size()];
+        node.port = spec.base_port + i;
+        node.addr = 0;
+    }
+    cfg.neighbors = Adjacency(adj);
+    return true;
+} // generate_topology()
+
+void write_config(ostream &out, const Config &cfg, const string &comment) {
+    if (!comment.empty()) out << "# " << comment << "\n";
+    out << cfg.n << " " << cfg.minPerActive << " " << cfg.maxPerActive << " "
+        << cfg.minSendDelay_ms << " " << cfg.snapshotDelay_ms << " "
+        << cfg.maxNumber << "\n\n";
+    for (int i = 0; i < cfg.n; ++i) {
+        out << cfg.nodes[i].id << " " << cfg.nodes[i].host << " "
+            << cfg.nodes[i].port << "\n";
+    }
+    out << "\n";
+    for (int i = 0; i < cfg.n; ++i) {
+        const NeighborRange row = cfg.neighbors[i];
+        for (size_t k = 0; k < row.size(); ++k) out << (k ? " " : "") << row[k];
+        out << "\n";
+    }
+} // write_config()
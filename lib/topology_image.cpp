@@ -0,0 +1,390 @@
+/****************************************************************************
+ * file: topology_image.cpp
+ * author: luke le
+ * description:
+ *     implements compiling a config file into a binary topology image and
+ *     loading one back into a Config.
+ * notes:
+ *     layout (all offsets from the start of the file, 4-byte aligned):
+ *
+ *         ImageHeader                     fixed size, magic + version
+ *         NodeRecord[n]                   id, port, addr, host in strings
+ *         uint32 offsets[n + 1]           CSR row starts
+ *         int32  targets[entries]         sorted neighbor ids per row
+ *         char   strings[strings_bytes]   host names and config name
+ *
+ *     payload_hash covers everything after the header, so a truncated or
+ *     partly overwritten image is caught before any table is trusted.
+ ****************************************************************************/
+#include "topology_image.hpp"
+#include "sctp_wrapper.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <map>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+    const char kMagic[8] = {'D', 'S', 'T', 'O', 'P', 'O', '\0', '\0'};
+    const uint32_t kByteOrder = 0x01020304;
+
+    struct ImageHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;        // kByteOrder as the compiler stored it
+        uint64_t image_bytes;
+        uint64_t payload_hash;
+        uint64_t source_bytes;      // the config file it was compiled from
+        int64_t source_mtime_ns;
+        uint64_t source_hash;
+        int32_t n, min_per_active, max_per_active;
+        int32_t min_send_delay_ms, snapshot_delay_ms, max_number;
+        uint32_t entries;
+        uint32_t name_off, name_len;    // config name, within strings
+        uint32_t nodes_off, offsets_off, targets_off;
+        uint32_t strings_off, strings_bytes;
+    };
+
+    struct NodeRecord {
+        int32_t id;
+        int32_t port;
+        uint32_t addr;              // network byte order, 0 = unresolved
+        uint32_t host_off, host_len;
+    };
+
+    /**
+     * @brief 64-bit hash of a byte range, four independent word lanes
+     *        folded at the end (not cryptographic; only has to notice an
+     *        edited config or a damaged image)
+     */
+    uint64_t hash_bytes(const char *p, size_t len) {
+        const uint64_t k = 0x9e3779b97f4a7c15ULL;
+        uint64_t lane[4] = {0xcbf29ce484222325ULL ^ len, 1, 2, 3};
+        size_t i = 0;
+        for (; i + 32 <= len; i += 32) {
+            for (int l = 0; l < 4; ++l) {
+                uint64_t w;
+                memcpy(&w, p + i + 8 * l, 8);
+                lane[l] = (lane[l] ^ w) * k;
+                lane[l] ^= lane[l] >> 29;
+            }
+        }
+        uint64_t h = lane[0];
+        for (int l = 1; l < 4; ++l) h = (h ^ lane[l]) * k;
+        for (; i + 8 <= len; i += 8) {
+            uint64_t w;
+            memcpy(&w, p + i, 8);
+            h = (h ^ w) * k;
+            h ^= h >> 29;
+        }
+        uint64_t tail = 0;
+        if (i < len) memcpy(&tail, p + i, len - i);
+        h = (h ^ tail) * k;
+        return h ^ (h >> 32);
+    } // hash_bytes()
+
+    int64_t mtime_ns(const struct stat &st) {
+        return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL +
+               st.st_mtim.tv_nsec;
+    } // mtime_ns()
+
+    /**
+     * @brief read-only mapping of a whole file plus its stat()
+     */
+    class Mapping {
+    public:
+        Mapping() : data_(nullptr), size_(0), mapped_(false) {}
+        ~Mapping() {
+            if (mapped_) ::munmap(const_cast<char *>(data_), size_);
+        }
+
+        bool open(const string &path) {
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0 || ::fstat(fd, &st_) != 0) {
+                if (fd >= 0) ::close(fd);
+                return false;
+            }
+            size_ = static_cast<size_t>(st_.st_size);
+            if (size_ > 0) {
+                void *m = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (m == MAP_FAILED) {
+                    ::close(fd);
+                    return false;
+                }
+                data_ = static_cast<const char *>(m);
+                mapped_ = true;
+            }
+            ::close(fd);
+            return true;
+        }
+
+        const char *data() const { return data_; }
+        size_t size() const { return size_; }
+        const struct stat &st() const { return st_; }
+
+    private:
+        const char *data_;
+        size_t size_;
+        bool mapped_;
+        struct stat st_;
+    };
+
+    void append(string &buf, const void *p, size_t len) {
+        buf.append(static_cast<const char *>(p), len);
+    } // append()
+
+    /**
+     * @brief check every section of a mapped image; false with a reason
+     *        on the first problem
+     */
+    bool validate(const char *base, size_t size, const char *&why) {
+        if (size < sizeof(ImageHeader)) {
+            why = "shorter than its header";
+            return false;
+        }
+        ImageHeader h;
+        memcpy(&h, base, sizeof(h));
+        if (memcmp(h.magic, kMagic, sizeof(kMagic)) != 0) {
+            why = "not a topology image";
+            return false;
+        }
+        if (h.byte_order != kByteOrder) {
+            why = "written on a host with another byte order";
+            return false;
+        }
+        if (h.version != TOPOLOGY_IMAGE_VERSION) {
+            why = "from another image version";
+            return false;
+        }
+        if (h.image_bytes != size) {
+            why = "truncated";
+            return false;
+        }
+
+        // sections follow each other with no gaps
+        const uint64_t n = h.n < 0 ? 0 : static_cast<uint64_t>(h.n);
+        if (h.n < 0 || h.nodes_off != sizeof(ImageHeader) ||
+            h.offsets_off != h.nodes_off + n * sizeof(NodeRecord) ||
+            h.targets_off != h.offsets_off + (n + 1) * sizeof(uint32_t) ||
+            h.strings_off !=
+                h.targets_off + uint64_t(h.entries) * sizeof(int32_t) ||
+            uint64_t(h.strings_off) + h.strings_bytes != size ||
+            uint64_t(h.name_off) + h.name_len > h.strings_bytes) {
+            why = "has a malformed section table";
+            return false;
+        }
+        if (hash_bytes(base + sizeof(ImageHeader),
+                       size - sizeof(ImageHeader)) != h.payload_hash) {
+            why = "corrupt (payload hash mismatch)";
+            return false;
+        }
+
+        const NodeRecord *nodes =
+            reinterpret_cast<const NodeRecord *>(base + h.nodes_off);
+        for (uint64_t i = 0; i < n; ++i) {
+            if (nodes[i].id != static_cast<int32_t>(i) ||
+                uint64_t(nodes[i].host_off) + nodes[i].host_len >
+                    h.strings_bytes) {
+                why = "has a malformed node table";
+                return false;
+            }
+        }
+
+        // rows ascend within [0, n) so Adjacency can binary-search them
+        const uint32_t *offsets =
+            reinterpret_cast<const uint32_t *>(base + h.offsets_off);
+        const int32_t *targets =
+            reinterpret_cast<const int32_t *>(base + h.targets_off);
+        if (offsets[0] != 0 || offsets[n] != h.entries) {
+            why = "has a malformed neighbor table";
+            return false;
+        }
+        for (uint64_t i = 0; i < n; ++i) {
+            if (offsets[i + 1] < offsets[i]) {
+                why = "has a malformed neighbor table";
+                return false;
+            }
+            int32_t prev = -1;
+            for (uint32_t k = offsets[i]; k < offsets[i + 1]; ++k) {
+                if (targets[k] <= prev || targets[k] >= h.n) {
+                    why = "has a malformed neighbor table";
+                    return false;
+                }
+                prev = targets[k];
+            }
+        }
+        return true;
+    } // validate()
+
+    /**
+     * @brief true if config_path still is the file the image was compiled
+     *        from; size and mtime first, the content hash if they moved
+     */
+    bool source_matches(const ImageHeader &h, const string &config_path) {
+        struct stat st;
+        if (::stat(config_path.c_str(), &st) != 0) {
+            cerr << "[~] cannot stat " << config_path
+                 << "; using the topology image as is\n";
+            return true;
+        }
+        if (static_cast<uint64_t>(st.st_size) != h.source_bytes) return false;
+        if (mtime_ns(st) == h.source_mtime_ns) return true;
+
+        // touched (e.g. copied or checked out again): compare the content
+        Mapping src;
+        if (!src.open(config_path)) return false;
+        return hash_bytes(src.data(), src.size()) == h.source_hash;
+    } // source_matches()
+
+} // end anonymous namespace
+
+bool compile_topology(const string &config_path, const string &image_path) {
+    Mapping src;
+    Config cfg;
+    if (!src.open(config_path)) {
+        cerr << "[!] cannot open config file: " << config_path << "\n";
+        return false;
+    }
+    if (!parse_config(config_path, cfg)) return false;
+
+    // resolve each distinct host once; many nodes usually share one
+    map<string, uint32_t> resolved;
+    for (size_t i = 0; i < cfg.nodes.size(); ++i) {
+        NodeInfo &node = cfg.nodes[i];
+        map<string, uint32_t>::iterator it = resolved.find(node.host);
+        if (it == resolved.end()) {
+            uint32_t addr = 0;
+            if (!SCTPSocket::resolve(node.host, addr)) {
+                cerr << "[~] nodes on " << node.host
+                     << " will resolve it at connect time\n";
+            }
+            it = resolved.insert(make_pair(node.host, addr)).first;
+        }
+        node.addr = it->second;
+    }
+
+    const size_t n = static_cast<size_t>(cfg.n);
+    const vector<uint32_t> &offsets = cfg.neighbors.offsets();
+    const vector<int> &targets = cfg.neighbors.targets();
+
+    string strings;
+    vector<NodeRecord> records(n);
+    for (size_t i = 0; i < n; ++i) {
+        NodeRecord &r = records[i];
+        r.id = cfg.nodes[i].id;
+        r.port = cfg.nodes[i].port;
+        r.addr = cfg.nodes[i].addr;
+        r.host_off = static_cast<uint32_t>(strings.size());
+        r.host_len = static_cast<uint32_t>(cfg.nodes[i].host.size());
+        strings += cfg.nodes[i].host;
+    }
+
+    ImageHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.version = TOPOLOGY_IMAGE_VERSION;
+    h.byte_order = kByteOrder;
+    h.source_bytes = src.size();
+    h.source_mtime_ns = mtime_ns(src.st());
+    h.source_hash = hash_bytes(src.data(), src.size());
+    h.n = cfg.n;
+    h.min_per_active = cfg.minPerActive;
+    h.max_per_active = cfg.maxPerActive;
+    h.min_send_delay_ms = cfg.minSendDelay_ms;
+    h.snapshot_delay_ms = cfg.snapshotDelay_ms;
+    h.max_number = cfg.maxNumber;
+    h.entries = static_cast<uint32_t>(targets.size());
+    h.name_off = static_cast<uint32_t>(strings.size());
+    h.name_len = static_cast<uint32_t>(cfg.config_name.size());
+    strings += cfg.config_name;
+    h.nodes_off = sizeof(ImageHeader);
+    h.offsets_off = h.nodes_off + n * sizeof(NodeRecord);
+    h.targets_off = h.offsets_off + (n + 1) * sizeof(uint32_t);
+    h.strings_off = h.targets_off + targets.size() * sizeof(int32_t);
+    h.strings_bytes = static_cast<uint32_t>(strings.size());
+
+    string buf;
+    buf.reserve(h.strings_off + strings.size());
+    append(buf, &h, sizeof(h));
+    append(buf, records.data(), n * sizeof(NodeRecord));
+    append(buf, offsets.data(), (n + 1) * sizeof(uint32_t));
+    append(buf, targets.data(), targets.size() * sizeof(int32_t));
+    buf += strings;
+
+    h.image_bytes = buf.size();
+    h.payload_hash = hash_bytes(buf.data() + sizeof(ImageHeader),
+                                buf.size() - sizeof(ImageHeader));
+    memcpy(&buf[0], &h, sizeof(h));
+
+    // write next to the target and rename, so readers see old or new
+    const string tmp = image_path + ".tmp." + to_string(::getpid());
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                    0644);
+    size_t done = 0;
+    while (fd >= 0 && done < buf.size()) {
+        ssize_t w = ::write(fd, buf.data() + done, buf.size() - done);
+        if (w <= 0) break;
+        done += static_cast<size_t>(w);
+    }
+    const bool ok = fd >= 0 && done == buf.size() && ::fsync(fd) == 0;
+    if (fd >= 0) ::close(fd);
+    if (!ok || ::rename(tmp.c_str(), image_path.c_str()) != 0) {
+        ::unlink(tmp.c_str());
+        cerr << "[!] cannot write topology image: " << image_path << "\n";
+        return false;
+    }
+    return true;
+} // compile_topology()
+
+bool load_topology(const string &image_path, const string &config_path,
+                   Config &cfg) {
+    Mapping img;
+    if (!img.open(image_path)) {
+        cerr << "[!] cannot open topology image: " << image_path << "\n";
+        return false;
+    }
+    const char *why = "";
+    if (!validate(img.data(), img.size(), why)) {
+        cerr << "[!] topology image " << image_path << " is " << why << "\n";
+        return false;
+    }
+    ImageHeader h;
+    memcpy(&h, img.data(), sizeof(h));
+    if (!config_path.empty() && !source_matches(h, config_path)) {
+        cerr << "[!] topology image " << image_path << " is stale: "
+             << config_path << " changed since it was compiled\n";
+        return false;
+    }
+
+    // everything checked; only now touch the caller's config
+    const char *strings = img.data() + h.strings_off;
+    const NodeRecord *records =
+        reinterpret_cast<const NodeRecord *>(img.data() + h.nodes_off);
+    cfg.n = h.n;
+    cfg.minPerActive = h.min_per_active;
+    cfg.maxPerActive = h.max_per_active;
+    cfg.minSendDelay_ms = h.min_send_delay_ms;
+    cfg.snapshotDelay_ms = h.snapshot_delay_ms;
+    cfg.maxNumber = h.max_number;
+    cfg.config_name.assign(strings + h.name_off, h.name_len);
+    cfg.nodes.resize(h.n);
+    for (int i = 0; i < h.n; ++i) {
+        NodeInfo &node = cfg.nodes[i];
+        node.id = records[i].id;
+        node.host.assign(strings + records[i].host_off, records[i].host_len);
+        node.port = records[i].port;
+        node.addr = records[i].addr;
+    }
+    cfg.neighbors.assign(
+        reinterpret_cast<const uint32_t *>(img.data() + h.offsets_off),
+        static_cast<size_t>(h.n),
+        reinterpret_cast<const int *>(img.data() + h.targets_off));
+    return true;
+} // load_topology()
@@ -0,0 +1,266 @@
+/****************************************************************************
+ * file: trace.cpp
+ * author: luke le
+ * description:
+ *     implements the per-thread event rings, the trace file writer and its
+ *     reader.
+ ****************************************************************************/
+#include "trace.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <sys/stat.h>
+
+std::atomic<bool> Tracer::on_(false);
+thread_local Tracer::Ring *Tracer::tls_ring_ = nullptr;
+
+// single producer (its thread), single consumer (the writer)
+struct Tracer::Ring {
+    TraceEvent *slots;
+    size_t mask;
+    uint32_t thread;
+    std::atomic<bool> retired;
+    char pad0[64];
+    std::atomic<size_t> head;
+    char pad1[64];
+    std::atomic<size_t> tail;
+    char pad2[64];
+};
+
+namespace {
+
+    const size_t kRingEvents = 1 << 14;
+    const int kWriteEveryMs = 50;
+    const char kMagic[] = "MAPTRC1\n";
+
+    // marks its thread's ring retired when the thread exits
+    struct RingOwner {
+        std::atomic<bool> *retired;
+        ~RingOwner() {
+            if (retired) retired->store(true, std::memory_order_release);
+        }
+    };
+    thread_local RingOwner t_owner = {nullptr};
+
+    template <typename T>
+    void put(FILE *out, const T &v) {
+        std::fwrite(&v, sizeof(v), 1, out);
+    } // put()
+
+    template <typename T>
+    bool get(FILE *in, T &v) {
+        return std::fread(&v, sizeof(v), 1, in) == 1;
+    } // get()
+
+} // end anonymous namespace
+
+// -------------------- tracer --------------------
+Tracer &Tracer::global() {
+    static Tracer tracer;
+    return tracer;
+} // global()
+
+Tracer::Tracer()
+    : next_thread_(0), stopping_(false), out_(nullptr), dropped_(0) {}
+
+Tracer::~Tracer() {
+    stop();
+    for (size_t i = 0; i < rings_.size(); ++i) {
+        delete[] rings_[i]->slots;
+        delete rings_[i];
+    }
+    rings_.clear();
+    tls_ring_ = nullptr;
+} // ~Tracer()
+
+bool Tracer::start(const std::string &path) {
+    std::lock_guard<std::mutex> lk(control_m_);
+    if (writer_.joinable()) return true;
+    const size_t slash = path.rfind('/');
+    if (slash != std::string::npos) ::mkdir(path.substr(0, slash).c_str(), 0755);
+    out_ = std::fopen(path.c_str(), "wb");
+    if (out_ == nullptr) {
+        std::cerr << "[!] cannot open trace " << path << ": "
+                  << std::strerror(errno) << "\n";
+        return false;
+    }
+    std::fwrite(kMagic, 1, sizeof(kMagic) - 1, out_);
+    put(out_, ShutdownSignal::now_ns());
+    put(out_, ShutdownSignal::wall_ns());
+    names_.clear();
+    stopping_ = false;
+    writer_ = std::thread(&Tracer::writer_loop, this);
+    on_.store(true, std::memory_order_release);
+    return true;
+} // start()
+
+void Tracer::stop() {
+    std::lock_guard<std::mutex> lk(control_m_);
+    if (!writer_.joinable()) return;
+    on_.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> fl(flush_m_);
+        stopping_ = true;
+    }
+    flush_cv_.notify_all();
+    writer_.join();
+    std::fclose(out_);
+    out_ = nullptr;
+    if (dropped_.load())
+        std::cerr << "[~] trace dropped " << dropped_.load()
+                  << " events (ring full)\n";
+} // stop()
+
+Tracer::Ring *Tracer::thread_ring() {
+    Ring *r = new Ring;
+    r->slots = new TraceEvent[kRingEvents];
+    r->mask = kRingEvents - 1;
+    r->retired.store(false);
+    r->head.store(0);
+    r->tail.store(0);
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        r->thread = next_thread_++;
+        rings_.push_back(r);
+    }
+    t_owner.retired = &r->retired;
+    tls_ring_ = r;
+    return r;
+} // thread_ring()
+
+void Tracer::record(const TraceEvent &e) {
+    if (!on()) return;      // a scope that outlived stop()
+    Ring *r = tls_ring_ ? tls_ring_ : thread_ring();
+    const size_t tail = r->tail.load(std::memory_order_relaxed);
+    if (tail - r->head.load(std::memory_order_acquire) > r->mask) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    r->slots[tail & r->mask] = e;
+    r->tail.store(tail + 1, std::memory_order_release);
+} // record()
+
+void Tracer::writer_loop() {
+    std::unique_lock<std::mutex> lk(flush_m_);
+    while (!stopping_) {
+        flush_cv_.wait_for(lk, std::chrono::milliseconds(kWriteEveryMs));
+        lk.unlock();
+        drain();
+        lk.lock();
+    }
+    lk.unlock();
+    drain();
+} // writer_loop()
+
+void Tracer::drain() {
+    std::vector<Ring *> rings;
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        rings = rings_;
+    }
+    std::vector<Ring *> done;
+    for (size_t k = 0; k < rings.size(); ++k) {
+        Ring *r = rings[k];
+        const bool retired = r->retired.load(std::memory_order_acquire);
+        size_t head = r->head.load(std::memory_order_relaxed);
+        const size_t tail = r->tail.load(std::memory_order_acquire);
+        for (; head < tail; ++head) {
+            const TraceEvent &e = r->slots[head & r->mask];
+            std::map<const char *, uint32_t>::iterator id = names_.find(e.name);
+            if (id == names_.end()) {
+                const uint32_t next = static_cast<uint32_t>(names_.size());
+                id = names_.insert(std::make_pair(e.name, next)).first;
+                const uint32_t len = static_cast<uint32_t>(std::strlen(e.name));
+                std::fputc('N', out_);
+                put(out_, next);
+                put(out_, len);
+                std::fwrite(e.name, 1, len, out_);
+            }
+            std::fputc('E', out_);
+            put(out_, id->second);
+            put(out_, r->thread);
+            put(out_, e.ts_ns);
+            put(out_, e.dur_ns);
+            put(out_, e.arg);
+            put(out_, e.node);
+            put(out_, e.peer);
+            std::fputc(e.phase, out_);
+        }
+        r->head.store(head, std::memory_order_release);
+        if (retired) done.push_back(r);
+    }
+    std::fflush(out_);
+
+    if (done.empty()) return;
+    std::lock_guard<std::mutex> lk(m_);
+    for (size_t k = 0; k < done.size(); ++k) {
+        for (size_t i = 0; i < rings_.size(); ++i) {
+            if (rings_[i] != done[k]) continue;
+            rings_.erase(rings_.begin() + i);
+            break;
+        }
+        delete[] done[k]->slots;
+        delete done[k];
+    }
+} // drain()
+
+// -------------------- reader --------------------
+TraceReader::TraceReader() : in_(nullptr), mono_anchor_(0), wall_anchor_(0) {}
+
+TraceReader::~TraceReader() {
+    if (in_) std::fclose(in_);
+} // ~TraceReader()
+
+bool TraceReader::open(const std::string &path) {
+    if (in_) std::fclose(in_);
+    names_.clear();
+    path_ = path;
+    in_ = std::fopen(path.c_str(), "rb");
+    if (in_ == nullptr) {
+        std::cerr << "[!] cannot open " << path << "\n";
+        return false;
+    }
+    char magic[sizeof(kMagic) - 1];
+    if (std::fread(magic, 1, sizeof(magic), in_) != sizeof(magic) ||
+        std::memcmp(magic, kMagic, sizeof(magic)) != 0 ||
+        !get(in_, mono_anchor_) || !get(in_, wall_anchor_)) {
+        std::cerr << "[!] " << path << " is not a trace file\n";
+        std::fclose(in_);
+        in_ = nullptr;
+        return false;
+    }
+    return true;
+} // open()
+
+bool TraceReader::next(TraceRecord &r) {
+    if (in_ == nullptr) return false;
+    int kind;
+    while ((kind = std::fgetc(in_)) == 'N') {
+        uint32_t id, len;
+        std::string name;
+        if (!get(in_, id) || !get(in_, len) || len > 4096) break;
+        name.resize(len);
+        if (len && std::fread(&name[0], 1, len, in_) != len) break;
+        names_[id] = name;
+    }
+    if (kind == EOF) return false;
+
+    uint32_t name;
+    int32_t node, peer;
+    int phase;
+    std::map<uint32_t, std::string>::const_iterator it;
+    if (kind != 'E' || !get(in_, name) || !get(in_, r.thread) ||
+        !get(in_, r.ts_ns) || !get(in_, r.dur_ns) || !get(in_, r.arg) ||
+        !get(in_, node) || !get(in_, peer) || (phase = std::fgetc(in_)) == EOF ||
+        (it = names_.find(name)) == names_.end()) {
+        std::cerr << "[!] " << path_ << ": damaged trace entry\n";
+        return false;
+    }
+    r.name = it->second;
+    r.node = node;
+    r.peer = peer;
+    r.phase = static_cast<char>(phase);
+    return true;
+} // next()
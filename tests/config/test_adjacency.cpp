@@ -0,0 +1,58 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include "config.hpp"
+
+using std::vector;
+
+void fail(const std::string &msg) {
+    std::cerr << "Test failed: " << msg << "\n";
+    std::exit(1);
+}
+
+int main() {
+    // rows are sorted and deduplicated, two arrays hold the whole table
+    Adjacency adj = {{4, 1, 4}, {0}, {}, {2, 0}};
+    if (adj.size() != 4 || adj.entries() != 5) fail("shape");
+    if (adj[0] != vector<int>({1, 4}) || !adj[2].empty() || adj[3][0] != 0)
+        fail("sorted rows");
+    if (adj.offsets() != vector<uint32_t>({0, 2, 3, 3, 5})) fail("offsets");
+
+    // membership by binary search, out-of-range rows are never neighbors
+    if (!adj.contains(0, 4) || adj.contains(0, 2) || adj.contains(9, 0) ||
+        adj.contains(-1, 0))
+        fail("contains");
+
+    // replacing a row shifts the ones after it
+    adj[1] = {3, 2, 3};
+    if (adj[1] != vector<int>({2, 3}) || adj[3] != vector<int>({0, 2}) ||
+        adj.entries() != 6)
+        fail("row assignment");
+    adj.push_back(vector<int>({0}));
+    if (adj.size() != 5 || adj[4] != vector<int>({0})) fail("push_back");
+
+    // row-by-row building, as the loader does it
+    Adjacency built;
+    built.add(2); built.add(1); built.close_row();
+    built.close_row();
+    if (built.size() != 2 || built[0] != vector<int>({1, 2}) || !built[1].empty())
+        fail("close_row");
+
+    // the one-pass bidirectional check on a large ring, then break one edge
+    const int n = 20000;
+    Config cfg;
+    cfg.n = n;
+    vector<vector<int>> ring(n);
+    for (int i = 0; i < n; ++i) {
+        ring[i].push_back((i + 1) % n);
+        ring[i].push_back((i + n - 1) % n);
+    }
+    cfg.neighbors = ring;
+    if (!testable_check_bidirectional_neighbors(cfg)) fail("ring rejected");
+    cfg.neighbors[n / 2] = {n / 2 + 1};
+    if (testable_check_bidirectional_neighbors(cfg)) fail("broken ring accepted");
+
+    std::cout << "All adjacency tests passed!\n";
+    return 0;
+}
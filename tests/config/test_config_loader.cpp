@@ -0,0 +1,71 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib>
+#include <cstdio>   // for std::remove
+#include "config.hpp"
+
+using std::string;
+
+void fail(const string &msg) {
+    std::cerr << "Test failed: " << msg << "\n";
+    std::exit(1);
+}
+
+bool parse_text(const string &content, Config &cfg) {
+    const string path = "test_config_loader.txt";
+    std::ofstream out(path.c_str(), std::ios::binary);
+    out << content;
+    out.close();
+    bool ok = parse_config(path, cfg);
+    std::remove(path.c_str());
+    return ok;
+}
+
+int main() {
+    // CRLF line ends, tabs, comments after values and no final newline
+    Config cfg;
+    string crlf =
+        "# header comment\r\n"
+        "\t3 1 5 10 1000 20  # globals\r\n"
+        "\r\n"
+        "0\tdc01.utdallas.edu 5000 # first\r\n"
+        "1 dc02 5001\r\n"
+        "  2 127.0.0.1\t5002\r\n"
+        "not a line: ignored\r\n"
+        "1 2 # of node 0\r\n"
+        "0 2\r\n"
+        "0 1";
+    if (!parse_text(crlf, cfg)) fail("CRLF config should parse");
+    if (cfg.n != 3 || cfg.maxNumber != 20 || cfg.config_name != "test_config_loader")
+        fail("globals / config name");
+    if (cfg.nodes[0].host != "dc01.utdallas.edu" || cfg.nodes[2].port != 5002 ||
+        cfg.nodes[2].host != "127.0.0.1")
+        fail("node table");
+    if (cfg.neighbors[0].size() != 2 || cfg.neighbors[2][1] != 1)
+        fail("neighbor lists");
+
+    // a node id outside 0..n-1 is an error, not a write past the table
+    Config bad_id;
+    if (parse_text("2 1 5 10 1000 20\n0 a 5000\n7 b 5001\n1\n0\n", bad_id))
+        fail("out-of-range node id accepted");
+
+    // a global that does not fit an int fails like istream extraction did
+    Config overflow;
+    if (parse_text("2 1 5 10 99999999999 20\n0 a 5000\n1 b 5001\n1\n0\n",
+                   overflow))
+        fail("overflowing global accepted");
+
+    // a neighbor list ends at the first token that is not a number
+    Config stop;
+    if (!parse_text("2 1 5 10 1000 20\n0 a 5000\n1 b 5001\n1 x 0\n0\n", stop) ||
+        stop.neighbors[0].size() != 1)
+        fail("neighbor list should stop at a non-number");
+
+    // an empty file has no valid lines
+    Config empty;
+    if (parse_text("", empty)) fail("empty config accepted");
+
+    std::cout << "All config loader tests passed!\n";
+    return 0;
+}
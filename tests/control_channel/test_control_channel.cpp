@@ -0,0 +1,123 @@
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include "control_channel.hpp"
+
+using std::string;
+
+void fail(const string &msg) {
+    std::cerr << "Test failed: " << msg << "\n";
+    std::exit(1);
+}
+
+void test_parse() {
+    ControlEvent ev;
+    if (!parse_control_line("UP 7", ev) || ev.kind != ControlEvent::UP ||
+        ev.id != 7)
+        fail("UP line");
+    if (!parse_control_line("READY 3 2 4 1500", ev) ||
+        ev.kind != ControlEvent::READY || ev.id != 3 || ev.links != 2 ||
+        ev.expected != 4 || ev.setup_us != 1500)
+        fail("READY line");
+    const char *bad[] = {"", "UP", "UP x", "UP -1", "READY 3 2 4",
+                         "GO 5", "UP 1 2"};
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i)
+        if (parse_control_line(bad[i], ev))
+            fail(string("accepted: ") + bad[i]);
+}
+
+struct NodeArgs {
+    string endpoint;
+    int id;
+    bool go;
+    int64_t started_wall_ns;
+};
+
+void run_node(NodeArgs *a) {
+    ShutdownSignal shutdown;
+    ControlClient c;
+    if (!c.connect(a->endpoint) || !c.report_up(a->id) ||
+        !c.report_ready(a->id, 2, 2, 100 + a->id))
+        return;
+    a->go = c.wait_go(shutdown);
+    a->started_wall_ns = ShutdownSignal::wall_ns();
+}
+
+// two nodes report in, wait at the barrier, and start no earlier than the
+// instant the driver picked
+void test_barrier() {
+    ControlServer server;
+    if (!server.listen(0) || server.port() <= 0) fail("listen");
+    const string endpoint = "127.0.0.1:" + std::to_string(server.port());
+
+    NodeArgs a[2];
+    std::vector<std::thread> nodes;
+    for (int i = 0; i < 2; ++i) {
+        a[i].endpoint = endpoint;
+        a[i].id = i;
+        a[i].go = false;
+        a[i].started_wall_ns = 0;
+        nodes.push_back(std::thread(run_node, &a[i]));
+    }
+
+    int ups = 0, readies = 0;
+    const int64_t deadline = ShutdownSignal::now_ns() + 5000000000LL;
+    while (readies < 2 && ShutdownSignal::now_ns() < deadline) {
+        std::vector<ControlEvent> events;
+        server.poll(50, events);
+        for (size_t k = 0; k < events.size(); ++k) {
+            if (events[k].kind == ControlEvent::UP) ++ups;
+            else if (events[k].setup_us != 100 + events[k].id) fail("setup_us");
+            else ++readies;
+        }
+    }
+    if (ups != 2 || readies != 2) fail("reports missing");
+    if (server.connections() != 2) fail("connection count");
+
+    const int64_t start = ShutdownSignal::wall_ns() + 30000000;   // +30 ms
+    if (server.release(start) != 2) fail("GO not sent");
+    for (size_t i = 0; i < nodes.size(); ++i) nodes[i].join();
+    for (int i = 0; i < 2; ++i) {
+        if (!a[i].go) fail("node did not pass the barrier");
+        if (a[i].started_wall_ns < start - 2000000) fail("started early");
+    }
+}
+
+// a driver that goes away releases its nodes; a shutdown does not
+void test_lost_driver_and_shutdown() {
+    NodeArgs a;
+    std::thread node;
+    {
+        ControlServer server;
+        if (!server.listen(0)) fail("listen");
+        a.endpoint = "127.0.0.1:" + std::to_string(server.port());
+        a.id = 5;
+        a.go = false;
+        node = std::thread(run_node, &a);
+        std::vector<ControlEvent> events;
+        while (events.size() < 2) server.poll(50, events);
+    }   // the driver exits without a GO
+    node.join();
+    if (!a.go) fail("node waits on a driver that is gone");
+
+    ControlServer server;
+    if (!server.listen(0)) fail("listen");
+    ControlClient c;
+    if (!c.connect("127.0.0.1:" + std::to_string(server.port()))) fail("connect");
+    ShutdownSignal shutdown;
+    shutdown.trigger();
+    if (c.wait_go(shutdown)) fail("barrier ignored shutdown");
+
+    ControlClient bad;
+    if (bad.connect("no-port-here")) fail("accepted endpoint without port");
+}
+
+int main() {
+    test_parse();
+    test_barrier();
+    test_lost_driver_and_shutdown();
+    std::cout << "All control channel tests passed\n";
+    return 0;
+}
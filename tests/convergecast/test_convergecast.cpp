@@ -0,0 +1,122 @@
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <string>
+#include <cstdlib>
+#include <memory>
+#include "convergecast.hpp"
+
+void fail(const std::string &msg) {
+    std::cerr << "Test failed: " << msg << "\n";
+    std::exit(1);
+}
+
+struct InFlight {
+    int from;
+    StateSend send;
+};
+
+// run one snapshot to completion over an in-memory network, delivering
+// local states in `order`; returns the STATE frames sent
+uint64_t simulate(const Config &cfg, CollectMode mode,
+                  const std::vector<int> &order, int sid,
+                  SnapshotState &global) {
+    std::vector<std::unique_ptr<Convergecast>> nodes;
+    for (int i = 0; i < cfg.n; ++i)
+        nodes.push_back(std::unique_ptr<Convergecast>(
+            new Convergecast(cfg, i, mode)));
+
+    std::deque<InFlight> net;
+    std::vector<StateSend> out;
+    for (size_t k = 0; k < order.size(); ++k) {
+        const int i = order[k];
+        SnapshotState st;
+        st.snapshot_id = sid;
+        st.origin = i;
+        st.nodes = 1;
+        st.active = i % 2;
+        st.in_transit = i;
+        out.clear();
+        nodes[i]->local_done(st, out);
+        for (size_t j = 0; j < out.size(); ++j) {
+            InFlight f = {i, out[j]};
+            net.push_back(f);
+        }
+        // interleave: deliver one pending frame per local completion
+        if (!net.empty()) {
+            InFlight f = net.front();
+            net.pop_front();
+            out.clear();
+            nodes[f.send.to]->received(f.from, f.send.state, out);
+            for (size_t j = 0; j < out.size(); ++j) {
+                InFlight g = {f.send.to, out[j]};
+                net.push_back(g);
+            }
+        }
+    }
+    while (!net.empty()) {
+        InFlight f = net.front();
+        net.pop_front();
+        out.clear();
+        nodes[f.send.to]->received(f.from, f.send.state, out);
+        for (size_t j = 0; j < out.size(); ++j) {
+            InFlight g = {f.send.to, out[j]};
+            net.push_back(g);
+        }
+    }
+
+    if (!nodes[0]->pop_complete(global)) fail("root did not complete");
+    SnapshotState extra;
+    if (nodes[0]->pop_complete(extra)) fail("root completed twice");
+    for (int i = 1; i < cfg.n; ++i)
+        if (nodes[i]->pop_complete(extra)) fail("non-root completed");
+
+    uint64_t sent = 0;
+    for (int i = 0; i < cfg.n; ++i) sent += nodes[i]->sent();
+    return sent;
+}
+
+int main() {
+    // topology of ds/config.txt: 5 nodes, 6 undirected edges
+    Config cfg;
+    cfg.n = 5;
+    cfg.neighbors = {{1, 4}, {0, 2, 3}, {1, 3}, {1, 2, 4}, {0, 3}};
+
+    const int orders[][5] = {{0, 1, 2, 3, 4}, {4, 3, 2, 1, 0}, {2, 0, 4, 1, 3}};
+    for (int o = 0; o < 3; ++o) {
+        std::vector<int> order(orders[o], orders[o] + 5);
+        SnapshotState tree, flood;
+        uint64_t tree_msgs = simulate(cfg, COLLECT_TREE, order, 7, tree);
+        uint64_t flood_msgs = simulate(cfg, COLLECT_FLOOD, order, 7, flood);
+
+        // nodes 1 and 3 are active, in-transit totals 0+1+2+3+4
+        if (tree.snapshot_id != 7 || tree.nodes != 5 || tree.active != 2 ||
+            tree.in_transit != 10)
+            fail("tree aggregate");
+        if (flood.nodes != tree.nodes || flood.active != tree.active ||
+            flood.in_transit != tree.in_transit)
+            fail("flood aggregate differs from tree");
+
+        // one record per tree edge vs. every state over every channel
+        if (tree_msgs != 4) fail("tree should send n - 1 STATE frames");
+        if (flood_msgs <= tree_msgs) fail("flooding should cost more");
+    }
+
+    // a STATE from a node that is not a child is ignored
+    Convergecast root(cfg, 0);
+    std::vector<StateSend> out;
+    SnapshotState st = {1, 2, 1, 1, 0};
+    root.received(2, st, out);
+    SnapshotState g;
+    if (!out.empty() || root.pop_complete(g)) fail("non-child STATE used");
+
+    // a leaf forwards as soon as its own snapshot is done
+    Convergecast leaf(cfg, 4);
+    SnapshotState mine = {1, 4, 1, 0, 3};
+    leaf.local_done(mine, out);
+    if (out.size() != 1 || out[0].to != 0 || out[0].state.in_transit != 3)
+        fail("leaf forward");
+
+    std::cout << "All convergecast tests passed!\n";
+    return 0;
+}
@@ -0,0 +1,45 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include "spanning_tree.hpp"
+
+void fail(const std::string &msg) {
+    std::cerr << "Test failed: " << msg << "\n";
+    std::exit(1);
+}
+
+int main() {
+    // topology of ds/config.txt
+    Config cfg;
+    cfg.n = 5;
+    cfg.neighbors = {{1, 4}, {0, 2, 3}, {1, 3}, {1, 2, 4}, {0, 3}};
+
+    SpanningTree t;
+    if (!build_spanning_tree(cfg, 0, t)) fail("connected graph rejected");
+    const std::vector<int> parent = {-1, 0, 1, 1, 0};
+    const std::vector<int> depth = {0, 1, 2, 2, 1};
+    if (t.parent != parent) fail("parents");
+    if (t.depth != depth) fail("depths");
+    if (t.children[0] != std::vector<int>({1, 4}) ||
+        t.children[1] != std::vector<int>({2, 3}) || !t.children[4].empty())
+        fail("children");
+    if (t.reachable() != 5 || t.height() != 2) fail("reachable/height");
+
+    // neighbor order in the file must not change the tree
+    cfg.neighbors[0] = {4, 1};
+    SpanningTree t2;
+    build_spanning_tree(cfg, 0, t2);
+    if (t2.parent != parent) fail("tree depends on neighbor order");
+
+    // a disconnected node is reported but the rest is still built
+    cfg.n = 6;
+    cfg.neighbors.push_back(std::vector<int>());
+    SpanningTree t3;
+    if (build_spanning_tree(cfg, 0, t3)) fail("disconnected graph accepted");
+    if (t3.reachable() != 5 || t3.depth[5] != -1 || t3.parent[5] != -1)
+        fail("unreachable node");
+
+    std::cout << "All spanning tree tests passed!\n";
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include "latency_histogram.hpp"
+
+using std::string;
+
+void fail(const string &msg) {
+    std::cerr << "Test failed: " << msg << "\n";
+    std::exit(1);
+}
+
+// every value falls in a bucket that starts at or below it and is at most
+// 1/16 of its power of two wide
+void test_buckets() {
+    for (uint64_t v = 0; v < 100000000; v += v / 64 + 1) {
+        const int b = LatencyHistogram::bucket_of(v);
+        if (b < 0 || b >= LatencyHistogram::kBuckets) fail("bucket range");
+        const uint64_t lo = LatencyHistogram::bucket_floor(b);
+        const uint64_t next = LatencyHistogram::bucket_floor(b + 1);
+        if (lo > v || next <= v) fail("value outside its bucket");
+        if (v >= 16 && (next - lo) * 16 > v) fail("bucket too wide");
+        if (v < 16 && lo != v) fail("small values are not exact");
+    }
+    if (LatencyHistogram::bucket_of(~uint64_t(0)) !=
+        LatencyHistogram::kBuckets - 1)
+        fail("largest value");
+}
+
+// percentiles of 1..10000 us stay within the bucket error
+void test_percentiles() {
+    LatencyHistogram h;
+    if (h.percentile(50) != 0) fail("empty histogram");
+    for (int64_t us = 1; us <= 10000; ++us) h.record(us * 1000);
+    if (h.count() != 10000) fail("count");
+    const double pcts[] = {50, 99, 99.9};
+    for (int i = 0; i < 3; ++i) {
+        const double want = pcts[i] * 100 * 1000;      // ns
+        const double got = static_cast<double>(h.percentile(pcts[i]));
+        if (got < want * 0.94 || got > want * 1.06)
+            fail("p" + std::to_string(pcts[i]) + " = " + std::to_string(got));
+    }
+    if (h.percentile(100) != h.max() || h.max() != 10000000) fail("max");
+
+    h.record(-5);
+    if (h.negatives() != 1 || h.percentile(0) != 0) fail("negative values");
+
+    LatencyHistogram other;
+    other.record(20000000);
+    h.merge(other);
+    if (h.count() != 10002 || h.max() != 20000000 || h.negatives() != 1)
+        fail("merge");
+}
+
+int main() {
+    test_buckets();
+    test_percentiles();
+    std::cout << "All latency histogram tests passed\n";
+    return 0;
+}
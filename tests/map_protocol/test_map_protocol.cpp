@@ -13,9 +13,9 @@ int main() {
     cfg.maxNumber = 5;
     cfg.config_name = "testconfig";
 
-    NodeInfo node0 = {0, "localhost", 4000};
-    NodeInfo node1 = {1, "localhost", 4001};
-    NodeInfo node2 = {2, "localhost", 4002};
+    NodeInfo node0 = {0, "localhost", 4000, 0};
+    NodeInfo node1 = {1, "localhost", 4001, 0};
+    NodeInfo node2 = {2, "localhost", 4002, 0};
     cfg.nodes = {node0, node1, node2};
     cfg.neighbors = {{1,2}, {0,2}, {0,1}};
 
@@ -0,0 +1,102 @@
+#include <iostream>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include "map_protocol.hpp"
+
+const int64_t kMaxExitUs = 100000;   // must exit within 100 ms
+
+void fail(const std::string &msg) {
+    std::cerr << "Test failed: " << msg << "\n";
+    std::exit(1);
+}
+
+void run_node(MapProtocol *mp) {
+    mp->run();
+}
+
+Config make_config(int n, int perActive, int sendDelay_ms) {
+    Config cfg;
+    cfg.n = n;
+    cfg.minPerActive = perActive;
+    cfg.maxPerActive = 2 * perActive;
+    cfg.minSendDelay_ms = sendDelay_ms;
+    cfg.snapshotDelay_ms = 200;
+    cfg.maxNumber = 5 * perActive;
+    cfg.config_name = "testshutdown";
+    return cfg;
+}
+
+int64_t us_since(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - t0).count();
+}
+
+void check_exit(const MapProtocol &mp, int64_t joined_us,
+                const std::string &what) {
+    if (mp.exit_latency_us() < 0 || mp.exit_latency_us() > kMaxExitUs ||
+        joined_us > kMaxExitUs) {
+        fail(what + ": exit latency " + std::to_string(mp.exit_latency_us()) +
+             " us (joined after " + std::to_string(joined_us) + " us)");
+    }
+    std::cout << what << ": exit latency " << mp.exit_latency_us() << " us\n";
+}
+
+// a single isolated node: it binds, finds no neighbors, turns active with
+// nowhere to send and then idles until stop()
+void isolated_node() {
+    Config cfg = make_config(1, 1, 100);
+    NodeInfo node0 = {0, "localhost", 47311, 0};
+    cfg.nodes = {node0};
+    cfg.neighbors = {{}};
+
+    MapProtocol mp(cfg, 0);
+    std::thread t(run_node, &mp);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    const std::chrono::steady_clock::time_point t0 =
+        std::chrono::steady_clock::now();
+    mp.stop();
+    t.join();
+    check_exit(mp, us_since(t0), "isolated node");
+}
+
+// two nodes with a live link, still trading APP frames (and snapshots)
+// when both are stopped: a burst of 100000 sends 1 ms apart is far from
+// over, so the writers, receivers and the snapshot thread have to leave
+// mid-send and mid-receive
+void linked_nodes() {
+    Config cfg = make_config(2, 100000, 1);
+    NodeInfo node0 = {0, "localhost", 47312, 0};
+    NodeInfo node1 = {1, "localhost", 47313, 0};
+    cfg.nodes = {node0, node1};
+    cfg.neighbors = {{1}, {0}};
+
+    MapProtocol mp0(cfg, 0);
+    MapProtocol mp1(cfg, 1);
+    std::thread t0(run_node, &mp0);
+    std::thread t1(run_node, &mp1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+
+    const std::chrono::steady_clock::time_point stopped =
+        std::chrono::steady_clock::now();
+    mp0.stop();
+    mp1.stop();
+    t0.join();
+    t1.join();
+    const int64_t joined_us = us_since(stopped);
+
+    if (mp0.channels() != 1 || mp1.channels() != 1)
+        fail("linked nodes: the link did not come up");
+    check_exit(mp0, joined_us, "linked node 0");
+    check_exit(mp1, joined_us, "linked node 1");
+}
+
+int main() {
+    isolated_node();
+    linked_nodes();
+
+    std::cout << "MapProtocol shutdown test passed.\n";
+    return 0;
+}
@@ -0,0 +1,61 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include "message.hpp"
+
+void fail(const std::string &msg) {
+    std::cerr << "Test failed: " << msg << "\n";
+    std::exit(1);
+}
+
+int main() {
+    const std::vector<int> vc = {3, 0, 7};
+
+    // plain frames are unchanged and carry no annotation
+    std::string plain = encode_app_message(2, vc, "hi");
+    if (plain != "APP|2|3,0,7|hi") fail("plain encoding changed");
+    long long v = 0;
+    if (find_app_annotation(plain, "e", v)) fail("annotation on plain frame");
+
+    // annotated frames decode with the old decoder
+    std::string f = encode_annotated_app_message(
+        2, app_annotation("e", 5) + app_annotation("ts", 123456789012LL),
+        vc, "a|b");
+    int sender = -1;
+    std::vector<int> clock;
+    std::string payload;
+    if (!decode_app_message(f, sender, clock, payload) || sender != 2 ||
+        clock != vc || payload != "a|b")
+        fail("annotated frame does not decode");
+    if (!find_app_annotation(f, "e", v) || v != 5) fail("epoch annotation");
+    if (!find_app_annotation(f, "ts", v) || v != 123456789012LL)
+        fail("timestamp annotation");
+    if (find_app_annotation(f, "x", v)) fail("missing key found");
+
+    // keys are only looked up in the sender field, not in the payload
+    std::string g = encode_app_message(1, vc, ";e=9");
+    if (find_app_annotation(g, "e", v)) fail("annotation read from payload");
+
+    // epoch announcements
+    int epoch = -1;
+    std::string e = encode_epoch_message(4, 17);
+    if (!is_epoch_message(e) || is_app_message(e) || is_marker_message(e))
+        fail("epoch frame type");
+    if (!decode_epoch_message(e, sender, epoch) || sender != 4 || epoch != 17)
+        fail("epoch decode");
+    if (decode_epoch_message("EPOCH|4", sender, epoch)) fail("short epoch");
+
+    // clock offsets for --latency, negative values included
+    long long offset = 0, rtt = 0;
+    std::string o = encode_offset_message(3, -42000, 91000);
+    if (!is_offset_message(o) || is_app_message(o)) fail("offset frame type");
+    if (!decode_offset_message(o, sender, offset, rtt) || sender != 3 ||
+        offset != -42000 || rtt != 91000)
+        fail("offset decode");
+    if (decode_offset_message("OFFSET|3|5", sender, offset, rtt))
+        fail("short offset");
+
+    std::cout << "All APP annotation tests passed!\n";
+    return 0;
+}
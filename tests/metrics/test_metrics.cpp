@@ -0,0 +1,164 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "metrics.hpp"
+
+using std::string;
+
+void fail(const string &msg) {
+    std::cerr << "Test failed: " << msg << "\n";
+    std::exit(1);
+}
+
+bool contains(const string &s, const string &part) {
+    return s.find(part) != string::npos;
+}
+
+struct CountArgs {
+    Metrics *m;
+    int id;
+    int times;
+};
+
+void count(CountArgs *a) {
+    for (int i = 0; i < a->times; ++i) a->m->add(a->id);
+}
+
+void test_counters_across_threads() {
+    Metrics m;
+    const int id = m.counter("t_total", "node=\"1\"", "test counter");
+    if (m.counter("t_total", "node=\"1\"", "again") != id)
+        fail("same name and labels gave a new id");
+    if (m.counter("t_total", "node=\"2\"", "") == id)
+        fail("different labels shared an id");
+
+    CountArgs a = {&m, id, 100000};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) threads.push_back(std::thread(count, &a));
+    for (size_t t = 0; t < threads.size(); ++t) threads[t].join();
+    m.add(id, 5);
+    if (m.value(id) != 400005) fail("counter lost updates");
+
+    // a thread that exited keeps its contribution
+    std::thread(count, &a).join();
+    if (m.value(id) != 500005) fail("exited thread's count dropped");
+
+    // a second registry on the same thread does not share cells
+    Metrics other;
+    const int oid = other.counter("t_total", "node=\"1\"", "");
+    other.add(oid, 3);
+    if (other.value(oid) != 3 || m.value(id) != 500005)
+        fail("registries share cells");
+}
+
+int64_t probe_value(void *ctx, int arg) {
+    return *static_cast<int *>(ctx) + arg;
+}
+
+void test_gauges_probes_and_formats() {
+    Metrics m;
+    const int g = m.gauge("t_depth", "node=\"0\"", "test gauge");
+    m.set(g, 7);
+    m.set(g, 3);
+    if (m.value(g) != 3) fail("gauge");
+
+    int base = 40;
+    const int p = m.probe("t_probe", "node=\"0\",peer=\"1\"", "test probe",
+                          probe_value, &base, 2);
+    if (m.value(p) != 42) fail("probe");
+    m.drop_probes(&base);
+    if (m.value(p) != -1) fail("dropped probe still called");
+
+    const int c = m.counter("t_sent_total", "node=\"0\",peer=\"1\"", "sent");
+    m.counter("t_sent_total", "node=\"0\",peer=\"2\"", "");
+    m.add(c, 9);
+
+    const string text = m.prometheus();
+    if (!contains(text, "# HELP t_depth test gauge\n# TYPE t_depth gauge\n"
+                        "t_depth{node=\"0\"} 3\n"))
+        fail("prometheus gauge:\n" + text);
+    if (!contains(text, "# TYPE t_sent_total counter\n"
+                        "t_sent_total{node=\"0\",peer=\"1\"} 9\n"
+                        "t_sent_total{node=\"0\",peer=\"2\"} 0\n"))
+        fail("prometheus family not contiguous:\n" + text);
+
+    const string json = m.json();
+    if (!contains(json, "{\"name\":\"t_sent_total\",\"labels\":{\"node\":\"0\","
+                        "\"peer\":\"1\"},\"type\":\"counter\",\"value\":9}"))
+        fail("json:\n" + json);
+
+    if (!m.dump("logs_test_metrics.txt", false)) fail("dump");
+    std::ifstream in("logs_test_metrics.txt");
+    std::stringstream dumped;
+    dumped << in.rdbuf();
+    if (dumped.str() != text) fail("dump differs from prometheus()");
+    std::remove("logs_test_metrics.txt");
+}
+
+string scrape(const string &path, const char *request) {
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+        fail("connect to " + path);
+    if (request) (void)::send(fd, request, std::strlen(request), 0);
+    ::shutdown(fd, SHUT_WR);
+    string out;
+    char buf[4096];
+    ssize_t n;
+    while ((n = ::recv(fd, buf, sizeof(buf), 0)) > 0) out.append(buf, n);
+    ::close(fd);
+    return out;
+}
+
+void test_server() {
+    Metrics m;
+    const int c = m.counter("t_frames_total", "node=\"4\"", "frames");
+    m.add(c, 12);
+
+    const string path = "test_metrics.sock";
+    MetricsServer server(m);
+    if (!server.start(path)) fail("server start");
+    if (scrape(path, nullptr) != m.prometheus()) fail("text scrape");
+    m.add(c);
+    if (!contains(scrape(path, "json\n"), "\"value\":13}")) fail("json scrape");
+    server.stop();
+    if (::access(path.c_str(), F_OK) == 0) fail("socket file left behind");
+
+    // a stale socket from a crashed run is replaced; a regular file is not
+    {
+        const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        struct sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+            fail("stale socket setup");
+        ::close(fd);
+    }
+    MetricsServer again(m);
+    if (!again.start(path)) fail("stale socket not replaced");
+    again.stop();
+    std::ofstream(path.c_str()) << "not a socket";
+    MetricsServer refused(m);
+    if (refused.start(path)) fail("replaced a regular file");
+    std::remove(path.c_str());
+}
+
+int main() {
+    test_counters_across_threads();
+    test_gauges_probes_and_formats();
+    test_server();
+    std::cout << "All metrics tests passed\n";
+    return 0;
+}
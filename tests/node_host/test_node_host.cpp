@@ -0,0 +1,110 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include "cut_checker.hpp"
+#include "node_host.hpp"
+#include "snapshot_log.hpp"
+#include "topology_gen.hpp"
+
+using std::string;
+
+void fail(const string &msg) {
+    std::cerr << "Test failed: " << msg << "\n";
+    std::exit(1);
+}
+
+void test_parse_node_ids() {
+    std::vector<int> ids;
+    if (!parse_node_ids("0-3,7,9-10", ids)) fail("list rejected");
+    const int want[] = {0, 1, 2, 3, 7, 9, 10};
+    if (ids != std::vector<int>(want, want + 7)) fail("list parsed wrong");
+
+    const char *bad[] = {"", "3-1", "1,,2", "a", "1-", "-1", "2,x"};
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i) {
+        std::vector<int> out;
+        if (parse_node_ids(bad[i], out))
+            fail(string("accepted bad list: ") + bad[i]);
+    }
+}
+
+Config small_torus(const string &name) {
+    TopologySpec spec;
+    spec.kind = TOPO_TORUS;
+    spec.n = 16;
+    Config cfg;
+    if (!generate_topology(spec, cfg)) fail("no torus");
+    cfg.config_name = name;
+    cfg.minPerActive = 2;
+    cfg.maxPerActive = 4;
+    cfg.minSendDelay_ms = 1;
+    cfg.snapshotDelay_ms = 5;
+    cfg.maxNumber = 30;
+    return cfg;
+}
+
+// every node halts on its own and every recorded snapshot is a consistent
+// cut, with all frames going through the host's mailboxes
+void test_hosted_run() {
+    const Config cfg = small_torus("test_node_host");
+    std::vector<int> ids;
+    for (int i = 0; i < cfg.n; ++i) ids.push_back(i);
+    Options opts;
+    opts.snapshot_writer.binary = true;
+
+    NodeHost host(cfg, ids, opts, 3);
+    if (host.workers() != 3) fail("worker count");
+    if (!host.run()) fail("run failed");
+    if (host.frames() == 0) fail("no frames passed in memory");
+
+    std::vector<std::vector<std::vector<int> > > clocks(cfg.n);
+    size_t records = static_cast<size_t>(-1);
+    long long app_sent = 0;
+    for (int i = 0; i < cfg.n; ++i) {
+        const string base = "logs/test_node_host-" + std::to_string(i);
+        std::ifstream halt((base + ".halt").c_str());
+        long long id, depth, detected, halted, exited, quiet, sent;
+        if (!(halt >> id >> depth >> detected >> halted >> exited >> quiet >>
+              sent))
+            fail("node " + std::to_string(i) + " wrote no halt record");
+        // termination can only be detected once every node went quiet
+        if (quiet > detected) fail("node active after termination");
+        app_sent += sent;
+        SnapshotReader r;
+        if (!r.open(base + ".snap")) fail("no snapshot log");
+        while (r.next()) clocks[i].push_back(r.clock());
+        if (clocks[i].size() < records) records = clocks[i].size();
+    }
+    if (records < 2) fail("too few snapshots recorded");
+    if (app_sent == 0) fail("halt records count no APP frames");
+
+    CutChecker checker;
+    std::vector<int> matrix(cfg.n * cfg.n);
+    for (size_t k = 0; k < records; ++k) {
+        for (int j = 0; j < cfg.n; ++j)
+            for (int i = 0; i < cfg.n; ++i)
+                matrix[j * cfg.n + i] = clocks[j][k][i];
+        CutViolation v;
+        if (!checker.check(matrix.data(), cfg.n, v))
+            fail("snapshot " + std::to_string(k) + " is not a consistent cut");
+    }
+}
+
+void test_bad_ids() {
+    const Config cfg = small_torus("test_node_host_bad");
+    std::vector<int> ids;
+    ids.push_back(0);
+    ids.push_back(16);
+    if (NodeHost(cfg, ids, Options(), 1).run()) fail("ran an id outside n");
+    ids.back() = 0;
+    if (NodeHost(cfg, ids, Options(), 1).run()) fail("ran an id twice");
+}
+
+int main() {
+    test_parse_node_ids();
+    test_hosted_run();
+    test_bad_ids();
+    std::cout << "All node host tests passed\n";
+    return 0;
+}
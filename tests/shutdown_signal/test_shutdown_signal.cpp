@@ -0,0 +1,72 @@
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include <unistd.h>
+#include "shutdown_signal.hpp"
+
+// every thread blocks forever on a pipe that never becomes readable; only
+// the shutdown signal can release it
+void wait_on_pipe(const ShutdownSignal *sig, int fd,
+                  ShutdownSignal::WaitResult *out) {
+    *out = sig->wait_readable(fd, -1);
+}
+
+int main() {
+    const int kThreads = 8;
+    const int64_t kMaxWakeUs = 50000;   // 50 ms for all threads to exit
+
+    ShutdownSignal sig;
+    if (sig.triggered() || sig.wait_for(0)) {
+        std::cerr << "Test failed: new signal reports triggered\n";
+        std::exit(1);
+    }
+
+    // --- Test 1: timeout without trigger ---
+    int fds[2];
+    if (::pipe(fds) != 0) {
+        std::cerr << "Test failed: pipe()\n";
+        std::exit(1);
+    }
+    if (sig.wait_readable(fds[0], 10) != ShutdownSignal::WAIT_TIMEOUT) {
+        std::cerr << "Test failed: expected timeout\n";
+        std::exit(1);
+    }
+
+    // --- Test 2: one trigger wakes all blocked threads at once ---
+    std::vector<ShutdownSignal::WaitResult> results(
+        kThreads, ShutdownSignal::WAIT_TIMEOUT);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kThreads; ++i)
+        threads.push_back(std::thread(wait_on_pipe, &sig, fds[0], &results[i]));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    sig.trigger();
+    for (size_t i = 0; i < threads.size(); ++i) threads[i].join();
+    const int64_t us = (ShutdownSignal::now_ns() - sig.triggered_at_ns()) / 1000;
+
+    for (int i = 0; i < kThreads; ++i) {
+        if (results[i] != ShutdownSignal::WAIT_SHUTDOWN) {
+            std::cerr << "Test failed: thread " << i << " not woken by shutdown\n";
+            std::exit(1);
+        }
+    }
+    if (us > kMaxWakeUs) {
+        std::cerr << "Test failed: wakeup took " << us << " us\n";
+        std::exit(1);
+    }
+
+    // --- Test 3: stays triggered for late waiters ---
+    if (!sig.wait_for(-1) ||
+        sig.wait_readable(fds[0], -1) != ShutdownSignal::WAIT_SHUTDOWN) {
+        std::cerr << "Test failed: late waiter blocked\n";
+        std::exit(1);
+    }
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+    std::cout << "All ShutdownSignal tests passed! (wake latency "
+              << us << " us)\n";
+    return 0;
+}
@@ -0,0 +1,57 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include "snapshot_manager.hpp"
+
+void fail(const std::string &msg) {
+    std::cerr << "Test failed: " << msg << "\n";
+    std::exit(1);
+}
+
+int main() {
+    SnapshotManager sm(1, "testcl", 3, 128);
+    sm.set_channels({0, 2});
+
+    if (sm.recording()) fail("recording before any snapshot");
+
+    // node 1 receives the first marker of snapshot 1 from node 0
+    std::vector<int> vc = {3, 4, 0};
+    sm.begin_snapshot(1, vc, true);
+    if (!sm.recording() || !sm.has_begun(1) || sm.has_begun(2))
+        fail("begin_snapshot state");
+    if (sm.close_channel(0, 1)) fail("snapshot done with channel 2 open");
+
+    // APP traffic: channel 0 is closed, channel 2 is still being recorded
+    sm.record_in_transit(0, "APP|0|4,0,0|");
+    sm.record_in_transit(2, "APP|2|0,0,1|");
+    sm.record_in_transit(2, "APP|2|0,0,2|");
+
+    std::vector<std::string> frames;
+    if (!sm.channel_frames(2, frames) || frames.size() != 2)
+        fail("channel 2 should hold two in-transit frames");
+    if (!sm.channel_frames(0, frames) || !frames.empty())
+        fail("closed channel 0 must not record");
+
+    // a marker for an unknown snapshot id is ignored
+    if (sm.close_channel(2, 7)) fail("foreign marker closed a channel");
+
+    if (!sm.close_channel(2, 1)) fail("last marker should finish snapshot");
+    if (sm.recording()) fail("still recording after last marker");
+    if (sm.close_channel(2, 1)) fail("duplicate marker reported completion");
+
+    SnapshotResult r = sm.finish_snapshot();
+    if (r.id != 1 || r.vc != vc || !r.active || r.in_transit != 2 ||
+        r.per_channel[0] != 0 || r.per_channel[2] != 2)
+        fail("snapshot result mismatch");
+    if (sm.completed() != 1) fail("completed count");
+
+    // a node with no channels finishes as soon as it begins
+    SnapshotManager lone(0, "testcl", 1);
+    lone.set_channels(std::vector<int>());
+    lone.begin_snapshot(1, std::vector<int>(1, 5), false);
+    if (!lone.all_channels_closed()) fail("lone node should be done");
+
+    std::cout << "All Chandy-Lamport SnapshotManager tests passed!\n";
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include "channel_recorder.hpp"
+
+void fail(const std::string &msg) {
+    std::cerr << "Test failed: " << msg << "\n";
+    std::exit(1);
+}
+
+int main() {
+    // --- Test 1: small channel stays in memory ---
+    {
+        ChannelRecorder rec(1024, "test_channel_mem.spill");
+        rec.append("APP|1|1,0|a");
+        rec.append("APP|1|2,0|b");
+        std::vector<std::string> out;
+        if (!rec.read_all(out) || out.size() != 2 || out[0] != "APP|1|1,0|a" ||
+            out[1] != "APP|1|2,0|b")
+            fail("in-memory records not read back in order");
+        if (rec.spilled() != 0) fail("nothing should spill");
+    }
+
+    // --- Test 2: memory stays bounded, order survives spill + wraparound ---
+    {
+        const size_t kLimit = 64;
+        ChannelRecorder rec(kLimit, "test_channel_spill.spill");
+        std::vector<std::string> sent;
+        for (int i = 0; i < 200; ++i) {
+            std::string frame = "APP|2|" + std::to_string(i) + "|payload";
+            sent.push_back(frame);
+            rec.append(frame);
+            if (rec.bytes_in_memory() > kLimit) fail("ring exceeded its limit");
+        }
+        if (rec.count() != sent.size()) fail("count mismatch");
+        if (rec.spilled() == 0) fail("expected records to spill");
+
+        std::vector<std::string> out;
+        if (!rec.read_all(out) || out != sent)
+            fail("spilled records out of order");
+
+        // a frame larger than the ring goes straight to disk
+        std::string big(256, 'x');
+        rec.append(big);
+        sent.push_back(big);
+        if (!rec.read_all(out) || out != sent) fail("oversized frame lost");
+
+        rec.clear();
+        if (rec.count() != 0 || !rec.read_all(out) || !out.empty())
+            fail("clear() left records behind");
+    }
+
+    std::cout << "All ChannelRecorder tests passed!\n";
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+#include "snapshot_writer.hpp"
+
+void fail(const std::string &msg) {
+    std::cerr << "Test failed: " << msg << "\n";
+    std::exit(1);
+}
+
+std::vector<std::string> read_lines(const std::string &path) {
+    std::vector<std::string> lines;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) lines.push_back(line);
+    return lines;
+}
+
+// submit `count` records {i, i+1, i+2} and return the file's lines
+std::vector<std::string> write_records(const std::string &path,
+                                       const SnapshotWriterOptions &opts,
+                                       int count, uint64_t &commits) {
+    SnapshotWriter w(path, opts);
+    for (int i = 0; i < count; ++i) {
+        SnapshotRecord rec;
+        rec.id = i;
+        rec.vc = {i, i + 1, i + 2};
+        w.submit(rec);
+    }
+    w.flush();
+    if (w.records_written() != static_cast<uint64_t>(count))
+        fail("flush() returned before every record was written");
+    commits = w.commits();
+    w.close();
+    return read_lines(path);
+}
+
+int main() {
+    const int kRecords = 100;
+
+    // --- Test 1: async writer groups records and preserves order ---
+    SnapshotWriterOptions async_opts;
+    async_opts.batch = 8;
+    async_opts.flush_ms = 1000;      // only batch size or flush() commit
+    async_opts.ring_capacity = 16;   // small ring exercises the full path
+    uint64_t commits = 0;
+    std::vector<std::string> lines =
+        write_records("test_writer_async.out", async_opts, kRecords, commits);
+    if (lines.size() != static_cast<size_t>(kRecords)) fail("async line count");
+    for (int i = 0; i < kRecords; ++i) {
+        std::string expect = std::to_string(i) + " " + std::to_string(i + 1) +
+                             " " + std::to_string(i + 2);
+        if (lines[i] != expect) fail("async line " + std::to_string(i));
+    }
+    if (commits >= static_cast<uint64_t>(kRecords))
+        fail("async writer did not batch commits");
+
+    // --- Test 2: synchronous mode commits every record itself ---
+    SnapshotWriterOptions sync_opts;
+    sync_opts.async = false;
+    lines = write_records("test_writer_sync.out", sync_opts, 5, commits);
+    if (lines.size() != 5 || lines[4] != "4 5 6" || commits != 5)
+        fail("sync writer output");
+
+    std::remove("test_writer_async.out");
+    std::remove("test_writer_sync.out");
+    std::cout << "All SnapshotWriter tests passed!\n";
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include "snapshot_merge.hpp"
+
+const int kN = 3;
+
+void fail(const std::string &msg) {
+    std::cerr << "Test failed: " << msg << "\n";
+    std::exit(1);
+}
+
+// node j's clock in snapshot k
+std::vector<int> clock_for(int j, int k) {
+    std::vector<int> vc(kN);
+    for (int i = 0; i < kN; ++i) vc[i] = 10 * k + (i == j ? 5 : i);
+    return vc;
+}
+
+std::string path_of(const std::string &ext, int j) {
+    return "test_merge-" + std::to_string(j) + ext;
+}
+
+// node j's file with the given snapshot ids, as SnapshotManager writes it:
+// the initial state under id -1 in a .snap file, as the first line of a
+// .out file
+void write_node(const std::string &ext, int j, const std::vector<int> &ids) {
+    std::ofstream out(path_of(ext, j).c_str(), std::ios::binary);
+    if (ext == ".out") {
+        for (size_t r = 0; r < ids.size(); ++r) {
+            const std::vector<int> vc = clock_for(j, ids[r] < 0 ? 0 : ids[r]);
+            for (int i = 0; i < kN; ++i) out << (i ? " " : "") << vc[i];
+            out << "\n";
+        }
+        return;
+    }
+    SnapshotLogEncoder enc(j, kN, 2);
+    std::string bytes;
+    enc.header(bytes);
+    for (size_t r = 0; r < ids.size(); ++r)
+        enc.record(ids[r], clock_for(j, ids[r] < 0 ? 0 : ids[r]), bytes);
+    enc.footer(bytes);
+    out.write(bytes.data(), bytes.size());
+}
+
+std::vector<std::string> paths(const std::string &ext) {
+    std::vector<std::string> p;
+    for (int j = kN - 1; j >= 0; --j) p.push_back(path_of(ext, j));
+    return p;
+}
+
+// merge the files and expect exactly the snapshots `want`, in order
+bool merged(const std::string &ext, const std::vector<long long> &want,
+            const std::string &what) {
+    SnapshotMerge merge;
+    if (!merge.open(paths(ext))) fail(what + ": open");
+    if (merge.n() != kN) fail(what + ": n");
+    std::vector<int> clocks(kN * kN);
+    long long id = -1;
+    size_t got = 0;
+    while (merge.next(clocks.data(), id)) {
+        if (got == want.size() || id != want[got])
+            fail(what + ": unexpected snapshot " + std::to_string(id));
+        for (int j = 0; j < kN; ++j) {
+            const std::vector<int> row(clocks.begin() + j * kN,
+                                       clocks.begin() + (j + 1) * kN);
+            if (row != clock_for(j, static_cast<int>(id)))
+                fail(what + ": clock of node " + std::to_string(j));
+        }
+        ++got;
+    }
+    if (got != want.size()) fail(what + ": snapshots missing");
+    return merge.finish();
+}
+
+int main() {
+    const std::vector<int> all = {-1, 1, 2, 3};
+    const std::vector<long long> ids = {0, 1, 2, 3};
+
+    // the .snap initial state (id -1) lines up as snapshot 0, like the
+    // first line of a .out file
+    for (int j = 0; j < kN; ++j) {
+        write_node(".snap", j, all);
+        write_node(".out", j, all);
+    }
+    if (!merged(".snap", ids, "snap")) fail("snap: files do not line up");
+    if (!merged(".out", ids, "out")) fail("out: files do not line up");
+
+    // a snapshot one node lacks is skipped and reported
+    write_node(".snap", 1, {-1, 1, 3});
+    if (merged(".snap", {0, 1, 3}, "missing")) fail("missing: not reported");
+
+    // ids must go up within a file
+    write_node(".snap", 1, {-1, 2, 1, 3});
+    SnapshotMerge merge;
+    if (!merge.open(paths(".snap"))) fail("order: open");
+    std::vector<int> clocks(kN * kN);
+    long long id = -1;
+    while (merge.next(clocks.data(), id)) {}
+    if (merge.finish()) fail("order: ids out of order accepted");
+
+    // one file per node id
+    std::vector<std::string> twice = paths(".snap");
+    twice[0] = twice[1];
+    SnapshotMerge dup;
+    if (dup.open(twice)) fail("duplicate node id accepted");
+
+    for (int j = 0; j < kN; ++j) {
+        std::remove(path_of(".snap", j).c_str());
+        std::remove(path_of(".out", j).c_str());
+    }
+    std::cout << "All snapshot merge tests passed!\n";
+    return 0;
+}
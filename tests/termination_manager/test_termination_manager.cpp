@@ -0,0 +1,156 @@
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <string>
+#include <cstdlib>
+#include <random>
+#include <memory>
+#include "message.hpp"
+#include "termination_manager.hpp"
+
+void fail(const std::string &msg) {
+    std::cerr << "Test failed: " << msg << "\n";
+    std::exit(1);
+}
+
+struct Frame {
+    int from;
+    int to;
+    bool app;                  // APP with one credit, else CREDIT
+    std::vector<int> credits;
+};
+
+// MAP over an in-memory network with frames delivered in random order,
+// mirroring MapProtocol: returns the number of CREDIT frames, fails if the
+// root ever claims termination too early or never claims it at all
+uint64_t simulate(const Config &cfg, int max_number, unsigned seed) {
+    SpanningTree tree;
+    if (!build_spanning_tree(cfg, 0, tree)) fail("tree");
+
+    std::vector<std::unique_ptr<TerminationManager>> tm;
+    for (int i = 0; i < cfg.n; ++i)
+        tm.push_back(std::unique_ptr<TerminationManager>(
+            new TerminationManager(i, tree)));
+    std::vector<bool> active(cfg.n, false);
+    std::vector<int> sent(cfg.n, 0);
+    active[0] = true;
+
+    std::mt19937 rng(seed);
+    std::vector<Frame> net;
+    uint64_t credit_frames = 0;
+    bool detected = false;
+
+    for (;;) {
+        // pick an active node's burst or a frame in flight
+        std::vector<int> ready;
+        for (int i = 0; i < cfg.n; ++i)
+            if (active[i]) ready.push_back(i);
+        const size_t choices = ready.size() + net.size();
+        if (choices == 0) break;
+        size_t c = std::uniform_int_distribution<size_t>(0, choices - 1)(rng);
+
+        int passive = -1;
+        if (c < ready.size()) {
+            const int i = ready[c];
+            const int burst = 1 + static_cast<int>(rng() % 3);
+            for (int k = 0; k < burst && sent[i] < max_number; ++k) {
+                const NeighborRange nbs = cfg.neighbors[i];
+                Frame f = {i, nbs[rng() % nbs.size()], true,
+                           std::vector<int>(1, tm[i]->split_credit())};
+                if (f.credits[0] < 0) fail("active node without weight");
+                net.push_back(f);
+                ++sent[i];
+            }
+            active[i] = false;
+            passive = i;
+        } else {
+            const size_t at = c - ready.size();
+            Frame f = net[at];
+            net.erase(net.begin() + at);
+            if (f.app) {
+                tm[f.to]->receive_credit(f.credits[0]);
+                if (!active[f.to] && sent[f.to] < max_number)
+                    active[f.to] = true;
+            } else {
+                tm[f.to]->receive_returned(f.credits);
+            }
+            if (!active[f.to]) passive = f.to;
+        }
+
+        if (passive >= 0) {
+            Frame back = {passive, tm[passive]->parent(), false,
+                          std::vector<int>()};
+            if (tm[passive]->release(back.credits)) {
+                net.push_back(back);
+                ++credit_frames;
+            }
+        }
+
+        bool app_in_flight = false;
+        for (size_t k = 0; k < net.size(); ++k) app_in_flight |= net[k].app;
+        bool any_active = false;
+        for (int i = 0; i < cfg.n; ++i) any_active |= active[i];
+
+        if (!active[0] && tm[0]->holds_all()) {
+            if (any_active || app_in_flight) fail("termination detected early");
+            detected = true;
+        }
+    }
+    if (!detected) fail("termination never detected");
+    return credit_frames;
+}
+
+int main() {
+    // topology of ds/config.txt: 5 nodes, 6 undirected edges
+    Config cfg;
+    cfg.n = 5;
+    cfg.neighbors = {{1, 4}, {0, 2, 3}, {1, 3}, {1, 2, 4}, {0, 3}};
+
+    for (unsigned seed = 1; seed <= 200; ++seed) {
+        if (simulate(cfg, 1 + seed % 40, seed) == 0)
+            fail("passive nodes returned no credit");
+    }
+
+    // splitting halves the smallest credit and adding carries
+    SpanningTree tree;
+    build_spanning_tree(cfg, 0, tree);
+    TerminationManager root(0, tree);
+    if (!root.holds_all() || root.weight() != 1.0) fail("root weight");
+    int a = root.split_credit(), b = root.split_credit();
+    if (a != 1 || b != 2 || root.weight() != 0.25) fail("split");
+    root.receive_credit(b);
+    if (root.weight() != 0.5) fail("carry");
+    root.receive_credit(a);
+    if (!root.holds_all()) fail("weight not recovered");
+
+    // the root keeps its weight; other nodes give all of it up
+    std::vector<int> out;
+    if (root.release(out)) fail("root released weight");
+    TerminationManager leaf(4, tree);
+    if (leaf.parent() != 0 || leaf.release(out)) fail("leaf starts empty");
+    leaf.receive_credit(3);
+    leaf.receive_credit(5);
+    if (!leaf.release(out) || out.size() != 2 || leaf.weight() != 0.0)
+        fail("leaf release");
+
+    // credits survive the wire format
+    int sender = -1;
+    std::vector<int> ks;
+    if (!decode_credit_message(encode_credit_message(4, out), sender, ks) ||
+        sender != 4 || ks != out)
+        fail("CREDIT round trip");
+    long long w = -1;
+    if (!find_app_annotation(encode_annotated_app_message(
+                                 2, app_annotation("w", 40), {1, 2}, ""),
+                             "w", w) ||
+        w != 40)
+        fail("APP credit annotation");
+    long long detected = -1;
+    if (!decode_halt_message(encode_halt_message(0, 1700000000123456789LL),
+                             sender, detected) ||
+        sender != 0 || detected != 1700000000123456789LL)
+        fail("HALT round trip");
+
+    std::cout << "All termination manager tests passed!\n";
+    return 0;
+}
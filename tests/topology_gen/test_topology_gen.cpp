@@ -0,0 +1,149 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstdio>
+#include "topology_gen.hpp"
+
+using std::string;
+
+void fail(const string &msg) {
+    std::cerr << "Test failed: " << msg << "\n";
+    std::exit(1);
+}
+
+// simple, bidirectional and connected, with the ports and hosts asked for
+void check_graph(const Config &cfg, const TopologySpec &spec,
+                 const string &what) {
+    if (cfg.n != spec.n || static_cast<int>(cfg.neighbors.size()) != spec.n)
+        fail(what + ": size");
+    for (int i = 0; i < cfg.n; ++i) {
+        if (cfg.nodes[i].id != i || cfg.nodes[i].port != spec.base_port + i ||
+            cfg.nodes[i].host != spec.hosts[i % spec.hosts.size()])
+            fail(what + ": node table");
+        const NeighborRange row = cfg.neighbors[i];
+        for (size_t k = 0; k < row.size(); ++k) {
+            if (row[k] == i || row[k] < 0 || row[k] >= cfg.n)
+                fail(what + ": bad neighbor id");
+            if (!cfg.neighbors.contains(row[k], i))
+                fail(what + ": one-way link");
+        }
+    }
+    std::vector<bool> seen(cfg.n, false);
+    std::vector<int> queue(1, 0);
+    seen[0] = true;
+    for (size_t q = 0; q < queue.size(); ++q) {
+        const NeighborRange row = cfg.neighbors[queue[q]];
+        for (size_t k = 0; k < row.size(); ++k) {
+            if (!seen[row[k]]) {
+                seen[row[k]] = true;
+                queue.push_back(row[k]);
+            }
+        }
+    }
+    if (static_cast<int>(queue.size()) != cfg.n) fail(what + ": disconnected");
+}
+
+Config generate(TopologyKind kind, int n, int degree, uint64_t seed,
+                const string &what) {
+    TopologySpec spec;
+    spec.kind = kind;
+    spec.n = n;
+    spec.degree = degree;
+    spec.seed = seed;
+    Config cfg;
+    if (!generate_topology(spec, cfg)) fail(what + ": not generated");
+    check_graph(cfg, spec, what);
+    return cfg;
+}
+
+bool same_graph(const Config &a, const Config &b) {
+    if (a.n != b.n) return false;
+    for (int i = 0; i < a.n; ++i) {
+        if (a.neighbors[i] != std::vector<int>(b.neighbors[i].begin(),
+                                               b.neighbors[i].end()))
+            return false;
+    }
+    return true;
+}
+
+int main() {
+    // fixed shapes
+    Config ring = generate(TOPO_RING, 50, 0, 1, "ring");
+    for (int i = 0; i < 50; ++i)
+        if (ring.neighbors[i].size() != 2) fail("ring degree");
+    Config torus = generate(TOPO_TORUS, 48, 0, 1, "torus");   // 6 x 8
+    for (int i = 0; i < 48; ++i)
+        if (torus.neighbors[i].size() != 4) fail("torus degree");
+    if (!torus.neighbors.contains(0, 8) || !torus.neighbors.contains(0, 40) ||
+        !torus.neighbors.contains(0, 7))
+        fail("torus wraps around");
+    generate(TOPO_TORUS, 13, 0, 1, "prime torus");
+
+    // random kinds, several seeds each
+    for (uint64_t seed = 1; seed <= 20; ++seed) {
+        Config rr = generate(TOPO_RANDOM_REGULAR, 200, 2 + seed % 4, seed,
+                             "random regular");
+        for (int i = 0; i < 200; ++i)
+            if (rr.neighbors[i].size() != 2 + seed % 4)
+                fail("random regular degree");
+        generate(TOPO_ERDOS_RENYI, 300, 1 + seed % 3, seed, "erdos-renyi");
+        Config ba = generate(TOPO_SCALE_FREE, 300, 4, seed, "scale-free");
+        if (ba.neighbors.entries() / 2 != 3 + 2 * (300 - 3))
+            fail("scale-free link count");
+    }
+
+    // the seed decides the graph
+    if (!same_graph(generate(TOPO_ERDOS_RENYI, 500, 4, 7, "er"),
+                    generate(TOPO_ERDOS_RENYI, 500, 4, 7, "er")))
+        fail("same seed, different graph");
+    if (same_graph(generate(TOPO_SCALE_FREE, 500, 4, 7, "ba"),
+                   generate(TOPO_SCALE_FREE, 500, 4, 8, "ba")))
+        fail("different seeds, same graph");
+
+    // impossible parameters are refused
+    TopologySpec bad;
+    Config unused;
+    bad.kind = TOPO_RANDOM_REGULAR;
+    bad.n = 5;
+    bad.degree = 3;   // odd n * d
+    if (generate_topology(bad, unused)) fail("odd n * degree accepted");
+    bad.kind = TOPO_RING;
+    bad.n = 60000;    // ports past 65535
+    if (generate_topology(bad, unused)) fail("port overflow accepted");
+    bad.kind = TOPO_TORUS;
+    bad.n = 12;
+    bad.rows = 5;
+    if (generate_topology(bad, unused)) fail("rows not dividing n accepted");
+
+    // what write_config emits is what parse_config reads
+    TopologySpec spec;
+    spec.kind = TOPO_SCALE_FREE;
+    spec.n = 64;
+    spec.hosts.assign(1, "dc01");
+    spec.hosts.push_back("dc02");
+    Config gen;
+    gen.minPerActive = 1;
+    gen.maxPerActive = 5;
+    gen.minSendDelay_ms = 10;
+    gen.snapshotDelay_ms = 100;
+    gen.maxNumber = 50;
+    if (!generate_topology(spec, gen)) fail("scale-free for round trip");
+    const string path = "test_topology_gen.txt";
+    {
+        std::ofstream out(path.c_str());
+        write_config(out, gen, "round trip");
+    }
+    Config parsed;
+    if (!parse_config(path, parsed)) fail("generated config does not parse");
+    std::remove(path.c_str());
+    if (!same_graph(gen, parsed) || parsed.maxNumber != 50 ||
+        parsed.snapshotDelay_ms != 100 || parsed.nodes[1].host != "dc02" ||
+        parsed.nodes[63].port != 10063)
+        fail("round trip");
+
+    std::cout << "All topology generator tests passed!\n";
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <arpa/inet.h>
+#include "topology_image.hpp"
+
+using std::string;
+
+void fail(const string &msg) {
+    std::cerr << "Test failed: " << msg << "\n";
+    std::exit(1);
+}
+
+void write_file(const string &path, const string &content) {
+    std::ofstream out(path.c_str(), std::ios::binary);
+    out << content;
+}
+
+string read_file(const string &path) {
+    std::ifstream in(path.c_str(), std::ios::binary);
+    return string(std::istreambuf_iterator<char>(in),
+                  std::istreambuf_iterator<char>());
+}
+
+// move the mtime without changing the content
+void touch_later(const string &path) {
+    struct timeval tv[2];
+    gettimeofday(&tv[0], nullptr);
+    tv[0].tv_sec += 5;
+    tv[1] = tv[0];
+    utimes(path.c_str(), tv);
+}
+
+int main() {
+    const string config = "test_topology_image.txt";
+    const string image = "test_topology_image.topo";
+    const string text =
+        "4 1 5 10 1000 20\n"
+        "0 127.0.0.1 5000\n"
+        "1 127.0.0.1 5001\n"
+        "2 10.1.2.3 5002\n"
+        "3 127.0.0.1 5003\n"
+        "3 1 # of node 0\n"
+        "0 2\n"
+        "1 3\n"
+        "0 2\n";
+    write_file(config, text);
+    if (!compile_topology(config, image)) fail("compile");
+
+    // the image describes exactly what parse_config reads
+    Config parsed, loaded;
+    if (!parse_config(config, parsed)) fail("parse");
+    if (!load_topology(image, config, loaded)) fail("load");
+    if (loaded.n != 4 || loaded.minPerActive != 1 || loaded.maxPerActive != 5 ||
+        loaded.minSendDelay_ms != 10 || loaded.snapshotDelay_ms != 1000 ||
+        loaded.maxNumber != 20 || loaded.config_name != parsed.config_name)
+        fail("globals");
+    for (int i = 0; i < 4; ++i) {
+        if (loaded.nodes[i].id != i ||
+            loaded.nodes[i].host != parsed.nodes[i].host ||
+            loaded.nodes[i].port != parsed.nodes[i].port)
+            fail("node table");
+        if (loaded.neighbors[i] != std::vector<int>(parsed.neighbors[i].begin(),
+                                                    parsed.neighbors[i].end()))
+            fail("neighbor table");
+    }
+    if (loaded.nodes[2].addr != inet_addr("10.1.2.3") ||
+        parsed.nodes[2].addr != 0)
+        fail("addresses resolved at compile time only");
+    if (!loaded.neighbors.contains(0, 3) || loaded.neighbors.contains(0, 2))
+        fail("membership");
+
+    // a touched but unchanged config still matches by content
+    touch_later(config);
+    Config touched;
+    if (!load_topology(image, config, touched)) fail("touched config rejected");
+
+    // an edited config makes the image stale; cfg is left alone
+    write_file(config, text + "# one more comment\n");
+    Config stale;
+    stale.n = -7;
+    if (load_topology(image, config, stale) || stale.n != -7)
+        fail("stale image accepted");
+    write_file(config, string(text).replace(text.find("5003"), 4, "5004"));
+    touch_later(config);   // same size, new content
+    if (load_topology(image, config, stale)) fail("same-size edit accepted");
+    if (!load_topology(image, "", stale)) fail("no config: image on its own");
+
+    // damaged images are rejected before anything is trusted
+    const string good = read_file(image);
+    string bad = good;
+    bad[bad.size() - 3] ^= 1;
+    write_file(image, bad);
+    if (load_topology(image, "", stale)) fail("corrupt payload accepted");
+    write_file(image, good.substr(0, good.size() - 8));
+    if (load_topology(image, "", stale)) fail("truncated image accepted");
+    write_file(image, "not an image at all, only some text........................"
+                      "............................................................");
+    if (load_topology(image, "", stale)) fail("foreign file accepted");
+    if (load_topology("no-such.topo", "", stale)) fail("missing image");
+
+    // a config that does not parse is not compiled
+    write_file(config, "3 1 5 10 1000 20\n0 a 5000\n1 b 5001\n2 c 5002\n"
+                       "1\n0 2\n0 1\n");
+    if (compile_topology(config, image)) fail("unidirectional config compiled");
+
+    std::remove(config.c_str());
+    std::remove(image.c_str());
+    std::cout << "All topology image tests passed!\n";
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include "trace.hpp"
+
+using std::string;
+
+void fail(const string &msg) {
+    std::cerr << "Test failed: " << msg << "\n";
+    std::exit(1);
+}
+
+void traced_work(int node) {
+    for (int i = 0; i < 1000; ++i) {
+        TraceScope scope(node, "work", i);
+        trace_point('s', node, "app", node + 1, i);
+    }
+}
+
+// events from several threads come back whole, with their names, and the
+// scopes cover their own duration
+void test_round_trip() {
+    const string path = "test_trace.trace";
+    trace_point('i', 0, "before start", -1, 0);      // not recorded
+    if (!Tracer::global().start(path)) fail("start");
+    if (!Tracer::on()) fail("not on after start");
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) threads.push_back(std::thread(traced_work, t));
+    for (size_t t = 0; t < threads.size(); ++t) threads[t].join();
+    trace_point('f', 9, "app", 3, 77);
+    Tracer::global().stop();
+    trace_point('i', 0, "after stop", -1, 0);        // not recorded
+    if (Tracer::global().dropped() != 0) fail("events dropped");
+
+    TraceReader reader;
+    if (!reader.open(path)) fail("open");
+    if (reader.wall_anchor() <= 0 || reader.monotonic_anchor() <= 0)
+        fail("clock anchors");
+    TraceRecord r;
+    int scopes[4] = {0, 0, 0, 0}, flows_out = 0, flows_in = 0;
+    while (reader.next(r)) {
+        if (r.name == "work" && r.phase == 'X' && r.node >= 0 && r.node < 4) {
+            if (r.arg != scopes[r.node]) fail("scope out of order");
+            if (r.dur_ns < 0) fail("negative duration");
+            ++scopes[r.node];
+        } else if (r.name == "app" && r.phase == 's') {
+            if (r.peer != r.node + 1) fail("flow peer");
+            ++flows_out;
+        } else if (r.name == "app" && r.phase == 'f' && r.node == 9 &&
+                   r.peer == 3 && r.arg == 77) {
+            ++flows_in;
+        } else {
+            fail("unexpected event " + r.name);
+        }
+    }
+    for (int t = 0; t < 4; ++t)
+        if (scopes[t] != 1000) fail("scopes lost");
+    if (flows_out != 4000 || flows_in != 1) fail("flow events lost");
+    std::remove(path.c_str());
+}
+
+int main() {
+    test_round_trip();
+    std::cout << "All trace tests passed\n";
+    return 0;
+}
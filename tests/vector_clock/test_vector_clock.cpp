@@ -0,0 +1,85 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include "message.hpp"
+#include "vector_clock.hpp"
+
+void fail(const std::string &msg) {
+    std::cerr << "Test failed: " << msg << "\n";
+    std::exit(1);
+}
+
+// the same receive/merge/tick/send sequence on either clock
+template <typename VC>
+void check_clock(const std::string &what) {
+    VC vc(4);
+    if (vc.size() != 4 || vc.to_vector() != std::vector<int>(4, 0))
+        fail(what + ": starts at zero");
+
+    const uint32_t sent[] = {3, 0, 7, 4294967294u};
+    const std::string in = encode_annotated_app_message(
+        2, app_annotation("w", 5), sent, 4, "");
+    const char *b = nullptr, *e = nullptr;
+    VC clock(4);
+    if (!find_app_clock(in, b, e) || !clock.parse(b, e))
+        fail(what + ": parse");
+    vc.tick(1);
+    vc.merge(clock);
+    vc.tick(1);
+    if (vc[0] != 3 || vc[1] != 2 || vc[2] != 7 || vc[3] != 4294967294u)
+        fail(what + ": merge and tick");
+
+    // what it sends decodes like a vector<int> frame did
+    VC small(4);
+    const char *text = "3,0,7";
+    small.parse(text, text + 5);
+    small.tick(1);
+    const std::string out = encode_annotated_app_message(
+        1, app_annotation("w", 9), small.data(), small.size(), "");
+    int sender = -1;
+    std::vector<int> decoded;
+    std::string payload;
+    long long w = -1;
+    if (!decode_app_message(out, sender, decoded, payload) || sender != 1 ||
+        decoded != std::vector<int>({3, 1, 7, 0}) ||
+        !payload.empty() || !find_app_annotation(out, "w", w) || w != 9)
+        fail(what + ": encode");
+
+    // short clocks leave the rest at 0, long ones are cut, junk is refused
+    const char *short_clock = "5,,6";
+    if (!clock.parse(short_clock, short_clock + 4) ||
+        clock.to_vector() != std::vector<int>({5, 6, 0, 0}))
+        fail(what + ": short clock");
+    const char *long_clock = "1,2,3,4,5,6";
+    if (!clock.parse(long_clock, long_clock + 11) || clock[3] != 4)
+        fail(what + ": long clock");
+    const char *junk[] = {"1,x,3", "1,-2", "4294967296", "1 2"};
+    for (size_t k = 0; k < 4; ++k) {
+        const std::string s = junk[k];
+        if (clock.parse(s.data(), s.data() + s.size()))
+            fail(what + ": accepted " + s);
+    }
+}
+
+int main() {
+    check_clock<DynamicVectorClock>("dynamic");
+    check_clock<FixedVectorClock<4> >("fixed");
+
+    // a dynamic merge of different sizes only covers the common prefix
+    DynamicVectorClock a(3), b(5);
+    const char *five = "9,9,9,9,9";
+    b.parse(five, five + 9);
+    a.merge(b);
+    if (a.to_vector() != std::vector<int>(3, 9)) fail("size mismatch merge");
+
+    // clock text matches the ostringstream encoder byte for byte
+    const std::vector<int> vc = {0, 10, 123456789, 7};
+    const uint32_t raw[] = {0, 10, 123456789, 7};
+    if (encode_annotated_app_message(4, ";e=2", vc, "p") !=
+        encode_annotated_app_message(4, ";e=2", raw, 4, "p"))
+        fail("encoders disagree");
+
+    std::cout << "All vector clock tests passed!\n";
+    return 0;
+}